@@ -3,4 +3,4 @@
 
 # target依存部
 ASM_SOURCES += startup.S 
-C_SOURCES += main.c intr_cntrl.c intr_hadle.c
+C_SOURCES += main.c intr_cntrl.c intr_hadle.c pmu.c vfp.c
@@ -41,5 +41,20 @@
 #define	CPSR_UND_MODE				0x1b 						/*! 未定義モード(特権) */
 #define	CPSR_SYS_MODE				0x1f 						/*! システムモード(特権) */
 
+/*
+ * ~コンテキストフレーム定義~
+ * 割込みの入り口でタスクスタック(システムモード)へ積むコンテキストのワード位置
+ * -SRSでPCとCPSR(SPSR)を積み，その下へr0～r12,r14を積む．RFEでPCとCPSRを同時に復帰するため，この順とする
+ */
+#define CONTEXT_R0					0 							/*! r0 */
+#define CONTEXT_R1					1 							/*! r1 */
+#define CONTEXT_R2					2 							/*! r2 */
+#define CONTEXT_R3					3 							/*! r3 */
+#define CONTEXT_R12					12 							/*! r12 */
+#define CONTEXT_LR					13 							/*! r14(システムモード) */
+#define CONTEXT_PC					14 							/*! 復帰先PC(例外モードのlr) */
+#define CONTEXT_CPSR				15 							/*! 復帰先CPSR(例外モードのspsr) */
+#define CONTEXT_WORDS				16 							/*! コンテキストフレームのワード数 */
+
 
 #endif
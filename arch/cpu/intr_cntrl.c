@@ -8,6 +8,7 @@
 
 /* os/arch/cpu */
 #include "intr_cntrl.h"
+#include "cpu_cntrl.h"
 /* os/kernel */
 #include "kernel/defines.h"
 
@@ -46,6 +47,63 @@ void intc_disable_irq(INTRPT_TYPE irq)
 }
 
 
+/*!
+ * @brief 割込みコントローラ(優先度設定)
+ * @param[in] irq:IRQ番号
+ *	@arg 0~96
+ * @param[in] priority:優先度
+ *	@arg 0(最高)~63(最低)
+ * @param[out] なし
+ * @return なし
+ * @note FIQNIRQビットは0(IRQ)とする
+ */
+void intc_set_priority(INTRPT_TYPE irq, int priority)
+{
+	REG32_WRITE(INTCPS_ILR(irq), (priority & INTC_PRIORITY_MASK) << 2);
+}
+
+
+/*!
+ * @brief 割込みコントローラ(FIQへの振り分け)
+ * @param[in] irq:IRQ番号
+ *	@arg 0~96
+ * @param[out] なし
+ * @return なし
+ * @note FIQは1本のみとするので，優先度は0(最高)とする
+ */
+void intc_set_fiq(INTRPT_TYPE irq)
+{
+	REG32_WRITE(INTCPS_ILR(irq), INTC_ILR_FIQNIRQ);
+}
+
+
+/*!
+ * @brief 割込みコントローラ(全割込みの優先度初期化)
+ * @param[in] なし
+ * @param[out] なし
+ * @return なし
+ * @note ・リセット値は全て優先度0(最高)なので，タイマ以外は下げておく
+ * 			 ・スケジューリング用タイマはFIQへ振り分ける
+ * 			 ・優先度しきい値は無効としておく(ネストした割込みの処理中のみ設定する)
+ */
+void intc_priority_init(void)
+{
+	int irq;
+
+	for (irq = 0; irq < EXTERNAL_INTERRUPT_NUM; irq++) {
+		intc_set_priority((INTRPT_TYPE)irq, INTC_PRIORITY_DEFAULT);
+	}
+	for (irq = INTERRUPT_TYPE_GPT1_IRQ; irq <= INTERRUPT_TYPE_GPT11_IRQ; irq++) {
+		intc_set_priority((INTRPT_TYPE)irq, INTC_PRIORITY_TIMER);
+	}
+	intc_set_priority(INTERRUPT_TYPE_UART3_IRQ, INTC_PRIORITY_SERIAL);
+	intc_set_priority(INTERRUPT_TYPE_SDMA_IRQ_0, INTC_PRIORITY_DMA);
+	intc_set_fiq(INTC_TICK_FIQ);
+
+	REG32_WRITE(INTCPS_THRESHOLD, INTC_THRESHOLD_DISABLE);
+}
+
+
 /*!
  * @brief CPSRの外部割込み(IRQとFIQ)有効化チェック
  * @param[in] なし
@@ -204,3 +262,42 @@ void disable_fiq(void)
 			 						"orr r0, r0, #0x40\n\t"
 			 						"msr cpsr, r0\n");
 }
+
+
+/*!
+ * @brief CPSRのIRQとFIQ無効化(無効化前のCPSRを返す)
+ * @param[in] なし
+ * @param[out] なし
+ * @return 無効化前のCPSR
+ * @note ・ネストした割込みハンドラからカーネルのデータ構造を保護するために使用する
+ * 			 ・スケジューリング用タイマ(FIQ)もレディーを変更するので，FIQも禁止する
+ */
+unsigned long save_disable_irq(void)
+{
+	unsigned long cpsr;
+
+	asm volatile("mrs %0, cpsr\n\t"
+			 "cpsid if\n" : "=r"(cpsr) : : "memory");
+
+	return cpsr;
+}
+
+
+/*!
+ * @brief CPSRのIRQとFIQを無効化前の状態へ戻す
+ * @param[in] cpsr:save_disable_irq()で返却されたCPSR
+ *	@arg 特になし
+ * @param[out] なし
+ * @return なし
+ */
+void restore_irq(unsigned long cpsr)
+{
+	/* 無効化前はFIQ割込み有効の場合 */
+	if (!(cpsr & FIQ_DISABLE)) {
+		asm volatile("cpsie f\n" : : : "memory");
+	}
+	/* 無効化前はIRQ割込み有効の場合 */
+	if (!(cpsr & IRQ_DISABLE)) {
+		asm volatile("cpsie i\n" : : : "memory");
+	}
+}
@@ -15,10 +15,33 @@
 #define INTC_DEFAULT_BASE 0x48200000
 #define INTCPS_SIR_IRQ        (INTC_DEFAULT_BASE + 0x40)
 #define INTCPS_CONTROL        (INTC_DEFAULT_BASE + 0x48)
+#define INTCPS_IRQ_PRIORITY   (INTC_DEFAULT_BASE + 0x60)
+#define INTCPS_THRESHOLD      (INTC_DEFAULT_BASE + 0x68)
+#define INTCPS_ILR(m)         (INTC_DEFAULT_BASE + 0x100 + 0x04 * (m))
 
 #define INTCPS_MIR_CLEAR(n)   (INTC_DEFAULT_BASE + 0x88 + 0x20 * (n))
 #define INTCPS_MIR_SET(n)     (INTC_DEFAULT_BASE + 0x8C + 0x20 * (n))
 
+/*
+ * ~割込み優先度定義~
+ * 0が最高優先度，63が最低優先度．ネストは現在処理中の割込みより優先度が高いもののみ受け付ける
+ */
+#define INTC_PRIORITY_MASK			0x3F 					/*! 優先度のマスク */
+#define INTC_THRESHOLD_DISABLE	0xFF 					/*! 優先度しきい値無効(全優先度を受け付ける) */
+#define INTC_PRIORITY_TIMER			8 						/*! タイマ(スケジューリングに使用するGPT)の優先度 */
+#define INTC_PRIORITY_DMA				24 						/*! sDMA完了割込みの優先度(DMA送信を待つタスクを早く起床させる) */
+#define INTC_PRIORITY_SERIAL		32 						/*! シリアルの優先度 */
+#define INTC_PRIORITY_DEFAULT		63 						/*! その他の優先度 */
+
+/*
+ * ~FIQ定義~
+ * スケジューリングに使用するGPT(ソフトタイマ)はFIQで受け付け，IRQの入り口(優先度しきい値の操作等)を通さない
+ */
+#define INTC_ILR_FIQNIRQ				(1 << 0) 			/*! ILRのFIQNIRQビット(1でFIQ) */
+#define INTC_CONTROL_NEWIRQAGR	(1 << 0) 			/*! 新しいIRQの受け付け */
+#define INTC_CONTROL_NEWFIQAGR	(1 << 1) 			/*! 新しいFIQの受け付け */
+#define INTC_TICK_FIQ						INTERRUPT_TYPE_GPT2_IRQ 	/*! FIQで受け付けるスケジューリング用タイマ */
+
 
 /*! 割込みコントローラ(MIR有効化) */
 extern void intc_enable_irq(INTRPT_TYPE irq);
@@ -26,6 +49,15 @@ extern void intc_enable_irq(INTRPT_TYPE irq);
 /*! 割込みコントローラ(MIR無効化) */
 extern void intc_disable_irq(INTRPT_TYPE irq);
 
+/*! 割込みコントローラ(優先度設定) */
+extern void intc_set_priority(INTRPT_TYPE irq, int priority);
+
+/*! 割込みコントローラ(FIQへの振り分け) */
+extern void intc_set_fiq(INTRPT_TYPE irq);
+
+/*! 割込みコントローラ(全割込みの優先度初期化) */
+extern void intc_priority_init(void);
+
 /*! CPSRの外部割込み(IRQとFIQ)有効化チェック */
 extern int is_ext_intr_enable(void);
 
@@ -44,6 +76,12 @@ extern void enable_irq(void);
 /*! CPSRの無効化 */
 extern void disable_irq(void);
 
+/*! CPSRのIRQとFIQ無効化(無効化前のCPSRを返す) */
+extern unsigned long save_disable_irq(void);
+
+/*! CPSRのIRQとFIQを無効化前の状態へ戻す */
+extern void restore_irq(unsigned long cpsr);
+
 /*! CPSRのFIQ割込み有効化チェック */
 extern int is_fiq_enable(void);
 
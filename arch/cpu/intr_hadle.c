@@ -10,6 +10,7 @@
 #include "cpu_cntrl.h"
 #include "intr_cntrl.h"
 #include "intr_hadle.h"
+#include "vfp.h"
 /* os/kernel */
 #include "kernel/defines.h"
 #include "kernel/kernel.h"
@@ -20,29 +21,71 @@
 #include "target/driver/serial_driver.h"
 
 
+/*! 例外の入り口で受け付けたFIQ(スケジューリング用タイマ)の処理を遅らせたか(_fiq_intrで立てる) */
+volatile UINT32 g_fiq_tick_pending;
+
+
+/*!
+ * @brief 遅らせたFIQ(スケジューリング用タイマ)の処理
+ * @param[in] なし
+ * @param[out] なし
+ * @return なし
+ * @note ・IRQ,SWI,未定義命令,アボートの入り口はコンテキストの保存を終えるまでFIQを禁止しないので，その間に
+ * 				 受け付けたFIQは_fiq_intrが割込み要因のクリアのみ行って戻る．それを全ての例外の出口
+ * 				 (スケジューラの呼び出し前)で処理する
+ * 			 ・FIQ禁止で呼ぶ(タスクのコンテキストは割込まれた例外で保存済みなので，ネストした割込みとして処理する)
+ */
+static void fiq_tick_pending(void)
+{
+	if (g_fiq_tick_pending) {
+		g_fiq_tick_pending = 0;
+		nest_external_intr((INTR_TYPE)INTC_TICK_FIQ);
+	}
+	else {
+		/* 処理なし */
+	}
+}
+
+
 /*!
  * @brief 未定義命令ハンドラ
  * @param[in] sp:スタックポインタ
  *	@arg 90002000~90003000
  * @param[out] なし
  * @return なし
+ * @note VFP/NEON命令の初回使用から戻る場合も，入り口で受け付けたFIQを処理する
+ * 			 (浮動小数点演算のみのタスクでタイマが止まらないようにする)
  */
 void intr_und(unsigned long sp)
 {
 	unsigned long pc, spsr;
 
+	/* VFP/NEON命令の初回使用(レジスタバンクを切り替えて例外命令から再実行) */
+	if (vfp_trap((UINT32 *)sp)) {
+		g_current->intr_info.sp = sp; /* カレントタスクのコンテキストを保存 */
+		fiq_tick_pending(); /* 入り口で受け付けたFIQ */
+		/* レディーが変更された場合 */
+		if (check_intr_resched()) {
+			context_switching(TIMER_INTERRUPT); /* タスクの切り替えを行う(スケジューラとディスパッチャ呼び出し) */
+		}
+		else {
+			/* 処理なし */
+		}
+		return;
+	}
+
 	/* コンテキストから，PC及びSPSRを得る */
-	spsr = *(unsigned long *)(sp + 0);
-	pc = *(unsigned long *)(sp + 12);
+	spsr = ((unsigned long *)sp)[CONTEXT_CPSR];
+	pc = ((unsigned long *)sp)[CONTEXT_PC];
 
-	KERNEL_OUTMSG("undefined instruction at ");
+	KERNEL_FATAL_OUTMSG("undefined instruction at ");
 	/* Thumbモードの場合 */
 	if ((spsr & THUMB_INSTRUCTION)) {
-		KERNEL_OUTVLE((pc - 2), 0); /* 例外を発生させたPCの値を表示 */
+		KERNEL_FATAL_OUTVLE((pc - 2), 0); /* 例外を発生させたPCの値を表示 */
 	}
 	/* ARMモードの場合 */
 	else {
-		KERNEL_OUTVLE((pc - 4), 0); /* 例外を発生させたPCの値を表示 */
+		KERNEL_FATAL_OUTVLE((pc - 4), 0); /* 例外を発生させたPCの値を表示 */
 	}
 	putc('\n');
 
@@ -59,12 +102,11 @@ void intr_und(unsigned long sp)
  */
 void intr_swi(unsigned long sp)
 {
-	ISR_TYPE type;
-	unsigned long pc, spsr;
+	unsigned long type, pc, spsr;
 
 	/* コンテキストから，PC及びSPSRを得る */
-	spsr = *(unsigned long *)(sp + 0);
-	pc = *(unsigned long *)(sp + 12);
+	spsr = ((unsigned long *)sp)[CONTEXT_CPSR];
+	pc = ((unsigned long *)sp)[CONTEXT_PC];
 
 	/* Thumbモードの場合 */
 	if (spsr & THUMB_INSTRUCTION) {
@@ -80,8 +122,16 @@ void intr_swi(unsigned long sp)
 	DEBUG_LEVEL1_OUTVLE(type, 0);
 	DEBUG_LEVEL1_OUTMSG(" out swi number : intr_swi().\n");
 
-	syscall_intr(type, sp); /* ISR呼び出し */
+	/* レジスタ渡しのシステムコールの場合 */
+	if (type >= ISR_RTYPE_BASE) {
+		rsyscall_intr((ISR_TYPE)(type - ISR_RTYPE_BASE), sp); /* ISR呼び出し */
+	}
+	/* パラメータブロック渡しのシステムコールの場合 */
+	else {
+		syscall_intr((ISR_TYPE)type, sp); /* ISR呼び出し */
+	}
 
+	fiq_tick_pending(); /* 入り口で受け付けたFIQ */
 	context_switching(SYSCALL_INTERRUPT); /* タスクの切り替えを行う(スケジューラとディスパッチャ呼び出し) */
 }
 
@@ -98,10 +148,12 @@ void intr_pabort(unsigned long sp)
 	unsigned long pc;
 
 	/* 保存されたコンテキストから，PCを得る */
-	pc = *(unsigned long *)(sp + 12);
+	pc = ((unsigned long *)sp)[CONTEXT_PC];
+
+	fiq_tick_pending(); /* 入り口で受け付けたFIQ */
 
-	KERNEL_OUTMSG("prefetch abort at ");
-	KERNEL_OUTVLE(pc - 4, 0);
+	KERNEL_FATAL_OUTMSG("prefetch abort at ");
+	KERNEL_FATAL_OUTVLE(pc - 4, 0);
 	putc('\n');
 
 	down_system(); /* OSをフリーズ  */
@@ -120,11 +172,13 @@ void intr_dabort(unsigned long sp)
 	unsigned long pc;
 
 	/* 保存されたコンテキストから，PCを得る */
-	pc = *(unsigned long *)(sp + 12);
+	pc = ((unsigned long *)sp)[CONTEXT_PC];
+
+	fiq_tick_pending(); /* 入り口で受け付けたFIQ */
 
 	/* 例外を発生させたPCの値を表示 */
-	KERNEL_OUTMSG("data abort at ");
-	KERNEL_OUTVLE(pc - 8, 0);
+	KERNEL_FATAL_OUTMSG("data abort at ");
+	KERNEL_FATAL_OUTVLE(pc - 8, 0);
 	putc('\n');
 
 	down_system(); /* OSをフリーズ */
@@ -132,24 +186,26 @@ void intr_dabort(unsigned long sp)
 
 
 /*!
- * @brief IRQハンドラ
- * @param[in] sp:スタックポインタ
- *	@arg 90002000~90003000
- * @param[out] なし
- * @return なし
- * @note 割込みコントローラのアサート取り消し
- * 				具体的には，INTCPS_CONTROL[0] NEWIRQAGRビットを1にし，同期バリアを張る
- *				このようにする事で，INTCPS_CONTROL[0] NEWIRQAGRビットを1→CPSRのIRQ割込み有効化の順序が保証される
- *			  これは，IRQのネストが発生を防ぐためである(上記の順序が逆になると，ネストし，割込みハンドラ内で無限ループする)．
+ * @brief IRQの受け付けとネストの許可
+ * @param[out] *p_threshold:受け付け前の優先度しきい値
+ *	@arg NULL以外
+ * @return 受け付けたIRQ番号
+ * @note ・受け付けたIRQの優先度をしきい値とし，それより優先度が高いIRQのみネストできるようにする
+ * 				・INTCPS_CONTROL[0] NEWIRQAGRビットを1にし，同期バリアを張ってからCPSRのIRQを有効化する
+ *				 (この順序が逆になると，同じIRQでネストし，割込みハンドラ内で無限ループする)
+ * 				・FIQ(スケジューリング用タイマ)も有効化し，ハンドラ実行中でもネストさせる
+ *				 (タイマからタスクまでの遅延がシリアル等のハンドラの処理時間に依存しないようにする)
  */
-void intr_irq(unsigned long sp)
+static INTR_TYPE irq_accept(UINT32 *p_threshold)
 {
 	INTR_TYPE type;
 
+	*p_threshold = REG32_READ(INTCPS_THRESHOLD);
+	REG32_WRITE(INTCPS_THRESHOLD, REG32_READ(INTCPS_IRQ_PRIORITY) & INTC_PRIORITY_MASK);
 	type = (INTR_TYPE)REG32_READ(INTCPS_SIR_IRQ) & 0x7F; /* 現在有効化したIRQ番号を取得(INTCPS_SIR_IRQレジスタは7ビット目で管理) */
 	DEBUG_LEVEL1_OUTVLE(type, 0);
 	DEBUG_LEVEL1_OUTMSG(" out interrupt number : intr_irq().\n");
-	external_intr(type, sp);
+
 	/*
 	* 割込みコントローラのアサート取り消し
 	*/
@@ -157,7 +213,123 @@ void intr_irq(unsigned long sp)
 	
 	/* 割込みコントローラとCPSRの同期バリア */
 	__asm__ volatile("mov r0, #0\n\t"
-			 "mcr p15, 0, r0, c7, c10, 4\n");
+			 "mcr p15, 0, r0, c7, c10, 4\n" : : : "r0", "memory");
+
+	asm volatile("cpsie if\n" : : : "memory"); /* 優先度の高いIRQとFIQのネストを許可 */
+
+	return type;
+}
+
+
+/*!
+ * @brief IRQとFIQのネスト禁止と優先度しきい値の復帰
+ * @param[in] threshold:irq_accept()で返却された優先度しきい値
+ *	@arg 特になし
+ * @return なし
+ */
+static void irq_finish(UINT32 threshold)
+{
+	asm volatile("cpsid if\n" : : : "memory");
+	REG32_WRITE(INTCPS_THRESHOLD, threshold);
+}
+
+
+/*!
+ * @brief IRQハンドラ(最外の割込み)
+ * @param[in] sp:スタックポインタ
+ *	@arg 90002000~90003000
+ * @param[out] なし
+ * @return なし
+ * @note ・タスク実行中のIRQはここへくる．コンテキストはタスクスタックへ保存されている
+ * 			 ・ハンドラ実行中は優先度の高いIRQがネストする(intr_irq_nest())
+ * 			 ・スケジューラとディスパッチャは最外の割込みの出口でのみ呼び出す
+ * 			 ・レディーが変更されていなければ，スケジューラを呼ばずに割込まれたタスクへ戻る
+ */
+void intr_irq(unsigned long sp)
+{
+	INTR_TYPE type;
+	UINT32 threshold;
+
+	type = irq_accept(&threshold);
+	external_intr(type, sp);
+	irq_finish(threshold);
+	fiq_tick_pending(); /* 入り口で受け付けたFIQ */
+
+	/* レディーが変更された場合 */
+	if (check_intr_resched()) {
+		context_switching(SERIAL_INTERRUPT); /* タスクの切り替えを行う(スケジューラとディスパッチャ呼び出し) */
+	}
+	else {
+		/* 処理なし */
+	}
+}
+
+
+/*!
+ * @brief IRQハンドラ(ネストした割込み)
+ * @param[in] なし
+ * @param[out] なし
+ * @return なし
+ * @note ・割込みハンドラ実行中(SVCモード)のIRQはここへくる．コンテキストはネストIRQスタックへ保存されている
+ * 			 ・タスクを切り替えずに割込まれたハンドラへ戻る(スケジューラは最外の割込みの出口で呼ばれる)
+ */
+void intr_irq_nest(void)
+{
+	INTR_TYPE type;
+	UINT32 threshold;
+
+	type = irq_accept(&threshold);
+	nest_external_intr(type);
+	irq_finish(threshold);
+	fiq_tick_pending(); /* 入り口で受け付けたFIQ */
+}
+
+
+/*!
+ * @brief FIQハンドラ(スケジューリング用タイマ)
+ * @param[in] sp:スタックポインタ
+ *	@arg 90002000~90003000
+ * @param[out] なし
+ * @return なし
+ * @note ・タスク実行中のFIQのみここへくる(例外の入り口で受け付けたFIQはfiq_tick_pending()で処理する)
+ * 			 ・タイマの割込み要因は入り口(_fiq_intr)でバンクレジスタのみを使用してクリアしている
+ * 			 ・FIQはINTC_TICK_FIQのみなので，INTCPS_SIR_FIQの読み出しと優先度しきい値の操作は行わない
+ */
+void intr_fiq(unsigned long sp)
+{
+	/* 割込みコントローラのアサート取り消し */
+	REG32_WRITE(INTCPS_CONTROL, REG32_READ(INTCPS_CONTROL) | INTC_CONTROL_NEWFIQAGR);
+
+	external_intr((INTR_TYPE)INTC_TICK_FIQ, sp);
+
+	/* レディーが変更された場合 */
+	if (check_intr_resched()) {
+		context_switching(TIMER_INTERRUPT); /* タスクの切り替えを行う(スケジューラとディスパッチャ呼び出し) */
+	}
+	else {
+		/* 処理なし */
+	}
+}
+
+
+/*!
+ * @brief FIQハンドラ(ネストした割込み)
+ * @param[in] なし
+ * @param[out] なし
+ * @return なし
+ * @note ・IRQを許可した割込みハンドラ実行中(SVCモード)のFIQはここへくる．割込まれたハンドラの状態は
+ * 				 SVCモードのスタックへ保存されている
+ * 			 ・タスクを切り替えずに割込まれたハンドラへ戻る(スケジューラは最外の割込みの出口で呼ばれる)
+ * 			 ・戻るとFIQが有効になるので，INTCのFIQの受け付けと同期バリアを先に行う
+ */
+void intr_fiq_nest(void)
+{
+	/* 割込みコントローラのアサート取り消し */
+	REG32_WRITE(INTCPS_CONTROL, REG32_READ(INTCPS_CONTROL) | INTC_CONTROL_NEWFIQAGR);
+
+	/* 割込みコントローラとCPSRの同期バリア */
+	__asm__ volatile("mov r0, #0\n\t"
+			 "mcr p15, 0, r0, c7, c10, 4\n" : : : "r0", "memory");
 
-	context_switching(SERIAL_INTERRUPT); /* タスクの切り替えを行う(スケジューラとディスパッチャ呼び出し) */
+	nest_external_intr((INTR_TYPE)INTC_TICK_FIQ);
 }
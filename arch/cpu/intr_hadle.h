@@ -25,5 +25,14 @@ extern void intr_dabort(unsigned long sp);
 /*! IRQハンドラ */
 extern void intr_irq(unsigned long sp);
 
+/*! IRQハンドラ(ネストした割込み) */
+extern void intr_irq_nest(void);
+
+/*! FIQハンドラ(スケジューリング用タイマ) */
+extern void intr_fiq(unsigned long sp);
+
+/*! FIQハンドラ(ネストした割込み) */
+extern void intr_fiq_nest(void);
+
 
 #endif
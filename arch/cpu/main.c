@@ -8,10 +8,15 @@
 
 /* os/arch/cpu */
 #include "arch/cpu/intr.h"
+#include "arch/cpu/pmu.h"
 /* os/kernel */
 #include "kernel/defines.h"
 #include "kernel/kernel.h"
 #include "kernel/command.h"
+/* os/kernel_svc */
+#include "kernel_svc/defer.h"
+#include "kernel_svc/transfer.h"
+#include "kernel_svc/log_drain.h"
 /* os/c_lib */
 #include "c_lib/lib.h"
 /* os/target/driver */
@@ -36,6 +41,150 @@ ER_ID sample_tsk7_id;
 ER_ID sample_tsk8_id;
 #endif
 
+/*! UARTコマンドの実行を遅延処理へ依頼済みか(確定した行ごとに依頼を積まない) */
+static volatile BOOL sg_uart_command_pending;
+
+
+/*!
+ * @brief sendlogコマンドの実行(転送処理)
+ * @param[in] *arg:sendlogコマンドの引数
+ *	@arg NULL以外
+ * @param[out] なし
+ * @return なし
+ * @note 転送タスクのコンテキストで呼ばれ，送信の終了後にプロンプトを出力する
+ */
+static void uart_sendlog(char *arg)
+{
+	sendlog_command(arg); /* sendlogコマンド(xmodem送信モード)呼び出し */
+	puts("> ");
+}
+
+
+/*!
+ * @brief loadコマンドの実行(転送処理)
+ * @param[in] *arg:使用しない
+ *	@arg 特になし
+ * @param[out] なし
+ * @return なし
+ * @note 転送タスクのコンテキストで呼ばれ，受信の終了後にプロンプトを出力する
+ */
+static void uart_load(char *arg)
+{
+	load_command(); /* loadコマンド(xmodem受信モード)呼び出し */
+	puts("> ");
+}
+
+
+/*!
+ * @brief UARTコマンドの実行(遅延処理)
+ * @param[in] arg:使用しない
+ *	@arg 特になし
+ * @param[out] なし
+ * @return なし
+ * @note ・遅延処理サービスタスクのコンテキストで，行が確定する度に呼ばれる
+ * 			 ・行組み立て(エコーバック，バックスペース)はUARTドライバの受信割込みで行われるので，
+ * 				 ここでは確定した行を受信リングバッファから読み出して実行するだけとする
+ * 			 ・行バッファに収まらない行は，改行まで読み捨てる
+ * 			 ・相手を待って長く止まるコマンド(sendlog,load)は転送タスクへ依頼し，ここでは待たない．
+ * 				 転送中は受信リングバッファを転送処理が使うので，依頼した後と転送中は読み出さない
+ * 			 ・ログ吸い出し中はsendlog,loadを依頼しない(吸い出しはログを消費し，パケットがXMODEMに混ざる)．
+ * 				 転送中はコマンドを読み出さないので，転送中に吸い出しが開始される事はない
+ */
+static void uart_command(int arg)
+{
+  static char buf[32];
+  static BOOL discard;
+  int len;
+
+	sg_uart_command_pending = FALSE; /* 以降に確定した行は再度依頼させる */
+	/* 転送中 */
+	if (transfer_busy()) {
+		return;
+	}
+
+	while ((len = recv_serial(buf, sizeof(buf) - 1, FALSE)) > 0) {
+		/* 改行まで読み出せていない(行バッファに収まらない) */
+		if (buf[len - 1] != '\n') {
+			discard = TRUE;
+			continue;
+		}
+		/* 長すぎる行の終端 */
+		else if (discard) {
+			discard = FALSE;
+			puts("command too long.\n");
+			puts("> ");
+			continue;
+		}
+		else {
+			/* 処理なし */
+		}
+		buf[len - 1] = '\0';
+		/* echoコマンドの場合 */
+		if (!strncmp(buf, "echo ", 5)) {
+			echo_command(buf); /* echoコマンド(標準出力にテキストを出力する)呼び出し */
+		}
+		/* helpコマンドの場合 */
+		else if (!strncmp(buf, "help", 4)) {
+			help_command(&buf[4]); /* helpコマンド呼び出し */
+		}
+#ifdef TSK_LIBRARY
+		/* runコマンドの場合 */
+		else if (!strncmp(buf, "run", 3)) {
+			run_command(&buf[3]); /* runコマンド(タスクセットの起動)呼び出し */
+		}
+#endif
+		/* sendlogの場合(プロンプトは転送タスクが出力する) */
+		else if (!strncmp(buf, "sendlog", 7)) {
+			if (log_drain_busy()) {
+				puts("drain is on, turn it off first.\n");
+			}
+			else if (transfer_request(uart_sendlog, &buf[7]) == E_OK) {
+				return;
+			}
+			else {
+				puts("transfer busy or bad argument.\n");
+			}
+		}
+		/* loadの場合(プロンプトは転送タスクが出力する) */
+		else if (!strncmp(buf, "load", 4)) {
+			if (log_drain_busy()) {
+				puts("drain is on, turn it off first.\n");
+			}
+			else if (transfer_request(uart_load, "") == E_OK) {
+				return;
+			}
+			else {
+				puts("transfer busy.\n");
+			}
+		}
+		/* slabの場合 */
+		else if (!strncmp(buf, "slab", 4)) {
+			slab_command(); /* slabコマンド(スラブキャッシュの統計情報出力)呼び出し */
+		}
+		/* stackの場合 */
+		else if (!strncmp(buf, "stack", 5)) {
+			stack_command(); /* stackコマンド(タスクスタックの最大使用量出力)呼び出し */
+		}
+		/* pmuの場合 */
+		else if (!strncmp(buf, "pmu", 3)) {
+			pmu_command(); /* pmuコマンド(SWIの入り口からディスパッチまでのサイクル数出力)呼び出し */
+		}
+		/* traceの場合 */
+		else if (!strncmp(buf, "trace", 5)) {
+			trace_command(&buf[5]); /* traceコマンド(トレースカテゴリの表示と切り替え)呼び出し */
+		}
+		/* drainの場合 */
+		else if (!strncmp(buf, "drain", 5)) {
+			drain_command(&buf[5]); /* drainコマンド(ログ吸い出しの表示と開始，停止)呼び出し */
+		}
+		/* 本システムに存在しないコマンド */
+		else {
+			puts("command unknown.\n");
+		}
+		puts("> ");
+	}
+}
+
 
 /*!
  * @brief IRQハンドラ
@@ -46,51 +195,32 @@ ER_ID sample_tsk8_id;
  *       (IIRレジスタは下位5ビットで割込みタイプを保持している)
  *       シリアル受信割込み : 0x2
  *       タイムアウト割込み(シリアル受信割込みを有効化すると同時に有効化される) : 0x6
+ *       シリアル送信割込み : 0x1
+ *       割込みハンドラは受信データを受信リングバッファへ移すだけとし，行が確定したら
+ *       コマンドの解析と実行を遅延処理サービスタスクへ依頼する
  */
 void uart_handler(void)
 {
-  unsigned char c;
-  static char buf[32];
-  static int len;
   int it_type;
 
 	it_type = (REG8_READ(UIIR) & 0x3E) >> 1;
-
   if (it_type == 2 || it_type == 6) {
-
-		c = getc(); /* 受信FIFOからデータを読み出す事によって，割込み要因をクリア */
-
-		if (c != '\n') {
-			buf[len++] = c;
-    }
-    else {
-			buf[len++] = '\0';
-			/* echoコマンドの場合 */
-    	if (!strncmp(buf, "echo ", 5)) {
-      	echo_command(buf); /* echoコマンド(標準出力にテキストを出力する)呼び出し */
-    	}
-			/* helpコマンドの場合 */
-   		else if (!strncmp(buf, "help", 4)) {
-     		help_command(&buf[4]); /* helpコマンド呼び出し */
-    	}
-#ifdef TSK_LIBRARY
-			/* runコマンドの場合 */
-			else if (!strncmp(buf, "run", 3)) {
-				run_command(&buf[3]); /* runコマンド(タスクセットの起動)呼び出し */
-			}
-#endif
-			/* sendlogの場合 */
-			else if (!strncmp(buf, "sendlog", 7)) {
-      	sendlog_command(); /* sendlogコマンド(xmodem送信モード)呼び出し */
+		/* 受信FIFOを空になるまで受信リングバッファへ移す事によって，割込み要因をクリア */
+		/* 行が確定した場合のみ(依頼済み，または転送中は積まない) */
+		if (serial_intr_recv() > 0 && !sg_uart_command_pending && !transfer_busy()) {
+			sg_uart_command_pending = TRUE;
+			if (defer_enqueue(uart_command, 0) != E_OK) {
+				sg_uart_command_pending = FALSE;
 			}
-			/* 本システムに存在しないコマンド */
-    	else {
-      	puts("command unknown.\n");
-    	}
-			puts("> ");
-			len = 0;
-    }
+		}
+		else {
+			/* 処理なし */
+		}
   }
+	/* 送信割込み(THR空)の場合 */
+	else if (it_type == 1) {
+		serial_intr_send(); /* 送信リングバッファから送信FIFOバッファへ移す */
+	}
 	else {
 		DEBUG_LEVEL1_OUTMSG(" not uart3 handler : uart_handler().\n");
 	}
@@ -117,6 +247,7 @@ int main(void)
   }
 
   uart3_init(); /* シリアルの初期化 */
+  pmu_init(); /* サイクルカウンタの初期化 */
 
   KERNEL_OUTMSG("kernel boot OK!\n");
 
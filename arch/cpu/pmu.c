@@ -0,0 +1,55 @@
+/*!
+ * @file ターゲット依存部(ARM-Cortex-A8)<モジュール:pmu.o>
+ * @brief パフォーマンスモニタ(PMU)のサイクルカウンタ
+ * @attention gcc4.5.x以外は試していない
+ * @note ・Cortex-A8テクニカルリファレンスマニュアル参照
+ * 			 ・PMU_SWI_PROFILE定義時はstartup.SでSWIの入り口とディスパッチのサイクル数をg_pmu_swiへ記録する
+ */
+
+
+/* os/arch/cpu */
+#include "pmu.h"
+
+
+/*! SWIの入り口からディスパッチまでのサイクル数 */
+PMU_SWI_STAT g_pmu_swi;
+
+
+/*!
+ * @brief サイクルカウンタの初期化
+ * @param[in] なし
+ * @param[out] なし
+ * @return なし
+ * @note サイクルカウンタはCPUクロックで(分周なし)カウントする
+ */
+void pmu_init(void)
+{
+	UINT32 pmcr;
+
+	asm volatile ("mrc p15, 0, %0, c9, c12, 0" : "=r"(pmcr)); /* PMCR読み出し */
+	pmcr = (pmcr | PMCR_E | PMCR_C) & ~PMCR_D;
+	asm volatile ("mcr p15, 0, %0, c9, c12, 0" : : "r"(pmcr)); /* PMCR書き込み */
+	asm volatile ("mcr p15, 0, %0, c9, c12, 1" : : "r"(PMCNTEN_C)); /* PMCNTENSET書き込み */
+
+	g_pmu_swi.entry = 0;
+	g_pmu_swi.last = 0;
+	g_pmu_swi.min = 0xFFFFFFFF;
+	g_pmu_swi.max = 0;
+	g_pmu_swi.count = 0;
+}
+
+
+/*!
+ * @brief サイクルカウンタの読み出し
+ * @param[in] なし
+ * @param[out] なし
+ * @return サイクルカウンタ値
+ */
+UINT32 pmu_read_ccnt(void)
+{
+	UINT32 ccnt;
+
+	asm volatile ("mrc p15, 0, %0, c9, c13, 0" : "=r"(ccnt)); /* PMCCNTR読み出し */
+
+	return ccnt;
+}
@@ -0,0 +1,47 @@
+/*!
+ * @file ターゲット依存部(ARM-Cortex-A8)
+ * @brief パフォーマンスモニタ(PMU)のサイクルカウンタ
+ * @attention gcc4.5.x以外は試していない
+ * @note Cortex-A8テクニカルリファレンスマニュアル参照
+ */
+
+
+#ifndef _PMU_H_INCLUDED_
+#define _PMU_H_INCLUDED_
+
+
+/* os/kernel */
+#include "kernel/defines.h"
+
+
+#define PMCR_E							(1 << 0) 				/*! 全カウンタ有効 */
+#define PMCR_C							(1 << 2) 				/*! サイクルカウンタリセット */
+#define PMCR_D							(1 << 3) 				/*! サイクルカウンタ64分周 */
+#define PMCNTEN_C						(1 << 31) 			/*! サイクルカウンタ有効 */
+
+
+/*!
+ * @brief SWIの入り口からディスパッチまでのサイクル数(PMU_SWI_PROFILE定義時)
+ * @attention メンバの順序はstartup.Sのオフセットと合わせる事
+ */
+typedef struct _pmu_swi_statistics {
+	UINT32 entry;													/*! SWI入り口のサイクルカウンタ値(0の場合は計測中ではない) */
+	UINT32 last;													/*! 最後に計測したサイクル数 */
+	UINT32 min;														/*! 最小サイクル数 */
+	UINT32 max;														/*! 最大サイクル数 */
+	UINT32 count;													/*! 計測回数 */
+} PMU_SWI_STAT;
+
+
+/*! サイクルカウンタの初期化 */
+extern void pmu_init(void);
+
+/*! サイクルカウンタの読み出し */
+extern UINT32 pmu_read_ccnt(void);
+
+
+/*! SWIの入り口からディスパッチまでのサイクル数 */
+extern PMU_SWI_STAT g_pmu_swi;
+
+
+#endif
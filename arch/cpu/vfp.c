@@ -0,0 +1,229 @@
+/*!
+ * @file ターゲット依存部(ARM-Cortex-A8)<モジュール:vfp.o>
+ * @brief VFP/NEONコンテキストの遅延切り替え
+ * @attention gcc4.5.x以外は試していない
+ * @note ・Cortex-A8テクニカルリファレンスマニュアル参照
+ * 			 ・ディスパッチ時はFPEXC.ENを落とすだけで，レジスタバンクの退避と復帰は行わない
+ * 			 ・VFP/NEON命令を最初に実行したタスクは未定義命令例外となり，ここでバンクの所有者を切り替える
+ * 			 ・VFPコンテキストは初回使用時にスラブキャッシュから獲得するので，整数演算のみのタスクはTCBが増えない
+ * 			 ・カーネルは-mfpuなしでビルドするので，カーネル内でVFP/NEONレジスタは使用されない
+ */
+
+
+/* os/arch/cpu */
+#include "vfp.h"
+#include "cpu_cntrl.h"
+/* os/kernel */
+#include "kernel/kernel.h"
+#include "kernel/slab.h"
+/* os/c_lib */
+#include "c_lib/lib.h"
+
+
+/*! FPEXCの書き込み */
+static void vfp_write_fpexc(UINT32 fpexc);
+
+/*! VFP/NEON命令か判定 */
+static BOOL is_vfp_instruction(UINT32 *context);
+
+/*! レジスタバンクの退避 */
+static void vfp_save(VFP_CONTEXT *ctx);
+
+/*! レジスタバンクの復帰 */
+static void vfp_restore(VFP_CONTEXT *ctx);
+
+
+/*! VFPコンテキストのスラブキャッシュ */
+static SLAB_CACHE sg_vfp_cache;
+
+/*! レジスタバンクの所有タスク(NULLの場合は所有者なし) */
+static TCB *sg_vfp_owner = NULL;
+
+/*! FPEXC.ENの状態(ディスパッチごとにFPEXCを書き込まないようにするため) */
+static BOOL sg_vfp_enable = FALSE;
+
+
+/*!
+ * @brief FPEXCの書き込み
+ * @param[in] fpexc:書き込む値
+ * @return なし
+ */
+static void vfp_write_fpexc(UINT32 fpexc)
+{
+	asm volatile (".fpu neon\n\tvmsr fpexc, %0" : : "r"(fpexc));
+	sg_vfp_enable = (fpexc & FPEXC_EN) ? TRUE : FALSE;
+}
+
+
+/*!
+ * @brief VFP/NEON命令か判定
+ * @param[in] *context:未定義命令例外のコンテキスト
+ * 	@arg NULL以外
+ * @return 判定結果
+ *	@retval TRUE:VFP/NEON命令,FALSE:それ以外
+ * @note ・cp10,cp11のコプロセッサ命令，Advanced SIMDのデータ処理命令及びロードストア命令を対象とする
+ * 			 ・戻り番地はARM命令では例外命令+4，Thumb命令では例外命令+2となる
+ */
+static BOOL is_vfp_instruction(UINT32 *context)
+{
+	UINT32 pc = context[CONTEXT_PC];
+	UINT32 inst;
+	UINT16 hw1, hw2;
+
+	/* Thumb命令の場合(VFP/NEON命令は32bit命令) */
+	if (context[CONTEXT_CPSR] & THUMB_INSTRUCTION) {
+		hw1 = *(UINT16 *)(pc - 2);
+		hw2 = *(UINT16 *)pc;
+		return (((hw1 & 0xEC00) == 0xEC00 && (hw2 & 0x0E00) == 0x0A00) ||	/* cp10,cp11 */
+						(hw1 & 0xEF00) == 0xEF00 ||															/* Advanced SIMDデータ処理 */
+						(hw1 & 0xFF10) == 0xF900) ? TRUE : FALSE;							/* Advanced SIMDロードストア */
+	}
+	/* ARM命令の場合 */
+	else {
+		inst = *(UINT32 *)(pc - 4);
+		return ((inst & 0x0C000E00) == 0x0C000A00 ||											/* cp10,cp11 */
+						(inst & 0xFE000000) == 0xF2000000 ||											/* Advanced SIMDデータ処理 */
+						(inst & 0xFF100000) == 0xF4000000) ? TRUE : FALSE;				/* Advanced SIMDロードストア */
+	}
+}
+
+
+/*!
+ * @brief レジスタバンクの退避
+ * @param[out] *ctx:退避先のVFPコンテキスト
+ * 	@arg NULL以外
+ * @return なし
+ * @attention FPEXC.ENが立っている事
+ */
+static void vfp_save(VFP_CONTEXT *ctx)
+{
+	UINT32 *p = ctx->d;
+
+	asm volatile (".fpu neon\n\t"
+								"vstmia %0!, {d0-d15}\n\t"
+								"vstmia %0!, {d16-d31}\n\t"
+								"vmrs %1, fpscr"
+								: "+r"(p), "=r"(ctx->fpscr) : : "memory");
+}
+
+
+/*!
+ * @brief レジスタバンクの復帰
+ * @param[in] *ctx:復帰するVFPコンテキスト
+ * 	@arg NULL以外
+ * @return なし
+ * @attention FPEXC.ENが立っている事
+ */
+static void vfp_restore(VFP_CONTEXT *ctx)
+{
+	UINT32 *p = ctx->d;
+
+	asm volatile (".fpu neon\n\t"
+								"vldmia %0!, {d0-d15}\n\t"
+								"vldmia %0!, {d16-d31}\n\t"
+								"vmsr fpscr, %1"
+								: "+r"(p) : "r"(ctx->fpscr) : "memory");
+}
+
+
+/*!
+ * @brief VFP/NEONの初期化
+ * @param[in] なし
+ * @param[out] なし
+ * @return エラーコード
+ *	@retval E_PAR:スラブキャッシュの生成失敗,E_OK:正常終了
+ * @note cp10,cp11へのアクセスを許可し，FPEXC.ENは落としておく(最初の使用で例外とするため)
+ */
+ER vfp_init(void)
+{
+	UINT32 cpacr;
+
+	asm volatile ("mrc p15, 0, %0, c1, c0, 2" : "=r"(cpacr)); /* CPACR読み出し */
+	cpacr |= CPACR_CP10_CP11;
+	asm volatile ("mcr p15, 0, %0, c1, c0, 2\n\tisb" : : "r"(cpacr)); /* CPACR書き込み */
+
+	vfp_write_fpexc(0);
+	sg_vfp_owner = NULL;
+
+	return slab_cache_create(&sg_vfp_cache, "vfp", sizeof(VFP_CONTEXT), VFP_CONTEXT_NUM, 0, NULL);
+}
+
+
+/*!
+ * @brief ディスパッチするタスクに合わせてVFP/NEONを有効化または無効化
+ * @param[in] *tcb:ディスパッチするタスク
+ * 	@arg NULL以外
+ * @return なし
+ * @note ・context_switching()でスケジューラの後に呼ぶ
+ * 			 ・レジスタバンクの所有タスクへ戻る場合は有効のままとし，例外を発生させない
+ */
+void vfp_switch(TCB *tcb)
+{
+	BOOL enable = (tcb == sg_vfp_owner) ? TRUE : FALSE;
+
+	if (enable != sg_vfp_enable) {
+		vfp_write_fpexc(enable ? FPEXC_EN : 0);
+	}
+}
+
+
+/*!
+ * @brief VFP/NEON命令による未定義命令例外の処理
+ * @param[in,out] *context:未定義命令例外のコンテキスト(例外命令から再実行するようPCを書き換える)
+ * 	@arg NULL以外
+ * @return 処理結果
+ *	@retval TRUE:処理した(例外命令から再実行する),FALSE:VFP/NEON命令ではない，またはVFPコンテキストが確保できない
+ * @note ・FPEXC.ENが立っている状態の例外は本当の未定義命令なので処理しない
+ * 			 ・VFPコンテキストがないタスクはここで獲得し，レジスタバンクを0で初期化する
+ */
+BOOL vfp_trap(UINT32 *context)
+{
+	VFP_CONTEXT *ctx;
+
+	if (sg_vfp_enable || !is_vfp_instruction(context)) {
+		return FALSE;
+	}
+
+	/* 初回使用の場合はVFPコンテキストを獲得 */
+	if ((ctx = g_current->ext_info.vfp) == NULL) {
+		if ((ctx = (VFP_CONTEXT *)slab_alloc(&sg_vfp_cache)) == NULL) {
+			return FALSE;
+		}
+		memset(ctx, 0, sizeof(*ctx));
+		g_current->ext_info.vfp = ctx;
+	}
+
+	vfp_write_fpexc(FPEXC_EN);
+	/* レジスタバンクの所有タスクを切り替える */
+	if (sg_vfp_owner != g_current) {
+		if (sg_vfp_owner != NULL) {
+			vfp_save(sg_vfp_owner->ext_info.vfp);
+		}
+		vfp_restore(ctx);
+		sg_vfp_owner = g_current;
+	}
+
+	/* 例外命令から再実行する */
+	context[CONTEXT_PC] -= (context[CONTEXT_CPSR] & THUMB_INSTRUCTION) ? 2 : 4;
+
+	return TRUE;
+}
+
+
+/*!
+ * @brief タスクのVFP/NEONコンテキストの解放
+ * @param[in] *tcb:排除するタスク
+ * 	@arg NULL以外
+ * @return なし
+ * @note del_tsk(),exd_tsk()でTCBをスラブキャッシュへ返却する前に呼ぶ
+ */
+void vfp_release(TCB *tcb)
+{
+	if (tcb == sg_vfp_owner) {
+		sg_vfp_owner = NULL; /* レジスタバンクは退避しない */
+	}
+	if (tcb->ext_info.vfp != NULL) {
+		slab_free(&sg_vfp_cache, tcb->ext_info.vfp);
+		tcb->ext_info.vfp = NULL;
+	}
+}
@@ -0,0 +1,46 @@
+/*!
+ * @file ターゲット依存部(ARM-Cortex-A8)
+ * @brief VFP/NEONコンテキストの遅延切り替えインターフェース
+ * @attention gcc4.5.x以外は試していない
+ * @note Cortex-A8テクニカルリファレンスマニュアル参照
+ */
+
+
+#ifndef _VFP_H_INCLUDED_
+#define _VFP_H_INCLUDED_
+
+
+/* os/kernel */
+#include "kernel/defines.h"
+#include "kernel/task.h"
+
+
+#define CPACR_CP10_CP11			(0xF << 20) 		/*! cp10,cp11(VFP/NEON)のフルアクセス許可 */
+#define FPEXC_EN						(1 << 30) 			/*! VFP/NEON有効 */
+#define VFP_DREG_NUM				32 							/*! VFPv3-D32/NEONのダブルワードレジスタ数 */
+#define VFP_CONTEXT_NUM			4 							/*! 1スラブあたりのVFPコンテキスト数 */
+
+
+/*!
+ * @brief VFP/NEONコンテキスト(TCBの拡張領域)
+ */
+typedef struct _vfp_context {
+	UINT32 d[VFP_DREG_NUM * 2];						/*! d0～d31 */
+	UINT32 fpscr;													/*! FPSCR */
+} VFP_CONTEXT;
+
+
+/*! VFP/NEONの初期化 */
+extern ER vfp_init(void);
+
+/*! ディスパッチするタスクに合わせてVFP/NEONを有効化または無効化 */
+extern void vfp_switch(TCB *tcb);
+
+/*! VFP/NEON命令による未定義命令例外の処理 */
+extern BOOL vfp_trap(UINT32 *context);
+
+/*! タスクのVFP/NEONコンテキストの解放 */
+extern void vfp_release(TCB *tcb);
+
+
+#endif
@@ -3,7 +3,7 @@
 
 # target非依存部
 # kernel source
-C_SOURCES += kernel.c syscall.c scheduler.c ready.c memory.c task_manage.c intr_manage.c task_sync.c multi_timer.c command.c
+C_SOURCES += kernel.c syscall.c scheduler.c ready.c memory.c task_manage.c intr_manage.c task_sync.c multi_timer.c command.c tlsf.c mempool_manage.c slab.c stack_pool.c kdata.c
 
 # task
 C_SOURCES += init_tsk.c
@@ -10,12 +10,42 @@
 #include "command.h"
 #include "kernel.h"
 #include "syscall.h"
+#include "slab.h"
+#include "stack_pool.h"
+/* os/arch/cpu */
+#include "arch/cpu/pmu.h"
 /* os/kerne/ */
 #include "kernel_svc/log_manage.h"
+#include "kernel_svc/log_drain.h"
+#include "kernel_svc/log_encode.h"
+#include "kernel_svc/loader.h"
 /* os/net */
 #include "net/xmodem.h"
 
 
+/*!
+ * @brief traceコマンドで指定するトレースカテゴリの名前
+ */
+typedef struct {
+	char *name;														/*! カテゴリ名 */
+	UINT32 cat;														/*! トレースカテゴリ(LOG_CAT_*) */
+} TRACE_CATEGORY;
+
+
+/*! トレースカテゴリの名前表("all"はイベントのカテゴリのみで，メッセージは含まない) */
+static const TRACE_CATEGORY sg_trace_cat[] = {
+	{"syscall", LOG_CAT_SYSCALL},
+	{"irq", LOG_CAT_IRQ},
+	{"timer", LOG_CAT_TIMER},
+	{"sched", LOG_CAT_SCHED},
+	{"debug", LOG_CAT_DEBUG_MSG},
+	{"kmsg", LOG_CAT_KERNEL_MSG},
+	{"all", LOG_CAT_TRACE_ALL},
+};
+
+#define TRACE_CATEGORY_NUM				(sizeof(sg_trace_cat) / sizeof(sg_trace_cat[0])) /*! トレースカテゴリ名の数 */
+
+
 #ifdef TSK_LIBRARY
 
 /*! tsk_set1の起動 */
@@ -30,10 +60,6 @@ static void tsk_set3_command(void);
 #endif
 
 
-/*! リンカのシンボルを参照(リンカシンボルに接頭語は付加しない) */
-extern UINT32 _logbuffer_start;
-
-
 /*!
  * @brief echoコマンド
  * @param[in] なし
@@ -61,7 +87,13 @@ void help_command(char *buf)
 	if (*buf == '\0') {
     puts("echo    - out text serial line.\n");
     puts("sendlog - send log file over serial line(xmodem mode)\n");
+    puts("load    - load task image over serial line(xmodem mode) and start it.\n");
     puts("run     - run task sets.\n");
+    puts("slab    - show kernel object slab cache statistics.\n");
+    puts("stack   - show task stack usage(high-water mark).\n");
+    puts("pmu     - show cycles from swi entry to dispatch.\n");
+    puts("trace   - show or switch trace categories.\n");
+    puts("drain   - stream trace events over serial line in the background.\n");
   }
 	/* echo helpメッセージ */
   else if (!strncmp(buf, " echo", 5)) {
@@ -72,7 +104,58 @@ void help_command(char *buf)
   }
 	/* sendlog helpメッセージ */
   else if (!strncmp(buf, " sendlog", 8)) {
-		puts("sendlog - send log file over serial line(xmodem mode)\n");
+		puts("sendlog - send log file over serial line(xmodem mode)\n\n");
+		puts("Usage:\n");
+		puts("sendlog [128 | g] [delta | lz]\n");
+		puts("  1K blocks with CRC-16 if receiver starts with 'C'(xmodem-1k)\n");
+		puts("  128 byte blocks if [128] is given or receiver starts with NAK\n");
+		puts("  streaming without per-block ACK if [g] is given(ymodem-g)\n");
+		puts("  delta and varint encoded if [delta] is given, back-referenced too if [lz]\n");
+		puts("  decode with tools/trace_decode\n");
+  }
+	/* load helpメッセージ */
+  else if (!strncmp(buf, " load", 5)) {
+		puts("load - load task image over serial line(xmodem mode) and start it.\n\n");
+		puts("Usage:\n");
+		puts("load\n");
+		puts("  receive image with xmodem-crc(128 or 1K blocks), check header and CRC-16,\n");
+		puts("  then create and start the task.\n");
+  }
+	/* slab helpメッセージ */
+  else if (!strncmp(buf, " slab", 5)) {
+		puts("slab - show kernel object slab cache statistics.\n\n");
+		puts("Output(hex):\n");
+		puts("  name size stride total inuse peak slabs fails\n");
+  }
+	/* stack helpメッセージ */
+  else if (!strncmp(buf, " stack", 6)) {
+		puts("stack - show task stack usage(high-water mark).\n\n");
+		puts("Output(hex):\n");
+		puts("  id name size used\n");
+  }
+	/* pmu helpメッセージ */
+  else if (!strncmp(buf, " pmu", 4)) {
+		puts("pmu - show cycles from swi entry to dispatch.\n\n");
+		puts("Output(hex):\n");
+		puts("  last min max count\n");
+  }
+	/* trace helpメッセージ */
+  else if (!strncmp(buf, " trace", 6)) {
+		puts("trace - show or switch trace categories.\n\n");
+		puts("Usage:\n");
+		puts("trace [on | off <category>]\n");
+		puts("  show enabled categories if no argument is given\n");
+		puts("  <category> : syscall irq timer sched debug kmsg all\n");
+		puts("  events are recorded to the log ring(send with sendlog)\n");
+  }
+	/* drain helpメッセージ */
+  else if (!strncmp(buf, " drain", 6)) {
+		puts("drain - stream trace events over serial line in the background.\n\n");
+		puts("Usage:\n");
+		puts("drain [on | off]\n");
+		puts("  show state, packets and errors(hex) if no argument is given\n");
+		puts("  packets of 16 events with CRC-16, decode with tools/trace_decode -s\n");
+		puts("  drained events are removed from the log ring, sendlog/load are refused while on\n");
   }
 #ifdef TSK_LIBRARY
 	/* run helpメッセージ */
@@ -117,17 +200,74 @@ void help_command(char *buf)
 
 /*!
  * @brief sendlogコマンド(logの送信)
- * @param[in] なし
+ * @param[in] *buf:コマンドの引数(" 128"の場合は128byteブロック，" g"の場合はYMODEM-G，それ以外は1Kブロック．
+ * 									 末尾が" delta"の場合は差分とvarint，" lz"の場合はさらに後方参照で符号化する)
+ *	@arg NULL以外
  * @param[out] なし
  * @return なし
+ * @note ・受信側がチェックサムモード(NAKで開始)の場合は，引数に関係なく128byteブロックとなる
+ * 			 ・ログリングのヘッダと古い順に並べたレコードを送信する(送信中のログは捨てて数える)
+ * 			 ・符号化した場合は符号化したコピーを送るので，送信中もログリングへの記録を続ける
+ * 				 (符号化しても小さくならない場合はそのまま送る)
  */
-void sendlog_command(void)
+void sendlog_command(char *buf)
 {
-	UINT32 *logbuf;
-	logbuf = (UINT32 *)&_logbuffer_start;
+	UINT8 *logbuf, *encbuf;
+	UINT32 size, encsize, flags;
+	BOOL encode = TRUE;
+	BOOL frozen = TRUE;
+	BOOL ret;
+	int len = strlen(buf);
+
+	/* 後方参照まで行う */
+	if (len >= 3 && !strcmp(&buf[len - 3], " lz")) {
+		flags = LOG_ENCODE_LZ;
+		buf[len - 3] = '\0';
+	}
+	/* 差分とvarintのみ */
+	else if (len >= 6 && !strcmp(&buf[len - 6], " delta")) {
+		flags = LOG_ENCODE_DELTA;
+		buf[len - 6] = '\0';
+	}
+	else {
+		encode = FALSE;
+	}
+
+	size = log_export_begin(&logbuf); /* 送信中はログリングを凍結する */
+
+	/* 符号化できた場合は凍結を解除する */
+	if (encode && (encsize = log_encode(logbuf, flags, &encbuf)) != 0) {
+		log_export_end();
+		frozen = FALSE;
+		logbuf = encbuf;
+		size = encsize;
+	}
+	else {
+		/* 処理なし */
+	}
+
+	/* YMODEM-G(ストリーミング) */
+	if (!strncmp(buf, " g", 2)) {
+		ret = send_ymodem_g("log.bin", logbuf, size);
+	}
+	/* XMODEM(128byteブロック) */
+	else if (!strncmp(buf, " 128", 4)) {
+		ret = send_xmodem(logbuf, size, XMODEM_BLOCK_SIZE);
+	}
+	/* XMODEM-1K */
+	else {
+		ret = send_xmodem(logbuf, size, XMODEM_1K_BLOCK_SIZE);
+	}
+
+	if (frozen) {
+		log_export_end();
+	}
+	else {
+		/* 処理なし */
+	}
 
 	/* ログをxmodemで送信して正常の場合 */
-	if (send_xmodem((UINT8 *)logbuf, *logbuf + 4)) { /* +4はログ管理機構の先頭番地(サイズ格納位置分) */
+	if (ret) {
 		puts("log to xmodem OK.\n");
 	}
 	/* エラーの場合 */
@@ -137,6 +277,222 @@ void sendlog_command(void)
 }
 
 
+/*!
+ * @brief loadコマンド(タスクイメージの受信と起動)
+ * @param[in] なし
+ * @param[out] なし
+ * @return なし
+ */
+void load_command(void)
+{
+	ER_ID tskid;
+	ER ercd;
+
+	puts("waiting for xmodem-crc sender...\n");
+
+	/* タスクイメージを受信して起動できた場合 */
+	if ((ercd = load_task_image(&tskid)) == E_OK) {
+		puts("load OK. tskid : ");
+		putxval(tskid, 0);
+		puts("\n");
+	}
+	/* エラーの場合 */
+	else {
+		puts("load error : ");
+		putxval(-ercd, 0);
+		puts("\n");
+	}
+}
+
+
+/*!
+ * @brief slabコマンド(スラブキャッシュの統計情報出力)
+ * @param[in] なし
+ * @param[out] なし
+ * @return なし
+ */
+void slab_command(void)
+{
+	SLAB_CACHE *cache;
+
+	puts("name            size     stride   total    inuse    peak     slabs    fails\n");
+	for (cache = g_slab_head; cache != NULL; cache = cache->next) {
+		puts(cache->name);
+		puts(&"                "[strlen(cache->name)]);
+		putxval(cache->objsize, 8);
+		puts(" ");
+		putxval(cache->stride, 8);
+		puts(" ");
+		putxval(cache->stat.total, 8);
+		puts(" ");
+		putxval(cache->stat.inuse, 8);
+		puts(" ");
+		putxval(cache->stat.peak, 8);
+		puts(" ");
+		putxval(cache->stat.slabs, 8);
+		puts(" ");
+		putxval(cache->stat.fails, 8);
+		puts("\n");
+	}
+}
+
+
+/*!
+ * @brief stackコマンド(タスクスタックの最大使用量出力)
+ * @param[in] なし
+ * @param[out] なし
+ * @return なし
+ * @note STACK_PAINT未定義時は最大使用量を求められない
+ */
+void stack_command(void)
+{
+#ifdef STACK_PAINT
+	int i, len;
+	TCB *tcb;
+
+	puts("id       name            size     used\n");
+	for (i = 0; i < g_tsk_info.tskid_num; i++) {
+		if ((tcb = TSK_ID_TABLE(i)) == NULL) {
+			continue;
+		}
+		putxval(i, 8);
+		puts(" ");
+		puts(tcb->init.name);
+		len = strlen(tcb->init.name);
+		puts(&"                "[(len < 16) ? len : 15]);
+		putxval(tcb->stacksize, 8);
+		puts(" ");
+		putxval(scan_stack_pool(tcb->stack - tcb->stacksize, tcb->stacksize), 8);
+		puts("\n");
+	}
+#else
+	puts("stack paint is not supported.\n");
+#endif
+}
+
+
+/*!
+ * @brief pmuコマンド(SWIの入り口からディスパッチまでのサイクル数出力)
+ * @param[in] なし
+ * @param[out] なし
+ * @return なし
+ * @note PMU_SWI_PROFILE未定義時は計測しない
+ */
+void pmu_command(void)
+{
+#ifdef PMU_SWI_PROFILE
+	puts("last     min      max      count\n");
+	putxval(g_pmu_swi.last, 8);
+	puts(" ");
+	putxval(g_pmu_swi.min, 8);
+	puts(" ");
+	putxval(g_pmu_swi.max, 8);
+	puts(" ");
+	putxval(g_pmu_swi.count, 8);
+	puts("\n");
+#else
+	puts("pmu swi profile is not supported.\n");
+#endif
+}
+
+
+/*!
+ * @brief traceコマンド(トレースカテゴリの表示と切り替え)
+ * @param[in] *buf:コマンドの引数(" on <category>"，" off <category>"，なしの場合は表示)
+ *	@arg NULL以外
+ * @param[out] なし
+ * @return なし
+ * @note 再ビルドせずに，動作中のまま特定のカテゴリ(例えばsched)だけを記録できる
+ */
+void trace_command(char *buf)
+{
+	UINT32 mask = log_get_mask();
+	char *name;
+	BOOL on;
+	int i;
+
+	/* 表示 */
+	if (*buf == '\0') {
+		puts("mask ");
+		putxval(mask, 8);
+		puts("\n");
+		for (i = 0; i < TRACE_CATEGORY_NUM - 1; i++) {
+			puts(sg_trace_cat[i].name);
+			puts((mask & sg_trace_cat[i].cat) ? " on\n" : " off\n");
+		}
+		return;
+	}
+	/* 有効化 */
+	else if (!strncmp(buf, " on ", 4)) {
+		on = TRUE;
+		name = &buf[4];
+	}
+	/* 無効化 */
+	else if (!strncmp(buf, " off ", 5)) {
+		on = FALSE;
+		name = &buf[5];
+	}
+	else {
+		puts("trace: usage trace [on | off <category>]\n");
+		return;
+	}
+
+	for (i = 0; i < TRACE_CATEGORY_NUM; i++) {
+		if (!strcmp(name, sg_trace_cat[i].name)) {
+			break;
+		}
+	}
+	/* 存在しないカテゴリ */
+	if (i == TRACE_CATEGORY_NUM) {
+		puts("trace: unknown category.\n");
+		return;
+	}
+
+	if (on) {
+		mask |= sg_trace_cat[i].cat;
+	}
+	else {
+		mask &= ~sg_trace_cat[i].cat;
+	}
+	log_set_mask(mask);
+}
+
+
+/*!
+ * @brief drainコマンド(ログ吸い出しの表示と開始，停止)
+ * @param[in] *buf:コマンドの引数(" on"または" off"，空の場合は表示)
+ *	@arg NULL以外
+ * @param[out] なし
+ * @return なし
+ */
+void drain_command(char *buf)
+{
+	UINT32 packets, errors;
+	BOOL enable;
+
+	/* 表示 */
+	if (*buf == '\0') {
+		enable = log_drain_status(&packets, &errors);
+		puts(enable ? "on " : "off ");
+		putxval(packets, 0);
+		puts(" ");
+		putxval(errors, 0);
+		puts("\n");
+	}
+	/* 開始 */
+	else if (!strcmp(buf, " on")) {
+		log_drain_enable(TRUE);
+	}
+	/* 停止 */
+	else if (!strcmp(buf, " off")) {
+		log_drain_enable(FALSE);
+	}
+	else {
+		puts("drain: usage drain [on | off]\n");
+	}
+}
+
+
 #ifdef TSK_LIBRARY
 
 /*!
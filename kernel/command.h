@@ -20,7 +20,25 @@ extern void echo_command(char buf[]);
 extern void help_command(char *buf);
 
 /*! sendlogコマンド */
-extern void sendlog_command(void);
+extern void sendlog_command(char *buf);
+
+/*! loadコマンド */
+extern void load_command(void);
+
+/*! slabコマンド */
+extern void slab_command(void);
+
+/*! stackコマンド */
+extern void stack_command(void);
+
+/*! pmuコマンド */
+extern void pmu_command(void);
+
+/*! traceコマンド */
+extern void trace_command(char *buf);
+
+/*! drainコマンド */
+extern void drain_command(char *buf);
 
 #ifdef TSK_LIBRARY
 /*! runコマンド */
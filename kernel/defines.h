@@ -30,6 +30,7 @@ extern "C" {
 typedef unsigned char 					UINT8; 									/*! プロセッサに自然な符号なし8ビット整数 */
 typedef unsigned short 					UINT16; 								/*! プロセッサに自然な符号なし16ビット整数 */
 typedef unsigned long 					UINT32; 								/*! プロセッサに自然な符号なし32ビット整数 */
+typedef unsigned long long			UINT64; 								/*! 符号なし64ビット整数 */
 typedef signed short 						ER;											/*! 機能としてのエラーコード */
 typedef signed char 						ER_BOOL; 								/*! 真偽または機能としてのエラーコードを返却 */
 typedef signed short 						ER_ID; 									/*! 機能としてのエラーコードまたはID(0,1,2,・・・)を返却 */
@@ -44,6 +45,7 @@ typedef unsigned long						TMRRQ_OBJP;							/*! タイマを要求したオブ
 typedef ER (*SOFTVEC_HANDL)(INTRPT_TYPE type, UINT32 sp); 		/*! ソフトウェアベクタのハンドラ型 */
 typedef int (*TSK_FUNC)(int argc, char *argv[]);				/*! TCBが呼ぶスレッドメインルーチンを記録 */
 typedef void (*IR_HANDL)(void); 												/*! 割込みハンドラ */
+typedef BOOL (*IR_VHANDL)(INTRPT_TYPE irq); 							/*! ベクタ割込みハンドラ(TRUEを返すと割込みの出口でスケジューラを呼ぶ) */
 typedef void (*TMR_CALLRTE)(void *argv); 								/*! タイマコールバックルーチン */
 
 
@@ -83,7 +85,7 @@ typedef void (*TMR_CALLRTE)(void *argv); 								/*! タイマコールバック
 #define SERIAL_DEFAULT_DEVICE 		1 											/*! シリアルドライバ */
 #define HARD_TIMER_DEFAULT_DEVICE 0 											/*! ハードタイマドライバ */
 #define SOFT_TIMER_DEFAULT_DEVICE 1 											/*! ソフトタイマドライバ */
-#define TASK_ID_NUM 							2 											/*! タスク数 */
+#define TASK_ID_NUM 							2 											/*! 1スラブあたりのTCB数 */
 /* (現在では32までしか設定できない．また32以下も設定できない(ビットサーチが問題)) */
 #define PRIORITY_NUM 							32 											/*! 優先度数 */
 #define SEMAPHORE_ID_NUM					2												/*! セマフォ資源数 */
@@ -92,6 +94,7 @@ typedef void (*TMR_CALLRTE)(void *argv); 								/*! タイマコールバック
 #define MUTEX_ID_NUM							2												/*! ミューテックス資源数 */
 #define ALARM_ID_NUM							2												/*! アラームハンドラ資源数 */
 #define CYCLE_ID_NUM							2												/*! 周期ハンドラ資源数 */
+#define MEMORYPOOL_ID_NUM					4												/*! 可変長メモリプール資源数 */
 
 
 /*! 割込みの種類 */
@@ -234,6 +237,13 @@ typedef enum {
 } ALM_TYPE;
 
 
+/*! 可変長メモリプール待ちタスクをレディーへ戻す属性の定義 */
+typedef enum {
+  MPL_TA_TFIFO 							= 0,	/*! FIFO順 */
+  MPL_TA_TPRI,										/*! 優先度順 */
+} MPL_ATR;
+
+
 /*! 8bit幅のレジスタ操作マクロ */
 #define	REG8_READ(adr)		*((volatile unsigned char *)(adr)) 									/*! 各レジスタから読み出し */
 #define	REG8_WRITE(adr, dat)	{*((volatile unsigned char *)(adr)) = (dat);}		/*! 各レジスタから書き出し */
@@ -253,39 +263,62 @@ typedef enum {
 
 
 
+/*!
+ * トレースカテゴリ(g_log_maskのビット)
+ * -traceコマンドまたはlog_set_mask()で実行時に切り替える
+ */
+#define LOG_CAT_SYSCALL						0x00000001							/*! システムコールの入り口と出口 */
+#define LOG_CAT_IRQ								0x00000002							/*! 外部割込みの入り口と出口 */
+#define LOG_CAT_TIMER							0x00000004							/*! タイマの満了 */
+#define LOG_CAT_SCHED							0x00000008							/*! 待ち解除とディスパッチ */
+#define LOG_CAT_DEBUG_MSG					0x40000000							/*! DEBUG_LEVEL1のメッセージ */
+#define LOG_CAT_KERNEL_MSG				0x80000000							/*! KERNEL_MSGのメッセージ */
+#define LOG_CAT_TRACE_ALL					(LOG_CAT_SYSCALL | LOG_CAT_IRQ | LOG_CAT_TIMER | LOG_CAT_SCHED) /*! 全イベント */
+
+/*! 有効なトレースカテゴリ(kernel_svc/log_manage.cで定義) */
+extern volatile UINT32 g_log_mask;
+
+/*! トレースカテゴリが有効か(無効側へ分岐予測させ，無効時はロードと分岐1回で済ませる) */
+#define LOG_CAT_ENABLED(cat)			(__builtin_expect((g_log_mask & (cat)) != 0, 0))
+
+
 /*! デバックマクロ */
 /*
- * -DEBUG_LEVEL1は簡単なメッセージと値チェック
- * -DEBUG_LEVEL2はログ出力(高級なデバッグ)
+ * -DEBUG_LEVEL1は簡単なメッセージと値チェック(LOG_CAT_DEBUG_MSGが有効な時のみ出力)
+ * -DEBUG_LEVEL2は起動時から全トレースカテゴリを有効にする(トレースポイント自体は常に組み込む)
  */
 #ifdef DEBUG_LEVEL1
 /* debug message */
-#define DEBUG_LEVEL1_OUTVLE(testvalue, testcolumn) (putxval(testvalue, testcolumn))
+#define DEBUG_LEVEL1_OUTVLE(testvalue, testcolumn) \
+	((void)(LOG_CAT_ENABLED(LOG_CAT_DEBUG_MSG) && putxval(testvalue, testcolumn)))
 /* debug value */
-#define DEBUG_LEVEL1_OUTMSG(testmsg) (puts(testmsg))
+#define DEBUG_LEVEL1_OUTMSG(testmsg) ((void)(LOG_CAT_ENABLED(LOG_CAT_DEBUG_MSG) && puts(testmsg)))
 #else
 #define DEBUG_LEVEL1_OUTVLE(testvalue, testcolumn)
 #define DEBUG_LEVEL1_OUTMSG(testmsg)
 #endif
 
 
-#ifdef DEBUG_LEVEL2
-	/* コンテキストスイッチングのログ出力マクロ */
-	#define DEBUG_LEVEL2_LOG_CONTEXT(log_tcb) (get_log((OBJP)log_tcb))
-#else
-	#define DEBUG_LEVEL2_LOG_CONTEXT(log_tcb)
-#endif
-
-
-/*! kernel message */
+/*!
+ * kernel message
+ * -KERNEL_OUTMSG,KERNEL_OUTVLEは診断用(LOG_CAT_KERNEL_MSGが有効な時のみ出力)
+ * -KERNEL_FATAL_OUTMSG,KERNEL_FATAL_OUTVLEはdown_system()前の致命的エラー用(g_log_maskによらず出力)
+ */
 #ifdef KERNEL_MSG
 /* kernel message */
-#define KERNEL_OUTVLE(kernelvalue, kernelcolumn) (putxval(kernelvalue, kernelcolumn))
+#define KERNEL_OUTVLE(kernelvalue, kernelcolumn) \
+	((void)(!(g_log_mask & LOG_CAT_KERNEL_MSG) || putxval(kernelvalue, kernelcolumn)))
 /* kernel value */
-#define KERNEL_OUTMSG(kernelmsg) (puts(kernelmsg))
+#define KERNEL_OUTMSG(kernelmsg) ((void)(!(g_log_mask & LOG_CAT_KERNEL_MSG) || puts(kernelmsg)))
+/* fatal kernel message */
+#define KERNEL_FATAL_OUTVLE(kernelvalue, kernelcolumn) (putxval(kernelvalue, kernelcolumn))
+/* fatal kernel value */
+#define KERNEL_FATAL_OUTMSG(kernelmsg) (puts(kernelmsg))
 #else
 #define KERNEL_OUTVLE(kernelvalue, kernelcolumn)
 #define KERNEL_OUTMSG(kernelmsg)
+#define KERNEL_FATAL_OUTVLE(kernelvalue, kernelcolumn)
+#define KERNEL_FATAL_OUTMSG(kernelmsg)
 #endif
 
 
@@ -11,10 +11,15 @@
 #include "multi_timer.h"
 /* os/arch/cpu */
 #include "arch/cpu/intr_cntrl.h"
+/* os/kernel_svc */
+#include "kernel_svc/defer.h"
+#include "kernel_svc/log_drain.h"
+#include "kernel_svc/transfer.h"
 /* os/c_lib */
 #include "c_lib/lib.h"
 /* os/target */
 #include "target/driver/serial_driver.h"
+#include "target/driver/dma_driver.h"
 
 
 extern void uart_handler(void);
@@ -32,6 +37,7 @@ extern void uart_handler(void);
 int start_threads(int argc, char *argv[])
 {
   KERNEL_OUTMSG("init task started.\n");
+  intc_priority_init(); /* 割込み優先度の設定(タイマをシリアルより高くし，ネストできるようにする) */
   intc_enable_irq(INTERRUPT_TYPE_UART3_IRQ); /* MIRの有効化 */
 	intc_enable_irq(INTERRUPT_TYPE_GPT1_IRQ); /* MIRの有効化 */
 	intc_enable_irq(INTERRUPT_TYPE_GPT2_IRQ); /* MIRの有効化 */
@@ -42,13 +48,21 @@ int start_threads(int argc, char *argv[])
 	intc_enable_irq(INTERRUPT_TYPE_GPT7_IRQ); /* MIRの有効化 */
 	intc_enable_irq(INTERRUPT_TYPE_GPT8_IRQ); /* MIRの有効化 */
 	intc_enable_irq(INTERRUPT_TYPE_GPT9_IRQ); /* MIRの有効化 */
+	intc_enable_irq(DMA_INTR_LINE); /* MIRの有効化 */
   serial_intr_recv_enable(); 								/* シリアル受信割込み有効化 */
   serial_intr_send_disable();
 
+  dma_init(); /* sDMAドライバの初期化(完了割込みのベクタ登録) */
+  defer_init(); /* 遅延処理サービスタスクの起動(UARTコマンドの解析と実行はここで行う) */
+  transfer_init(); /* 転送タスクの起動(sendlog,loadコマンドの送受信はここで行う) */
+  log_drain_init(); /* ログ吸い出しタスクの起動(drainコマンドで開始するまで起床待ち) */
   mz_def_inh(INTERRUPT_TYPE_UART3_IRQ, uart_handler); /* 割込みハンドラの登録 */
+  serial_send_buffered(); /* 以降の出力は送信リングバッファ経由(送信割込み)とする */
+  serial_recv_buffered(); /* 以降の入力は受信リングバッファ経由(受信割込み)とする */
 
 	/* 外部割込み有効化(CPSR) */
   enable_irq();
+  enable_fiq(); /* スケジューリング用タイマ(FIQ) */
 
 	while (1) {
 		;
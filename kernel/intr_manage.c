@@ -15,9 +15,33 @@
 #include "arch/cpu/intr.h"
 
 
+/*! def_inh()で登録された割込みハンドラを呼び出すベクタ割込みハンドラ */
+static BOOL inh_vector(INTRPT_TYPE irq);
+
+
 /*! 割込みハンドラ */
 IR_HANDL g_exter_handlers[EXTERNAL_INTERRUPT_NUM] = {0};
 
+/*! ベクタ割込みハンドラ(NULLの場合は未登録) */
+IR_VHANDL g_intr_vectors[EXTERNAL_INTERRUPT_NUM] = {0};
+
+
+/*!
+ * @brief def_inh()で登録された割込みハンドラを呼び出すベクタ割込みハンドラ
+ * @param[in] irq:IRQ番号(デコード済み)
+ *	@arg 0~96
+ * @return スケジューラの呼び出しが必要か
+ *	@retval FALSE:不要
+ * @note ハンドラからレディーを変更できるのは非タスクコンテキスト用システムコールのみであり，
+ * 			 その場合はisyscall_intr()で記録されるので，ここではFALSEを返す
+ */
+static BOOL inh_vector(INTRPT_TYPE irq)
+{
+	(*g_exter_handlers[irq])();
+
+	return FALSE;
+}
+
 
 /*!
  * @brief システムコールの処理(def_inh():割込みハンドラの定義)
@@ -39,8 +63,9 @@ ER def_inh_isr(INTRPT_TYPE type, IR_HANDL handler)
 		return E_PAR;
 	}
 	/* initタスク生成時でのソフトウェア割込みベクタへ割込みハンドラ定義 */
-	else if (g_tsk_info.id_table[INIT_TASK_ID] == NULL) {
+	else if (TSK_ID_TABLE(INIT_TASK_ID) == NULL) {
   	g_exter_handlers[type] = handler;
+  	g_intr_vectors[type] = inh_vector;
 		return E_OK;
 	}
 	/* initタスクでのソフトウェア割込みベクタへ割込みハンドラを定義 */
@@ -48,6 +73,7 @@ ER def_inh_isr(INTRPT_TYPE type, IR_HANDL handler)
 		/* シリアル割込みハンドラか */
 		if (type == INTERRUPT_TYPE_UART3_IRQ) {
   		g_exter_handlers[type] = handler;
+  		g_intr_vectors[type] = inh_vector;
 			return E_OK;
 		}
 		/* それ以外は不正使用 */
@@ -56,3 +82,27 @@ ER def_inh_isr(INTRPT_TYPE type, IR_HANDL handler)
 		}
 	}
 }
+
+
+/*!
+ * @brief ベクタ割込みハンドラの登録(カーネル内部用)
+ * @param[in] type:IRQ番号
+ *	@arg 0~96
+ * @param[in] handler:登録するベクタ割込みハンドラ
+ *	@arg NULL以外
+ * @return エラーコード
+ *	@retval E_PAR:パラメータエラー,E_OK:登録完了
+ * @note ・ハンドラにはIRQ番号がデコード済みで渡され，レディーを変更した場合はTRUEを返す
+ * 			 ・カーネル内部(タイマ等)のハンドラ登録に使用し，システムコールとしては提供しない
+ */
+ER def_vec_isr(INTRPT_TYPE type, IR_VHANDL handler)
+{
+	/* パラメータは正しいか */
+	if (type < 0 || EXTERNAL_INTERRUPT_NUM <= type || handler == NULL) {
+		return E_PAR;
+	}
+	else {
+		g_intr_vectors[type] = handler;
+		return E_OK;
+	}
+}
@@ -16,8 +16,14 @@
 /*! システムコールの処理(def_inh():割込みハンドラの定義) */
 extern ER def_inh_isr(INTRPT_TYPE type, IR_HANDL handler);
 
+/*! ベクタ割込みハンドラの登録(カーネル内部用) */
+extern ER def_vec_isr(INTRPT_TYPE type, IR_VHANDL handler);
+
 /*! 割込みハンドラ */
 extern IR_HANDL g_exter_handlers[EXTERNAL_INTERRUPT_NUM];
 
+/*! ベクタ割込みハンドラ(IRQ番号ごとのディスパッチテーブル) */
+extern IR_VHANDL g_intr_vectors[EXTERNAL_INTERRUPT_NUM];
+
 
 #endif
@@ -0,0 +1,121 @@
+/*!
+ * @file ターゲット非依存部<モジュール:kdata.o>
+ * @brief カーネルデータページ
+ * @attention gcc4.5.x以外は試していない
+ * @note ・自タスクのID，優先度，状態及び単調増加時刻をトラップなしで参照できるようにする
+ * 			 ・更新はカーネル(割込み禁止状態)のみで行うので，書き込み側の排他はいらない
+ * 			 ・読み出し側はタスクコンテキストで割込まれる事があるので，seqで一貫性を検査する
+ */
+
+
+/* os/kernel */
+#include "kdata.h"
+#include "kernel.h"
+#include "ready.h"
+/* os/target/driver */
+#include "target/driver/timer_driver.h"
+
+
+/*! カーネルデータページ(キャッシュライン境界に配置) */
+KERNEL_DATA g_kdata __attribute__ ((section (".kdata"), aligned (64))) = {0, -1, E_NOSPT, -1, 0, 0, 0};
+
+
+/*!
+ * @brief カーネルデータページの初期化
+ * @param[in] なし
+ * @param[out] なし
+ * @return なし
+ */
+void kdata_init(void)
+{
+	g_kdata.seq = 0;
+	g_kdata.tskid = -1;
+	g_kdata.tim_wrap = 0;
+	g_kdata.tim_last = get_sync_counter();
+}
+
+
+/*!
+ * @brief カーネルデータページの更新
+ * @param[in] なし
+ * @param[out] なし
+ * @return なし
+ * @note ・context_switching()でスケジューラの後(ディスパッチ直前)に呼ぶ
+ * 			 ・32KHz同期カウンタのラップアラウンドはここで検出するので，約36時間以内に1回は呼ばれる事
+ */
+void kdata_update(void)
+{
+	UINT32 now = get_sync_counter();
+
+	g_kdata.seq++; /* 奇数(更新中) */
+	KDATA_BARRIER();
+
+	g_kdata.tskid = (ER_ID)g_current->init.tskid;
+	g_kdata.pri_ercd = (g_ready_info.type == SINGLE_READY_QUEUE) ? E_NOSPT : E_OK;
+	g_kdata.priority = g_current->priority;
+	g_kdata.state = g_current->state;
+	/* ラップアラウンドした */
+	if (now < g_kdata.tim_last) {
+		g_kdata.tim_wrap++;
+	}
+	g_kdata.tim_last = now;
+
+	KDATA_BARRIER();
+	g_kdata.seq++; /* 偶数(更新完了) */
+}
+
+
+/*!
+ * @brief カーネルデータページから自タスクの状態を読み出す
+ * @param[out] *pk_rtsk:自タスクの状態を格納する領域
+ * 	@arg NULL以外
+ * @param[out] *p_pri_ercd:get_pri()の可否を格納する領域
+ * 	@arg NULL以外
+ * @return なし
+ * @note タスクコンテキストから呼ぶ(トラップは発行しない)
+ */
+void kdata_read_tsk(T_RTSK *pk_rtsk, ER *p_pri_ercd)
+{
+	UINT32 seq;
+
+	do {
+		seq = g_kdata.seq;
+		KDATA_BARRIER();
+		pk_rtsk->tskid = g_kdata.tskid;
+		pk_rtsk->priority = g_kdata.priority;
+		pk_rtsk->state = g_kdata.state;
+		*p_pri_ercd = g_kdata.pri_ercd;
+		KDATA_BARRIER();
+	} while ((seq & 1) || seq != g_kdata.seq);
+}
+
+
+/*!
+ * @brief カーネルデータページから単調増加時刻を読み出す
+ * @param[in] なし
+ * @param[out] なし
+ * @return 単調増加時刻(usec)
+ * @note ・タスクコンテキストから呼ぶ(トラップは発行しない)
+ * 			 ・最後の更新以降にラップアラウンドしていれば，ここで補正する
+ */
+UINT64 kdata_read_tim(void)
+{
+	UINT32 seq, wrap, last, now;
+
+	do {
+		seq = g_kdata.seq;
+		KDATA_BARRIER();
+		wrap = g_kdata.tim_wrap;
+		last = g_kdata.tim_last;
+		now = get_sync_counter();
+		KDATA_BARRIER();
+	} while ((seq & 1) || seq != g_kdata.seq);
+
+	/* 最後の更新以降にラップアラウンドした */
+	if (now < last) {
+		wrap++;
+	}
+
+	/* 32768Hz → usec(1000000 / 32768 = 15625 / 512) */
+	return ((((UINT64)wrap << 32) | now) * 15625) >> 9;
+}
@@ -0,0 +1,64 @@
+/*!
+ * @file ターゲット非依存部
+ * @brief カーネルデータページインターフェース
+ * @attention gcc4.5.x以外は試していない
+ * @note Linuxのvdso(vvar)とseqcount参考
+ */
+
+
+#ifndef _KDATA_H_INCLUDED_
+#define _KDATA_H_INCLUDED_
+
+
+/* os/kernel */
+#include "defines.h"
+
+
+/*! コンパイラに対するメモリバリア(読み出しの順序を入れ替えさせない) */
+#define KDATA_BARRIER()							asm volatile ("" : : : "memory")
+
+
+/*!
+ * @brief タスク状態の参照パケット(ref_tsk())
+ */
+typedef struct _task_reference {
+	ER_ID tskid;													/*! タスクID */
+	int priority;													/*! 優先度 */
+	UINT16 state;													/*! 状態フラグ */
+} T_RTSK;
+
+
+/*!
+ * @brief カーネルデータページ(タスクから直接参照するread-mostlyなデータ)
+ * @note ・カーネルはディスパッチ直前にのみ更新し，タスクはトラップを発行せずに読み出す
+ * 			 ・更新中はseqを奇数とし，読み出し側は前後のseqが一致するまで読み直す
+ */
+typedef struct _kernel_data_page {
+	volatile UINT32 seq;									/*! シーケンスカウンタ(奇数の間は更新中) */
+	ER_ID tskid;													/*! 実行するタスクのID */
+	ER pri_ercd;													/*! get_pri()の可否(E_OK,E_NOSPT) */
+	int priority;													/*! 実行するタスクの優先度 */
+	UINT16 state;													/*! 実行するタスクの状態フラグ */
+	UINT32 tim_wrap;											/*! 32KHz同期カウンタのラップアラウンド回数 */
+	UINT32 tim_last;											/*! 最後に観測した32KHz同期カウンタの値 */
+} KERNEL_DATA;
+
+
+/*! カーネルデータページの初期化 */
+extern void kdata_init(void);
+
+/*! カーネルデータページの更新(ディスパッチ直前に呼ぶ) */
+extern void kdata_update(void);
+
+/*! カーネルデータページから自タスクの状態を読み出す */
+extern void kdata_read_tsk(T_RTSK *pk_rtsk, ER *p_pri_ercd);
+
+/*! カーネルデータページから単調増加時刻(usec)を読み出す */
+extern UINT64 kdata_read_tim(void);
+
+
+/*! カーネルデータページ */
+extern KERNEL_DATA g_kdata;
+
+
+#endif
@@ -14,31 +14,26 @@
 #include "task_manage.h"
 #include "task_sync.h"
 #include "multi_timer.h"
+#include "mempool_manage.h"
+#include "stack_pool.h"
+#include "kdata.h"
 /* os/arch */
 #include "arch/cpu/intr.h"
+#include "arch/cpu/intr_cntrl.h"
+#include "arch/cpu/cpu_cntrl.h"
+#include "arch/cpu/vfp.h"
 /* os/c_lib */
 #include "c_lib/lib.h"
 /* os_kernel_svc */
 #include "kernel_svc/log_manage.h"
 /* target/driver */
 #include "target/driver/timer_driver.h"
+#include "target/driver/serial_driver.h"
 
 
 /*! タスク生成パラメータチェック関数 */
 static ER check_cre_tsk(TSK_FUNC func, int priority, int stacksize, int rate, int rel_exetim, int deadtim, int floatim);
 
-/*! tskid変換テーブルの次の割付け可能IDを検索をする関数 */
-static ER_ID serch_tskid_table(int tskids);
-
-/*! task IDが足らなくなった場合の処理(次の割付可能ID) */
-static ER pow_tskid_table(void);
-
-/*! task IDが足らなくなった時に倍のID変換テーブルへコピーする関数 */
-static void copy_all_tsk(TCB **tsktbl_tmp, TCB *dtsk_atmp, TCB *dtsk_ftmp);
-
-/*! task IDが足らなくなった時に現在と同じID数を連結し，aloc headとfree headを更新する関数 */
-static void copy_dtsk(TCB *dtsk_atmp, TCB *dtsk_ftmp, int tskids);
-
 /*! システムコールの処理(acre_tsk():タスクコントロールブロックの生成(ID自動割付)と起動) */
 static void kernelrte_run_tsk(SYSCALL_PARAMCB *p);
 
@@ -54,6 +49,9 @@ static void kernelrte_chg_pri(SYSCALL_PARAMCB *p);
 /*! tskid変換テーブル設定処理はいらない(slp_tsk():自タスクの起床待ち) */
 static void kernelrte_slp_tsk(SYSCALL_PARAMCB *p);
 
+/*! tskid変換テーブル設定処理はいらない(tslp_tsk():自タスクの起床待ち(タイムアウトあり)) */
+static void kernelrte_tslp_tsk(SYSCALL_PARAMCB *p);
+
 /*! tskid変換テーブル設定処理(wup_tsk():タスクの起床) */
 static void kernelrte_wup_tsk(SYSCALL_PARAMCB *p);
 
@@ -66,6 +64,29 @@ static void kernelrte_get_mpf(SYSCALL_PARAMCB *p);
 /*! システムコール処理(rel_mpf():動的メモリ解放) */
 static void kernelrte_rel_mpf(SYSCALL_PARAMCB *p);
 
+/*! mplid変換テーブル設定処理(cre_mpl():可変長メモリプールの生成) */
+static void kernelrte_cre_mpl(SYSCALL_PARAMCB *p);
+
+/*! mplid変換テーブル設定処理(get_mpl(),tget_mpl():可変長メモリブロックの獲得) */
+static void kernelrte_get_mpl(SYSCALL_PARAMCB *p);
+
+/*! mplid変換テーブル設定処理(rel_mpl():可変長メモリブロックの返却) */
+static void kernelrte_rel_mpl(SYSCALL_PARAMCB *p);
+
+/*! tskid変換テーブル設定処理(ref_stk():タスクスタックの使用量参照) */
+static void kernelrte_ref_stk(SYSCALL_PARAMCB *p);
+
+/*! システムコールの一括発行(batch()) */
+static void kernelrte_batch(SYSCALL_PARAMCB *p);
+
+/*! 非タスクコンテキスト用システムコールの実行 */
+static void isyscall_exec(ISR_ITYPE type, SYSCALL_PARAMCB *p, ER *ercd);
+
+#ifdef ISYSCALL_QUEUE
+/*! 積まれた非タスクコンテキスト用システムコールをまとめて実行する */
+static void isyscall_drain(void);
+#endif
+
 /*! ディスパッチャの初期化 */
 static void dispatch_init(void);
 
@@ -80,7 +101,16 @@ TCB *g_current = NULL;
 DSP_INFO g_dsp_info = {0, NULL};
 
 /*! タスク情報 */
-TSK_INFO g_tsk_info = {NULL, NULL, NULL, 0, 0, TASK_ID_NUM};
+TSK_INFO g_tsk_info = {{NULL}, {0}, 0, 0, 0};
+
+
+/*!
+ * 一括発行できないシステムコール(自タスクが待ち，終了となるものと一括発行自身)
+ * -エントリごとに発行タスクをg_currentへ戻して実行するため，発行タスクがレディーから抜けるものは認めない
+ */
+#define ISR_BATCH_DENY_MAP	((1 << ISR_TYPE_EXT_TSK) | (1 << ISR_TYPE_EXD_TSK) | (1 << ISR_TYPE_SLP_TSK) | \
+														(1 << ISR_TYPE_GET_MPL) | (1 << ISR_TYPE_TGET_MPL) | (1 << ISR_TYPE_BATCH) | \
+														(1 << ISR_TYPE_TSLP_TSK))
 
 
 /*! タスクコンテキスト用のISRハンドラ */
@@ -90,15 +120,34 @@ static void (*sg_isr_handlers[ISR_NUM])(SYSCALL_PARAMCB *p) =
 		kernelrte_ext_tsk, 	kernelrte_exd_tsk, 	kernelrte_ter_tsk, 	kernelrte_get_pri,
 		kernelrte_chg_pri, 	kernelrte_slp_tsk, 	kernelrte_wup_tsk, 	kernelrte_rel_wai,
 		kernelrte_get_mpf, 	kernelrte_rel_mpf,
-		kernelrte_def_inh, 	kernelrte_sel_schdul,
+		kernelrte_def_inh, 	NULL, 							kernelrte_sel_schdul,
+		kernelrte_cre_mpl, 	kernelrte_get_mpl, 	kernelrte_get_mpl, 	kernelrte_rel_mpl,
+		kernelrte_ref_stk, 	kernelrte_batch, 		kernelrte_tslp_tsk,
 };
 
 /*! 非タスクコンテキスト用のISRハンドラ */
 static void (*sg_isr_ihandlers[ISR_INUM])(SYSCALL_PARAMCB *p) =
 {
-	kernelrte_acre_tsk, kernelrte_sta_tsk,
+	kernelrte_acre_tsk, kernelrte_sta_tsk, kernelrte_chg_pri, kernelrte_wup_tsk,
 };
 
+/*! 割込みの出口でスケジューラの呼び出しが必要か(レディーが変更された) */
+static volatile BOOL sg_intr_resched = FALSE;
+
+#ifdef ISYSCALL_QUEUE
+/*!
+ * @brief 非タスクコンテキスト用システムコール要求リング
+ * @note 生産者は割込みハンドラ(ネストする)とタスクなのでIRQ禁止で排他し，消費者はcontext_switching()のみ
+ */
+static struct {
+	UINT32 head;													/*! 次に書き込む位置 */
+	UINT32 tail;													/*! 次に読み出す位置 */
+	UINT32 drops;													/*! リングが満杯で捨てた数 */
+	UINT32 errors;												/*! 実行時にエラーとなった数 */
+	ISYSCALL_REQ que[ISYSCALL_QUEUE_SIZE];	/*! 要求の格納領域 */
+} sg_isyscall_que;
+#endif
+
 
 /*!
  * @brief タスク生成パラメータチェック関数
@@ -127,7 +176,7 @@ static ER check_cre_tsk(TSK_FUNC func, int priority, int stacksize, int rate, in
   }
   
   /* Deadline Monotonic時のパラメータチェック(initタスクは省く) */
-  else if (schdul_type == DM_SCHEDULING && g_tsk_info.counter > INIT_TASK_ID) {
+  else if (schdul_type == DM_SCHEDULING && TSK_ID_TABLE(INIT_TASK_ID) != NULL) {
   	if (rate <= 0 || rel_exetim <= 0 || deadtim <= 0 || rate < rel_exetim || deadtim < rel_exetim || rate < deadtim) {
   		return E_PAR; /* 生成不可 */
   	}
@@ -153,11 +202,12 @@ static ER check_cre_tsk(TSK_FUNC func, int priority, int stacksize, int rate, in
  *	@arg NULL以外
  * @return なし
  * @note -この関数からmz_acre_tsk()のISRを呼ぶ
- * 				-IDの割付は0から順番に行う.最大数までいった時は，0に再度戻り検索する(タスクがdeleteされている事があるため)
+ * 				-IDの割付は空きIDビットマップから最小の空きIDを求める(ID不足時はチャンク単位で追加し，コピーはしない)
  */
 void kernelrte_acre_tsk(SYSCALL_PARAMCB *p)
 {
-	int tskids;
+	ER_ID tskid;
+	OBJP tcb;
 
 	/* システムコールパラメータ設定(効率化) */
 	TSK_FUNC func = p->un.acre_tsk.func;
@@ -176,167 +226,27 @@ void kernelrte_acre_tsk(SYSCALL_PARAMCB *p)
 		p->un.acre_tsk.ret = E_PAR; /* システムコールのエラーコードを設定(システムコールのパラメータエラー) */
 		return;
 	}
-	/* 次の割付けIDが存在しない場合(ID不足)，または次の割付けIDが使用されている場合(タスクがdeleteされている) */
-	else if ((tskids = g_tsk_info.tskid_num) <= g_tsk_info.counter || g_tsk_info.id_table[g_tsk_info.counter] != NULL) {
-		/* 割付け可能なIDを検索(存在しない場合は，取得してくる) */
-		if (0 > (g_tsk_info.counter = (int)serch_tskid_table(tskids))) {
-			p->un.acre_tsk.ret = E_NOID; /* システムコールのエラーコードを設定(割付け可能なIDが存在しない) */
-			return;
-		}
+	/* 割付け可能なIDを獲得(存在しない場合は，チャンクを追加してくる) */
+	else if ((tskid = get_tskid()) < 0) {
+		p->un.acre_tsk.ret = E_NOID; /* システムコールのエラーコードを設定(割付け可能なIDが存在しない) */
+		return;
 	}
 	/* 以外 */
 	else {
 		/* 処理なし */
 	}
 
-	/* ISRの呼び出し(mz_acre_tsk())とID変換テーブルの設定 */
-	g_tsk_info.id_table[g_tsk_info.counter] = (TCB *)acre_tsk_isr(func, name, priority, 
-																																stacksize, rate, rel_exetim, deadtim,floatim, argc, argv);
-	/* システムコールのリターンパラメータ型へ変換 */
-	p->un.acre_tsk.ret = (ER_ID)g_tsk_info.counter; /* 生成したタスクIDを設定 */
-	g_tsk_info.counter++;
-
-	/* ログの出力(ISR呼び出しでg_currentは切り替わらないため，この位置でログ出力) */
-	DEBUG_LEVEL2_LOG_CONTEXT(g_current);
-}
-
-
-/*!
- * @brief 次割付けタスクIDの検索
- * @param[in] tskid:割付け可能なID変換テーブルのインデックス
- *	@arg 0以外
- * @return エラーコードまたはID
- *	@retval srh:検索した割付可能ID,srh(E_NOID):割付け可能なIDが存在しない(メモリ不足)
- * @note IDが不足している(ID変換テーブルが不足)場合は倍のID数をとってくる
- */
-static ER_ID serch_tskid_table(int tskids)
-{
-	ER_ID srh_cuntr; /* 検索するカウンタ */
-	
-	/* tskid変換テーブルを先頭から検索する */
-	for (srh_cuntr = 0; srh_cuntr < tskids; srh_cuntr++) {
-		if (g_tsk_info.id_table[srh_cuntr] == NULL) {
-			DEBUG_LEVEL1_OUTVLE(srh_cuntr, 0);
-			return srh_cuntr;
-		}
+	/* ISRの呼び出し(mz_acre_tsk()) */
+	tcb = acre_tsk_isr(tskid, func, name, priority, stacksize, rate, rel_exetim, deadtim, floatim, argc, argv);
+	/* TCBまたはスタックが確保できない場合はIDを返却 */
+	if (tcb == (OBJP)E_NOMEM) {
+		rel_tskid(tskid);
+		p->un.acre_tsk.ret = E_NOMEM;
 	}
-	
-	/* メモリ不足 */
-	if (pow_tskid_table() != E_OK) { /* tskidが足らなくなった場合 */
-		srh_cuntr = E_NOID;
-	}
-	/* メモリ確保できた */
+	/* ID変換テーブルの設定 */
 	else {
-		srh_cuntr = tskids; /* 割付可能IDは累乗前(累乗前の要素数のインデックス)の位置にある */
-	}
-	DEBUG_LEVEL1_OUTVLE(srh_cuntr, 0);
-  DEBUG_LEVEL1_OUTMSG(" next tsk counter : serch_tskid_table()\n");
-  
-	return srh_cuntr;
-}
-
-
-/*!
- * @brief task IDが足らなくなった場合の処理(次の割付可能ID)
- * @param[in] なし
- * @param[out] なし
- * @return エラーコード
- *	@retval E_NOMEM:メモリが確保できない,E_OK:正常終了
- * @note IDが不足している(ID変換テーブルが不足)場合は倍のID数をとってきて，変換テーブル，
- * 				静的型配列をコピーし，動的型リンクドリストを連結させる
- */
-static ER pow_tskid_table(void)
-{
-	TCB **tsktbl_tmp, *dtsk_atmp, *dtsk_ftmp;
-	
-	g_tsk_info.power_count++;
-	g_tsk_info.tskid_num = TASK_ID_NUM << g_tsk_info.power_count;
-	
-	/* 現在使用していた領域すべてを一時退避 */
-	tsktbl_tmp = g_tsk_info.id_table;
-	dtsk_atmp = g_tsk_info.alochead;
-	dtsk_ftmp = g_tsk_info.freehead; /* この時，必ずg_tsk_info.freeheadはNULLとはならない(静的型があるため) */
-	
-	if (tsk_init() != E_OK) { /* 現在使用していた倍の領域の確保及び初期化する */
-		return E_NOMEM;
-	}
-	/* 新たに確保した領域にすべてコピー */
-	copy_all_tsk(tsktbl_tmp, dtsk_atmp, dtsk_ftmp);
-	
-	/* 退避していた領域を解放(動的型alarm handlerリストは解放しない) */
-	rel_mpf_isr(tsktbl_tmp);
-	
-	return E_OK;
-}
-
-
-/*!
- * @brief task IDが足らなくなった時に倍のID変換テーブルへコピーする関数
- * @param[in] なし
- * @param[out] **tsktbl_tmp:古いtask ID変換テーブル
- * 	@arg NULL以外
- * @param[out] *dtsk_atmp:古い動的型task aloc list head
- * 	@arg NULL以外
- * @param[out] *dtsk_ftmp:古い動的型task free list head
- * 	@arg NULL以外
- * @return なし
- */
-static void copy_all_tsk(TCB **tsktbl_tmp, TCB *dtsk_atmp, TCB *dtsk_ftmp)
-{
-	int tskids;
-	
-	tskids = TASK_ID_NUM << (g_tsk_info.power_count - 1); /* 古いtask ID資源数 */
-	memcpy(g_tsk_info.id_table, tsktbl_tmp, sizeof(&(**tsktbl_tmp)) * tskids); /* 可変長配列なのでコピー */
-	
-	copy_dtsk(dtsk_atmp, dtsk_ftmp, tskids); /* 動的型taskリストの連結と更新(コピーはしない) */
-}
-
-
-/*!
- * @brief task IDが足らなくなった時に現在と同じID数を連結し，aloc headとfree headを更新する関数
- * @param[in] tskids : 古いtask ID資源数
- * 	@arg 0以外
- * @param[out] *dtsk_atmp:古い動的型task aloc list head
- * 	@arg NULL以外
- * @param[out] *dtsk_ftmp:古い動的型task free list head
- * 	@arg NULL以外
- * @return なし
- * @note 倍の個数は取得せずにalocリストと同じ数を取得し，alocリスト終端へつなげる
- */
-static void copy_dtsk(TCB *dtsk_atmp, TCB *dtsk_ftmp, int tskids)
-{
-	TCB *oldtcb;
-	
-	/*
-	* 動的型taskはalocheadにfreeheadをつなげる
-	* 倍の個数は取得せずにalocリストと同じ数を取得し，alocリスト終端へつなげる
-	*/
-	/* 古い動的型task freeheadの終端の一つ前を検索
-	* (freeリストは使い切っているかもしれないのでalocheadから検索する)
-	*/
-	if (dtsk_ftmp == NULL) {
-		oldtcb = dtsk_atmp;
-	}
-	else {
-		oldtcb = dtsk_ftmp;
-	}
-	for (; oldtcb->free_next != NULL; oldtcb = oldtcb->free_next) {
-		;
-	}
-	/*
-	* old task freeリストと new task freeリストの連結する
-	* コピーはしない
-	*/
-	oldtcb->free_next = g_tsk_info.freehead;
-	g_tsk_info.freehead->free_prev = dtsk_ftmp;
-	
-	/* リスト切れしていないならば，free headの位置を戻す */
-	if (dtsk_ftmp != NULL) {
-		g_tsk_info.freehead = dtsk_ftmp;
-	}
-	/* リスト切れしているならば，aloc headの位置を戻す */
-	if (dtsk_atmp != NULL) {
-		g_tsk_info.alochead = dtsk_atmp;
+		TSK_ID_TABLE(tskid) = (TCB *)tcb;
+		p->un.acre_tsk.ret = tskid; /* 生成したタスクIDを設定 */
 	}
 }
 
@@ -360,22 +270,19 @@ void kernelrte_del_tsk(SYSCALL_PARAMCB *p)
 		p->un.del_tsk.ret = E_ID;
 	}
 	/* 対象タスクは存在するか?(すでに排除されていないか) */
-	else if (g_tsk_info.id_table[tskid] == NULL) {
+	else if (TSK_ID_TABLE(tskid) == NULL) {
 		p->un.del_tsk.ret = E_NOEXS;
 	}
 	/* 割込みサービスルーチンの呼び出し */
 	else {
-		ercd = del_tsk_isr(g_tsk_info.id_table[tskid]);
+		ercd = del_tsk_isr(TSK_ID_TABLE(tskid));
 		/* 排除できたならば，taskID変換テーブルを初期化 */
 		if (ercd == E_OK) {
-			g_tsk_info.id_table[tskid] = NULL;
+			rel_tskid(tskid);
 		}
 		
 		p->un.del_tsk.ret = ercd;
 	}
-
-	/* ログの出力(ISR呼び出しでg_currentは切り替わらないため，この位置でログ出力) */
-	DEBUG_LEVEL2_LOG_CONTEXT(g_current);
 }
 
 
@@ -392,23 +299,17 @@ void kernelrte_sta_tsk(SYSCALL_PARAMCB *p)
 	ER_ID tskid;
 	tskid = p->un.sta_tsk.tskid;
 
-	/*
-	* ・ログの出力(ISR呼び出しでg_currentは切り替わる事があるので，ここの位置でログ出力)
-	* ・putcurrent()でレディーデータ構造へ戻した状態でログを出力
-	*/
-	DEBUG_LEVEL2_LOG_CONTEXT(g_current);
-
 	/* 作成であるacre_tsk()でE_NOIDを返していたならばsta_tsk()ではE_IDを返却 */
 	if (tskid == E_NOID || g_tsk_info.tskid_num <= tskid) {
 		p->un.sta_tsk.ret = E_ID;
 	}
 	/* 対象タスクは存在するか?(すでに排除されていないか) */
-	else if (g_tsk_info.id_table[tskid] == NULL) {
+	else if (TSK_ID_TABLE(tskid) == NULL) {
 		p->un.sta_tsk.ret = E_NOEXS;
 	}
 	/* 割込みサービスルーチンの呼び出し */
 	else {
-		p->un.sta_tsk.ret = sta_tsk_isr(g_tsk_info.id_table[tskid]);
+		p->un.sta_tsk.ret = sta_tsk_isr(TSK_ID_TABLE(tskid));
 	}
 }
 
@@ -442,9 +343,6 @@ static void kernelrte_ext_tsk(SYSCALL_PARAMCB *p)
 	getcurrent(); /* システムコール発行タスクをレディーから抜き取る */
 
 	ext_tsk_isr(); /* 割込みサービスルーチンの呼び出し */
-
-	/* ログの出力(ISR呼び出しでg_currentは切り替わらないため，この位置でログ出力) */
-	DEBUG_LEVEL2_LOG_CONTEXT(g_current);
 }
 
 
@@ -462,9 +360,6 @@ static void kernelrte_exd_tsk(SYSCALL_PARAMCB *p)
 	getcurrent(); /* システムコール発行タスクをレディーから抜き取る */
 
 	exd_tsk_isr(); /* 割込みサービスルーチンの呼び出し */
-
-	/* ログの出力(ISR呼び出しでg_currentは切り替わらないため，この位置でログ出力) */
-	DEBUG_LEVEL2_LOG_CONTEXT(g_current);
 }
 
 
@@ -480,20 +375,17 @@ void kernelrte_ter_tsk(SYSCALL_PARAMCB *p)
 	ER_ID tskid;
 	tskid = p->un.ter_tsk.tskid;
 
-	/* ログの出力(ISR呼び出しでg_currentは切り替わる事があるので，ここの位置でログ出力) */
-	DEBUG_LEVEL2_LOG_CONTEXT(g_current);
-
 	/* 作成であるacre_tsk()でE_NOIDを返していたならばter_tsk()ではE_IDを返却 */
 	if (tskid == E_NOID || g_tsk_info.tskid_num <= tskid) {
 		p->un.ter_tsk.ret = E_ID;
 	}
 	/* 対象タスクは存在するか?(すでに排除されていないか) */
-	else if (g_tsk_info.id_table[tskid] == NULL) {
+	else if (TSK_ID_TABLE(tskid) == NULL) {
 		p->un.ter_tsk.ret = E_NOEXS;
 	}
 	/* 割込みサービスルーチンの呼び出し */
 	else {
-		p->un.ter_tsk.ret = ter_tsk_isr(g_tsk_info.id_table[tskid]);
+		p->un.ter_tsk.ret = ter_tsk_isr(TSK_ID_TABLE(tskid));
 	}
 }
 
@@ -517,7 +409,7 @@ void kernelrte_get_pri(SYSCALL_PARAMCB *p)
 		p->un.get_pri.ret = E_ID;
 	}
 	/* 対象タスクは存在するか?(すでに排除されていないか) */
-	else if (g_tsk_info.id_table[tskid] == NULL) {
+	else if (TSK_ID_TABLE(tskid) == NULL) {
 		p->un.get_pri.ret = E_NOEXS;
 	}
 	/* スケジューラによって認めているか */
@@ -526,11 +418,8 @@ void kernelrte_get_pri(SYSCALL_PARAMCB *p)
 	}
 	/* 割込みサービスルーチンの呼び出し */
 	else {
-		p->un.get_pri.ret = get_pri_isr(g_tsk_info.id_table[tskid], p_tskpri);
+		p->un.get_pri.ret = get_pri_isr(TSK_ID_TABLE(tskid), p_tskpri);
 	}
-
-	/* ログの出力(ISR呼び出しでg_currentは切り替わらないため，この位置でログ出力) */
-	DEBUG_LEVEL2_LOG_CONTEXT(g_current);
 }
 
 
@@ -554,7 +443,7 @@ static void kernelrte_chg_pri(SYSCALL_PARAMCB *p)
 		p->un.chg_pri.ret = E_ID;
 	}
 	/* 対象タスクは存在するか?(すでに排除されていないか) */
-	else if (g_tsk_info.id_table[tskid] == NULL) {
+	else if (TSK_ID_TABLE(tskid) == NULL) {
 		p->un.chg_pri.ret = E_NOEXS;
 	}
 	/* スケジューラによって認めているか(スケジュール属性作った方がいいかな～) */
@@ -563,7 +452,7 @@ static void kernelrte_chg_pri(SYSCALL_PARAMCB *p)
 	}
 	/* 割込みサービスルーチンの呼び出し */
 	else {
-		p->un.chg_pri.ret = chg_pri_isr(g_tsk_info.id_table[tskid], tskpri);
+		p->un.chg_pri.ret = chg_pri_isr(TSK_ID_TABLE(tskid), tskpri);
 	}
 }
 
@@ -588,9 +477,28 @@ static void kernelrte_slp_tsk(SYSCALL_PARAMCB *p)
 		getcurrent(); /* システムコール発行タスクをレディーから抜き取る */
 		p->un.slp_tsk.ret = slp_tsk_isr(); /* 割込みサービスルーチンの呼び出し */
 	}
+}
+
 
-	/* ログの出力(ISR呼び出しでg_currentは切り替わらないため，この位置でログ出力) */
-	DEBUG_LEVEL2_LOG_CONTEXT(g_current);
+/*!
+ * @brief tskid変換テーブル設定処理はいらない(tslp_tsk():自タスクの起床待ち(タイムアウトあり))
+ * @param[in] なし
+ * @param[out] *p:システムコールバッファポインタ
+ * 	@arg NULL以外
+ * @return なし
+ */
+static void kernelrte_tslp_tsk(SYSCALL_PARAMCB *p)
+{
+	SCHDUL_TYPE type = g_schdul_info.type;
+	
+	/* スケジューラによって認めているか */
+	if (type >= RM_SCHEDULING) {
+		p->un.tslp_tsk.ret = E_NOSPT;
+	}
+	/* 割込みサービスルーチン呼び出し(起床待ちとなる場合はレディーから抜き取られる) */
+	else {
+		p->un.tslp_tsk.ret = tslp_tsk_isr(p->un.tslp_tsk.tmout);
+	}
 }
 
 
@@ -605,20 +513,17 @@ static void kernelrte_wup_tsk(SYSCALL_PARAMCB *p)
 {
 	ER_ID tskid = p->un.wup_tsk.tskid;
 
-	/* ログの出力(ISR呼び出しでg_currentは切り替わる事があるので，ここの位置でログ出力) */
-	DEBUG_LEVEL2_LOG_CONTEXT(g_current);
-
 	/* 作成であるacre_tsk()でE_NOIDを返していたならばwup_tsk()ではE_IDを返却 */
 	if (tskid == E_NOID || g_tsk_info.tskid_num <= tskid) {
 		p->un.wup_tsk.ret = E_ID;
 	}
 	/* 対象タスクは存在するか?(すでに排除されていないか) */
-	else if (g_tsk_info.id_table[tskid] == NULL) {
+	else if (TSK_ID_TABLE(tskid) == NULL) {
 		p->un.wup_tsk.ret = E_NOEXS;
 	}
 	/* 割込みサービスルーチンの呼び出し */
 	else {
-		p->un.wup_tsk.ret = wup_tsk_isr(g_tsk_info.id_table[tskid]);
+		p->un.wup_tsk.ret = wup_tsk_isr(TSK_ID_TABLE(tskid));
 	}
 }
 
@@ -634,20 +539,17 @@ static void kernelrte_rel_wai(SYSCALL_PARAMCB *p)
 {
 	ER_ID tskid = p->un.rel_wai.tskid;
 
-	/* ログの出力(ISR呼び出しでg_currentは切り替わる事があるので，ここの位置でログ出力) */
-	DEBUG_LEVEL2_LOG_CONTEXT(g_current);
-
 	/* 作成であるacre_tsk()でE_NOIDを返していたならばrel_wai()ではE_IDを返却 */
 	if (tskid == E_NOID || g_tsk_info.tskid_num <= tskid) {
 		p->un.rel_wai.ret = E_ID;
 	}
 	/* 対象タスクは存在するか?(すでに排除されていないか) */
-	else if (g_tsk_info.id_table[tskid] == NULL) {
+	else if (TSK_ID_TABLE(tskid) == NULL) {
 		p->un.rel_wai.ret = E_NOEXS;
 	}
 	/* 割込みサービスルーチンの呼び出し */
 	else {
-		p->un.rel_wai.ret = rel_wai_isr(g_tsk_info.id_table[tskid]);
+		p->un.rel_wai.ret = rel_wai_isr(TSK_ID_TABLE(tskid));
 	}
 }
 
@@ -664,9 +566,6 @@ static void kernelrte_get_mpf(SYSCALL_PARAMCB *p)
 	int size = p->un.get_mpf.size;
 
   p->un.get_mpf.ret = get_mpf_isr(size);
-
-	/* ログの出力(ISR呼び出しでg_currentは切り替わらないため，この位置でログ出力) */
-	DEBUG_LEVEL2_LOG_CONTEXT(g_current);
 }
 
 
@@ -683,9 +582,6 @@ static void kernelrte_rel_mpf(SYSCALL_PARAMCB *p)
 
   rel_mpf_isr(ptr);
   p->un.rel_mpf.ret = 0;
-
-	/* ログの出力(ISR呼び出しでg_currentは切り替わらないため，この位置でログ出力) */
-	DEBUG_LEVEL2_LOG_CONTEXT(g_current);
 }
 
 
@@ -702,9 +598,6 @@ void kernelrte_def_inh(SYSCALL_PARAMCB *p)
 	IR_HANDL handler = p->un.def_inh.handler;
 
 	p->un.def_inh.ret = def_inh_isr(type, handler);
-
-	/* ログの出力(ISR呼び出しでg_currentは切り替わらないため，この位置でログ出力) */
-	DEBUG_LEVEL2_LOG_CONTEXT(g_current);
 }
 
 
@@ -720,34 +613,204 @@ void kernelrte_sel_schdul(SYSCALL_PARAMCB *p)
 	SCHDUL_TYPE type = p->un.sel_schdul.type;
 	long param = p->un.sel_schdul.param;
 
-	/* ログの出力(ISR呼び出しでg_currentは切り替わる事があるので，ここの位置でログ出力) */
-	DEBUG_LEVEL2_LOG_CONTEXT(g_current);
-
 	p->un.sel_schdul.ret = sel_schdul_isr(type, param); /* 割込みサービスルーチンの呼び出し */
 }
 
 
 /*!
- * @brief 非タスクコンテキスト用システムコール呼び出しライブラリ関数
+ * @brief mplid変換テーブル設定処理(cre_mpl():可変長メモリプールの生成)
+ * @param[in] なし
+ * @param[out] *p:システムコールバッファポインタ
+ * 	@arg NULL以外
+ * @return なし
+ */
+static void kernelrte_cre_mpl(SYSCALL_PARAMCB *p)
+{
+	ER_ID mplid = p->un.cre_mpl.mplid;
+
+	/* 可変長メモリプールIDは正しいか */
+	if (mplid < 0 || MEMORYPOOL_ID_NUM <= mplid) {
+		p->un.cre_mpl.ret = E_ID;
+	}
+	/* 対象可変長メモリプールはすでに生成されていないか */
+	else if (g_mpl_info.id_table[mplid] != NULL) {
+		p->un.cre_mpl.ret = E_OBJ;
+	}
+	/* 割込みサービスルーチンの呼び出し */
+	else {
+		p->un.cre_mpl.ret = cre_mpl_isr(mplid, p->un.cre_mpl.mplatr, p->un.cre_mpl.mplsz);
+	}
+}
+
+
+/*!
+ * @brief mplid変換テーブル設定処理(get_mpl(),tget_mpl():可変長メモリブロックの獲得)
+ * @param[in] なし
+ * @param[out] *p:システムコールバッファポインタ
+ * 	@arg NULL以外
+ * @return なし
+ * @note get_mpl()はtmoutにTMO_FEVRを設定して呼ばれる
+ */
+static void kernelrte_get_mpl(SYSCALL_PARAMCB *p)
+{
+	ER_ID mplid = p->un.get_mpl.mplid;
+
+	/* 可変長メモリプールIDは正しいか */
+	if (mplid < 0 || MEMORYPOOL_ID_NUM <= mplid) {
+		p->un.get_mpl.ret = E_ID;
+	}
+	/* 対象可変長メモリプールは存在するか */
+	else if (g_mpl_info.id_table[mplid] == NULL) {
+		p->un.get_mpl.ret = E_NOEXS;
+	}
+	/* 割込みサービスルーチンの呼び出し(獲得待ちとなる場合はレディーから抜き取られる) */
+	else {
+		p->un.get_mpl.ret = get_mpl_isr(g_mpl_info.id_table[mplid], p->un.get_mpl.blksz,
+																		p->un.get_mpl.p_blk, p->un.get_mpl.tmout);
+	}
+}
+
+
+/*!
+ * @brief mplid変換テーブル設定処理(rel_mpl():可変長メモリブロックの返却)
+ * @param[in] なし
+ * @param[out] *p:システムコールバッファポインタ
+ * 	@arg NULL以外
+ * @return なし
+ */
+static void kernelrte_rel_mpl(SYSCALL_PARAMCB *p)
+{
+	ER_ID mplid = p->un.rel_mpl.mplid;
+
+	/* 可変長メモリプールIDは正しいか */
+	if (mplid < 0 || MEMORYPOOL_ID_NUM <= mplid) {
+		p->un.rel_mpl.ret = E_ID;
+	}
+	/* 対象可変長メモリプールは存在するか */
+	else if (g_mpl_info.id_table[mplid] == NULL) {
+		p->un.rel_mpl.ret = E_NOEXS;
+	}
+	/* 割込みサービスルーチンの呼び出し */
+	else {
+		p->un.rel_mpl.ret = rel_mpl_isr(g_mpl_info.id_table[mplid], p->un.rel_mpl.blk);
+	}
+}
+
+
+/*!
+ * @brief tskid変換テーブル設定処理(ref_stk():タスクスタックの使用量参照)
+ * @param[in] なし
+ * @param[out] *p:システムコールバッファポインタ
+ * 	@arg NULL以外
+ * @return なし
+ */
+static void kernelrte_ref_stk(SYSCALL_PARAMCB *p)
+{
+	ER_ID tskid = p->un.ref_stk.tskid;
+
+	/* 作成であるacre_tsk()でE_NOIDを返していたならばref_stk()ではE_IDを返却 */
+	if (tskid == E_NOID || tskid < 0 || g_tsk_info.tskid_num <= tskid) {
+		p->un.ref_stk.ret = E_ID;
+	}
+	/* 対象タスクは存在するか?(すでに排除されていないか) */
+	else if (TSK_ID_TABLE(tskid) == NULL) {
+		p->un.ref_stk.ret = E_NOEXS;
+	}
+	/* 割込みサービスルーチンの呼び出し */
+	else {
+		p->un.ref_stk.ret = ref_stk_isr(TSK_ID_TABLE(tskid), p->un.ref_stk.p_stksz, p->un.ref_stk.p_stkused);
+	}
+}
+
+
+/*!
+ * @brief システムコールの処理(batch():システムコールの一括発行)
+ * @param[in] なし
+ * @param[out] *p:システムコールバッファポインタ
+ * 	@arg NULL以外
+ * @return なし
+ * @note ・エントリを先頭から順に1回のトラップ内で実行し，スケジューラは最後に1回だけ呼ばれる
+ * 			 ・ISR(sta_tsk_isr()等)はg_currentを書き換えるので，エントリごとに発行タスクへ戻す
+ * 			 ・実行できないエントリがあっても残りのエントリは実行する
+ */
+static void kernelrte_batch(SYSCALL_PARAMCB *p)
+{
+	SYSCALL_BATCH *entry = p->un.batch.entry;
+	TCB *self = g_current;
+	TSK_SYSCALL_INFOCB info = self->syscall_info;
+	int i;
+
+	if (entry == NULL || p->un.batch.num <= 0) {
+		p->un.batch.ret = E_PAR;
+		return;
+	}
+
+	for (i = 0; i < p->un.batch.num; i++) {
+		g_current = self;
+		/* 未登録のシステムコール */
+		if (entry[i].type < 0 || ISR_NUM <= entry[i].type || sg_isr_handlers[entry[i].type] == NULL) {
+			entry[i].ercd = EV_NORTE;
+		}
+		/* 一括発行できないシステムコール */
+		else if (ISR_BATCH_DENY_MAP & (1 << entry[i].type)) {
+			entry[i].ercd = E_NOSPT;
+		}
+		/* 割込みハンドラ起動(返却値はエントリのparamへ格納される) */
+		else {
+			self->syscall_info.type = entry[i].type;
+			self->syscall_info.param = &entry[i].param;
+			(*sg_isr_handlers[entry[i].type])(&entry[i].param);
+			entry[i].ercd = E_OK;
+		}
+	}
+
+	/* 発行タスクとシステムコール情報を戻す(スケジューラはsyscall_intr()の後に1回だけ呼ばれる) */
+	g_current = self;
+	self->syscall_info = info;
+	p->un.batch.ret = E_OK;
+}
+
+
+/*!
+ * @brief 非タスクコンテキスト用システムコールの実行
  * @param[in] type:割込みタイプ
  *	@arg ISR_NUM
  * @param[out] *p:システムコールバッファポインタ
  * 	@arg NULL以外
+ * @param[out] *ercd:E_CTX,EV_NORTEの返却先
+ * 	@arg NULL:割込まれたタスクのsyscall_info.ret,NULL以外:要求自身の返却領域
  * @return なし
- * @note これはタスクコンテキスト用システムコール呼び出しと一貫性を保つため追加した
- *			 トラップの発行は行わない
+ * @note 割込みハンドラ実行中は優先度の高いIRQがネストするので，IRQを禁止して呼び出す
+ *			 ISRの延長で書き換えられるg_current及びsyscall_info.flagの退避と復帰もIRQ禁止中に行う
+ *			 (ネストした割込みに起床したタスクをg_currentとして見せない)
  */
-void isyscall_intr(ISR_ITYPE type, SYSCALL_PARAMCB *p)
+static void isyscall_exec(ISR_ITYPE type, SYSCALL_PARAMCB *p, ER *ercd)
 {
-	ER *ercd;
+	unsigned long cpsr = save_disable_irq(); /* ネストした割込みハンドラからレディー等を保護 */
+	/* ISRの延長でget_tsk_readyque()が呼ばれるとg_currentが書き換えられるので一時退避 */
+	TCB *tmptcb = g_current;
+	/*
+	* システムコール割込みハンドラの延長で非タスクコンテキスト用システムコールが呼ばれた時は，
+	* syscall_info.flagが書き換えられるため退避
+	*/
+	SYSCALL_TYPE tmp_flag = g_current->syscall_info.flag;
+
+	/* 返却先の指定がなければ割込まれたタスク */
+	if (ercd == NULL) {
+		ercd = (ER *)g_current->syscall_info.ret;
+	}
+	else {
+		/* 処理なし */
+	}
 
 	g_current->intr_info.type = SYSCALL_INTERRUPT; /* システムコール割込み実行を記録 */	
+	LOG_TRACE(LOG_CAT_SYSCALL, LOG_EV_SYSCALL_ENTRY, g_current->init.tskid, type, LOG_SYSCALL_INTR);
+	sg_intr_resched = TRUE; /* レディーが変更されるので，割込みの出口でスケジューラを呼ぶ */
 	
 	/* ISRが登録されている場合 */
 	if ((*sg_isr_ihandlers[type])) {
 		/* ディスパッチ禁止状態の場合 */
 		if (g_dsp_info.flag == FALSE && type != (ISR_ITYPE)ISR_TYPE_ENA_DSP) {
-			ercd = (ER *)g_current->syscall_info.ret;
 			*ercd = E_CTX; /* システムコール発行タスクにディスパッチ禁止状態(E_CTX)を返却 */
 		}
 		g_current->syscall_info.flag = MZ_ISYSCALL; /* システムコールタイプを記録 */
@@ -763,12 +826,122 @@ void isyscall_intr(ISR_ITYPE type, SYSCALL_PARAMCB *p)
 	}
 	/* ISRが未登録の場合 */
 	else {
-		ercd = (ER *)g_current->syscall_info.ret;
-			*ercd = EV_NORTE;
+		*ercd = EV_NORTE;
 	}
+
+	/* 実行状態タスクを前の状態へ戻す */
+	g_current = tmptcb;
+	g_current->syscall_info.flag = tmp_flag;
+
+	restore_irq(cpsr);
 }
 
 
+/*!
+ * @brief 非タスクコンテキスト用システムコール呼び出しライブラリ関数
+ * @param[in] type:割込みタイプ
+ *	@arg ISR_NUM
+ * @param[out] *p:システムコールバッファポインタ
+ * 	@arg NULL以外
+ * @return なし
+ * @note これはタスクコンテキスト用システムコール呼び出しと一貫性を保つため追加した
+ *			 トラップの発行は行わない
+ */
+void isyscall_intr(ISR_ITYPE type, SYSCALL_PARAMCB *p)
+{
+	isyscall_exec(type, p, NULL);
+}
+
+
+#ifdef ISYSCALL_QUEUE
+
+/*!
+ * @brief 非タスクコンテキスト用システムコールの要求を積む
+ * @param[in] type:非タスクコンテキスト用システムコールのタイプ
+ *	@arg ISR_TYPE_ISTA_TSK,ISR_TYPE_ICHG_PRI,ISR_TYPE_IWUP_TSK
+ * @param[in] tskid:対象タスクのID
+ *	@arg 特になし(実行時に検査する)
+ * @param[in] arg:付加パラメータ
+ *	@arg ichg_pri()の場合は優先度，それ以外は0
+ * @param[out] なし
+ * @return エラーコード
+ *	@retval E_QOVR:リングが満杯(要求は捨てる),E_OK:正常終了(要求を積んだ)
+ * @note ・割込み中の処理は定数時間となり，割込まれたタスクのTCBには触らない
+ * 			 ・実行結果は呼び出し側へ返らない(エラーとなった数のみ記録する)
+ */
+ER isyscall_enqueue(ISR_ITYPE type, ER_ID tskid, int arg)
+{
+	ISYSCALL_REQ *req;
+	unsigned long cpsr = save_disable_irq(); /* ネストした割込みハンドラ同士の排他 */
+
+	/* リングが満杯 */
+	if (sg_isyscall_que.head - sg_isyscall_que.tail >= ISYSCALL_QUEUE_SIZE) {
+		sg_isyscall_que.drops++;
+		restore_irq(cpsr);
+		return E_QOVR;
+	}
+
+	req = &sg_isyscall_que.que[sg_isyscall_que.head & (ISYSCALL_QUEUE_SIZE - 1)];
+	req->type = type;
+	req->tskid = tskid;
+	req->arg = arg;
+	sg_isyscall_que.head++;
+	sg_intr_resched = TRUE; /* 割込みの出口でスケジューラ(とリングの実行)を呼ぶ */
+
+	restore_irq(cpsr);
+
+	return E_OK;
+}
+
+
+/*!
+ * @brief 積まれた非タスクコンテキスト用システムコールをまとめて実行する
+ * @param[in] なし
+ * @param[out] なし
+ * @return なし
+ * @note ・context_switching()でスケジューラの前に呼ぶ(IRQ禁止状態)
+ * 			 ・複数の起床要求は1回のスケジューリングにまとめられる
+ * 			 ・E_CTX,EV_NORTEは要求自身の返却領域へ返す(たまたまトラップしたタスクのTCBには書かない)
+ */
+static void isyscall_drain(void)
+{
+	SYSCALL_PARAMCB param;
+	ISYSCALL_REQ *req;
+	ER *ercd;
+
+	while (sg_isyscall_que.tail != sg_isyscall_que.head) {
+		req = &sg_isyscall_que.que[sg_isyscall_que.tail & (ISYSCALL_QUEUE_SIZE - 1)];
+		/* タイプごとにパラメータを設定 */
+		if (req->type == ISR_TYPE_ICHG_PRI) {
+			param.un.chg_pri.tskid = req->tskid;
+			param.un.chg_pri.tskpri = req->arg;
+			ercd = &param.un.chg_pri.ret;
+		}
+		else if (req->type == ISR_TYPE_IWUP_TSK) {
+			param.un.wup_tsk.tskid = req->tskid;
+			ercd = &param.un.wup_tsk.ret;
+		}
+		else {
+			param.un.sta_tsk.tskid = req->tskid;
+			ercd = &param.un.sta_tsk.ret;
+		}
+		*ercd = E_OK;
+		isyscall_exec(req->type, &param, ercd);
+
+		if (*ercd != E_OK) {
+			sg_isyscall_que.errors++;
+		}
+		else {
+			/* 処理なし */
+		}
+		sg_isyscall_que.tail++;
+	}
+	sg_intr_resched = FALSE; /* これからスケジューラを呼ぶので，isyscall_intr()で立てたフラグは落とす */
+}
+
+#endif
+
+
 /*!
  * @brief スケジューラとディスパッチャの呼び出し
  * @param[in] type:割込みタイプ
@@ -780,11 +953,15 @@ void isyscall_intr(ISR_ITYPE type, SYSCALL_PARAMCB *p)
  */
 void context_switching(INTR_TYPE type)
 {
+	log_kick(); /* ログの吸い出しタスクの起床(非タスクコンテキスト用システムコールのキューより前に積む) */
+#ifdef ISYSCALL_QUEUE
+	isyscall_drain(); /* 積まれた非タスクコンテキスト用システムコールを実行し，1回のスケジューリングにまとめる */
+#endif
 	schedule(); /* スケジューラ呼び出し */
-  
-	if (type == SYSCALL_INTERRUPT) {
-			DEBUG_LEVEL2_LOG_CONTEXT(g_current); /* 次に実行されるタスクのログを出力 */
-	}
+	vfp_switch(g_current); /* VFP/NEONの所有タスク以外はFPEXC.ENを落とす(遅延切り替え) */
+	kdata_update(); /* 次に実行されるタスクの情報をカーネルデータページへ */
+	LOG_TRACE(LOG_CAT_SCHED, LOG_EV_DISPATCH, g_current->init.tskid, type, g_current->priority);
+
 	(*g_dsp_info.func)(&g_current->intr_info.sp); /* ディスパッチャの呼び出し */
 
 	/* ここには返ってこない */
@@ -803,6 +980,8 @@ void context_switching(INTR_TYPE type)
  *	@retval E_OK:正常終了(実質上記のエラーコードは返却されない),EV_NORTE:ハンドラが未登録
  * @note ・外部割込み(シリアル割込み，タイマ割込み)はカレントタスクのスタックへコンテキストを保存し，
  * 　			スケジューラ→ディスパッチャという順となる
+ * 			 ・IRQ番号ごとのベクタ割込みハンドラを呼び，レディーを変更した場合はsg_intr_reschedを立てる
+ * 			 ・スケジューラを呼ぶかは割込みの出口でcheck_intr_resched()により判定する
  */
 ER external_intr(INTR_TYPE type, UINT32 sp)
 {
@@ -811,8 +990,16 @@ ER external_intr(INTR_TYPE type, UINT32 sp)
   g_current->intr_info.sp = sp;
 	g_current->intr_info.type = type;
 
-  if ((*g_exter_handlers[type])) {
-    (*g_exter_handlers[type])(); /* 割込みハンドラ起動 */
+  if ((*g_intr_vectors[type])) {
+		LOG_TRACE(LOG_CAT_IRQ, LOG_EV_IRQ_ENTRY, g_current->init.tskid, type, FALSE);
+		/* 割込みハンドラ起動 */
+    if ((*g_intr_vectors[type])((INTRPT_TYPE)type)) {
+			sg_intr_resched = TRUE;
+		}
+		else {
+			/* 処理なし */
+		}
+		LOG_TRACE(LOG_CAT_IRQ, LOG_EV_IRQ_EXIT, g_current->init.tskid, type, sg_intr_resched);
 
 		return E_OK;
 	}
@@ -823,6 +1010,58 @@ ER external_intr(INTR_TYPE type, UINT32 sp)
 }
 
 
+/*!
+ * @brief ネストした外部割込みハンドラを呼び出す
+ * @param[in] type:割込みタイプ
+ *	@arg INTR_NUM
+ * @param[out] なし
+ * @return エラーコード
+ *	@retval E_OK:正常終了,EV_NORTE:ハンドラが未登録
+ * @note ・タスクのコンテキストは最外の割込み(external_intr())で保存済みなので，g_currentは更新しない
+ * 			 ・スケジューラとディスパッチャは最外の割込みの出口で呼ばれる
+ */
+ER nest_external_intr(INTR_TYPE type)
+{
+  if ((*g_intr_vectors[type])) {
+		LOG_TRACE(LOG_CAT_IRQ, LOG_EV_IRQ_ENTRY, g_current->init.tskid, type, TRUE);
+		/* 割込みハンドラ起動 */
+    if ((*g_intr_vectors[type])((INTRPT_TYPE)type)) {
+			sg_intr_resched = TRUE;
+		}
+		else {
+			/* 処理なし */
+		}
+		LOG_TRACE(LOG_CAT_IRQ, LOG_EV_IRQ_EXIT, g_current->init.tskid, type, sg_intr_resched);
+
+		return E_OK;
+	}
+	/* ハンドラが未登録の場合 */
+	else {
+		return EV_NORTE;
+	}
+}
+
+
+/*!
+ * @brief 割込みの出口でスケジューラの呼び出しが必要か判定する
+ * @param[in] なし
+ * @param[out] なし
+ * @return スケジューラの呼び出しが必要か
+ *	@retval TRUE:必要(フラグはクリアする),FALSE:不要(割込まれたタスクへそのまま戻る)
+ * @note 最外の割込みの出口(IRQ禁止状態)で呼ぶ．ネストした割込みで立てられたフラグもここで判定する
+ */
+BOOL check_intr_resched(void)
+{
+	if (sg_intr_resched) {
+		sg_intr_resched = FALSE;
+		return TRUE;
+	}
+	else {
+		return FALSE;
+	}
+}
+
+
 /*!
  * @brief システムコール割込みハンドラ(ISR)を呼び出す準備
  * @param[in] type:システムコールのタイプ
@@ -835,26 +1074,142 @@ ER external_intr(INTR_TYPE type, UINT32 sp)
  */
 void syscall_intr(ISR_TYPE type, UINT32 sp)
 {
-	ER *ercd;
+	TCB *tcb = g_current; /* ISR呼び出しでg_currentは切り替わる事があるので，発行タスクを退避 */
+	ER *ercd = (ER *)tcb->syscall_info.ret; /* ext_tsk(),exd_tsk()は返却値がない(NULL) */
+	UINT32 tskid = tcb->init.tskid; /* exd_tsk()はISRでTCBを解放するので，トレース用に退避 */
 
-  g_current->intr_info.sp = sp; /* カレントタスクのコンテキストを保存 */
-	g_current->intr_info.type = SYSCALL_INTERRUPT; /* システムコール割込み実行を記録 */
+  tcb->intr_info.sp = sp; /* カレントタスクのコンテキストを保存 */
+	tcb->intr_info.type = SYSCALL_INTERRUPT; /* システムコール割込み実行を記録 */
+	LOG_TRACE(LOG_CAT_SYSCALL, LOG_EV_SYSCALL_ENTRY, tskid, type, LOG_SYSCALL_PARAM);
 
 	/* ISRが登録されている場合 */
 	if ((*sg_isr_handlers[type])) {
 		/* ディスパッチ禁止状態の場合 */
-		if (g_dsp_info.flag == FALSE && type != ISR_TYPE_ENA_DSP) {
-			ercd = (ER *)g_current->syscall_info.ret;
+		if (g_dsp_info.flag == FALSE && type != ISR_TYPE_ENA_DSP && ercd != NULL) {
 			*ercd = E_CTX; /* システムコール発行タスクにディスパッチ禁止状態(E_CTX)を返却 */
 		}
-		g_current->syscall_info.flag = MZ_SYSCALL; /* システムコールタイプを記録 */
-    (*sg_isr_handlers[type])(g_current->syscall_info.param); /* 割込みハンドラ起動 */
+		tcb->syscall_info.flag = MZ_SYSCALL; /* システムコールタイプを記録 */
+    (*sg_isr_handlers[type])(tcb->syscall_info.param); /* 割込みハンドラ起動 */
 	}
 	/* ISRが未登録の場合 */
-	else {
-		ercd = (ER *)g_current->syscall_info.ret;
+	else if (ercd != NULL) {
 			*ercd = EV_NORTE;
 	}
+	else {
+		/* 処理なし */
+	}
+
+	/* 発行タスクが終了した場合(返却先がなく，exd_tsk()はTCBも解放済み)は出口を記録しない */
+	if (type != ISR_TYPE_EXT_TSK && type != ISR_TYPE_EXD_TSK) {
+		LOG_TRACE(LOG_CAT_SYSCALL, LOG_EV_SYSCALL_EXIT, tskid, type, (ercd != NULL) ? *ercd : E_OK);
+	}
+	else {
+		/* 処理なし */
+	}
+}
+
+
+/*!
+ * @brief レジスタ渡しのシステムコール割込みハンドラ(ISR)を呼び出す準備
+ * @param[in] type:システムコールのタイプ(SWI番号からISR_RTYPE_BASEを引いたもの)
+ *	@arg ISR_NUM
+ * @param[in] sp:タスクコンテキストのポインタ
+ *	@arg 90002000~90003000
+ * @return なし
+ * @note ・コンテキストはCONTEXT_R0～CONTEXT_CPSRの順に積まれているので，ここから引数を取り出す
+ * 			 ・パラメータブロックはこの関数のスタック上に作成し，既存のISRを呼び出す
+ * 			 ・返却値はコンテキストのr0へ書き込む．待ちとなるシステムコールの待ち解除時の返却値も
+ * 				 syscall_info.retを経由してコンテキストのr0へ直接書き込まれる
+ * 			 ・待ち解除時にパラメータブロックを参照するもの(get_mpl()等)はレジスタ渡しを認めない
+ */
+void rsyscall_intr(ISR_TYPE type, UINT32 sp)
+{
+	UINT32 *context = (UINT32 *)sp;
+	UINT32 r0 = context[CONTEXT_R0], r1 = context[CONTEXT_R1], r2 = context[CONTEXT_R2];
+	SYSCALL_PARAMCB param;
+	ER *ret;
+	TCB *tcb = g_current; /* ISR呼び出しでg_currentは切り替わる事があるので，発行タスクを退避 */
+	UINT32 tskid = tcb->init.tskid; /* トレース用(ISRの後にTCBを参照しない) */
+
+  tcb->intr_info.sp = sp; /* カレントタスクのコンテキストを保存 */
+	tcb->intr_info.type = SYSCALL_INTERRUPT; /* システムコール割込み実行を記録 */
+	LOG_TRACE(LOG_CAT_SYSCALL, LOG_EV_SYSCALL_ENTRY, tskid, type, LOG_SYSCALL_REG);
+
+	/* レジスタからパラメータブロックへ */
+	switch (type) {
+	case ISR_TYPE_DEL_TSK:
+		param.un.del_tsk.tskid = (ER_ID)r0;
+		ret = &param.un.del_tsk.ret;
+		break;
+	case ISR_TYPE_STA_TSK:
+		param.un.sta_tsk.tskid = (ER_ID)r0;
+		ret = &param.un.sta_tsk.ret;
+		break;
+	case ISR_TYPE_TER_TSK:
+		param.un.ter_tsk.tskid = (ER_ID)r0;
+		ret = &param.un.ter_tsk.ret;
+		break;
+	case ISR_TYPE_GET_PRI:
+		param.un.get_pri.tskid = (ER_ID)r0;
+		param.un.get_pri.p_tskpri = (int *)r1;
+		ret = &param.un.get_pri.ret;
+		break;
+	case ISR_TYPE_CHG_PRI:
+		param.un.chg_pri.tskid = (ER_ID)r0;
+		param.un.chg_pri.tskpri = (int)r1;
+		ret = &param.un.chg_pri.ret;
+		break;
+	case ISR_TYPE_SLP_TSK:
+		ret = &param.un.slp_tsk.ret;
+		break;
+	case ISR_TYPE_WUP_TSK:
+		param.un.wup_tsk.tskid = (ER_ID)r0;
+		ret = &param.un.wup_tsk.ret;
+		break;
+	case ISR_TYPE_REL_WAI:
+		param.un.rel_wai.tskid = (ER_ID)r0;
+		ret = &param.un.rel_wai.ret;
+		break;
+	case ISR_TYPE_CRE_MPL:
+		param.un.cre_mpl.mplid = (ER_ID)r0;
+		param.un.cre_mpl.mplatr = (MPL_ATR)r1;
+		param.un.cre_mpl.mplsz = (int)r2;
+		ret = &param.un.cre_mpl.ret;
+		break;
+	case ISR_TYPE_REL_MPL:
+		param.un.rel_mpl.mplid = (ER_ID)r0;
+		param.un.rel_mpl.blk = (void *)r1;
+		ret = &param.un.rel_mpl.ret;
+		break;
+	case ISR_TYPE_REF_STK:
+		param.un.ref_stk.tskid = (ER_ID)r0;
+		param.un.ref_stk.p_stksz = (int *)r1;
+		param.un.ref_stk.p_stkused = (int *)r2;
+		ret = &param.un.ref_stk.ret;
+		break;
+	/* レジスタ渡しを認めていないシステムコール */
+	default:
+		context[CONTEXT_R0] = (UINT32)EV_NORTE;
+		LOG_TRACE(LOG_CAT_SYSCALL, LOG_EV_SYSCALL_EXIT, tskid, type, context[CONTEXT_R0]);
+		return;
+	}
+
+	/* ディスパッチ禁止状態の場合 */
+	if (g_dsp_info.flag == FALSE) {
+		context[CONTEXT_R0] = (UINT32)E_CTX; /* システムコール発行タスクにディスパッチ禁止状態(E_CTX)を返却 */
+		LOG_TRACE(LOG_CAT_SYSCALL, LOG_EV_SYSCALL_EXIT, tskid, type, context[CONTEXT_R0]);
+		return;
+	}
+
+	/* 待ち解除時の返却値はコンテキストのr0へ直接書き込ませる */
+	tcb->syscall_info.type = type;
+	tcb->syscall_info.param = NULL;
+	tcb->syscall_info.ret = (OBJP)&context[CONTEXT_R0];
+	tcb->syscall_info.flag = MZ_SYSCALL; /* システムコールタイプを記録 */
+
+	(*sg_isr_handlers[type])(&param); /* 割込みハンドラ起動(g_currentは切り替わる事がある) */
+	context[CONTEXT_R0] = (UINT32)*ret;
+	LOG_TRACE(LOG_CAT_SYSCALL, LOG_EV_SYSCALL_EXIT, tskid, type, context[CONTEXT_R0]);
 }
 
 
@@ -915,22 +1270,32 @@ void kernel_obj_init(void)
 {
   dispatch_init(); /* ディスパッチャの初期化 */
   mem_init(); /* 動的メモリの初期化 */
+  stack_pool_init(); /* タスクスタックプールの初期化 */
+  kdata_init(); /* カーネルデータページの初期化 */
+  /* カーネルオブジェクトのスラブキャッシュの生成 */
+  if (tsk_cache_init() != E_OK || tmr_cache_init() != E_OK || vfp_init() != E_OK) {
+		KERNEL_FATAL_OUTMSG("error: slab cache init \n");
+    down_system();
+  }
   /* スケジューラの初期化 */
   if (schdul_init() != E_OK) {
-		KERNEL_OUTMSG("error: schdul_init() \n");
+		KERNEL_FATAL_OUTMSG("error: schdul_init() \n");
     down_system();
   }
   /* レディーの初期化 */
   if (ready_init() != E_OK) {
-		KERNEL_OUTMSG("error: ready_init() \n");
+		KERNEL_FATAL_OUTMSG("error: ready_init() \n");
     down_system();
   }
   /* タスク周りの初期化(静的，動的) */
   if (tsk_init() != E_OK) {
-		KERNEL_OUTMSG("error: tsk_init() \n");
+		KERNEL_FATAL_OUTMSG("error: tsk_init() \n");
     down_system(); /* メモリが取得できない場合はOSをスリープさせる */
   }
 
+	/* ソフトタイマ(差分のキュー)のタイマ割込みハンドラ登録(FIQで受け付ける) */
+	def_vec_isr(INTC_TICK_FIQ, oneshot_timer_vector);
+
 	/* 以下のhandlerはstartup時にセットする */
 	KERNEL_OUTMSG("　undefined handler ok\n");
 	KERNEL_OUTMSG(" swi handler ok\n");
@@ -977,6 +1342,7 @@ void start_init_tsk(TSK_FUNC func, char *name, int priority, int stacksize,
   kernelrte_sta_tsk(&tsk_param2); /* タスクの起動 */
 	
   /* 最初のタスクの起動 */
+  kdata_update(); /* initタスクの情報をカーネルデータページへ */
   (*g_dsp_info.func)(&g_current->intr_info.sp); /* ディスパッチャの呼び出し */
 
   /* ここには返ってこないこない */
@@ -1007,6 +1373,8 @@ void kernel_init(TSK_FUNC func, char *name, int priority, int stacksize,
 	
 	kernel_obj_init(); /* kernelオブジェクトの初期化 */
 
+	log_init(); /* ログリングの初期化 */
+
 	start_init_tsk(func, name, priority, stacksize, argc, argv); /* initタスクの生成と起動 */
 
   /* ここには返ってこないこない */
@@ -1021,7 +1389,8 @@ void kernel_init(TSK_FUNC func, char *name, int priority, int stacksize,
  */
 void down_system(void)
 {
-  KERNEL_OUTMSG("system error! kernel freeze!\n");
+  serial_send_polled(); /* 送信リングバッファを吐き出し，以降はポーリング送信とする */
+  KERNEL_FATAL_OUTMSG("system error! kernel freeze!\n");
   /* システムをとめる */
   while (1) {
     ;
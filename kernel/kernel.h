@@ -21,6 +21,7 @@ extern "C" {
 /* os/kernel */
 #include "syscall.h"
 #include "task.h"
+#include "kdata.h"
 
 
 /*!
@@ -57,15 +58,29 @@ extern void kernelrte_sel_schdul(SYSCALL_PARAMCB *p);
 /*! 非タスクコンテキスト用システムコール呼び出しライブラリ関数 */
 extern void isyscall_intr(ISR_ITYPE type, SYSCALL_PARAMCB *param);
 
+#ifdef ISYSCALL_QUEUE
+/*! 非タスクコンテキスト用システムコールの要求を積む */
+extern ER isyscall_enqueue(ISR_ITYPE type, ER_ID tskid, int arg);
+#endif
+
 /*! スケジューラとディスパッチャの呼び出し */
 extern void context_switching(INTR_TYPE type);
 
 /*! 外部割込みハンドラを呼び出す準備 */
 extern ER external_intr(INTR_TYPE type, UINT32 sp);
 
+/*! ネストした外部割込みハンドラを呼び出す */
+extern ER nest_external_intr(INTR_TYPE type);
+
+/*! 割込みの出口でスケジューラの呼び出しが必要か判定する */
+extern BOOL check_intr_resched(void);
+
 /*! システムコール割込みハンドラ(ISR)を呼び出す準備 */
 extern void syscall_intr(ISR_TYPE type, UINT32 sp);
 
+/*! レジスタ渡しのシステムコール割込みハンドラ(ISR)を呼び出す準備 */
+extern void rsyscall_intr(ISR_TYPE type, UINT32 sp);
+
 /*! トラップ発行(システムコール) */
 extern void issue_trap_syscall(ISR_TYPE type, SYSCALL_PARAMCB *param, OBJP ret);
 
@@ -124,6 +139,9 @@ ER mz_get_slt(SCHDUL_TYPE type, ER_ID tskid, int *p_slice);
 /*! mz_slp_tsk():自タスクの起床待ち */
 ER mz_slp_tsk(void);
 
+/*! mz_tslp_tsk():自タスクの起床待ち(タイムアウトあり) */
+ER mz_tslp_tsk(int tmout);
+
 /*! mz_wup_tsk():タスクの起床 */
 ER mz_wup_tsk(ER_ID tskid);
 
@@ -139,6 +157,68 @@ int mz_rel_mpf(void *p);
 /*! mz_def_inh():割込みハンドラの定義 */
 ER mz_def_inh(INTRPT_TYPE type, IR_HANDL handler);
 
+/*! mz_cre_mpl():可変長メモリプールの生成 */
+ER mz_cre_mpl(ER_ID mplid, MPL_ATR mplatr, int mplsz);
+
+/*! mz_get_mpl():可変長メモリブロックの獲得 */
+ER mz_get_mpl(ER_ID mplid, int blksz, void **p_blk);
+
+/*! mz_tget_mpl():可変長メモリブロックの獲得(タイムアウトあり) */
+ER mz_tget_mpl(ER_ID mplid, int blksz, void **p_blk, int tmout);
+
+/*! mz_rel_mpl():可変長メモリブロックの返却 */
+ER mz_rel_mpl(ER_ID mplid, void *blk);
+
+/*! mz_ref_stk():タスクスタックの使用量参照 */
+ER mz_ref_stk(ER_ID tskid, int *p_stksz, int *p_stkused);
+
+/*! mz_batch():システムコールの一括発行 */
+ER mz_batch(SYSCALL_BATCH *entry, int num);
+
+/* トラップを発行しない参照系のシステムコール(カーネルデータページを直接読む，実体はsyscall.cにある) */
+/*! mz_get_tid():自タスクのID参照 */
+ER mz_get_tid(ER_ID *p_tskid);
+
+/*! mz_ref_tsk():自タスクの状態参照 */
+ER mz_ref_tsk(T_RTSK *pk_rtsk);
+
+/*! mz_get_tim():単調増加時刻(usec)の参照 */
+ER mz_get_tim(UINT64 *p_systim);
+
+/* レジスタ渡しのシステムコールのプロトタイプ(引数が4つ以下のもの，実体はsyscall.cにある) */
+/*! mr_del_tsk():タスクの排除 */
+ER mr_del_tsk(ER_ID tskid);
+
+/*! mr_sta_tsk():タスクの起動 */
+ER mr_sta_tsk(ER_ID tskid);
+
+/*! mr_ter_tsk():タスクの強制終了 */
+ER mr_ter_tsk(ER_ID tskid);
+
+/*! mr_get_pri():タスクの優先度取得 */
+ER mr_get_pri(ER_ID tskid, int *p_tskpri);
+
+/*! mr_chg_pri():タスクの優先度変更 */
+ER mr_chg_pri(ER_ID tskid, int tskpri);
+
+/*! mr_slp_tsk():自タスクの起床待ち */
+ER mr_slp_tsk(void);
+
+/*! mr_wup_tsk():タスクの起床 */
+ER mr_wup_tsk(ER_ID tskid);
+
+/*! mr_rel_wai():待ち状態強制解除 */
+ER mr_rel_wai(ER_ID tskid);
+
+/*! mr_cre_mpl():可変長メモリプールの生成 */
+ER mr_cre_mpl(ER_ID mplid, MPL_ATR mplatr, int mplsz);
+
+/*! mr_rel_mpl():可変長メモリブロックの返却 */
+ER mr_rel_mpl(ER_ID mplid, void *blk);
+
+/*! mr_ref_stk():タスクスタックの使用量参照 */
+ER mr_ref_stk(ER_ID tskid, int *p_stksz, int *p_stkused);
+
 /* 非タスクコンテキストから呼ぶシステムコールのプロトタイプ，実体はsyscall.cにある) */
 /*! mz_iacre_tsk():タスクの生成 */
 ER mz_iacre_tsk(SYSCALL_PARAMCB *par);
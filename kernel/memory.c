@@ -36,6 +36,9 @@ typedef struct _mem_pool {
 /*! メモリプールの初期化 */
 static void mem_init_pool(MEM_POOL *p);
 
+/*! heap領域の未使用位置(固定長メモリプールと可変長メモリプールで共有する) */
+static char *sg_heap_area = NULL;
+
 /*! メモリプールの定義(個々のサイズ(2のべき乗)と個数) */
 /* ターゲットのメモリサイズを考える事 */
 static MEM_POOL sg_pool[] = {
@@ -55,10 +58,8 @@ static void mem_init_pool(MEM_POOL *p)
   int i;
   MEM_BLOCK *mp;
   MEM_BLOCK **mpp;
-  extern char _heap; /* リンカスクリプトで定義される空き領域 */
-  static char *area = &_heap;
 
-  mp = (MEM_BLOCK *)area;
+  mp = (MEM_BLOCK *)sg_heap_area;
 
   /* 個々の領域をすべて解放済みリンクリストに繋ぐ */
   mpp = &p->free;
@@ -68,7 +69,7 @@ static void mem_init_pool(MEM_POOL *p)
     mp->size = p->size;
     mpp = &(mp->next);
     mp = (MEM_BLOCK *)((char *)mp + p->size);
-    area += p->size;
+    sg_heap_area += p->size;
   }
 }
 
@@ -76,7 +77,9 @@ static void mem_init_pool(MEM_POOL *p)
 void mem_init(void)
 {
   int i;
-  
+  extern char _heap; /* リンカスクリプトで定義される空き領域 */
+
+  sg_heap_area = &_heap;
   for (i = 0; i < MEMORY_AREA_NUM; i++) {
     mem_init_pool(&sg_pool[i]); /* 各メモリプールを初期化する */
   }
@@ -85,6 +88,8 @@ void mem_init(void)
 /*!
  * 動的メモリの獲得
  * size : 要求サイズ
+ * (返却値)NULL : 領域が不足
+ * (返却値)NULL以外 : 獲得した領域の先頭
  */
 void* get_mpf_isr(int size)
 {
@@ -97,10 +102,8 @@ void* get_mpf_isr(int size)
   for (i = 0; i < MEMORY_AREA_NUM; i++) {
     p = &sg_pool[i];
     if (size <= p->size - sizeof(MEM_BLOCK)) {
-      if (p->free == NULL) { /* 解放済み領域が無い(メモリブロック不足) */
-				KERNEL_OUTMSG("error: get_mpf_isr()1 \n");
-				down_system();
-				return NULL;
+      if (p->free == NULL) { /* 解放済み領域が無い(一つ大きいメモリプールから取得する) */
+				continue;
       }
       /* 解放済みリンクリストから領域を取得する */
       mp = p->free;
@@ -115,11 +118,10 @@ void* get_mpf_isr(int size)
     }
   }
 
-  /* 指定されたサイズの領域を格納できるメモリプールが無い */
+  /* 指定されたサイズの領域を格納できるメモリプールが無い(またはすべて不足) */
 	KERNEL_OUTMSG("error: get_mpf_isr2() \n");
-  down_system();
-  
-  return NULL;
+
+  return NULL; /* 呼び出し側でE_NOMEMとする(システムは停止させない) */
 }
 
 /*! 
@@ -145,6 +147,28 @@ void rel_mpf_isr(void *mem)
     }
   }
 
-	KERNEL_OUTMSG("error: rel_mpf_isr() \n");
+	KERNEL_FATAL_OUTMSG("error: rel_mpf_isr() \n");
   down_system();
 }
+
+/*!
+ * heap領域の切り出し
+ * 切り出した領域は返却しない(カーネルオブジェクトの静的な領域として使用する)
+ * size : 要求サイズ(8byte境界に切り上げる)
+ * (返却値)NULL : heap領域が不足
+ * (返却値)NULL以外 : 切り出した領域の先頭
+ */
+void* get_heap_area(int size)
+{
+  char *area;
+  extern char _heap_end; /* リンカスクリプトで定義されるheap領域の終端 */
+
+  area = (char *)(((UINT32)sg_heap_area + 7) & ~7);
+  size = (size + 7) & ~7;
+  if (size <= 0 || &_heap_end - area < size) {
+    return NULL;
+  }
+  sg_heap_area = area + size;
+
+  return area;
+}
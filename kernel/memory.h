@@ -18,5 +18,8 @@ extern void* get_mpf_isr(int size);
 /*! メモリの解放 */
 extern void rel_mpf_isr(void *mem);
 
+/*! heap領域の切り出し */
+extern void* get_heap_area(int size);
+
 
 #endif
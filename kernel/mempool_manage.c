@@ -0,0 +1,312 @@
+/*!
+ * @file ターゲット非依存部<モジュール:mempool_manage.o>
+ * @brief 可変長メモリプール管理
+ * @attention gcc4.5.x以外は試していない
+ * @note ・μITRON4.0仕様参考
+ * 			 ・プール領域はheapから切り出し，TLSFで管理する(獲得，返却ともにO(1))
+ * 			 ・プールが不足した場合はdown_system()せずに，獲得待ちとする
+ */
+
+
+/* os/kernel */
+#include "mempool_manage.h"
+#include "kernel.h"
+#include "memory.h"
+#include "ready.h"
+#include "multi_timer.h"
+/* os/kernel_svc */
+#include "kernel_svc/log_manage.h"
+/* os/c_lib */
+#include "c_lib/lib.h"
+
+
+/*! 獲得待ちキューへタスクをつなぐ */
+static void put_mpl_waitque(MPLCB *mplcb, TCB *tcb);
+
+/*! 獲得待ちキューからタスクを抜き取る(後続タスクの獲得は行わない) */
+static void remove_mpl_waitque(TCB *tcb);
+
+/*! 獲得待ちキューの先頭から獲得できるタスクをレディーへ戻す */
+static void wakeup_mpl_waitque(MPLCB *mplcb);
+
+/*! 獲得待ちタイムアウト時のコールバックルーチン */
+static void mpl_tmout_callrte(void *argv);
+
+
+/*! 可変長メモリプール情報 */
+MPL_INFO g_mpl_info;
+
+
+/*!
+ * @brief 獲得待ちキューへタスクをつなぐ
+ * @param[in] *mplcb:対象可変長メモリプールコントロールブロック
+ * @param[in] *tcb:獲得待ちとなるタスク
+ * @return なし
+ * @note MPL_TA_TPRIの場合は優先度順(同一優先度はFIFO順)，MPL_TA_TFIFOの場合はFIFO順につなぐ
+ */
+static void put_mpl_waitque(MPLCB *mplcb, TCB *tcb)
+{
+	TCB *worktcb = NULL;
+
+	/* 優先度順の場合は挿入位置を検索 */
+	if (mplcb->atr == MPL_TA_TPRI) {
+		for (worktcb = mplcb->waithead; worktcb != NULL; worktcb = worktcb->wait_info.wait_next) {
+			if (tcb->priority < worktcb->priority) {
+				break;
+			}
+		}
+	}
+	/* FIFO順 */
+	else {
+		/* 処理なし */
+	}
+
+	/* 最後尾へつなぐ */
+	if (worktcb == NULL) {
+		tcb->wait_info.wait_next = NULL;
+		tcb->wait_info.wait_prev = mplcb->waittail;
+		if (mplcb->waittail != NULL) {
+			mplcb->waittail->wait_info.wait_next = tcb;
+		}
+		else {
+			mplcb->waithead = tcb;
+		}
+		mplcb->waittail = tcb;
+	}
+	/* worktcbの前へつなぐ */
+	else {
+		tcb->wait_info.wait_next = worktcb;
+		tcb->wait_info.wait_prev = worktcb->wait_info.wait_prev;
+		if (worktcb->wait_info.wait_prev != NULL) {
+			worktcb->wait_info.wait_prev->wait_info.wait_next = tcb;
+		}
+		else {
+			mplcb->waithead = tcb;
+		}
+		worktcb->wait_info.wait_prev = tcb;
+	}
+}
+
+
+/*!
+ * @brief 獲得待ちキューからタスクを抜き取る(後続タスクの獲得は行わない)
+ * @param[in] *tcb:獲得待ちとなっているタスク
+ * @return なし
+ * @note タイムアウト用のタイマコントロールブロックを持っている場合は排除する
+ */
+static void remove_mpl_waitque(TCB *tcb)
+{
+	MPLCB *mplcb = (MPLCB *)tcb->wait_info.wobjp;
+
+	if (tcb->wait_info.wait_prev != NULL) {
+		tcb->wait_info.wait_prev->wait_info.wait_next = tcb->wait_info.wait_next;
+	}
+	else {
+		mplcb->waithead = tcb->wait_info.wait_next;
+	}
+	if (tcb->wait_info.wait_next != NULL) {
+		tcb->wait_info.wait_next->wait_info.wait_prev = tcb->wait_info.wait_prev;
+	}
+	else {
+		mplcb->waittail = tcb->wait_info.wait_prev;
+	}
+	tcb->wait_info.wait_next = tcb->wait_info.wait_prev = NULL;
+	tcb->wait_info.wobjp = 0;
+	tcb->state &= ~TASK_WAIT_MEMORY_POOL;
+
+	/* タイマブロックを持っているものは対象タイマブロックを排除する */
+	if (tcb->wait_info.tobjp != 0) {
+		delete_tmrcb_diffque((TMRCB *)tcb->wait_info.tobjp);
+		tcb->wait_info.tobjp = 0;
+	}
+	/* 以外 */
+	else {
+		/* 処理なし */
+	}
+}
+
+
+/*!
+ * @brief 獲得待ちキューの先頭から獲得できるタスクをレディーへ戻す
+ * @param[in] *mplcb:対象可変長メモリプールコントロールブロック
+ * @return なし
+ * @note ・先頭タスクが獲得できない場合はそこで終了する(後続タスクに追い越しはさせない)
+ * 			 ・待ちタスクの返却値とブロックはシステムコールパラメータを経由して書き込む
+ */
+static void wakeup_mpl_waitque(MPLCB *mplcb)
+{
+	TCB *tcb;
+	SYSCALL_PARAMCB *p;
+	void *blk;
+	ER *ercd;
+
+	while ((tcb = mplcb->waithead) != NULL) {
+		p = tcb->syscall_info.param;
+		if ((blk = tlsf_malloc(&mplcb->tlsf, (UINT32)p->un.get_mpl.blksz)) == NULL) {
+			break;
+		}
+		*(p->un.get_mpl.p_blk) = blk;
+		remove_mpl_waitque(tcb);
+		ercd = (ER *)tcb->syscall_info.ret;
+		*ercd = E_OK;
+		LOG_TRACE(LOG_CAT_SCHED, LOG_EV_WAKEUP, tcb->init.tskid, E_OK, tcb->state);
+		g_current = tcb;
+		putcurrent(); /* 待ちとなっているタスクをレディーへ */
+	}
+}
+
+
+/*!
+ * @brief 獲得待ちタイムアウト時のコールバックルーチン
+ * @param[in] *argv:タイムアウトしたタスク
+ * @return なし
+ * @note 差分のキューのタイマ満了処理から呼ばれる(タイマコントロールブロックは満了処理で解放される)
+ */
+static void mpl_tmout_callrte(void *argv)
+{
+	TCB *tcb = (TCB *)argv;
+	ER *ercd;
+
+	tcb->wait_info.tobjp = 0; /* 満了処理で解放されるので，ここでは排除しない */
+	get_mpl_waitque(tcb);
+
+	ercd = (ER *)tcb->syscall_info.ret;
+	*ercd = E_TMOUT;
+	LOG_TRACE(LOG_CAT_SCHED, LOG_EV_WAKEUP, tcb->init.tskid, E_TMOUT, tcb->state);
+	g_current = tcb;
+	putcurrent(); /* 待ちとなっているタスクをレディーへ */
+}
+
+
+/*!
+ * @brief システムコールの処理(cre_mpl():可変長メモリプールの生成)
+ * @param[in] mplid:可変長メモリプールID
+ * 	@arg 0～MEMORYPOOL_ID_NUM-1(kernelrte_cre_mpl()でチェック済み)
+ * @param[in] mplatr:待ちタスクをレディーへ戻す属性
+ * 	@arg MPL_TA_TFIFO,MPL_TA_TPRI
+ * @param[in] mplsz:プール領域のサイズ
+ * 	@arg TLSF_SMALL_BLOCK_SIZE以上
+ * @return エラーコード
+ *	@retval E_PAR:パラメータエラー(TLSFで管理できない領域を含む),E_NOMEM:heap領域が不足,E_OK:正常終了
+ */
+ER cre_mpl_isr(ER_ID mplid, MPL_ATR mplatr, int mplsz)
+{
+	MPLCB *mplcb;
+
+	/* パラメータは正しいか(TLSFで管理できるサイズか) */
+	if ((mplatr != MPL_TA_TFIFO && mplatr != MPL_TA_TPRI)
+			|| mplsz < TLSF_SMALL_BLOCK_SIZE || (1 << TLSF_FL_INDEX_MAX) <= mplsz) {
+		return E_PAR;
+	}
+	/* heapからコントロールブロックとプール領域を連続して切り出す */
+	else if ((mplcb = (MPLCB *)get_heap_area(sizeof(*mplcb) + mplsz)) == NULL) {
+		return E_NOMEM;
+	}
+	/* 以外 */
+	else {
+		/* 処理なし */
+	}
+
+	mplcb->mplid = mplid;
+	mplcb->atr = mplatr;
+	mplcb->mplsz = mplsz;
+	mplcb->area = (char *)(mplcb + 1);
+	mplcb->waithead = mplcb->waittail = NULL;
+	/* TLSFで管理できない領域(ヘッダと番兵を除くと小さすぎる等)ならば登録しない */
+	if (tlsf_init(&mplcb->tlsf, mplcb->area, (UINT32)mplsz) != E_OK) {
+		return E_PAR; /* heapは切り出し専用なので，切り出した領域は返却できない */
+	}
+
+	g_mpl_info.id_table[mplid] = mplcb;
+
+	return E_OK;
+}
+
+
+/*!
+ * @brief システムコールの処理(get_mpl(),tget_mpl():可変長メモリブロックの獲得)
+ * @param[in] *mplcb:対象可変長メモリプールコントロールブロック
+ * 	@arg NULL以外
+ * @param[in] blksz:獲得するブロックのサイズ
+ * 	@arg 0より大きい
+ * @param[out] *p_blk:獲得したブロックの先頭番地を格納する領域
+ * 	@arg NULL以外
+ * @param[in] tmout:タイムアウト時間(msec)
+ * 	@arg TMO_FEVR(永久待ち),TMO_POL(ポーリング),1以上
+ * @return エラーコード
+ *	@retval E_PAR:パラメータエラー,E_TMOUT:ポーリング失敗,E_OK:正常終了(または獲得待ち)
+ * @note ・獲得待ちとなる場合の返却値は，待ち解除時に書き換えられる(E_OK,E_TMOUT,E_RLWAI)
+ * 			 ・すでに獲得待ちタスクがいる場合は，そのタスクを追い越して獲得しない
+ */
+ER get_mpl_isr(MPLCB *mplcb, int blksz, void **p_blk, int tmout)
+{
+	void *blk;
+
+	/* パラメータは正しいか */
+	if (blksz <= 0 || blksz > mplcb->mplsz || p_blk == NULL || tmout < TMO_FEVR) {
+		return E_PAR;
+	}
+	/* 獲得できる場合 */
+	else if (mplcb->waithead == NULL && (blk = tlsf_malloc(&mplcb->tlsf, (UINT32)blksz)) != NULL) {
+		*p_blk = blk;
+		return E_OK;
+	}
+	/* ポーリングの場合 */
+	else if (tmout == TMO_POL) {
+		return E_TMOUT;
+	}
+	/* 獲得待ちとする */
+	else {
+		getcurrent(); /* システムコール発行タスクをレディーから抜き取る */
+		g_current->state |= TASK_WAIT_MEMORY_POOL;
+		g_current->wait_info.wobjp = (WAIT_OBJP)mplcb;
+		put_mpl_waitque(mplcb, g_current);
+		/* タイムアウトありの場合はソフトタイマを要求 */
+		if (tmout != TMO_FEVR) {
+			g_current->wait_info.tobjp = (TMR_OBJP)create_tmrcb_diffque(OTHER_MAKE_TIMER, tmout * 1000,
+																																		(TMRRQ_OBJP)g_current, mpl_tmout_callrte, g_current);
+		}
+		return E_OK;
+	}
+}
+
+
+/*!
+ * @brief システムコールの処理(rel_mpl():可変長メモリブロックの返却)
+ * @param[in] *mplcb:対象可変長メモリプールコントロールブロック
+ * 	@arg NULL以外
+ * @param[in] *blk:返却するブロックの先頭番地
+ * 	@arg get_mpl(),tget_mpl()で獲得したもの
+ * @return エラーコード
+ *	@retval E_PAR:対象プールのブロックではない,E_OK:正常終了
+ * @note 返却後に獲得待ちタスクを先頭から獲得させる
+ */
+ER rel_mpl_isr(MPLCB *mplcb, void *blk)
+{
+	/* 対象プールの領域か */
+	if ((char *)blk < mplcb->area || mplcb->area + mplcb->mplsz <= (char *)blk) {
+		return E_PAR;
+	}
+	/* 以外 */
+	else {
+		tlsf_free(&mplcb->tlsf, blk);
+		wakeup_mpl_waitque(mplcb);
+		return E_OK;
+	}
+}
+
+
+/*!
+ * @brief 可変長メモリプールの待ちキューからタスクを抜き取る(rel_wai(),ter_tsk()用)
+ * @param[in] *tcb:獲得待ちとなっているタスク
+ * 	@arg TASK_WAIT_MEMORY_POOLの状態であるもの
+ * @return なし
+ * @note 先頭タスクが抜けた事で後続タスクが獲得できる場合があるので，後続タスクの獲得も行う
+ */
+void get_mpl_waitque(TCB *tcb)
+{
+	MPLCB *mplcb = (MPLCB *)tcb->wait_info.wobjp;
+
+	remove_mpl_waitque(tcb);
+	wakeup_mpl_waitque(mplcb);
+}
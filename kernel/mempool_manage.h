@@ -0,0 +1,58 @@
+/*!
+ * @file ターゲット非依存部
+ * @brief 可変長メモリプール管理インターフェース
+ * @attention gcc4.5.x以外は試していない
+ * @note μITRON4.0仕様参考
+ */
+
+
+#ifndef _MEMPOOL_MANAGE_H_INCLUDED_
+#define _MEMPOOL_MANAGE_H_INCLUDED_
+
+
+/* os/kernel */
+#include "task.h"
+#include "tlsf.h"
+
+
+/*!
+ * @brief 可変長メモリプールコントロールブロック
+ * @note コントロールブロック，TLSF管理ブロック，プール領域の順にheapから連続して切り出す
+ */
+typedef struct _memorypool_struct {
+	ER_ID mplid;													/*! 可変長メモリプールID */
+	MPL_ATR atr;													/*! 待ちタスクをレディーへ戻す属性 */
+	int mplsz;														/*! プール領域のサイズ */
+	char *area;														/*! プール領域の先頭 */
+	TLSF_CNTRL tlsf;											/*! TLSF管理ブロック */
+	TCB *waithead;												/*! 獲得待ちキューの先頭 */
+	TCB *waittail;												/*! 獲得待ちキューの最後尾 */
+} MPLCB;
+
+
+/*!
+ * @brief 可変長メモリプール情報
+ */
+typedef struct _memorypool_infomation {
+	MPLCB *id_table[MEMORYPOOL_ID_NUM];		/*! 可変長メモリプールID変換テーブル */
+} MPL_INFO;
+
+
+/*! システムコールの処理(cre_mpl():可変長メモリプールの生成) */
+extern ER cre_mpl_isr(ER_ID mplid, MPL_ATR mplatr, int mplsz);
+
+/*! システムコールの処理(get_mpl(),tget_mpl():可変長メモリブロックの獲得) */
+extern ER get_mpl_isr(MPLCB *mplcb, int blksz, void **p_blk, int tmout);
+
+/*! システムコールの処理(rel_mpl():可変長メモリブロックの返却) */
+extern ER rel_mpl_isr(MPLCB *mplcb, void *blk);
+
+/*! 可変長メモリプールの待ちキューからタスクを抜き取る(rel_wai(),ter_tsk()用) */
+extern void get_mpl_waitque(TCB *tcb);
+
+
+/*! 可変長メモリプール情報 */
+extern MPL_INFO g_mpl_info;
+
+
+#endif
@@ -8,7 +8,9 @@
 /* os/kernel */
 #include "multi_timer.h"
 #include "kernel.h"
-#include "memory.h"
+#include "slab.h"
+/* os/kernel_svc */
+#include "kernel_svc/log_manage.h"
 /* os/c_lib */
 #include "c_lib/lib.h"
 /* os/target */
@@ -27,6 +29,9 @@
  */
 
 
+/*! タイマコントロールブロックのコンストラクタ */
+static void tmrcb_ctor(void *obj);
+
 /*! 差分のキューへタイマコントロールブロック挿入 */
 static void insert_tmrcb_diffque(TMRCB* newtbf);
 
@@ -37,11 +42,39 @@ static void next_tmrcb_diffque(void);
 /*! タイマ情報 */
 TMR_INFO g_timerque = {NULL, 1};
 
+/*! タイマコントロールブロックのスラブキャッシュ */
+static SLAB_CACHE sg_tmrcb_cache;
+
+
+/*!
+ * タイマコントロールブロックのコンストラクタ
+ * *obj : スラブから切り出したタイマコントロールブロック
+ */
+static void tmrcb_ctor(void *obj)
+{
+	TMRCB *tbf = (TMRCB *)obj;
+
+	tbf->next = tbf->prev = NULL;
+}
+
+
+/*!
+ * タイマコントロールブロックのスラブキャッシュの生成
+ * -kernel_obj_init()で動的メモリの初期化後に呼ぶ
+ * (返却値)E_PAR : パラメータエラー
+ * (返却値)E_OK : 正常終了
+ */
+ER tmr_cache_init(void)
+{
+	return slab_cache_create(&sg_tmrcb_cache, "tmrcb", sizeof(TMRCB), 16, 0, tmrcb_ctor);
+}
+
 
 /*! 周期タイマハンドラ */
 void cyclic_timer_handler1(void)
 {
 	DEBUG_LEVEL1_OUTMSG(" exection : cyclic_timer_handler1()\n");
+	LOG_TRACE(LOG_CAT_TIMER, LOG_EV_TIMER, g_current->init.tskid, LOG_TIMER_CYCLIC, 0);
 	expire_cycle_timer(0); /* タイマ満了処理 */
 }
 
@@ -54,10 +87,28 @@ void oneshot_timer_handler1(void)
 	DEBUG_LEVEL1_OUTMSG(" exection : oneshot_timer_handler()\n");
 	expire_oneshot_timer(1);
   cancel_timer(g_timerque.index); /* タイマキャンセル処理 */
+	/* 満了したタイマコントロールブロックのコールバックルーチンを呼ぶ */
+	if (g_timerque.tmrhead != NULL && g_timerque.tmrhead->func != NULL) {
+		LOG_TRACE(LOG_CAT_TIMER, LOG_EV_TIMER, g_current->init.tskid, LOG_TIMER_ONESHOT, g_timerque.tmrhead->func);
+		(*g_timerque.tmrhead->func)(g_timerque.tmrhead->argv);
+	}
 	next_tmrcb_diffque(); /* 差分のキューからタイマコントロールブロックの排除 */
 }
 
 
+/*!
+ * ワンショットタイマのベクタ割込みハンドラ(スケジューリング用タイマとしてFIQで受け付ける)
+ * irq : IRQ番号(デコード済み)
+ * (返却値)TRUE : コールバックルーチンでレディーが変更されるので，常にスケジューラを呼ぶ
+ */
+BOOL oneshot_timer_vector(INTRPT_TYPE irq)
+{
+	oneshot_timer_handler1();
+
+	return TRUE;
+}
+
+
 /*!
  * 差分のキューのノードを作成
  * 多少のすれ違い(タイマ割込みによるノード解放とシステムコールによるノード作成)の考慮
@@ -72,7 +123,7 @@ OBJP create_tmrcb_diffque(short flag, int request_sec, TMRRQ_OBJP rqobjp, TMR_CA
 {
 	TMRCB *newtbf;
 
-	newtbf = (TMRCB *)get_mpf_isr(sizeof(*newtbf)); /* 動的メモリ取得要求 */
+	newtbf = (TMRCB *)slab_alloc(&sg_tmrcb_cache); /* スラブキャッシュから取得 */
 
 	/* メモリが取得できない */
   if(newtbf == NULL) {
@@ -100,11 +151,11 @@ OBJP create_tmrcb_diffque(short flag, int request_sec, TMRRQ_OBJP rqobjp, TMR_CA
 static void insert_tmrcb_diffque(TMRCB* newtbf)
 {
 	TMRCB *worktbf, *tmptbf;
-	int time_now = 0; /* 現在までカウントしたタイマ値 */
+	int time_now = 0; /* 先頭ノードのタイマの残り時間 */
 	int diff_usec; /* 差分タイマ値 */
 	int i;
 
-	/* 現在までカウントタイマ値を取得 */
+	/* 先頭ノードのタイマの残り時間を取得(get_timervalue()はオーバーフローまでの残りを返す) */
   if (g_timerque.tmrhead != NULL) {
     time_now = (int)get_timervalue(g_timerque.index);
   }
@@ -121,7 +172,8 @@ static void insert_tmrcb_diffque(TMRCB* newtbf)
 	else {
 		/* (forの継続条件でtmptbf != NULLは指定できない) */
 		for (i = 0; worktbf != NULL; i++) {
-			diff_usec = worktbf->usec - time_now; /* 現在ノードのタイマ値 - 現在までカウントしたタイマ値 */
+			/* 先頭ノードはタイマの残り時間，以降のノードは差分値そのもの */
+			diff_usec = (i == 0) ? time_now : worktbf->usec;
 			/* ここから挿入操作 */
 			if (newtbf->usec < diff_usec) {
 				/* ここで差分をする(最後に挿入される以外は現在ノードの値も差分) */
@@ -180,8 +232,9 @@ static void next_tmrcb_diffque(void)
 		g_timerque.tmrhead = NULL;
 		DEBUG_LEVEL1_OUTMSG(" not timerque node : next tmrcb_diffque().\n");
 	}
-	/* タイマコントロールブロックの動的メモリ解放(カーネルが発行できるシステムコールはないため，内部関数を呼ぶ) */
-	rel_mpf_isr(worktbf);
+	/* タイマコントロールブロックをスラブキャッシュへ返却(コンストラクタ状態へ戻す) */
+	worktbf->next = worktbf->prev = NULL;
+	slab_free(&sg_tmrcb_cache, worktbf);
 }
 
 
@@ -203,12 +256,16 @@ void delete_tmrcb_diffque(TMRCB *deltbf)
 	*/
 	if (deltbf == g_timerque.tmrhead) {
 		g_timerque.tmrhead = deltbf->next;
-		g_timerque.tmrhead->prev = NULL;
-		cancel_timer(1);
-		/* まだタイマ要求があれば次の要求にうつる */
+		/* まだタイマ要求があれば次の要求にうつる(排除するノードの残り時間を引き継ぐ) */
 		if (g_timerque.tmrhead != NULL) {
+			g_timerque.tmrhead->prev = NULL;
+			g_timerque.tmrhead->usec += (int)get_timervalue(g_timerque.index);
+			cancel_timer(g_timerque.index);
 			start_oneshot_timer(g_timerque.index, g_timerque.tmrhead->usec); /* タイマをスタートさせる */
 		}
+		else {
+			cancel_timer(g_timerque.index);
+		}
 	}
 	/* タイマキューの最後から抜き取る */
 	else if (deltbf->next == NULL) {
@@ -225,8 +282,9 @@ void delete_tmrcb_diffque(TMRCB *deltbf)
 		deltbf->next->prev = deltbf->prev;
 	}
 	/*
-	* タイマコントロールブロックの動的メモリ解放
-	* メモリ解放を行うので，deltbfのポインタはNULLしておかなくてよい
+	* タイマコントロールブロックをスラブキャッシュへ返却
+	* コンストラクタ状態へ戻してから返却する
 	*/
-	rel_mpf_isr(deltbf);
+	deltbf->next = deltbf->prev = NULL;
+	slab_free(&sg_tmrcb_cache, deltbf);
 }
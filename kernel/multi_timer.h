@@ -46,6 +46,12 @@ extern void cyclic_timer_handler1(void);
 /*! ワンショットタイマハンドラ */
 extern void oneshot_timer_handler1(void);
 
+/*! ワンショットタイマのベクタ割込みハンドラ(FIQ) */
+extern BOOL oneshot_timer_vector(INTRPT_TYPE irq);
+
+/*! タイマコントロールブロックのスラブキャッシュの生成 */
+extern ER tmr_cache_init(void);
+
 /*! 差分のキューのノードを作成 */
 extern OBJP create_tmrcb_diffque(short flag, int request_sec, TMRRQ_OBJP rqobjp, TMR_CALLRTE func, void *argv);
 
@@ -220,7 +220,7 @@ static void schedule_fcfs(void)
 		}
 		/* initタスクは存在しない場合 */
 		else {
-			KERNEL_OUTMSG("error: schdule_fcfs() \n");
+			KERNEL_FATAL_OUTMSG("error: schdule_fcfs() \n");
 			down_system();
 		}
 	}
@@ -300,7 +300,7 @@ static void schedule_ps(void)
 		}
 		/* initタスクは存在しない場合 */
 		else {
-			KERNEL_OUTMSG("error: schdule_ps() \n");
+			KERNEL_FATAL_OUTMSG("error: schdule_ps() \n");
 			down_system();
 		}
 	}
@@ -393,8 +393,8 @@ void set_unrolled_schedule_val(int len, int exetim)
 */
 static void rmschedule_miss_handler(void)
 {
-	KERNEL_OUTMSG(" Rate Monotonic Deadline Miss task set\n");
-	KERNEL_OUTMSG(" OS sleep... Please push reset button\n");
+	KERNEL_FATAL_OUTMSG(" Rate Monotonic Deadline Miss task set\n");
+	KERNEL_FATAL_OUTMSG(" OS sleep... Please push reset button\n");
 	down_system(); /* kernelのフリーズ */
 	
 }
@@ -425,7 +425,7 @@ static void schedule_rms(void)
 		}
 		/* initタスクは存在しない場合 */
 		else {
-			KERNEL_OUTMSG("error: schdule_rms() \n");
+			KERNEL_FATAL_OUTMSG("error: schdule_rms() \n");
 			down_system();
 		}
 	}
@@ -446,8 +446,8 @@ static void schedule_rms(void)
 */
 static void dmschedule_miss_handler(void)
 {
-	KERNEL_OUTMSG(" Deadline Monotonic Deadline Miss task set\n");
-	KERNEL_OUTMSG(" OS sleep... Please push reset button\n");
+	KERNEL_FATAL_OUTMSG(" Deadline Monotonic Deadline Miss task set\n");
+	KERNEL_FATAL_OUTMSG(" OS sleep... Please push reset button\n");
 	down_system(); /* kernelのフリーズ */
 	
 }
@@ -478,7 +478,7 @@ static void schedule_dms(void)
 		}
 		/* initタスクは存在しない場合 */
 		else {
-			KERNEL_OUTMSG("error: schdule_dms() \n");
+			KERNEL_FATAL_OUTMSG("error: schdule_dms() \n");
 			down_system();
 		}
 	}
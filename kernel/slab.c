@@ -0,0 +1,160 @@
+/*!
+ * @file ターゲット非依存部<モジュール:slab.o>
+ * @brief カーネルオブジェクト用スラブキャッシュ
+ * @attention gcc4.5.x以外は試していない
+ * @note ・スラブはheapから連続領域として切り出し，返却しない
+ * 			 ・オブジェクトはキャッシュライン境界に配置し，スラブごとにカラーリングでずらす
+ * 			 ・獲得と返却はfreeリストのpopとpushのみとなる
+ */
+
+
+/* os/kernel */
+#include "slab.h"
+#include "kernel.h"
+#include "memory.h"
+/* os/c_lib */
+#include "c_lib/lib.h"
+
+
+/*! オブジェクトのfreeリストのリンクを求める */
+#define SLAB_LINK(cache, obj)		(*(void **)((char *)(obj) + (cache)->link_off))
+
+
+/*! スラブを1つ確保し，freeリストへつなぐ */
+static ER slab_grow(SLAB_CACHE *cache);
+
+
+/*! 登録済みスラブキャッシュリストの先頭 */
+SLAB_CACHE *g_slab_head = NULL;
+
+
+/*!
+ * @brief スラブを1つ確保し，freeリストへつなぐ
+ * @param[in] *cache:対象スラブキャッシュ
+ * @return エラーコード
+ *	@retval E_NOMEM:heap領域が不足,E_OK:正常終了
+ * @note コンストラクタはここで一度だけ呼ぶ
+ */
+static ER slab_grow(SLAB_CACHE *cache)
+{
+	int i, size;
+	char *area, *obj;
+
+	/* キャッシュライン境界への調整分とカラーリング分を余分に切り出す */
+	size = cache->stride * cache->slab_objs + SLAB_CACHE_LINE_SIZE * (cache->colors + 1);
+	if ((area = (char *)get_heap_area(size)) == NULL) {
+		return E_NOMEM;
+	}
+	area = (char *)(((UINT32)area + (SLAB_CACHE_LINE_SIZE - 1)) & ~(SLAB_CACHE_LINE_SIZE - 1));
+	area += SLAB_CACHE_LINE_SIZE * cache->next_color;
+	cache->next_color = (cache->next_color >= cache->colors) ? 0 : cache->next_color + 1;
+
+	/* 後ろから順につなぎ，先頭のオブジェクトから獲得されるようにする */
+	for (i = cache->slab_objs - 1; i >= 0; i--) {
+		obj = area + cache->stride * i;
+		if (cache->ctor != NULL) {
+			(*cache->ctor)(obj);
+		}
+		SLAB_LINK(cache, obj) = cache->freelist;
+		cache->freelist = obj;
+	}
+	cache->stat.total += cache->slab_objs;
+	cache->stat.slabs++;
+
+	return E_OK;
+}
+
+
+/*!
+ * @brief スラブキャッシュの生成
+ * @param[out] *cache:生成するスラブキャッシュ(実体は各カーネルオブジェクトの管理側で持つ)
+ * 	@arg NULL以外
+ * @param[in] *name:キャッシュ名
+ * 	@arg NULL以外
+ * @param[in] size:オブジェクトのサイズ
+ * 	@arg 0より大きい
+ * @param[in] slab_objs:1スラブあたりのオブジェクト数
+ * 	@arg 0より大きい
+ * @param[in] colors:カラーリング数(スラブごとにキャッシュライン単位でずらす数)
+ * 	@arg 0(カラーリングなし)以上
+ * @param[in] ctor:コンストラクタ
+ * 	@arg NULL(なし)も可
+ * @return エラーコード
+ *	@retval E_PAR:パラメータエラー,E_OK:正常終了
+ * @note スラブは最初の獲得時に確保する
+ */
+ER slab_cache_create(SLAB_CACHE *cache, char *name, int size, int slab_objs, int colors, SLAB_CTOR ctor)
+{
+	int i;
+
+	if (size <= 0 || slab_objs <= 0 || colors < 0) {
+		return E_PAR;
+	}
+
+	memset(cache, 0, sizeof(*cache));
+	/* キャッシュ名の設定(最大値を超えた分は切り捨て) */
+	for (i = 0; i < SLAB_NAME_SIZE - 1 && name[i] != '\0'; i++) {
+		cache->name[i] = name[i];
+	}
+	cache->objsize = size;
+	cache->link_off = (size + 3) & ~3;
+	cache->stride = (cache->link_off + sizeof(void *) + (SLAB_CACHE_LINE_SIZE - 1)) & ~(SLAB_CACHE_LINE_SIZE - 1);
+	cache->slab_objs = slab_objs;
+	cache->colors = colors;
+	cache->ctor = ctor;
+	cache->freelist = NULL;
+
+	/* 登録済みキャッシュリストへつなぐ */
+	cache->next = g_slab_head;
+	g_slab_head = cache;
+
+	return E_OK;
+}
+
+
+/*!
+ * @brief スラブキャッシュからオブジェクトを獲得
+ * @param[in] *cache:対象スラブキャッシュ
+ * 	@arg NULL以外
+ * @return 獲得したオブジェクト(コンストラクタ状態)
+ *	@retval NULL:heap領域が不足
+ */
+void* slab_alloc(SLAB_CACHE *cache)
+{
+	void *obj;
+
+	/* 空きオブジェクトがなければスラブを追加 */
+	if (cache->freelist == NULL && slab_grow(cache) != E_OK) {
+		cache->stat.fails++;
+		KERNEL_OUTMSG("error: slab_alloc() \n");
+		return NULL;
+	}
+	obj = cache->freelist;
+	cache->freelist = SLAB_LINK(cache, obj);
+
+	cache->stat.allocs++;
+	if (++cache->stat.inuse > cache->stat.peak) {
+		cache->stat.peak = cache->stat.inuse;
+	}
+
+	return obj;
+}
+
+
+/*!
+ * @brief スラブキャッシュへオブジェクトを返却
+ * @param[in] *cache:対象スラブキャッシュ
+ * 	@arg NULL以外
+ * @param[in] *obj:返却するオブジェクト
+ * 	@arg slab_alloc()で獲得したもの
+ * @return なし
+ * @attention 返却するオブジェクトは呼び出し側でコンストラクタ状態へ戻しておく事
+ */
+void slab_free(SLAB_CACHE *cache, void *obj)
+{
+	SLAB_LINK(cache, obj) = cache->freelist;
+	cache->freelist = obj;
+
+	cache->stat.frees++;
+	cache->stat.inuse--;
+}
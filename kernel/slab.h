@@ -0,0 +1,72 @@
+/*!
+ * @file ターゲット非依存部
+ * @brief カーネルオブジェクト用スラブキャッシュインターフェース
+ * @attention gcc4.5.x以外は試していない
+ * @note Bonwickのスラブアロケータ参考
+ */
+
+
+#ifndef _SLAB_H_INCLUDED_
+#define _SLAB_H_INCLUDED_
+
+
+/* os/kernel */
+#include "defines.h"
+
+
+#define SLAB_CACHE_LINE_SIZE			64				/*! キャッシュラインサイズ(Cortex-A8 L1) */
+#define SLAB_NAME_SIZE						16				/*! キャッシュ名の最大値 */
+
+
+/*! オブジェクトのコンストラクタ(スラブ生成時に一度だけ呼ばれる) */
+typedef void (*SLAB_CTOR)(void *obj);
+
+
+/*!
+ * @brief スラブキャッシュの統計情報
+ */
+typedef struct _slab_statistics {
+	int total;														/*! 確保済みオブジェクト数 */
+	int inuse;														/*! 使用中オブジェクト数 */
+	int peak;															/*! 使用中オブジェクト数の最大値 */
+	int slabs;														/*! 確保済みスラブ数 */
+	int allocs;														/*! 獲得回数 */
+	int frees;														/*! 返却回数 */
+	int fails;														/*! 獲得失敗回数(heap不足) */
+} SLAB_STAT;
+
+
+/*!
+ * @brief スラブキャッシュ
+ * @note freeリストのリンクはオブジェクトの後ろに置くので，返却されたオブジェクトもコンストラクタ状態を保つ
+ */
+typedef struct _slab_cache {
+	struct _slab_cache *next;							/*! 登録済みキャッシュリストの次ポインタ */
+	char name[SLAB_NAME_SIZE];						/*! キャッシュ名 */
+	int objsize;													/*! オブジェクトのサイズ */
+	int link_off;													/*! freeリストのリンクの位置(オブジェクト先頭から) */
+	int stride;														/*! オブジェクトの間隔(キャッシュライン境界に切り上げ) */
+	int slab_objs;												/*! 1スラブあたりのオブジェクト数 */
+	int colors;														/*! カラーリング数(0でカラーリングなし) */
+	int next_color;												/*! 次のスラブのカラー */
+	SLAB_CTOR ctor;												/*! コンストラクタ(NULLの場合は呼ばない) */
+	void *freelist;												/*! 空きオブジェクトリスト */
+	SLAB_STAT stat;												/*! 統計情報 */
+} SLAB_CACHE;
+
+
+/*! スラブキャッシュの生成 */
+extern ER slab_cache_create(SLAB_CACHE *cache, char *name, int size, int slab_objs, int colors, SLAB_CTOR ctor);
+
+/*! スラブキャッシュからオブジェクトを獲得 */
+extern void* slab_alloc(SLAB_CACHE *cache);
+
+/*! スラブキャッシュへオブジェクトを返却 */
+extern void slab_free(SLAB_CACHE *cache, void *obj);
+
+
+/*! 登録済みスラブキャッシュリストの先頭 */
+extern SLAB_CACHE *g_slab_head;
+
+
+#endif
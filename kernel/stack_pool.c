@@ -0,0 +1,182 @@
+/*!
+ * @file ターゲット非依存部<モジュール:stack_pool.o>
+ * @brief タスクスタックプール
+ * @attention gcc4.5.x以外は試していない
+ * @note ・リンカスクリプトで定義しているタスクスタック領域(_tskstack～_tskstack_end)を2のべき乗の
+ * 				 バケットごとのfreeリストで管理し，del_tsk(),exd_tsk()で返却されたスタックを再利用する
+ * 			 ・タスクスタックはheapメモリを使用しない(スタックトレースをしやすくするため)
+ * 			 ・獲得時にスタック領域のクリアは行わない(初期コンテキストはtsk_stack_init()で積む)
+ * 			 ・STACK_PAINT定義時はスタック領域をパターンで塗りつぶし，最大使用量を求められるようにする
+ */
+
+
+/* os/kernel */
+#include "stack_pool.h"
+
+
+/*!
+ * @brief 空きスタック(freeリストのリンクはスタック領域の下方アドレスに置く)
+ */
+typedef struct _stack_free {
+	struct _stack_free *next;							/*! freeリストの次ポインタ */
+} STACK_FREE;
+
+
+/*! 要求サイズからバケット番号を求める */
+static int stack_pool_bucket(int size);
+
+
+/*! バケットごとの空きスタックリスト */
+static STACK_FREE *sg_stack_free[STACK_POOL_BUCKET_NUM];
+
+/*! タスクスタック領域の未使用位置 */
+static char *sg_stack_area = NULL;
+
+
+/*!
+ * @brief 要求サイズからバケット番号を求める
+ * @param[in] size:要求サイズ
+ * 	@arg 0より大きい
+ * @return バケット番号
+ *	@retval STACK_POOL_BUCKET_NUM以上:要求サイズが大きすぎる
+ */
+static int stack_pool_bucket(int size)
+{
+	int log2;
+
+	if (size <= STACK_POOL_MIN_SIZE) {
+		return 0;
+	}
+	log2 = 32 - __builtin_clz((UINT32)size - 1); /* 2のべき乗へ切り上げ */
+
+	return log2 - STACK_POOL_MIN_LOG2;
+}
+
+
+/*!
+ * @brief タスクスタックプールの初期化
+ * @param[in] なし
+ * @param[out] なし
+ * @return なし
+ */
+void stack_pool_init(void)
+{
+	int i;
+	extern char _tskstack; /* リンカスクリプトで定義されるスタック領域 */
+
+	sg_stack_area = &_tskstack;
+	for (i = 0; i < STACK_POOL_BUCKET_NUM; i++) {
+		sg_stack_free[i] = NULL;
+	}
+}
+
+
+/*!
+ * @brief タスクスタックプールからスタック領域を獲得
+ * @param[in,out] *p_size:要求サイズ(獲得したバケットのサイズに書き換える)
+ * 	@arg 0より大きい
+ * @return スタック領域の下方アドレス
+ *	@retval NULL:スタック領域が確保できない
+ * @note 同じバケットの空きスタック，未使用領域，大きいバケットの空きスタックの順に探す
+ */
+char* get_stack_pool(int *p_size)
+{
+	int bucket, size;
+	STACK_FREE *sp;
+	extern char _tskstack_end; /* リンカスクリプトで定義されるスタック領域の終端 */
+
+	if ((bucket = stack_pool_bucket(*p_size)) >= STACK_POOL_BUCKET_NUM) {
+		return NULL;
+	}
+	size = STACK_POOL_MIN_SIZE << bucket;
+
+	/* 同じバケットの空きスタックを再利用 */
+	if ((sp = sg_stack_free[bucket]) != NULL) {
+		sg_stack_free[bucket] = sp->next;
+	}
+	/* 未使用領域から切り出す */
+	else if (&_tskstack_end - sg_stack_area >= size) {
+		sp = (STACK_FREE *)sg_stack_area;
+		sg_stack_area += size;
+	}
+	/* 大きいバケットの空きスタックを丸ごと使う */
+	else {
+		for (bucket++; bucket < STACK_POOL_BUCKET_NUM; bucket++) {
+			if ((sp = sg_stack_free[bucket]) != NULL) {
+				sg_stack_free[bucket] = sp->next;
+				size = STACK_POOL_MIN_SIZE << bucket;
+				break;
+			}
+		}
+		if (sp == NULL) {
+			return NULL;
+		}
+	}
+	*p_size = size;
+
+	return (char *)sp;
+}
+
+
+/*!
+ * @brief タスクスタックプールへスタック領域を返却
+ * @param[in] *base:スタック領域の下方アドレス
+ * 	@arg get_stack_pool()で獲得したもの
+ * @param[in] size:get_stack_pool()で書き換えられたサイズ
+ * 	@arg 特になし
+ * @return なし
+ */
+void rel_stack_pool(char *base, int size)
+{
+	int bucket = stack_pool_bucket(size);
+	STACK_FREE *sp = (STACK_FREE *)base;
+
+	sp->next = sg_stack_free[bucket];
+	sg_stack_free[bucket] = sp;
+}
+
+
+#ifdef STACK_PAINT
+
+/*!
+ * @brief スタック領域をパターンで塗りつぶす
+ * @param[in] *base:スタック領域の下方アドレス
+ * 	@arg 4byte境界
+ * @param[in] size:スタック領域のサイズ
+ * 	@arg 4の倍数
+ * @return なし
+ * @note タスク生成時(初期コンテキストを積む前)に呼ぶ
+ */
+void paint_stack_pool(char *base, int size)
+{
+	UINT32 *p = (UINT32 *)base;
+	UINT32 *end = (UINT32 *)(base + size);
+
+	while (p < end) {
+		*p++ = STACK_PAINT_PATTERN;
+	}
+}
+
+
+/*!
+ * @brief スタック領域の最大使用量(ハイウォーターマーク)を求める
+ * @param[in] *base:スタック領域の下方アドレス
+ * 	@arg paint_stack_pool()で塗りつぶしたもの
+ * @param[in] size:スタック領域のサイズ
+ * 	@arg 4の倍数
+ * @return 最大使用量(byte)
+ * @note スタックは上方から伸びるので，下方からパターンが残っている間をワード単位で数える
+ */
+int scan_stack_pool(char *base, int size)
+{
+	UINT32 *p = (UINT32 *)base;
+	UINT32 *end = (UINT32 *)(base + size);
+
+	while (p < end && *p == STACK_PAINT_PATTERN) {
+		p++;
+	}
+
+	return (int)((char *)end - (char *)p);
+}
+
+#endif
@@ -0,0 +1,41 @@
+/*!
+ * @file ターゲット非依存部
+ * @brief タスクスタックプールインターフェース
+ * @attention gcc4.5.x以外は試していない
+ */
+
+
+#ifndef _STACK_POOL_H_INCLUDED_
+#define _STACK_POOL_H_INCLUDED_
+
+
+/* os/kernel */
+#include "defines.h"
+
+
+#define STACK_POOL_MIN_LOG2					8											/*! 最小バケットのサイズ(2のべき乗) */
+#define STACK_POOL_BUCKET_NUM				6											/*! バケット数(256byte～8Kbyte) */
+#define STACK_POOL_MIN_SIZE					(1 << STACK_POOL_MIN_LOG2)			/*! 最小バケットのサイズ */
+#define STACK_POOL_MAX_SIZE					(STACK_POOL_MIN_SIZE << (STACK_POOL_BUCKET_NUM - 1))	/*! 最大バケットのサイズ */
+#define STACK_PAINT_PATTERN					0xDEADBEEF						/*! スタックペイントのパターン */
+
+
+/*! タスクスタックプールの初期化 */
+extern void stack_pool_init(void);
+
+/*! タスクスタックプールからスタック領域を獲得 */
+extern char* get_stack_pool(int *p_size);
+
+/*! タスクスタックプールへスタック領域を返却 */
+extern void rel_stack_pool(char *base, int size);
+
+#ifdef STACK_PAINT
+/*! スタック領域をパターンで塗りつぶす */
+extern void paint_stack_pool(char *base, int size);
+
+/*! スタック領域の最大使用量(ハイウォーターマーク)を求める */
+extern int scan_stack_pool(char *base, int size);
+#endif
+
+
+#endif
@@ -13,6 +13,22 @@
 #include "c_lib/lib.h"
 
 
+/*!
+ * レジスタ渡しのトラップ発行
+ * -引数をr0～r3へ，システムコール番号をSWIの即値へ設定し，返却値はr0で受け取る
+ * -SYSCALL_PARAMCBを使用しないので，パラメータの退避とissue_trap_syscall()はいらない
+ * -例外からの復帰でr0以外のレジスタは復旧されるが，ポインタ引数で書き込まれる事があるのでmemoryを破壊指定する
+ */
+#define ISSUE_TRAP_RSYSCALL(type, a0, a1, a2, a3) ({ \
+	register UINT32 r0 asm("r0") = (UINT32)(a0); \
+	register UINT32 r1 asm("r1") = (UINT32)(a1); \
+	register UINT32 r2 asm("r2") = (UINT32)(a2); \
+	register UINT32 r3 asm("r3") = (UINT32)(a3); \
+	asm volatile ("swi %4" : "+r" (r0) : "r" (r1), "r" (r2), "r" (r3), "i" (ISR_RTYPE_BASE + (type)) : "memory"); \
+	(ER)r0; \
+})
+
+
 /* システムコール */
 /*!
 * 割込み出入り口前のパラメータ類の退避(mz_acre_tsk():タスクコントロールブロックの生成(ID自動割付))
@@ -195,6 +211,7 @@ ER mz_ter_tsk(ER_ID tskid)
 
 /*!
 * 割込み出入り口前のパラメータ類の退避(mz_get_pri():スレッドの優先度取得)
+* 自タスクの優先度取得はカーネルデータページを読むだけとし，トラップを発行しない
 * tskid : 優先度を参照するタスクID
 * *p_tskpri : 参照優先度を格納するポインタ(実体はユーザタスク側で宣言されているもの)
 * (返却値)E_ID : エラー終了(タスクIDが不正)
@@ -206,6 +223,19 @@ ER mz_ter_tsk(ER_ID tskid)
 ER mz_get_pri(ER_ID tskid, int *p_tskpri)
 {
 	SYSCALL_PARAMCB param;
+	T_RTSK rtsk;
+	ER ercd;
+
+	/* 自タスクの場合はカーネルデータページを読む(トラップは発行しない) */
+	if (p_tskpri != NULL) {
+		kdata_read_tsk(&rtsk, &ercd);
+		if (tskid == rtsk.tskid) {
+			if (ercd == E_OK) {
+				*p_tskpri = rtsk.priority;
+			}
+			return ercd;
+		}
+	}
 
 	/* パラメータ退避 */
 	param.un.get_pri.tskid = tskid;
@@ -266,6 +296,31 @@ ER mz_slp_tsk(void)
 }
 
 
+/*!
+* 割込み出入り口前のパラメータ類の退避(mz_tslp_tsk():自タスクの起床待ち(タイムアウトあり))
+* tmout : タイムアウト時間(msec.TMO_POLでポーリング，TMO_FEVRで永久待ち)
+* (返却値)E_NOSPT : 未サポート
+* (返却値)E_PAR : パラメータエラー
+* (返却値)E_RLWAI : 待ち状態の強制解除
+* (返却値)E_TMOUT : ポーリング失敗またはタイムアウト
+* (返却値)E_OK : 正常終了(起床された)
+*/
+ER mz_tslp_tsk(int tmout)
+{
+	SYSCALL_PARAMCB param;
+
+	/* パラメータ退避 */
+	param.un.tslp_tsk.tmout = tmout;
+	/* トラップ発行 */
+	issue_trap_syscall(ISR_TYPE_TSLP_TSK, &param, (OBJP)(&(param.un.tslp_tsk.ret)));
+	asm volatile ("swi #23");
+
+	/* 割込み復帰後はここへもどってくる */
+
+	return param.un.tslp_tsk.ret;
+}
+
+
 /*!
 * 割込み出入り口前のパラメータ類の退避(mz_wup_tsk():タスクの起床)
 * tskid : タスクの起床するタスクID
@@ -380,6 +435,371 @@ ER mz_sel_schdul(SCHDUL_TYPE type, long param)
 }
 
 
+/*!
+* 割込み出入り口前のパラメータ類の退避(mz_cre_mpl():可変長メモリプールの生成)
+* mplid : 生成する可変長メモリプールID
+* mplatr : 獲得待ちタスクをレディーへ戻す属性
+* mplsz : プール領域のサイズ
+* (返却値)E_ID : エラー終了(可変長メモリプールIDが不正)
+* (返却値)E_OBJ : エラー終了(対象可変長メモリプールがすでに生成されている)
+* (返却値)E_PAR : パラメータエラー
+* (返却値)E_NOMEM : heap領域が不足
+* (返却値)E_OK : 正常終了
+*/
+ER mz_cre_mpl(ER_ID mplid, MPL_ATR mplatr, int mplsz)
+{
+  SYSCALL_PARAMCB param;
+
+	/* パラメータ退避 */
+  param.un.cre_mpl.mplid = mplid;
+  param.un.cre_mpl.mplatr = mplatr;
+  param.un.cre_mpl.mplsz = mplsz;
+	/* トラップ発行 */
+  issue_trap_syscall(ISR_TYPE_CRE_MPL, &param, (OBJP)(&(param.un.cre_mpl.ret)));
+	asm volatile ("swi #17");
+
+	/* 割込み復帰後はここへもどってくる */
+
+  return param.un.cre_mpl.ret;
+}
+
+
+/*!
+* 割込み出入り口前のパラメータ類の退避(mz_get_mpl():可変長メモリブロックの獲得)
+* mplid : 可変長メモリプールID
+* blksz : 獲得するブロックのサイズ
+* *p_blk : 獲得したブロックの先頭番地を格納する領域
+* (返却値)E_ID : エラー終了(可変長メモリプールIDが不正)
+* (返却値)E_NOEXS : エラー終了(対象可変長メモリプールが未生成)
+* (返却値)E_PAR : パラメータエラー
+* (返却値)E_RLWAI : 待ち状態の強制解除
+* (返却値)E_OK : 正常終了
+*/
+ER mz_get_mpl(ER_ID mplid, int blksz, void **p_blk)
+{
+  SYSCALL_PARAMCB param;
+
+	/* パラメータ退避 */
+  param.un.get_mpl.mplid = mplid;
+  param.un.get_mpl.blksz = blksz;
+  param.un.get_mpl.p_blk = p_blk;
+  param.un.get_mpl.tmout = TMO_FEVR;
+	/* トラップ発行 */
+  issue_trap_syscall(ISR_TYPE_GET_MPL, &param, (OBJP)(&(param.un.get_mpl.ret)));
+	asm volatile ("swi #18");
+
+	/* 割込み復帰後はここへもどってくる */
+
+  return param.un.get_mpl.ret;
+}
+
+
+/*!
+* 割込み出入り口前のパラメータ類の退避(mz_tget_mpl():可変長メモリブロックの獲得(タイムアウトあり))
+* mplid : 可変長メモリプールID
+* blksz : 獲得するブロックのサイズ
+* *p_blk : 獲得したブロックの先頭番地を格納する領域
+* tmout : タイムアウト時間(msec.TMO_POLでポーリング，TMO_FEVRで永久待ち)
+* (返却値)E_ID : エラー終了(可変長メモリプールIDが不正)
+* (返却値)E_NOEXS : エラー終了(対象可変長メモリプールが未生成)
+* (返却値)E_PAR : パラメータエラー
+* (返却値)E_RLWAI : 待ち状態の強制解除
+* (返却値)E_TMOUT : ポーリング失敗またはタイムアウト
+* (返却値)E_OK : 正常終了
+*/
+ER mz_tget_mpl(ER_ID mplid, int blksz, void **p_blk, int tmout)
+{
+  SYSCALL_PARAMCB param;
+
+	/* パラメータ退避 */
+  param.un.get_mpl.mplid = mplid;
+  param.un.get_mpl.blksz = blksz;
+  param.un.get_mpl.p_blk = p_blk;
+  param.un.get_mpl.tmout = tmout;
+	/* トラップ発行 */
+  issue_trap_syscall(ISR_TYPE_TGET_MPL, &param, (OBJP)(&(param.un.get_mpl.ret)));
+	asm volatile ("swi #19");
+
+	/* 割込み復帰後はここへもどってくる */
+
+  return param.un.get_mpl.ret;
+}
+
+
+/*!
+* 割込み出入り口前のパラメータ類の退避(mz_rel_mpl():可変長メモリブロックの返却)
+* mplid : 可変長メモリプールID
+* *blk : 返却するブロックの先頭番地
+* (返却値)E_ID : エラー終了(可変長メモリプールIDが不正)
+* (返却値)E_NOEXS : エラー終了(対象可変長メモリプールが未生成)
+* (返却値)E_PAR : エラー終了(対象可変長メモリプールのブロックではない)
+* (返却値)E_OK : 正常終了
+*/
+ER mz_rel_mpl(ER_ID mplid, void *blk)
+{
+  SYSCALL_PARAMCB param;
+
+	/* パラメータ退避 */
+  param.un.rel_mpl.mplid = mplid;
+  param.un.rel_mpl.blk = blk;
+	/* トラップ発行 */
+  issue_trap_syscall(ISR_TYPE_REL_MPL, &param, (OBJP)(&(param.un.rel_mpl.ret)));
+	asm volatile ("swi #20");
+
+	/* 割込み復帰後はここへもどってくる */
+
+  return param.un.rel_mpl.ret;
+}
+
+
+/*!
+* 割込み出入り口前のパラメータ類の退避(mz_ref_stk():タスクスタックの使用量参照)
+* tskid : 参照するタスクID
+* *p_stksz : スタックサイズを格納するポインタ(実体はユーザタスク側で宣言されているもの)
+* *p_stkused : スタックの最大使用量を格納するポインタ(実体はユーザタスク側で宣言されているもの)
+* (返却値)E_ID : エラー終了(タスクIDが不正)
+* (返却値)E_NOEXS : エラー終了(タスクが未登録状態)
+* (返却値)E_PAR : エラー終了(格納するポインタが不正)
+* (返却値)E_NOSPT : 未サポート(STACK_PAINT未定義)
+* (返却値)E_OK : 正常終了
+*/
+ER mz_ref_stk(ER_ID tskid, int *p_stksz, int *p_stkused)
+{
+  SYSCALL_PARAMCB param;
+
+	/* パラメータ退避 */
+  param.un.ref_stk.tskid = tskid;
+  param.un.ref_stk.p_stksz = p_stksz;
+  param.un.ref_stk.p_stkused = p_stkused;
+	/* トラップ発行 */
+  issue_trap_syscall(ISR_TYPE_REF_STK, &param, (OBJP)(&(param.un.ref_stk.ret)));
+	asm volatile ("swi #21");
+
+	/* 割込み復帰後はここへもどってくる */
+
+  return param.un.ref_stk.ret;
+}
+
+
+/*!
+* 割込み出入り口前のパラメータ類の退避(mz_batch():システムコールの一括発行)
+* *entry : 発行するシステムコールのエントリ配列(実体はユーザタスク側で宣言されているもの)
+* num : エントリ数
+* (返却値)E_PAR : エラー終了(エントリ配列が不正)
+* (返却値)E_OK : 正常終了(各エントリの結果はentry[].ercdとentry[].paramのretへ格納)
+* -entry[].ercd(EV_NORTE) : 未登録のシステムコール
+* -entry[].ercd(E_NOSPT) : 一括発行できないシステムコール(ext_tsk,exd_tsk,slp_tsk,tslp_tsk,get_mpl,tget_mpl,batch)
+* -entry[].ercd(E_OK) : 実行した
+*/
+ER mz_batch(SYSCALL_BATCH *entry, int num)
+{
+  SYSCALL_PARAMCB param;
+
+	/* パラメータ退避 */
+  param.un.batch.entry = entry;
+  param.un.batch.num = num;
+	/* トラップ発行 */
+  issue_trap_syscall(ISR_TYPE_BATCH, &param, (OBJP)(&(param.un.batch.ret)));
+	asm volatile ("swi #22");
+
+	/* 割込み復帰後はここへもどってくる */
+
+  return param.un.batch.ret;
+}
+
+
+/*
+* fast path syscall
+* カーネルデータページを直接読む参照系のシステムコール(トラップは発行しない)
+*/
+/*!
+* トラップなし(mz_get_tid():自タスクのID参照)
+* *p_tskid : 自タスクのIDを格納するポインタ
+* (返却値)E_PAR : パラメータエラー
+* (返却値)E_OK : 正常終了
+*/
+ER mz_get_tid(ER_ID *p_tskid)
+{
+	T_RTSK rtsk;
+	ER ercd;
+
+	if (p_tskid == NULL) {
+		return E_PAR;
+	}
+	kdata_read_tsk(&rtsk, &ercd);
+	*p_tskid = rtsk.tskid;
+
+	return E_OK;
+}
+
+
+/*!
+* トラップなし(mz_ref_tsk():自タスクの状態参照)
+* *pk_rtsk : 自タスクのID，優先度，状態を格納するポインタ(一貫性のあるスナップショット)
+* (返却値)E_PAR : パラメータエラー
+* (返却値)E_OK : 正常終了
+*/
+ER mz_ref_tsk(T_RTSK *pk_rtsk)
+{
+	ER ercd;
+
+	if (pk_rtsk == NULL) {
+		return E_PAR;
+	}
+	kdata_read_tsk(pk_rtsk, &ercd);
+
+	return E_OK;
+}
+
+
+/*!
+* トラップなし(mz_get_tim():単調増加時刻の参照)
+* *p_systim : 単調増加時刻(usec，32KHz同期カウンタの分解能)を格納するポインタ
+* (返却値)E_PAR : パラメータエラー
+* (返却値)E_OK : 正常終了
+*/
+ER mz_get_tim(UINT64 *p_systim)
+{
+	if (p_systim == NULL) {
+		return E_PAR;
+	}
+	*p_systim = kdata_read_tim();
+
+	return E_OK;
+}
+
+/*
+* register syscall
+* レジスタ渡しのシステムコール(引数が4つ以下のもの)
+* 待ち解除時の返却値はタスクコンテキストのr0へ書き込まれる
+*/
+/*!
+* レジスタ渡しのトラップ発行(mr_del_tsk():タスクの排除)
+* tskid : 排除するタスクID
+* (返却値)mz_del_tsk()と同じ
+*/
+ER mr_del_tsk(ER_ID tskid)
+{
+	return ISSUE_TRAP_RSYSCALL(ISR_TYPE_DEL_TSK, tskid, 0, 0, 0);
+}
+
+
+/*!
+* レジスタ渡しのトラップ発行(mr_sta_tsk():タスクの起動)
+* tskid : 起動するタスクID
+* (返却値)mz_sta_tsk()と同じ
+*/
+ER mr_sta_tsk(ER_ID tskid)
+{
+	return ISSUE_TRAP_RSYSCALL(ISR_TYPE_STA_TSK, tskid, 0, 0, 0);
+}
+
+
+/*!
+* レジスタ渡しのトラップ発行(mr_ter_tsk():タスクの強制終了)
+* tskid : 強制終了するタスクID
+* (返却値)mz_ter_tsk()と同じ
+*/
+ER mr_ter_tsk(ER_ID tskid)
+{
+	return ISSUE_TRAP_RSYSCALL(ISR_TYPE_TER_TSK, tskid, 0, 0, 0);
+}
+
+
+/*!
+* レジスタ渡しのトラップ発行(mr_get_pri():タスクの優先度取得)
+* tskid : 優先度を参照するタスクID
+* *p_tskpri : 参照優先度を格納するポインタ(実体はユーザタスク側で宣言されているもの)
+* (返却値)mz_get_pri()と同じ
+*/
+ER mr_get_pri(ER_ID tskid, int *p_tskpri)
+{
+	return ISSUE_TRAP_RSYSCALL(ISR_TYPE_GET_PRI, tskid, p_tskpri, 0, 0);
+}
+
+
+/*!
+* レジスタ渡しのトラップ発行(mr_chg_pri():タスクの優先度変更)
+* tskid : 優先度を変更するタスクID
+* tskpri : 変更する優先度
+* (返却値)mz_chg_pri()と同じ
+*/
+ER mr_chg_pri(ER_ID tskid, int tskpri)
+{
+	return ISSUE_TRAP_RSYSCALL(ISR_TYPE_CHG_PRI, tskid, tskpri, 0, 0);
+}
+
+
+/*!
+* レジスタ渡しのトラップ発行(mr_slp_tsk():自タスクの起床待ち)
+* (返却値)mz_slp_tsk()と同じ
+*/
+ER mr_slp_tsk(void)
+{
+	return ISSUE_TRAP_RSYSCALL(ISR_TYPE_SLP_TSK, 0, 0, 0, 0);
+}
+
+
+/*!
+* レジスタ渡しのトラップ発行(mr_wup_tsk():タスクの起床)
+* tskid : 起床するタスクID
+* (返却値)mz_wup_tsk()と同じ
+*/
+ER mr_wup_tsk(ER_ID tskid)
+{
+	return ISSUE_TRAP_RSYSCALL(ISR_TYPE_WUP_TSK, tskid, 0, 0, 0);
+}
+
+
+/*!
+* レジスタ渡しのトラップ発行(mr_rel_wai():待ち状態強制解除)
+* tskid : 待ち状態を強制解除するタスクID
+* (返却値)mz_rel_wai()と同じ
+*/
+ER mr_rel_wai(ER_ID tskid)
+{
+	return ISSUE_TRAP_RSYSCALL(ISR_TYPE_REL_WAI, tskid, 0, 0, 0);
+}
+
+
+/*!
+* レジスタ渡しのトラップ発行(mr_cre_mpl():可変長メモリプールの生成)
+* mplid : 可変長メモリプールID
+* mplatr : 待ちタスクをレディーへ戻す属性
+* mplsz : プール領域のサイズ
+* (返却値)mz_cre_mpl()と同じ
+*/
+ER mr_cre_mpl(ER_ID mplid, MPL_ATR mplatr, int mplsz)
+{
+	return ISSUE_TRAP_RSYSCALL(ISR_TYPE_CRE_MPL, mplid, mplatr, mplsz, 0);
+}
+
+
+/*!
+* レジスタ渡しのトラップ発行(mr_rel_mpl():可変長メモリブロックの返却)
+* mplid : 可変長メモリプールID
+* *blk : 返却するブロックの先頭番地
+* (返却値)mz_rel_mpl()と同じ
+*/
+ER mr_rel_mpl(ER_ID mplid, void *blk)
+{
+	return ISSUE_TRAP_RSYSCALL(ISR_TYPE_REL_MPL, mplid, blk, 0, 0);
+}
+
+
+/*!
+* レジスタ渡しのトラップ発行(mr_ref_stk():タスクスタックの使用量参照)
+* tskid : 参照するタスクID
+* *p_stksz : スタックサイズを格納するポインタ
+* *p_stkused : スタックの最大使用量を格納するポインタ
+* (返却値)mz_ref_stk()と同じ
+*/
+ER mr_ref_stk(ER_ID tskid, int *p_stksz, int *p_stkused)
+{
+	return ISSUE_TRAP_RSYSCALL(ISR_TYPE_REF_STK, tskid, p_stksz, p_stkused, 0);
+}
+
+
 /*
 * interrput syscall
 * 非タスクコンテキストから呼び出すシステムコール(タスクの切り替えは行わない)
@@ -396,14 +816,7 @@ ER mz_sel_schdul(SCHDUL_TYPE type, long param)
 ER mz_iacre_tsk(SYSCALL_PARAMCB *par)
 {
 	SYSCALL_PARAMCB param;
-	/* iacre_tskの延長でget_tsk_readyque()が呼ばれるとg_currentが書き換えられるので一時退避 */
-	TCB *tmptcb = g_current;
-	/*
-	* システムコール割込みハンドラの延長で非タスクコンテキスト用システムコールが呼ばれた時は，
-	* syscall_info.flagが書き換えられるため退避
-	*/
-	SYSCALL_TYPE tmp_flag = g_current->syscall_info.flag;
-	
+
 	/* パラメータ退避 */
   param.un.acre_tsk.func = par->un.acre_tsk.func;
   param.un.acre_tsk.name = par->un.acre_tsk.name;
@@ -418,10 +831,6 @@ ER mz_iacre_tsk(SYSCALL_PARAMCB *par)
 	/* トラップは発行しない(単なる関数呼び出し) */
   isyscall_intr(ISR_TYPE_IACRE_TSK, &param);
 
-	/* 実行状態タスクを前の状態へ戻す */
-	g_current = tmptcb;
-	g_current->syscall_info.flag = tmp_flag;
-
 	return param.un.acre_tsk.ret;
 }
 
@@ -433,28 +842,23 @@ ER mz_iacre_tsk(SYSCALL_PARAMCB *par)
 * (返却値)E_NOEXS エラー終了(対象タスクが未登録)
 * (返却値)E_OK : 正常終了
 * (返却値)E_OBJ : エラー終了(タスクが休止状態ではない)
+* (返却値)E_QOVR : 要求リングが満杯(ISYSCALL_QUEUE定義時．定義時は要求を積んだらE_OKとなる)
 */
 ER mz_ista_tsk(ER_ID tskid)
 {
+#ifdef ISYSCALL_QUEUE
+	/* 要求を積むだけとし，context_switching()でまとめて実行する(実行結果は返らない) */
+	return isyscall_enqueue(ISR_TYPE_ISTA_TSK, tskid, 0);
+#else
 	SYSCALL_PARAMCB param;
-	/* ichg_priの延長でget_tsk_readyque()が呼ばれるとg_currentが書き換えられるので一時退避 */
-	TCB *tmptcb = g_current;
-	/*
-	* システムコール割込みハンドラの延長で非タスクコンテキスト用システムコールが呼ばれた時は，
-	* syscall_info.flagが書き換えられるため退避
-	*/
-	SYSCALL_TYPE tmp_flag = g_current->syscall_info.flag;
-	
+
 	/* パラメータ退避 */
 	param.un.sta_tsk.tskid = tskid;
 	/* トラップは発行しない(単なる関数呼び出し) */
   isyscall_intr(ISR_TYPE_ISTA_TSK, &param);
 
-	/* 実行状態タスクを前の状態へ戻す */
-	g_current = tmptcb;
-	g_current->syscall_info.flag = tmp_flag;
-
 	return param.un.sta_tsk.ret;
+#endif
 }
 
 
@@ -467,29 +871,24 @@ ER mz_ista_tsk(ER_ID tskid)
 * (返却値)E_PAR : エラー終了(tskpriが不正)
 * (返却値)E_OBJ : エラー終了(タスクが休止状態)
 * (返却値)E_OK : 正常終了
+* (返却値)E_QOVR : 要求リングが満杯(ISYSCALL_QUEUE定義時．定義時は要求を積んだらE_OKとなる)
 */
 ER mz_ichg_pri(ER_ID tskid, int tskpri)
 {
+#ifdef ISYSCALL_QUEUE
+	/* 要求を積むだけとし，context_switching()でまとめて実行する(実行結果は返らない) */
+	return isyscall_enqueue(ISR_TYPE_ICHG_PRI, tskid, tskpri);
+#else
   SYSCALL_PARAMCB param;
-	/* ichg_priの延長でget_tsk_readyque()が呼ばれるとg_currentが書き換えられるので一時退避 */
-	TCB *tmptcb = g_current;
-	/*
-	* システムコール割込みハンドラの延長で非タスクコンテキスト用システムコールが呼ばれた時は，
-	* syscall_info.flagが書き換えられるため退避
-	*/
-	SYSCALL_TYPE tmp_flag = g_current->syscall_info.flag;
- 
+
 	/* パラメータ退避 */
   param.un.chg_pri.tskid = tskid;
   param.un.chg_pri.tskpri = tskpri;
   /* トラップは発行しない(単なる関数呼び出し) */
-  isyscall_intr(ISR_TYPE_CHG_PRI, &param);
-
-	/* 実行状態タスクを前の状態へ戻す */
-	g_current = tmptcb;
-	g_current->syscall_info.flag = tmp_flag;
+  isyscall_intr(ISR_TYPE_ICHG_PRI, &param);
   
   return param.un.chg_pri.ret;
+#endif
 }
 
 
@@ -501,26 +900,21 @@ ER mz_ichg_pri(ER_ID tskid, int tskpri)
 * (返却値)E_OBJ : 対象タスクが休止状態
 * (返却値)E_ILUSE : システムコール不正使用(要求タスクが実行状態または，何らかの待ち行列につながれている)
 * (返却値)E_OK : 正常終了
+* (返却値)E_QOVR : 要求リングが満杯(ISYSCALL_QUEUE定義時．定義時は要求を積んだらE_OKとなる)
 */
 ER mz_iwup_tsk(ER_ID tskid)
 {
+#ifdef ISYSCALL_QUEUE
+	/* 要求を積むだけとし，context_switching()でまとめて実行する(実行結果は返らない) */
+	return isyscall_enqueue(ISR_TYPE_IWUP_TSK, tskid, 0);
+#else
   SYSCALL_PARAMCB param;
-	/* iwup_tskの延長でget_tsk_readyque()が呼ばれるとg_currentが書き換えられるので一時退避 */
-	TCB *tmptcb = g_current;
-	/*
-	* システムコール割込みハンドラの延長で非タスクコンテキスト用システムコールが呼ばれた時は，
-	* syscall_info.flagが書き換えられるため退避
-	*/
-	SYSCALL_TYPE tmp_flag = g_current->syscall_info.flag;
 
 	/* パラメータ退避 */
   param.un.wup_tsk.tskid = tskid;
 	/* トラップは発行しない(単なる関数呼び出し) */
-  isyscall_intr(ISR_TYPE_WUP_TSK, &param);
-
-	/* 実行状態タスクを前の状態へ戻す */
-	g_current = tmptcb;
-	g_current->syscall_info.flag = tmp_flag;
+  isyscall_intr(ISR_TYPE_IWUP_TSK, &param);
 
   return param.un.wup_tsk.ret;
+#endif
 }
@@ -35,13 +35,30 @@ typedef enum {
 	ISR_TYPE_DEF_INH, 			/*! 割込みハンドラ登録 */
   ISR_TYPE_ENA_DSP, 			/*! ディスパッチの許可 */
 	ISR_TYPE_SEL_SCHDUL, 		/*! タスクスケジューラ動的切り替え サービスコールのみとなるので，実際はいらないが，他と一貫性と保つため */
+	ISR_TYPE_CRE_MPL, 			/*! 可変長メモリプールの生成 */
+	ISR_TYPE_GET_MPL, 			/*! 可変長メモリブロックの獲得 */
+	ISR_TYPE_TGET_MPL, 			/*! 可変長メモリブロックの獲得(タイムアウトあり) */
+	ISR_TYPE_REL_MPL, 			/*! 可変長メモリブロックの返却 */
+	ISR_TYPE_REF_STK, 			/*! タスクスタックの使用量参照 */
+	ISR_TYPE_BATCH, 				/*! システムコールの一括発行 */
+	ISR_TYPE_TSLP_TSK, 			/*! 自タスク起床待ち(タイムアウトあり) */
 	ISR_NUM,								/*! ISRの数 */
  } ISR_TYPE;
 
 
+/*!
+ * レジスタ渡しABIのSWI番号の開始
+ * -SWI番号 = ISR_RTYPE_BASE + ISR_TYPE とし，引数はr0～r3，返却値はr0で受け渡す
+ * -SWI番号は0～255までなので，ISR_NUMはISR_RTYPE_BASE以下とする事
+ */
+#define ISR_RTYPE_BASE						0x80
+
+
 typedef enum {
   ISR_TYPE_IACRE_TSK = 0,	/*! タスク生成  */
   ISR_TYPE_ISTA_TSK, 			/*! タスク起動  */
+  ISR_TYPE_ICHG_PRI, 			/*! タスク優先度変更  */
+  ISR_TYPE_IWUP_TSK, 			/*! タスクの起床(ウェイクアップ) */
 	ISR_INUM,
 } ISR_ITYPE;
 
@@ -149,6 +166,14 @@ typedef struct {
     struct {
     	ER ret;
     } slp_tsk;
+		/*!
+		 * @brief タスク起床待ち(タイムアウトあり)
+		 * @attention unionはメモリ効率が良いが、エンディアンの関係上、移植には注意
+		 */
+    struct {
+    	int tmout;
+    	ER ret;
+    } tslp_tsk;
 		/*!
 		 * @brief タスク起床
 		 * @attention unionはメモリ効率が良いが、エンディアンの関係上、移植には注意
@@ -200,8 +225,86 @@ typedef struct {
 			long param;
 			ER ret;
 		} sel_schdul;
+		/*!
+		 * @brief 可変長メモリプールの生成
+		 * @attention unionはメモリ効率が良いが、エンディアンの関係上、移植には注意
+		 */
+		struct {
+			ER_ID mplid;
+			MPL_ATR mplatr;
+			int mplsz;
+			ER ret;
+		} cre_mpl;
+		/*!
+		 * @brief 可変長メモリブロックの獲得(get_mpl()とtget_mpl()で共用)
+		 * @attention unionはメモリ効率が良いが、エンディアンの関係上、移植には注意
+		 */
+		struct {
+			ER_ID mplid;
+			int blksz;
+			void **p_blk;
+			int tmout;
+			ER ret;
+		} get_mpl;
+		/*!
+		 * @brief 可変長メモリブロックの返却
+		 * @attention unionはメモリ効率が良いが、エンディアンの関係上、移植には注意
+		 */
+		struct {
+			ER_ID mplid;
+			void *blk;
+			ER ret;
+		} rel_mpl;
+		/*!
+		 * @brief タスクスタックの使用量参照
+		 * @attention unionはメモリ効率が良いが、エンディアンの関係上、移植には注意
+		 */
+		struct {
+			ER_ID tskid;
+			int *p_stksz;
+			int *p_stkused;
+			ER ret;
+		} ref_stk;
+		/*!
+		 * @brief システムコールの一括発行
+		 * @attention unionはメモリ効率が良いが、エンディアンの関係上、移植には注意
+		 */
+		struct {
+			struct _syscall_batch *entry;
+			int num;
+			ER ret;
+		} batch;
   } un;
 } SYSCALL_PARAMCB;
 
 
+/*!
+ * @brief 一括発行するシステムコールのエントリ(mz_batch())
+ * @note ・各システムコールの返却値はparam.un.xxx.retへ格納される
+ * 			 ・ercdはエントリを実行できたか(E_OK)，実行できなかった理由を格納する
+ */
+typedef struct _syscall_batch {
+	ISR_TYPE type;												/*! 発行するシステムコール番号 */
+	SYSCALL_PARAMCB param;								/*! システムコールのパラメータ */
+	ER ercd;															/*! エントリの実行結果 */
+} SYSCALL_BATCH;
+
+
+#ifdef ISYSCALL_QUEUE
+
+#define ISYSCALL_QUEUE_SIZE				16				/*! 非タスクコンテキスト用システムコール要求リングの要素数(2のべき乗) */
+
+/*!
+ * @brief 非タスクコンテキスト用システムコールの要求(ISYSCALL_QUEUE定義時)
+ * @note 割込みでは要求を積むだけとし，context_switching()でスケジューラの前にまとめて実行する
+ */
+typedef struct _isyscall_request {
+	ISR_ITYPE type;												/*! 非タスクコンテキスト用システムコールのタイプ */
+	ER_ID tskid;													/*! 対象タスクのID */
+	int arg;															/*! 付加パラメータ(ichg_pri()の優先度) */
+} ISYSCALL_REQ;
+
+#endif
+
+
 #endif
@@ -29,6 +29,7 @@
 #define TASK_WAIT_MUTEX								(1 << 6)		/*! mutex待ち */
 #define TASK_WAIT_VIRTUAL_MUTEX				(1 << 7)		/*! virtual mutex待ち */
 #define TASK_WAIT_MAILBOX							(1 << 8)		/*! mail box待ち */
+#define TASK_WAIT_MEMORY_POOL					(1 << 9)		/*! 可変長メモリブロック獲得待ち */
 
 #define TASK_STATE_INFO								(0x07 << 0)	/*! タスク状態の抜き取り */
 #define TASK_WAIT_ONLY_TIME						(3 << 3)		/*! タイマ要因のみ(tslp_tsk()とdly_tsk()) */
@@ -44,6 +45,12 @@
 
 #define TASK_NAME_SIZE								16					/*!  タスク名の最大値! */
 #define INIT_TASK_ID									0						/*!  initタスクIDは0とする */
+#define TASK_ID_CHUNK_LOG2						5						/*! ID変換テーブルのチャンクサイズ(2のべき乗，空きIDビットマップの1ワード分) */
+#define TASK_ID_CHUNK_SIZE						(1 << TASK_ID_CHUNK_LOG2)	/*! 1チャンクあたりのID数 */
+#define TASK_ID_CHUNK_NUM							32					/*! チャンクの最大数(チャンクビットマップの1ワード分) */
+
+/*! task IDからID変換テーブルの要素を求める */
+#define TSK_ID_TABLE(tskid)						(g_tsk_info.id_table[(tskid) >> TASK_ID_CHUNK_LOG2][(tskid) & (TASK_ID_CHUNK_SIZE - 1)])
 
 
 /*!
@@ -146,12 +153,19 @@ typedef struct _ready_depend_infomation {
 } READY_DEP_INFOCB;
 
 
+/*!
+ * @brief タスクの拡張コンテキスト
+ * @note 使用するタスクのみ初回使用時に確保するので，使用しないタスクのディスパッチは増えない
+ */
+typedef struct _task_extension_infomation {
+	struct _vfp_context *vfp;							/*! VFP/NEONレジスタの退避領域(未使用の場合はNULL) */
+} TSK_EXT_INFOCB;
+
+
 /*!
  * @brief タスクコントロールブロック
  */
 typedef struct _task_struct {
-	struct _task_struct *free_next; 	/*! free listの次ポインタ */
-  struct _task_struct *free_prev; 	/*! free listの前ポインタ */
 	READY_DEP_INFOCB ready_info;			/*! レディーごとに依存する内容 */
   int priority;   									/*! 静的優先度 */
 	int stacksize;
@@ -163,19 +177,21 @@ typedef struct _task_struct {
 	TSK_INTR_INFOCB intr_info; 				/*! 割込み情報(ここはつねに変動する) */
 	TSK_SYSCALL_INFOCB syscall_info; 	/*! システムコール情報管理 */
   SCHDUL_DEP_INFOCB schdul_info;		/*! スケジューラごとに依存する情報 */
+	TSK_EXT_INFOCB ext_info;					/*! 拡張コンテキスト */
 } TCB;
 
 
 /*!
  * @brief タスク情報(タスクメカニズム管理)
+ * @note ・ID変換テーブルはチャンク単位で確保し，確保済みのチャンクは移動しない(コピーしない)
+ * 			 ・空きIDはビットマップで管理し，CLZで最小の空きIDを求める(MSBがチャンク内の先頭ID)
  */
 typedef struct _task_infomation {
-	TCB **id_table; 									/*! task ID変換テーブルへのheadポインタ(可変長配列として使用) */
-	TCB *freehead; 										/*! taskリンクドfreeリストのキュー(freeheadポインタを記録) */
-	TCB *alochead; 										/*! taskリンクドalocリストのキュー(alocheadポインタを記録) */
-	int counter;											/*! 次の割付可能ID */
+	TCB **id_table[TASK_ID_CHUNK_NUM]; /*! task ID変換テーブル(チャンクへのポインタ配列) */
+	UINT32 free_map[TASK_ID_CHUNK_NUM]; /*! チャンクごとの空きIDビットマップ(1が空き) */
+	UINT32 chunk_map; 								/*! 空きIDを持つチャンクのビットマップ(MSBがチャンク0) */
+	int chunk_num;										/*! 確保済みチャンク数 */
 	int tskid_num;										/*! 現在のタスク資源ID数 */
-	int power_count; 									/*! task IDが足らなくなった回数(<<で倍増やしていく).この変数で可変長配列のサイズが求められる */
 } TSK_INFO;
 
 
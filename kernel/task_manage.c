@@ -12,17 +12,22 @@
 #include "memory.h"
 #include "scheduler.h"
 #include "ready.h"
+#include "mempool_manage.h"
+#include "multi_timer.h"
+#include "slab.h"
+#include "stack_pool.h"
 /* os/arch/cpu */
 #include "arch/cpu/cpu_cntrl.h"
+#include "arch/cpu/vfp.h"
 /* os/c_lib */
 #include "c_lib/lib.h"
 
 
-/*! タスクの領域確保と初期化(タスクのfreeリストを作成する) */
-static ER dynamic_tsk_init(void);
+/*! TCBのコンストラクタ */
+static void tcb_ctor(void *obj);
 
-/*! tsk alocリストからタスクコントロールブロックを抜き取る */
-static void get_aloclist(TCB *tcb);
+/*! task ID変換テーブルのチャンクを追加する */
+static ER add_tskid_chunk(void);
 
 /*! TCBスケジューリング依存ブロックの初期化 */
 static void tsk_schdul_infocb_init(TCB *tcb, int rate, int rel_exetim, int deadtim, int floatim);
@@ -36,6 +41,9 @@ static void tsk_priority_init(TCB *tcb, int priority);
 /*! タスクのスタック領域の確保 */
 static ER get_tsk_stack(TCB *tcb, int stacksize);
 
+/*! タスクのスタック領域の返却 */
+static void rel_tsk_stack(TCB *tcb);
+
 /*! タスク(スレッド)の終了の手続きをする関数 */
 static void tsk_endup(void);
 
@@ -52,97 +60,128 @@ static void chg_pri_isyscall_isr(TCB *tcb, int tskpri);
 static void chg_pri_syscall_isr(TCB *tcb, int tskpri);
 
 
+/*! TCBのスラブキャッシュ */
+static SLAB_CACHE sg_tcb_cache;
+
+
+/*!
+ * TCBのコンストラクタ
+ * *obj : スラブから切り出したTCB
+ */
+static void tcb_ctor(void *obj)
+{
+  memset(obj, -1, sizeof(TCB)); /* 確保したノードを初期化 */
+}
+
+
+/*!
+ * TCBのスラブキャッシュの生成
+ * -kernel_obj_init()で動的メモリの初期化後に呼ぶ
+ * (返却値)E_PAR : パラメータエラー
+ * (返却値)E_OK : 正常終了
+ */
+ER tsk_cache_init(void)
+{
+  return slab_cache_create(&sg_tcb_cache, "tcb", sizeof(TCB), TASK_ID_NUM, 1, tcb_ctor);
+}
+
+
 /*!
- * タスクの初期化(task ID変換テーブルの領域確保と初期化)
- * -この関数は，kernel_obj_init()で呼ばれる場合と，taskIDが足らなくなった場合に呼ばれる
- * (返却値)E_NOMEM : メモリが取得できない(この返却値は)
+ * タスクの初期化(task ID変換テーブルの最初のチャンクの確保と初期化)
+ * -この関数は，kernel_obj_init()で呼ばれる
+ * (返却値)E_NOMEM : メモリが取得できない
  * (返却値)E_OK : 正常終了
  */
 ER tsk_init(void)
 {
-  int tskids, i;
-  TCB *tcb;
-	
-  tskids = g_tsk_info.tskid_num; /* 倍の領域を確保する(start_init_tsk()の時はデフォルト通り) */
-	
-  g_tsk_info.id_table = (TCB **)get_mpf_isr(sizeof(tcb) * tskids); /* 変換テーブルの動的メモリ確保 */
-	if (g_tsk_info.id_table == NULL) {
-    return E_NOMEM; /* initタスクの時は，start_init_tsk()関数内でOSをスリープさせる */
-  }
-  /* taskID変換テーブルの初期化(メモリにNULLを埋めるのにmemset()は使用できない) */
-  for (i = 0; i < tskids; i++) {
+  int i;
+
+  for (i = 0; i < TASK_ID_CHUNK_NUM; i++) {
     g_tsk_info.id_table[i] = NULL;
+    g_tsk_info.free_map[i] = 0;
   }
-  /* TCBの静的型配列の作成及び初期化とTCBの動的型freeリストの作成と初期化 */
-  if (E_NOMEM == dynamic_tsk_init()) {
-    return E_NOMEM; /* initタスクの時は，start_init_tsk()関数内でOSをスリープさせる */
-  }
-	
-  return E_OK;
+  g_tsk_info.chunk_map = 0;
+  g_tsk_info.chunk_num = g_tsk_info.tskid_num = 0;
+
+  return add_tskid_chunk(); /* initタスクの時は，kernel_obj_init()内でOSをスリープさせる */
 }
 
 
 /*!
- * タスクの領域確保と初期化(タスクのfreeリストを作成する)
+ * task ID変換テーブルのチャンクを追加する
+ * -チャンク単位で確保するので，確保済みのチャンク(TCBへのポインタ)はコピーしない
+ * (返却値)E_NOID : チャンクの最大数に達している
  * (返却値)E_NOMEM : メモリが取得できない
  * (返却値)E_OK : 正常終了
  */
-static ER dynamic_tsk_init(void)
+static ER add_tskid_chunk(void)
 {
-  int tskids, i;
-  TCB *tcb;
-	
-  g_tsk_info.freehead = g_tsk_info.alochead = NULL;
-	
-  /* start_init_tsk()の時以外 */
-  if (g_tsk_info.power_count) {
-    tskids = TASK_ID_NUM << (g_tsk_info.power_count - 1); /* 現在と同じ領域を確保する */
+  int i, chunk = g_tsk_info.chunk_num;
+  TCB **table;
+
+  if (chunk >= TASK_ID_CHUNK_NUM) {
+    return E_NOID;
   }
-  /* start_init_tsk()の時 */
-  else {
-    tskids = g_tsk_info.tskid_num;
+  table = (TCB **)get_mpf_isr(sizeof(*table) * TASK_ID_CHUNK_SIZE); /* 変換テーブルの動的メモリ確保 */
+  if (table == NULL) {
+    return E_NOMEM;
   }
-	
-  for (i = 0; i < tskids; i++) {
-    tcb = (TCB *)get_mpf_isr(sizeof(*tcb)); /* ノードのメモリ確保 */
-    /*メモリが取得できない*/
-    if(tcb == NULL) {
-      return E_NOMEM;	 /* initタスクの時は，start_init_tsk()関数内でOSをスリープさせる */
-    }
-    memset(tcb, -1, sizeof(*tcb)); /* 確保したノードを初期化 */
-    /* freeキューの作成 */
-    tcb->free_next = g_tsk_info.freehead;
-    tcb->free_prev = NULL;
-    /* NULLを経由するとCodeSourceryはエラー(データアボートを発行する) */
-    if (tcb->free_next != NULL) {
-      tcb->free_next->free_prev = tcb;
-    }
-    g_tsk_info.freehead = tcb;
+  /* taskID変換テーブルの初期化(メモリにNULLを埋めるのにmemset()は使用できない) */
+  for (i = 0; i < TASK_ID_CHUNK_SIZE; i++) {
+    table[i] = NULL;
   }
-	
+
+  g_tsk_info.id_table[chunk] = table;
+  g_tsk_info.free_map[chunk] = ~0UL; /* チャンク内のIDはすべて空き */
+  g_tsk_info.chunk_map |= (0x80000000UL >> chunk);
+  g_tsk_info.chunk_num++;
+  g_tsk_info.tskid_num += TASK_ID_CHUNK_SIZE;
+
   return E_OK;
 }
 
 
 /*!
- * tsk alocリストからタスクコントロールブロックを抜き取る
- * tcb : 抜き取るTCB
+ * 割付可能な最小のtask IDを獲得する
+ * -空きIDを持つチャンクと，チャンク内の空きIDをそれぞれCLZで求める(検索はO(1))
+ * -空きIDがない場合はチャンクを1つ追加する
+ * (返却値)E_NOID : 割付可能なIDがない(チャンクの最大数に達しているか，メモリが取得できない)
+ * (返却値)tskid : 獲得したtask ID
  */
-static void get_aloclist(TCB *tcb)
+ER_ID get_tskid(void)
 {
-  /* 先頭から抜きとる */
-  if (tcb == g_tsk_info.alochead) {
-    g_tsk_info.alochead = tcb->free_next;
-    g_tsk_info.alochead->free_prev = NULL;
+  int chunk, bit;
+
+  /* 空きIDがない場合はチャンクを追加 */
+  if (g_tsk_info.chunk_map == 0 && add_tskid_chunk() != E_OK) {
+    return E_NOID;
   }
-  /* それ以外から抜き取る */
-  else {
-    tcb->free_prev->free_next = tcb->free_next;
-		/* NULLを経由するとgcc4はエラー(データアボートを発行する) */
-		if (tcb->free_prev->free_next != NULL) {
-    	tcb->free_next->free_prev = tcb->free_prev;
-		}
+  chunk = __builtin_clz(g_tsk_info.chunk_map);
+  bit = __builtin_clz(g_tsk_info.free_map[chunk]);
+
+  g_tsk_info.free_map[chunk] &= ~(0x80000000UL >> bit);
+  /* チャンク内の空きIDを使い切った */
+  if (g_tsk_info.free_map[chunk] == 0) {
+    g_tsk_info.chunk_map &= ~(0x80000000UL >> chunk);
   }
+  DEBUG_LEVEL1_OUTVLE((chunk << TASK_ID_CHUNK_LOG2) | bit, 0);
+  DEBUG_LEVEL1_OUTMSG(" next tsk id : get_tskid()\n");
+
+  return (chunk << TASK_ID_CHUNK_LOG2) | bit;
+}
+
+
+/*!
+ * task IDを返却する(ID変換テーブルも初期化する)
+ * tskid : 返却するtask ID(get_tskid()で獲得したもの)
+ */
+void rel_tskid(ER_ID tskid)
+{
+  int chunk = tskid >> TASK_ID_CHUNK_LOG2;
+
+  TSK_ID_TABLE(tskid) = NULL;
+  g_tsk_info.free_map[chunk] |= (0x80000000UL >> (tskid & (TASK_ID_CHUNK_SIZE - 1)));
+  g_tsk_info.chunk_map |= (0x80000000UL >> chunk);
 }
 
 
@@ -220,32 +259,42 @@ static void tsk_priority_init(TCB *tcb, int priority)
 /*!
  * タスクのスタック領域の確保
  * -タスクスタックはheapメモリを使用しない(スタックトレースをしやすくするため)
- * -リンカスクリプトで定義しているタスクスタック領域は，再利用を考えて，リスト管理をした方が良い
+ * -リンカスクリプトで定義しているタスクスタック領域をスタックプールで管理し，返却されたスタックを再利用する
+ * -スタック領域のクリアは行わない(初期コンテキストはtsk_stack_init()で積む)
+ * -STACK_PAINT定義時はパターンで塗りつぶす(ref_stk()で最大使用量を求めるため)
  * *tcb : スタック領域を確保するTCB
- * stacksize : 確保するスタックサイズ
+ * stacksize : 確保するスタックサイズ(バケットのサイズに切り上げられる)
  * (返却値)E_NOMEM : スタック領域が確保できない
  * (返却値)E_OK : スタック領域が確保完了
  */
 static ER get_tsk_stack(TCB *tcb, int stacksize)
 {
-	extern char _tskstack; /* リンカスクリプトで定義されるスタック領域 */
-  static char *p_stack = &_tskstack;
-
-	tcb->stacksize = stacksize;
+  char *p_stack;
 
 	/* タスクスタック領域を獲得 */
-  memset(p_stack, 0, stacksize);
-  p_stack += stacksize; /* タスクスタック領域を切り出す */
-  
-  /* タスクスタック空間検査 */
-  if (p_stack > (char *)(0x90000000 + 0x00002000)) {
+  if ((p_stack = get_stack_pool(&stacksize)) == NULL) {
     KERNEL_OUTMSG("task stack over flow.\n");
     return E_NOMEM;
   }
 
-  tcb->stack = p_stack; /* タスクスタックの上方アドレスの設定 */
+	tcb->stacksize = stacksize; /* 実際に獲得したサイズ(返却時に使用する) */
+  tcb->stack = p_stack + stacksize; /* タスクスタックの上方アドレスの設定 */
+#ifdef STACK_PAINT
+	paint_stack_pool(p_stack, stacksize); /* 最大使用量を求めるため塗りつぶしておく */
+#endif
 
-	return E_OK; /* ローカルstatic変数は返却できないので，エラーコードを返却 */
+	return E_OK;
+}
+
+
+/*!
+ * タスクのスタック領域の返却
+ * -del_tsk(),exd_tsk()でTCBを初期化する前に呼ぶ
+ * *tcb : スタック領域を返却するTCB
+ */
+static void rel_tsk_stack(TCB *tcb)
+{
+  rel_stack_pool(tcb->stack - tcb->stacksize, tcb->stacksize);
 }
 
 
@@ -283,6 +332,16 @@ static void tsk_stack_init(TCB *tcb)
 
   sp = (UINT32 *)tcb->stack;
 
+  /* 優先度が0の場合は割込み禁止とする */
+  /* 優先度が0以外の場合 */
+  if (tcb->priority) {
+    *(--sp) = (UINT32)(CPSR_SYS_MODE | 0); /* CPSR */
+  }
+  /* 優先度が0の場合 */
+  else {
+    *(--sp) = (UINT32)(CPSR_SYS_MODE | IRQ_DISABLE | FIQ_DISABLE); /* CPSR */
+	}
+  *(--sp) = (UINT32)tsk_startup; /* PC */
   *(--sp) = (UINT32)tsk_endup; /* R14_SYS:タスクの戻り先 */
   *(--sp) = 0; /* R12 */
   *(--sp) = 0; /* R11 */
@@ -295,20 +354,9 @@ static void tsk_stack_init(TCB *tcb)
   *(--sp) = 0; /* R4 */
   *(--sp) = 0; /* R3 */
   *(--sp) = 0; /* R2 */
-  *(--sp) = (UINT32)tsk_startup; /* PC */
   *(--sp) = 0; /* R1 */
   *(--sp) = (UINT32)tcb; /* R0(タスクスタートアップ(tsk_startup()に渡す引数の設定)) */
 
-  /* 優先度が0の場合は割込み禁止とする */
-  /* 優先度が0以外の場合 */
-  if (tcb->priority) {
-    *(--sp) = (UINT32)(CPSR_SYS_MODE | 0);
-  }
-  /* 優先度が0の場合 */
-  else {
-    *(--sp) = (UINT32)(CPSR_SYS_MODE | IRQ_DISABLE | FIQ_DISABLE);
-	}
-
   tcb->intr_info.sp = (UINT32)sp; /* タスクスタック下方アドレスの設定 */
 }
 
@@ -316,6 +364,7 @@ static void tsk_stack_init(TCB *tcb)
 /*!
  * システムコールの処理(acre_tsk():タスクの生成(ID自動割付))
  * タスクの状態としては未登録状態から休止状態に移行
+ * tskid : 割付けるタスクID(get_tskid()で獲得したもの)
  * func : タスクのメイン関数
  * *name : タスクの名前
  * priority : タスクの優先度
@@ -329,18 +378,14 @@ static void tsk_stack_init(TCB *tcb)
  * (返却値)E_NOMEM : メモリが確保できない
  * (返却値)tcb : 正常終了(作成したタスクコントロールブロックへのポインタ)
  */
-OBJP acre_tsk_isr(TSK_FUNC func, char *name, int priority,
+OBJP acre_tsk_isr(ER_ID tskid, TSK_FUNC func, char *name, int priority,
     int stacksize, int rate, int rel_exetim, int deadtim, int floatim, int argc, char *argv[])
 {
   TCB *tcb; /* 新規作成するTCB(タスクコントロールブロック) */
     
-  /* 動的型taskの場合 */
- 
-  tcb = g_tsk_info.freehead; /* free headからノードを与える(抜き取るわけではない) */
-  g_tsk_info.freehead = tcb->free_next; /* free headを一つ進める */
-  /* aloc headが空の場合 */
-  if (g_tsk_info.alochead == NULL) {
-		g_tsk_info.alochead = tcb;
+  /* TCBはスラブキャッシュから獲得(コンストラクタで初期化済み) */
+  if ((tcb = (TCB *)slab_alloc(&sg_tcb_cache)) == NULL) {
+    return E_NOMEM;
   }
 
   /* TCBの設定 */
@@ -349,9 +394,10 @@ OBJP acre_tsk_isr(TSK_FUNC func, char *name, int priority,
   tcb->get_info.flags = tcb->get_info.gobjp = 0; /* 取得情報を初期化 */
   tcb->wait_info.tobjp = tcb->wait_info.wobjp = 0; /* 待ち情報を初期化 */
   tcb->wait_info.wait_next = tcb->wait_info.wait_prev = NULL; /* 待ちポインタをNULLに */
+  tcb->ext_info.vfp = NULL; /* VFPコンテキストは初回使用時に獲得 */
 
   /* TCBの設定(実行時に変化しない内容) */
-  tcb->init.tskid = g_tsk_info.counter;
+  tcb->init.tskid = tskid;
   tcb->init.func = func;
   tcb->init.argc = argc;
   tcb->init.argv = argv;
@@ -365,6 +411,8 @@ OBJP acre_tsk_isr(TSK_FUNC func, char *name, int priority,
 
 	/* タスクのスタック領域を確保 */
  	if (E_NOMEM == get_tsk_stack(tcb, stacksize)) {
+    memset(tcb, -1, sizeof(*tcb)); /* コンストラクタ状態へ戻してスラブキャッシュへ返却 */
+    slab_free(&sg_tcb_cache, tcb);
 		return E_NOMEM;
 	}
 
@@ -383,17 +431,12 @@ OBJP acre_tsk_isr(TSK_FUNC func, char *name, int priority,
  */
 ER del_tsk_isr(TCB *tcb)
 {
- 	/* 本来ならスタックも解放して再利用できるようにすべきだが省略．*/
-  
 	/* 休止状態の場合(排除) */
   if (tcb->state == TASK_DORMANT) {
-    memset(tcb, -1, sizeof(*tcb)); /* ノードを初期化 */
-    /* タスクalocリストから抜き取りfreeリストへ挿入 */
-    get_aloclist(tcb); /* alocリストから抜き取り */
-    /* freeリスト先頭へ挿入 */
-    tcb->free_next = g_tsk_info.freehead;
-    tcb->free_prev = g_tsk_info.freehead->free_prev;
-    g_tsk_info.freehead = tcb->free_next->free_prev = tcb->free_prev->free_next = tcb;
+    rel_tsk_stack(tcb); /* スタックをスタックプールへ返却し再利用できるようにする */
+    vfp_release(tcb); /* VFPコンテキストの解放 */
+    memset(tcb, -1, sizeof(*tcb)); /* ノードを初期化(コンストラクタ状態へ戻す) */
+    slab_free(&sg_tcb_cache, tcb); /* スラブキャッシュへ返却 */
     
     DEBUG_LEVEL1_OUTMSG(" delete task contorol block : del_tsk_isr()\n");
 		
@@ -540,18 +583,18 @@ void exd_tsk_isr(void)
     g_current = tmpcurrent;
   }
 	
-  /* 本来ならスタックも解放して再利用できるようにすべきだが省略． */
   KERNEL_OUTMSG(g_current->init.name);
   KERNEL_OUTMSG(" EXIT.\n");
 
-  memset(g_current, -1, sizeof(*g_current)); /* ノードの初期化 */
-  /* タスクalocリストから抜き取りfreeリストへ挿入 */
-  get_aloclist(g_current); /* alocリストから抜き取り */
-  /* freeリスト先頭へ挿入 */
-  g_current->free_next = g_tsk_info.freehead;
-  g_current->free_prev = g_tsk_info.freehead->free_prev; /* NULLが入る */
-  g_tsk_info.freehead = g_current->free_next->free_prev = g_current->free_prev->free_next = g_current;
-  g_tsk_info.id_table[g_current->init.tskid] = NULL; /* ID変換テーブルのクリア */
+  /*
+   * スタックをスタックプールへ返却し再利用できるようにする
+   * (ここはSVCモードのスタックで動作しているので，自タスクのスタックを返却してもよい)
+   */
+  rel_tsk_stack(g_current);
+  vfp_release(g_current); /* VFPコンテキストの解放 */
+  rel_tskid(g_current->init.tskid); /* IDの返却とID変換テーブルのクリア(TCBの初期化前に行う) */
+  memset(g_current, -1, sizeof(*g_current)); /* ノードの初期化(コンストラクタ状態へ戻す) */
+  slab_free(&sg_tcb_cache, g_current); /* スラブキャッシュへ返却 */
 }
 
 
@@ -587,10 +630,16 @@ ER ter_tsk_isr(TCB *tcb)
     }
     /* 待ち状態(何らかの待ち行列につながれている時は対象タスクを待ち行列からはずす) */
     else {
-      /* タイマブロックを持っているものは対象タイマブロックを排除する */
+      /* 可変長メモリブロック獲得待ちの場合は待ちキューから外す(タイマブロックも排除される) */
+      if (tcb->state & TASK_WAIT_MEMORY_POOL) {
+        get_mpl_waitque(tcb);
+      }
+      /* タイマブロックを持っているもの(タイムアウトスリープ)は対象タイマブロックを排除する */
       if (tcb->wait_info.tobjp != 0) {
+				delete_tmrcb_diffque((TMRCB *)tcb->wait_info.tobjp);
 				tcb->wait_info.tobjp = 0; /* クリアにしておく */
       }
+      tcb->state &= ~TASK_WAIT_TIME_SLEEP;
     }
     tcb->state |= TASK_DORMANT; /* タスクを休止状態へ */
     KERNEL_OUTMSG(tcb->init.name);
@@ -604,6 +653,33 @@ ER ter_tsk_isr(TCB *tcb)
 }
 
 
+/*!
+ * システムコールの処理(ref_stk():タスクスタックの使用量参照)
+ * *tcb : 参照するタスクコントロールブロックへのポインタ
+ * *p_stksz : スタックサイズを格納するポインタ(実体はユーザタスク側で宣言されているもの)
+ * *p_stkused : スタックの最大使用量(ハイウォーターマーク)を格納するポインタ(実体はユーザタスク側で宣言されているもの)
+ * (返却値)E_PAR : パラメータエラー
+ * (返却値)E_NOSPT : 未サポート(STACK_PAINT未定義)
+ * (返却値)E_OK : 正常終了
+ */
+ER ref_stk_isr(TCB *tcb, int *p_stksz, int *p_stkused)
+{
+	/* パラメータは正しいか */
+	if (p_stksz == NULL || p_stkused == NULL) {
+		return E_PAR;
+	}
+
+#ifdef STACK_PAINT
+	*p_stksz = tcb->stacksize;
+	*p_stkused = scan_stack_pool(tcb->stack - tcb->stacksize, tcb->stacksize);
+
+	return E_OK;
+#else
+	return E_NOSPT;
+#endif
+}
+
+
 /*!
  * システムコールの処理(get_pri():タスクの優先度取得)
  * tskid : 優先度を参照するタスクコントロールブロックへのポインタ
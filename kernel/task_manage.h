@@ -14,11 +14,20 @@
 #include "task.h"
 
 
-/*! タスクの初期化(task ID変換テーブルの領域確保と初期化) */
+/*! TCBのスラブキャッシュの生成 */
+extern ER tsk_cache_init(void);
+
+/*! タスクの初期化(task ID変換テーブルの最初のチャンクの確保と初期化) */
 extern ER tsk_init(void);
 
+/*! 割付可能な最小のtask IDを獲得する */
+extern ER_ID get_tskid(void);
+
+/*! task IDを返却する(ID変換テーブルも初期化する) */
+extern void rel_tskid(ER_ID tskid);
+
 /*! システムコールの処理(acre_tsk():タスクの生成(ID自動割付)) */
-extern OBJP acre_tsk_isr(TSK_FUNC func, char *name, int priority, int stacksize, 
+extern OBJP acre_tsk_isr(ER_ID tskid, TSK_FUNC func, char *name, int priority, int stacksize, 
 										int rate, int exetim, int deadtim, int floatim, int argc, char *argv[]);
 				 
 /*! システムコール処理(del_tsk():タスクの排除) */
@@ -39,6 +48,9 @@ extern void exd_tsk_isr(void);
 /*! システムコール処理(ter_tsk():タスクの強制終了) */
 extern ER ter_tsk_isr(TCB *tcb);
 
+/*! システムコールの処理(ref_stk():タスクスタックの使用量参照) */
+extern ER ref_stk_isr(TCB *tcb, int *p_stksz, int *p_stkused);
+
 /*! システムコールの処理(get_pri():タスクの優先度取得) */
 extern ER get_pri_isr(TCB *tcb, int *p_tskpri);
 
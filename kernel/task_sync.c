@@ -10,10 +10,39 @@
 #include "task_sync.h"
 #include "kernel.h"
 #include "scheduler.h"
+#include "mempool_manage.h"
+#include "multi_timer.h"
+/* os/kernel_svc */
+#include "kernel_svc/log_manage.h"
 /* os/c_lib */
 #include "c_lib/lib.h"
 
 
+/*! 起床待ちタイムアウト時のコールバックルーチン */
+static void tslp_tmout_callrte(void *argv);
+
+
+/*!
+* 起床待ちタイムアウト時のコールバックルーチン
+* *argv : タイムアウトしたタスク
+* -差分のキューのタイマ満了処理から呼ばれる(タイマコントロールブロックは満了処理で解放される)
+*/
+static void tslp_tmout_callrte(void *argv)
+{
+	TCB *tcb = (TCB *)argv;
+	ER *ercd;
+
+	tcb->wait_info.tobjp = 0; /* 満了処理で解放されるので，ここでは排除しない */
+	tcb->state &= ~TASK_WAIT_TIME_SLEEP;
+
+	ercd = (ER *)tcb->syscall_info.ret;
+	*ercd = E_TMOUT;
+	LOG_TRACE(LOG_CAT_SCHED, LOG_EV_WAKEUP, tcb->init.tskid, E_TMOUT, tcb->state);
+	g_current = tcb;
+	putcurrent(); /* 待ちとなっているタスクをレディーへ */
+}
+
+
 /*!
 * システムコールの処理(slp_tsk():自タスクの起床待ち)
 * (返却値)E_OK : 正常終了
@@ -25,6 +54,38 @@ ER slp_tsk_isr(void)
 }
 
 
+/*!
+* システムコールの処理(tslp_tsk():自タスクの起床待ち(タイムアウトあり))
+* tmout : タイムアウト時間(msec)
+* (返却値)E_PAR : パラメータエラー
+* (返却値)E_TMOUT : ポーリング
+* (返却値)E_OK : 正常終了(起床待ちとなる場合の返却値は，待ち解除時に書き換えられる(E_OK,E_TMOUT,E_RLWAI))
+* -起床要求のキューイングはないので，呼び出し側は起床条件を検査してから発行する事
+*/
+ER tslp_tsk_isr(int tmout)
+{
+	/* パラメータは正しいか(usecへ変換して溢れないか) */
+	if (tmout < TMO_FEVR || tmout > 0x7fffffff / 1000) {
+		return E_PAR;
+	}
+	/* ポーリングの場合 */
+	else if (tmout == TMO_POL) {
+		return E_TMOUT;
+	}
+	/* 起床待ちとする */
+	else {
+		getcurrent(); /* システムコール発行タスクをレディーから抜き取る */
+		/* タイムアウトありの場合はソフトタイマを要求 */
+		if (tmout != TMO_FEVR) {
+			g_current->state |= TASK_WAIT_TIME_SLEEP;
+			g_current->wait_info.tobjp = (TMR_OBJP)create_tmrcb_diffque(OTHER_MAKE_TIMER, tmout * 1000,
+																																	(TMRRQ_OBJP)g_current, tslp_tmout_callrte, g_current);
+		}
+		return E_OK;
+	}
+}
+
+
 /*!
 * システムコールの処理(wup_tsk():タスクの起床)
 * 起動要求キューイング機能はない.また任意の待ち要因がある時は起床できない
@@ -53,6 +114,13 @@ ER wup_tsk_isr(TCB *tcb)
 	}
 	/* 要求タスクをレディーへつなぎ起床 */
 	else {
+		/* タイムアウトスリープの場合はタイマブロックを排除する */
+		if (tcb->wait_info.tobjp != 0) {
+			delete_tmrcb_diffque((TMRCB *)tcb->wait_info.tobjp);
+			tcb->wait_info.tobjp = 0;
+		}
+		tcb->state &= ~TASK_WAIT_TIME_SLEEP;
+		LOG_TRACE(LOG_CAT_SCHED, LOG_EV_WAKEUP, tcb->init.tskid, E_OK, tcb->state);
   	g_current = tcb;
   	putcurrent(); /* 要求タスクを起床 */
   	return E_OK;
@@ -73,13 +141,20 @@ ER rel_wai_isr(TCB *tcb)
 	
 	/* 待ち状態 */
 	if ((tcb->state & TASK_STATE_INFO) == TASK_WAIT) {
-		/* タイマブロックを持っているものは対象タイマブロックを排除する */
+		/* 可変長メモリブロック獲得待ちの場合は待ちキューから外す(タイマブロックも排除される) */
+		if (tcb->state & TASK_WAIT_MEMORY_POOL) {
+			get_mpl_waitque(tcb);
+		}
+		/* タイマブロックを持っているもの(タイムアウトスリープ)は対象タイマブロックを排除する */
 		if (tcb->wait_info.tobjp != 0) {
+			delete_tmrcb_diffque((TMRCB *)tcb->wait_info.tobjp);
 			tcb->wait_info.tobjp = 0; /* クリアにしておく */
 		}
+		tcb->state &= ~TASK_WAIT_TIME_SLEEP;
 		/* 待ちに入ったシステムコールの返却値をポインタを経由して書き換える */
 		ercd = (ER *)tcb->syscall_info.ret;
 		*ercd = E_RLWAI;
+		LOG_TRACE(LOG_CAT_SCHED, LOG_EV_WAKEUP, tcb->init.tskid, E_RLWAI, tcb->state);
 		g_current = tcb;
 		putcurrent(); /* 待ちとなっているタスクをレディーへ */
 		return E_OK;
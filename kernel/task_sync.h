@@ -18,6 +18,9 @@
 /*! システムコールの処理(slp_tsk():自タスクの起床待ち) */
 extern ER slp_tsk_isr(void);
 
+/*! システムコールの処理(tslp_tsk():自タスクの起床待ち(タイムアウトあり)) */
+extern ER tslp_tsk_isr(int tmout);
+
 /*! システムコールの処理(wup_tsk():タスクの起床) */
 extern ER wup_tsk_isr(TCB *tcb);
 
@@ -0,0 +1,434 @@
+/*!
+ * @file ターゲット非依存部<モジュール:tlsf.o>
+ * @brief TLSF(Two-Level Segregated Fit)アロケータ
+ * @attention gcc4.5.x以外は試していない
+ * @note ・獲得，解放ともにO(1)(ビットサーチはCLZ命令1回)
+ * 			 ・解放時は物理的に隣接する空きブロックと結合する
+ */
+
+
+/* os/kernel */
+#include "tlsf.h"
+
+
+/*! ブロックヘッダのフラグ */
+#define TLSF_BLOCK_FREE						(1 << 0)			/*! このブロックは空き */
+#define TLSF_BLOCK_PREV_FREE			(1 << 1)			/*! 物理的に前のブロックは空き */
+#define TLSF_BLOCK_FLAGS					(TLSF_BLOCK_FREE | TLSF_BLOCK_PREV_FREE)
+
+/*! ブロックヘッダのオーバーヘッド(使用中ブロックはprev_physとsizeのみ) */
+#define TLSF_BLOCK_HDR						(sizeof(TLSF_BLOCK *) + sizeof(UINT32))
+/*! 最小ブロックサイズ(空きリストのポインタ分) */
+#define TLSF_BLOCK_SIZE_MIN				(sizeof(TLSF_BLOCK) - TLSF_BLOCK_HDR)
+/*! 最大ブロックサイズ */
+#define TLSF_BLOCK_SIZE_MAX				((UINT32)1 << TLSF_FL_INDEX_MAX)
+
+
+/*! 最上位ビットの検索 */
+static int tlsf_fls(UINT32 word);
+
+/*! 最下位ビットの検索 */
+static int tlsf_ffs(UINT32 word);
+
+/*! サイズから登録先のインデックスを求める */
+static void mapping_insert(UINT32 size, int *fli, int *sli);
+
+/*! サイズから検索開始のインデックスを求める(切り上げ) */
+static void mapping_search(UINT32 size, int *fli, int *sli);
+
+/*! 要求を満たす空きブロックの検索 */
+static TLSF_BLOCK* search_suitable_block(TLSF_CNTRL *tlsf, int *fli, int *sli);
+
+/*! 物理的に次のブロックを求める */
+static TLSF_BLOCK* block_next(TLSF_BLOCK *block);
+
+/*! ブロックを空きにする(次ブロックへ前空きを通知) */
+static void block_mark_as_free(TLSF_BLOCK *block);
+
+/*! ブロックを使用中にする(次ブロックへ前使用中を通知) */
+static void block_mark_as_used(TLSF_BLOCK *block);
+
+/*! 空きリストから抜き取る */
+static void remove_free_block(TLSF_CNTRL *tlsf, TLSF_BLOCK *block, int fli, int sli);
+
+/*! 空きリストへつなぐ */
+static void insert_free_block(TLSF_CNTRL *tlsf, TLSF_BLOCK *block);
+
+/*! 空きブロックを要求サイズで分割し，残りを空きリストへ戻す */
+static void block_trim_free(TLSF_CNTRL *tlsf, TLSF_BLOCK *block, UINT32 size);
+
+
+/*!
+ * @brief 最上位ビットの検索
+ * @param[in] word:検索するワード
+ * 	@arg 0以外
+ * @return 最上位の1のビット位置(0～31)
+ */
+static int tlsf_fls(UINT32 word)
+{
+	return 31 - __builtin_clz(word);
+}
+
+
+/*!
+ * @brief 最下位ビットの検索
+ * @param[in] word:検索するワード
+ * 	@arg 0以外
+ * @return 最下位の1のビット位置(0～31)
+ * @note 最下位ビットだけを残してCLZで求める
+ */
+static int tlsf_ffs(UINT32 word)
+{
+	return tlsf_fls(word & (~word + 1));
+}
+
+
+/*!
+ * @brief サイズから登録先のインデックスを求める
+ * @param[in] size:ブロックサイズ
+ * 	@arg TLSF_ALIGN_SIZEの倍数
+ * @param[out] *fli:第1レベルインデックス
+ * @param[out] *sli:第2レベルインデックス
+ * @return なし
+ */
+static void mapping_insert(UINT32 size, int *fli, int *sli)
+{
+	int fl, sl;
+
+	/* 小さいブロックは第1レベル0番で線形に管理 */
+	if (size < TLSF_SMALL_BLOCK_SIZE) {
+		fl = 0;
+		sl = (int)size / (TLSF_SMALL_BLOCK_SIZE / TLSF_SL_INDEX_COUNT);
+	}
+	/* 以外 */
+	else {
+		fl = tlsf_fls(size);
+		sl = (int)(size >> (fl - TLSF_SL_INDEX_COUNT_LOG2)) ^ TLSF_SL_INDEX_COUNT;
+		fl -= (TLSF_FL_INDEX_SHIFT - 1);
+	}
+	*fli = fl;
+	*sli = sl;
+}
+
+
+/*!
+ * @brief サイズから検索開始のインデックスを求める(切り上げ)
+ * @param[in] size:要求サイズ
+ * 	@arg TLSF_ALIGN_SIZEの倍数
+ * @param[out] *fli:第1レベルインデックス
+ * @param[out] *sli:第2レベルインデックス
+ * @return なし
+ * @note 次のサイズクラスへ切り上げる事で，見つかったリストのどのブロックでも要求を満たせる
+ */
+static void mapping_search(UINT32 size, int *fli, int *sli)
+{
+	if (size >= TLSF_SMALL_BLOCK_SIZE) {
+		size += (1 << (tlsf_fls(size) - TLSF_SL_INDEX_COUNT_LOG2)) - 1;
+	}
+	/* 以外 */
+	else {
+		/* 処理なし */
+	}
+	mapping_insert(size, fli, sli);
+}
+
+
+/*!
+ * @brief 要求を満たす空きブロックの検索
+ * @param[in] *tlsf:TLSF管理ブロック
+ * @param[out] *fli:第1レベルインデックス(見つかったリストに更新される)
+ * @param[out] *sli:第2レベルインデックス(見つかったリストに更新される)
+ * @return 空きブロック
+ *	@retval NULL:要求を満たすブロックがない
+ */
+static TLSF_BLOCK* search_suitable_block(TLSF_CNTRL *tlsf, int *fli, int *sli)
+{
+	int fl = *fli;
+	int sl;
+	UINT32 sl_map, fl_map;
+
+	if (fl >= TLSF_FL_INDEX_COUNT) {
+		return NULL;
+	}
+
+	/* 同じ第1レベル内で，sl以上のリストを探す */
+	sl_map = tlsf->sl_bitmap[fl] & (~0U << *sli);
+	if (!sl_map) {
+		/* 上位の第1レベルを探す */
+		fl_map = (fl + 1 < 32) ? (tlsf->fl_bitmap & (~0U << (fl + 1))) : 0;
+		if (!fl_map) {
+			return NULL; /* 空きなし */
+		}
+		fl = tlsf_ffs(fl_map);
+		sl_map = tlsf->sl_bitmap[fl];
+	}
+	sl = tlsf_ffs(sl_map);
+
+	*fli = fl;
+	*sli = sl;
+
+	return tlsf->blocks[fl][sl];
+}
+
+
+/*!
+ * @brief 物理的に次のブロックを求める
+ * @param[in] *block:ブロック
+ * @return 次のブロック
+ */
+static TLSF_BLOCK* block_next(TLSF_BLOCK *block)
+{
+	return (TLSF_BLOCK *)((char *)block + TLSF_BLOCK_HDR + (block->size & ~TLSF_BLOCK_FLAGS));
+}
+
+
+/*!
+ * @brief ブロックを空きにする(次ブロックへ前空きを通知)
+ * @param[in] *block:ブロック
+ * @return なし
+ */
+static void block_mark_as_free(TLSF_BLOCK *block)
+{
+	TLSF_BLOCK *next = block_next(block);
+
+	next->prev_phys = block;
+	next->size |= TLSF_BLOCK_PREV_FREE;
+	block->size |= TLSF_BLOCK_FREE;
+}
+
+
+/*!
+ * @brief ブロックを使用中にする(次ブロックへ前使用中を通知)
+ * @param[in] *block:ブロック
+ * @return なし
+ */
+static void block_mark_as_used(TLSF_BLOCK *block)
+{
+	TLSF_BLOCK *next = block_next(block);
+
+	next->size &= ~TLSF_BLOCK_PREV_FREE;
+	block->size &= ~TLSF_BLOCK_FREE;
+}
+
+
+/*!
+ * @brief 空きリストから抜き取る
+ * @param[in] *tlsf:TLSF管理ブロック
+ * @param[in] *block:抜き取るブロック
+ * @param[in] fli:第1レベルインデックス
+ * @param[in] sli:第2レベルインデックス
+ * @return なし
+ */
+static void remove_free_block(TLSF_CNTRL *tlsf, TLSF_BLOCK *block, int fli, int sli)
+{
+	TLSF_BLOCK *prev = block->prev_free;
+	TLSF_BLOCK *next = block->next_free;
+
+	if (next != NULL) {
+		next->prev_free = prev;
+	}
+	if (prev != NULL) {
+		prev->next_free = next;
+	}
+	/* 先頭の場合 */
+	else {
+		tlsf->blocks[fli][sli] = next;
+		/* リストが空になったらビットマップを落とす */
+		if (next == NULL) {
+			tlsf->sl_bitmap[fli] &= ~(1U << sli);
+			if (!tlsf->sl_bitmap[fli]) {
+				tlsf->fl_bitmap &= ~(1U << fli);
+			}
+		}
+	}
+	tlsf->free_size -= block->size & ~TLSF_BLOCK_FLAGS;
+}
+
+
+/*!
+ * @brief 空きリストへつなぐ
+ * @param[in] *tlsf:TLSF管理ブロック
+ * @param[in] *block:つなぐブロック
+ * @return なし
+ * @note リストの先頭へつなぐ
+ */
+static void insert_free_block(TLSF_CNTRL *tlsf, TLSF_BLOCK *block)
+{
+	int fl, sl;
+	TLSF_BLOCK *head;
+
+	mapping_insert(block->size & ~TLSF_BLOCK_FLAGS, &fl, &sl);
+	head = tlsf->blocks[fl][sl];
+
+	block->next_free = head;
+	block->prev_free = NULL;
+	if (head != NULL) {
+		head->prev_free = block;
+	}
+	tlsf->blocks[fl][sl] = block;
+
+	tlsf->fl_bitmap |= (1U << fl);
+	tlsf->sl_bitmap[fl] |= (1U << sl);
+	tlsf->free_size += block->size & ~TLSF_BLOCK_FLAGS;
+}
+
+
+/*!
+ * @brief 空きブロックを要求サイズで分割し，残りを空きリストへ戻す
+ * @param[in] *tlsf:TLSF管理ブロック
+ * @param[in] *block:分割するブロック(空きリストからは抜き取り済み)
+ * @param[in] size:要求サイズ
+ * @return なし
+ * @note 残りがヘッダと最小ブロックサイズに満たない場合は分割しない
+ */
+static void block_trim_free(TLSF_CNTRL *tlsf, TLSF_BLOCK *block, UINT32 size)
+{
+	TLSF_BLOCK *remain;
+	UINT32 bsize = block->size & ~TLSF_BLOCK_FLAGS;
+
+	if (bsize >= size + TLSF_BLOCK_HDR + TLSF_BLOCK_SIZE_MIN) {
+		remain = (TLSF_BLOCK *)((char *)block + TLSF_BLOCK_HDR + size);
+		remain->size = bsize - size - TLSF_BLOCK_HDR; /* 前(block)は空きのままなのでフラグは下で立てる */
+		block->size = size | (block->size & TLSF_BLOCK_FLAGS);
+		block_mark_as_free(remain);
+		remain->size |= TLSF_BLOCK_PREV_FREE;
+		remain->prev_phys = block;
+		insert_free_block(tlsf, remain);
+	}
+	/* 以外 */
+	else {
+		/* 処理なし */
+	}
+}
+
+
+/*!
+ * @brief TLSF管理ブロックと領域の初期化
+ * @param[out] *tlsf:TLSF管理ブロック
+ * 	@arg NULL以外
+ * @param[in] *mem:管理する領域の先頭
+ * 	@arg NULL以外
+ * @param[in] bytes:管理する領域のサイズ
+ * 	@arg 特になし
+ * @return エラーコード
+ *	@retval E_PAR:領域が小さすぎる，または大きすぎる,E_OK:正常終了
+ * @note 領域全体を1つの空きブロックとし，終端に番兵(サイズ0の使用中ブロック)を置く
+ */
+ER tlsf_init(TLSF_CNTRL *tlsf, void *mem, UINT32 bytes)
+{
+	int fl, sl;
+	UINT32 start, usable;
+	TLSF_BLOCK *block, *sentinel;
+
+	tlsf->fl_bitmap = 0;
+	tlsf->free_size = 0;
+	for (fl = 0; fl < TLSF_FL_INDEX_COUNT; fl++) {
+		tlsf->sl_bitmap[fl] = 0;
+		for (sl = 0; sl < TLSF_SL_INDEX_COUNT; sl++) {
+			tlsf->blocks[fl][sl] = NULL;
+		}
+	}
+
+	/* 先頭をアライメントし，ヘッダ2つ分(先頭ブロックと番兵)を差し引く */
+	start = ((UINT32)mem + (TLSF_ALIGN_SIZE - 1)) & ~(TLSF_ALIGN_SIZE - 1);
+	if (bytes < (start - (UINT32)mem) + 2 * TLSF_BLOCK_HDR + TLSF_BLOCK_SIZE_MIN) {
+		return E_PAR;
+	}
+	usable = (bytes - (start - (UINT32)mem) - 2 * TLSF_BLOCK_HDR) & ~(TLSF_ALIGN_SIZE - 1);
+	if (usable < TLSF_BLOCK_SIZE_MIN || usable >= TLSF_BLOCK_SIZE_MAX) {
+		return E_PAR;
+	}
+
+	block = (TLSF_BLOCK *)start;
+	block->prev_phys = NULL;
+	block->size = usable;
+	sentinel = block_next(block);
+	sentinel->size = 0;
+	block_mark_as_free(block);
+	insert_free_block(tlsf, block);
+
+	return E_OK;
+}
+
+
+/*!
+ * @brief TLSFからのブロック獲得
+ * @param[in] *tlsf:TLSF管理ブロック
+ * 	@arg NULL以外
+ * @param[in] size:要求サイズ
+ * 	@arg 0以外
+ * @return 獲得した領域へのポインタ
+ *	@retval NULL:要求を満たす空きブロックがない
+ */
+void* tlsf_malloc(TLSF_CNTRL *tlsf, UINT32 size)
+{
+	int fl, sl;
+	TLSF_BLOCK *block;
+
+	if (size == 0 || size >= TLSF_BLOCK_SIZE_MAX) {
+		return NULL;
+	}
+	size = (size + (TLSF_ALIGN_SIZE - 1)) & ~(TLSF_ALIGN_SIZE - 1);
+	if (size < TLSF_BLOCK_SIZE_MIN) {
+		size = TLSF_BLOCK_SIZE_MIN;
+	}
+
+	mapping_search(size, &fl, &sl);
+	block = search_suitable_block(tlsf, &fl, &sl);
+	if (block == NULL) {
+		return NULL;
+	}
+	remove_free_block(tlsf, block, fl, sl);
+	block_trim_free(tlsf, block, size);
+	block_mark_as_used(block);
+
+	return (char *)block + TLSF_BLOCK_HDR;
+}
+
+
+/*!
+ * @brief TLSFへのブロック返却
+ * @param[in] *tlsf:TLSF管理ブロック
+ * 	@arg NULL以外
+ * @param[in] *ptr:tlsf_malloc()で獲得した領域へのポインタ
+ * 	@arg NULL以外
+ * @return なし
+ * @note 物理的に前後の空きブロックと結合してから空きリストへつなぐ
+ */
+void tlsf_free(TLSF_CNTRL *tlsf, void *ptr)
+{
+	int fl, sl;
+	TLSF_BLOCK *block, *prev, *next;
+
+	block = (TLSF_BLOCK *)((char *)ptr - TLSF_BLOCK_HDR);
+	block_mark_as_free(block);
+
+	/* 前のブロックと結合 */
+	if (block->size & TLSF_BLOCK_PREV_FREE) {
+		prev = block->prev_phys;
+		mapping_insert(prev->size & ~TLSF_BLOCK_FLAGS, &fl, &sl);
+		remove_free_block(tlsf, prev, fl, sl);
+		prev->size += TLSF_BLOCK_HDR + (block->size & ~TLSF_BLOCK_FLAGS);
+		block = prev;
+		block_mark_as_free(block);
+	}
+	/* 以外 */
+	else {
+		/* 処理なし */
+	}
+
+	/* 次のブロックと結合(番兵は使用中なので結合されない) */
+	next = block_next(block);
+	if (next->size & TLSF_BLOCK_FREE) {
+		mapping_insert(next->size & ~TLSF_BLOCK_FLAGS, &fl, &sl);
+		remove_free_block(tlsf, next, fl, sl);
+		block->size += TLSF_BLOCK_HDR + (next->size & ~TLSF_BLOCK_FLAGS);
+		block_mark_as_free(block);
+	}
+	/* 以外 */
+	else {
+		/* 処理なし */
+	}
+
+	insert_free_block(tlsf, block);
+}
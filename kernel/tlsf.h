@@ -0,0 +1,61 @@
+/*!
+ * @file ターゲット非依存部
+ * @brief TLSF(Two-Level Segregated Fit)アロケータインターフェース
+ * @attention gcc4.5.x以外は試していない
+ * @note TLSF(M.Masmano et al., ECRTS'04)参考
+ */
+
+
+#ifndef _TLSF_H_INCLUDED_
+#define _TLSF_H_INCLUDED_
+
+
+/* os/kernel */
+#include "defines.h"
+
+
+/*! TLSFパラメータ定義 */
+#define TLSF_ALIGN_SIZE_LOG2					3																						/*! ブロックアライメント(2のべき乗) */
+#define TLSF_ALIGN_SIZE								(1 << TLSF_ALIGN_SIZE_LOG2)									/*! ブロックアライメント(8byte) */
+#define TLSF_SL_INDEX_COUNT_LOG2			4																						/*! 第2レベルの分割数(2のべき乗) */
+#define TLSF_SL_INDEX_COUNT						(1 << TLSF_SL_INDEX_COUNT_LOG2)							/*! 第2レベルの分割数 */
+#define TLSF_FL_INDEX_MAX							24																					/*! 第1レベルの最大インデックス(16Mbyteまで) */
+#define TLSF_FL_INDEX_SHIFT						(TLSF_SL_INDEX_COUNT_LOG2 + TLSF_ALIGN_SIZE_LOG2)	/*! 第1レベルの最小インデックス */
+#define TLSF_FL_INDEX_COUNT						(TLSF_FL_INDEX_MAX - TLSF_FL_INDEX_SHIFT + 1)	/*! 第1レベルの分割数 */
+#define TLSF_SMALL_BLOCK_SIZE					(1 << TLSF_FL_INDEX_SHIFT)									/*! 第1レベル0番で線形管理するサイズ */
+
+
+/*!
+ * @brief TLSFブロックヘッダ
+ * @note next_free,prev_freeは空きブロックの時のみ使用する(使用中はユーザ領域となる)
+ */
+typedef struct _tlsf_block {
+	struct _tlsf_block *prev_phys;				/*! 物理的に前のブロック(前が空きブロックの時のみ有効) */
+	UINT32 size;													/*! ブロックのユーザ領域サイズ(下位2ビットはフラグ) */
+	struct _tlsf_block *next_free;				/*! 空きリストの次ポインタ */
+	struct _tlsf_block *prev_free;				/*! 空きリストの前ポインタ */
+} TLSF_BLOCK;
+
+
+/*!
+ * @brief TLSF管理ブロック
+ */
+typedef struct _tlsf_control {
+	UINT32 fl_bitmap;																						/*! 第1レベルビットマップ */
+	UINT32 sl_bitmap[TLSF_FL_INDEX_COUNT];												/*! 第2レベルビットマップ */
+	TLSF_BLOCK *blocks[TLSF_FL_INDEX_COUNT][TLSF_SL_INDEX_COUNT];	/*! 各サイズクラスの空きリスト先頭 */
+	UINT32 free_size;																						/*! 空き領域の合計(ヘッダ含まず) */
+} TLSF_CNTRL;
+
+
+/*! TLSF管理ブロックと領域の初期化 */
+extern ER tlsf_init(TLSF_CNTRL *tlsf, void *mem, UINT32 bytes);
+
+/*! TLSFからのブロック獲得 */
+extern void* tlsf_malloc(TLSF_CNTRL *tlsf, UINT32 size);
+
+/*! TLSFへのブロック返却 */
+extern void tlsf_free(TLSF_CNTRL *tlsf, void *ptr);
+
+
+#endif
@@ -1 +1 @@
-C_SOURCES += log_manage.c
+C_SOURCES += log_manage.c log_encode.c log_drain.c defer.c transfer.c loader.c
@@ -0,0 +1,174 @@
+/*!
+ * @file ターゲット非依存部<モジュール:defer.o>
+ * @brief 割込み遅延処理(ボトムハーフ)
+ * @attention gcc4.5.x以外は試していない
+ * @note ・割込みハンドラは遅延処理要求をリングへ積むだけとし，実際の処理は高優先度の
+ * 				 サービスタスクがまとめて行う(割込み禁止区間と割込みハンドラの実行時間を短くする)
+ * 			 ・wup_tsk()は起床要求をキューイングしないので，サービスタスクはIRQ禁止のまま
+ * 				 リングが空である事を確認してslp_tsk()を発行し，起床要求の取りこぼしを防ぐ
+ * 				 (SWIはIRQ禁止を引き継ぐので，確認から起床待ちまでの間に割込みは入らない)
+ */
+
+
+/* os/kernel_svc */
+#include "defer.h"
+/* os/kernel */
+#include "kernel/kernel.h"
+/* os/arch/cpu */
+#include "arch/cpu/intr_cntrl.h"
+
+
+/*! コンパイラに対するメモリバリア(要求の書き込みとhead,tailの更新の順序を入れ替えさせない) */
+#define DEFER_BARRIER()							asm volatile ("" : : : "memory")
+
+
+/*! 遅延処理リングから要求を取り出し，まとめて実行する */
+static int defer_drain(void);
+
+/*! 遅延処理サービスタスク */
+static int defer_tsk_main(int argc, char *argv[]);
+
+
+/*! 遅延処理リング */
+static DEFER_INFO sg_defer;
+
+
+/*!
+ * @brief 遅延処理リングから要求を取り出し，まとめて実行する
+ * @param[in] なし
+ * @param[out] なし
+ * @return 実行した要求の数
+ * @note ・消費者はサービスタスクのみなので，IRQ禁止は行わない
+ * 			 ・tailはまとめて実行した後に1回だけ更新する(実行中の要求は上書きされない)
+ */
+static int defer_drain(void)
+{
+	UINT32 tail = sg_defer.tail;
+	UINT32 head = sg_defer.head;
+	int num = 0;
+	DEFER_WORK *work;
+
+	DEFER_BARRIER();
+
+	while (tail != head && num < DEFER_BATCH_MAX) {
+		work = &sg_defer.que[tail & (DEFER_QUEUE_SIZE - 1)];
+		(*work->func)(work->arg);
+		tail++;
+		num++;
+	}
+
+	DEFER_BARRIER();
+	sg_defer.tail = tail;
+
+	return num;
+}
+
+
+/*!
+ * @brief 遅延処理サービスタスク
+ * @param[in] argc:使用しない
+ * @param[in] *argv[]:使用しない
+ * @return 終了値(戻らない)
+ * @note slp_tsk()がサポートされないスケジューラ(RM以降)の場合はポーリングとなる
+ */
+static int defer_tsk_main(int argc, char *argv[])
+{
+	unsigned long cpsr;
+
+	while (1) {
+		defer_drain();
+
+		cpsr = save_disable_irq();
+		/* リングが空ならば起床待ち(起床後はIRQ禁止のまま戻ってくる) */
+		if (sg_defer.head == sg_defer.tail) {
+			sg_defer.sleep = TRUE;
+			if (mz_slp_tsk() != E_OK) {
+				sg_defer.sleep = FALSE;
+			}
+		}
+		else {
+			/* 処理なし */
+		}
+		restore_irq(cpsr);
+	}
+
+	return 0;
+}
+
+
+/*!
+ * @brief 遅延処理サービスタスクの生成と起動
+ * @param[in] なし
+ * @param[out] なし
+ * @return エラーコード
+ *	@retval 0より小さい:mz_run_tsk()のエラーコード,E_OK:正常終了
+ * @note initタスクから外部割込みを有効化する前に呼ぶ
+ */
+ER defer_init(void)
+{
+	SYSCALL_PARAMCB param;
+
+	sg_defer.head = sg_defer.tail = 0;
+	sg_defer.sleep = FALSE;
+	sg_defer.drops = 0;
+
+	param.un.run_tsk.func = defer_tsk_main;
+	param.un.run_tsk.name = "defer tsk";
+	param.un.run_tsk.priority = DEFER_TSK_PRI;
+	param.un.run_tsk.stacksize = DEFER_TSK_STACK;
+	param.un.run_tsk.rate = 0;
+	param.un.run_tsk.rel_exetim = 0;
+	param.un.run_tsk.deadtim = 0;
+	param.un.run_tsk.floatim = 0;
+	param.un.run_tsk.argc = 0;
+	param.un.run_tsk.argv = NULL;
+
+	if ((sg_defer.tskid = mz_run_tsk(&param)) < 0) {
+		return sg_defer.tskid;
+	}
+
+	return E_OK;
+}
+
+
+/*!
+ * @brief 遅延処理要求の登録
+ * @param[in] func:遅延処理関数
+ * 	@arg NULL以外
+ * @param[in] arg:遅延処理関数の引数
+ * 	@arg 特になし
+ * @return エラーコード
+ *	@retval E_QOVR:リングが満杯(要求は捨てる),E_OK:正常終了
+ * @note 割込みハンドラから呼ぶ(サービスタスクが起床待ちならばiwup_tsk()で起床させる)
+ */
+ER defer_enqueue(DEFER_FUNC func, int arg)
+{
+	DEFER_WORK *work;
+	unsigned long cpsr = save_disable_irq(); /* ネストした割込みハンドラ(生産者)同士の排他 */
+
+	/* リングが満杯 */
+	if (sg_defer.head - sg_defer.tail >= DEFER_QUEUE_SIZE) {
+		sg_defer.drops++;
+		restore_irq(cpsr);
+		return E_QOVR;
+	}
+
+	work = &sg_defer.que[sg_defer.head & (DEFER_QUEUE_SIZE - 1)];
+	work->func = func;
+	work->arg = arg;
+	DEFER_BARRIER();
+	sg_defer.head++;
+
+	/* サービスタスクが起床待ちの場合 */
+	if (sg_defer.sleep) {
+		sg_defer.sleep = FALSE;
+		mz_iwup_tsk(sg_defer.tskid);
+	}
+	else {
+		/* 処理なし */
+	}
+
+	restore_irq(cpsr);
+
+	return E_OK;
+}
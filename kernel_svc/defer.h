@@ -0,0 +1,58 @@
+/*!
+ * @file ターゲット非依存部
+ * @brief 割込み遅延処理(ボトムハーフ)インターフェース
+ * @attention gcc4.5.x以外は試していない
+ * @note Linuxのtasklet(softirq)参考
+ */
+
+
+#ifndef _DEFER_H_INCLUDED_
+#define _DEFER_H_INCLUDED_
+
+
+/* os/kernel */
+#include "kernel/defines.h"
+
+
+#define DEFER_QUEUE_SIZE					64				/*! 遅延処理リングの要素数(2のべき乗) */
+#define DEFER_BATCH_MAX						16				/*! サービスタスクが1回にまとめて処理する数 */
+#define DEFER_TSK_PRI							1					/*! サービスタスクの優先度(initタスクの次) */
+#define DEFER_TSK_STACK						0x200			/*! サービスタスクのスタックサイズ */
+
+
+/*! 遅延処理関数(サービスタスクのコンテキストで呼ばれる) */
+typedef void (*DEFER_FUNC)(int arg);
+
+
+/*!
+ * @brief 遅延処理要求
+ */
+typedef struct _defer_work {
+	DEFER_FUNC func;											/*! 遅延処理関数 */
+	int arg;															/*! 遅延処理関数の引数 */
+} DEFER_WORK;
+
+
+/*!
+ * @brief 遅延処理リング
+ * @note ・headは割込みハンドラ(生産者)のみ，tailはサービスタスク(消費者)のみが書き換える
+ * 			 ・割込みハンドラはネストするので，生産者同士はIRQ禁止で排他する
+ */
+typedef struct _defer_info {
+	volatile UINT32 head;									/*! 次に書き込む位置 */
+	volatile UINT32 tail;									/*! 次に読み出す位置 */
+	volatile BOOL sleep;									/*! サービスタスクが起床待ちか */
+	ER_ID tskid;													/*! サービスタスクのID */
+	UINT32 drops;													/*! リングが満杯で捨てた数 */
+	DEFER_WORK que[DEFER_QUEUE_SIZE];			/*! 遅延処理要求の格納領域 */
+} DEFER_INFO;
+
+
+/*! 遅延処理サービスタスクの生成と起動(initタスクから呼ぶ) */
+extern ER defer_init(void);
+
+/*! 遅延処理要求の登録(割込みハンドラから呼ぶ) */
+extern ER defer_enqueue(DEFER_FUNC func, int arg);
+
+
+#endif
@@ -0,0 +1,204 @@
+/*!
+ * @file ターゲット非依存部<モジュール:loader.o>
+ * @brief タスクイメージローダ
+ * @attention gcc4.5.x以外は試していない
+ * @note ・シリアル(XMODEM)で受信したタスクイメージを可変長メモリプールへ置き，タスクとして起動する
+ * 			 ・タスクセットを変更する度にuImageを書き換えて再起動しなくてもよいようにする
+ * 			 ・ロードしたイメージはタスクの終了を検出できないので解放しない(プールが尽きたら再起動する)
+ * 			 ・ロードしたタスクへはメイン関数の引数でサービステーブルを渡す(ABIはloader.hを参照)
+ */
+
+
+/* os/kernel_svc */
+#include "loader.h"
+/* os/kernel */
+#include "kernel/kernel.h"
+/* os/c_lib */
+#include "c_lib/lib.h"
+/* os/net */
+#include "net/xmodem.h"
+#include "net/crc16.h"
+
+
+/*! ローダ用の可変長メモリプールの生成 */
+static ER loader_pool_init(void);
+
+/*! タスクイメージの検査 */
+static ER check_task_image(UINT8 *image, UINT32 len);
+
+/*! 命令キャッシュとデータの同期 */
+static void sync_task_image(void);
+
+
+/*! ローダ用の可変長メモリプールを生成したか */
+static BOOL sg_loader_pool = FALSE;
+
+/*! ロードしたタスクへ渡すカーネルサービステーブル */
+static const LOADER_SERVICES sg_loader_services = {
+	LOADER_ABI_VERSION,
+	sizeof(LOADER_SERVICES),
+	mz_ext_tsk,
+	mz_exd_tsk,
+	mz_get_tid,
+	mz_get_pri,
+	mz_chg_pri,
+	mz_slp_tsk,
+	mz_tslp_tsk,
+	mz_wup_tsk,
+	mz_rel_wai,
+	mz_tget_mpl,
+	mz_rel_mpl,
+	mz_get_tim,
+	puts,
+	putxval,
+};
+
+/*! ロードしたタスクのメイン関数の第二引数(すべてのタスクで共有し，書き換えない) */
+static char *sg_loader_argv[] = {
+	(char *)&sg_loader_services,
+	NULL,
+};
+
+
+/*!
+ * @brief ローダ用の可変長メモリプールの生成
+ * @param[in] なし
+ * @param[out] なし
+ * @return エラーコード
+ *	@retval E_OK:生成済みまたは正常終了,上記以外:mz_cre_mpl()のエラーコード
+ * @note 最初のロード時に1回だけ生成する
+ */
+static ER loader_pool_init(void)
+{
+	ER ercd;
+
+	if (sg_loader_pool) {
+		return E_OK;
+	}
+	if ((ercd = mz_cre_mpl(LOADER_MPL_ID, MPL_TA_TFIFO, LOADER_MPL_SIZE)) != E_OK) {
+		return ercd;
+	}
+	sg_loader_pool = TRUE;
+
+	return E_OK;
+}
+
+
+/*!
+ * @brief タスクイメージの検査
+ * @param[in] *image:受信したタスクイメージ
+ * 	@arg NULL以外
+ * @param[in] len:受信したデータ長
+ * 	@arg 特になし
+ * @return エラーコード
+ *	@retval E_PAR:ヘッダの不正,E_OBJ:CRC-16の不一致,E_OK:正常
+ */
+static ER check_task_image(UINT8 *image, UINT32 len)
+{
+	LOADER_IMAGE_HEADER *hdr = (LOADER_IMAGE_HEADER *)image;
+
+	/* ヘッダの不正 */
+	if (len < sizeof(*hdr) || hdr->magic != LOADER_IMAGE_MAGIC || hdr->size == 0 ||
+			len - sizeof(*hdr) < hdr->size || hdr->size <= hdr->entry || (hdr->entry & 0x3) ||
+			hdr->stacksize == 0) {
+		return E_PAR;
+	}
+	/* CRC-16の不一致 */
+	else if (crc16_update(image + sizeof(*hdr), hdr->size, 0) != hdr->crc) {
+		return E_OBJ;
+	}
+	else {
+		return E_OK;
+	}
+}
+
+
+/*!
+ * @brief 命令キャッシュとデータの同期
+ * @param[in] なし
+ * @param[out] なし
+ * @return なし
+ * @note ・MMU(Dキャッシュ)は有効化していないので，書き込みの完了を待って命令キャッシュを無効化する
+ * 			 ・タスクはシステムモード(特権)で動作するので，CP15を操作できる
+ */
+static void sync_task_image(void)
+{
+	asm volatile ("mcr p15, 0, %0, c7, c10, 4\n\t" /* DSB */
+								"mcr p15, 0, %0, c7, c5, 0\n\t" /* ICIALLU */
+								"mcr p15, 0, %0, c7, c5, 4" /* ISB */
+								: : "r"(0) : "memory");
+}
+
+
+/*!
+ * @brief タスクイメージを受信して起動する
+ * @param[out] *p_tskid:起動したタスクのIDを格納する領域
+ * 	@arg NULL以外
+ * @return エラーコード
+ *	@retval E_NOMEM:プールの不足,E_PAR:ヘッダの不正,E_OBJ:CRC-16の不一致,
+ *	 				上記以外:recv_xmodem(),mz_acre_tsk(),mz_sta_tsk()のエラーコード,E_OK:正常終了
+ * @note ・受信用の最大サイズの領域へXMODEMで受信し，検査後にイメージのサイズ分の領域へ移してから
+ * 				 受信用の領域を返却する(プールにはイメージ分だけが残る)
+ * 			 ・タスクコンテキストから呼ぶ(受信中は起床待ちとなる)
+ * 			 ・メイン関数へはargc=1，argv[0]=サービステーブルを渡す
+ */
+ER load_task_image(ER_ID *p_tskid)
+{
+	UINT8 *recvbuf, *image;
+	UINT32 len, image_size;
+	LOADER_IMAGE_HEADER *hdr;
+	SYSCALL_PARAMCB param;
+	ER ercd;
+	ER_ID tskid;
+
+	if ((ercd = loader_pool_init()) != E_OK) {
+		return ercd;
+	}
+	if (mz_tget_mpl(LOADER_MPL_ID, LOADER_IMAGE_MAX, (void **)&recvbuf, TMO_POL) != E_OK) {
+		return E_NOMEM;
+	}
+
+	/* 受信と検査 */
+	if ((ercd = recv_xmodem(recvbuf, LOADER_IMAGE_MAX, &len)) != E_OK ||
+			(ercd = check_task_image(recvbuf, len)) != E_OK) {
+		mz_rel_mpl(LOADER_MPL_ID, recvbuf);
+		return ercd;
+	}
+
+	/* イメージのサイズ分の領域へ移す(EOFの埋め草は捨てる) */
+	image_size = sizeof(*hdr) + ((LOADER_IMAGE_HEADER *)recvbuf)->size;
+	if (mz_tget_mpl(LOADER_MPL_ID, image_size, (void **)&image, TMO_POL) != E_OK) {
+		mz_rel_mpl(LOADER_MPL_ID, recvbuf);
+		return E_NOMEM;
+	}
+	memcpy(image, recvbuf, image_size);
+	mz_rel_mpl(LOADER_MPL_ID, recvbuf);
+	sync_task_image();
+
+	hdr = (LOADER_IMAGE_HEADER *)image;
+	hdr->name[LOADER_NAME_SIZE - 1] = '\0';
+
+	param.un.acre_tsk.func = (TSK_FUNC)(image + sizeof(*hdr) + hdr->entry);
+	param.un.acre_tsk.name = hdr->name;
+	param.un.acre_tsk.priority = hdr->priority;
+	param.un.acre_tsk.stacksize = hdr->stacksize;
+	param.un.acre_tsk.rate = 0;
+	param.un.acre_tsk.rel_exetim = 0;
+	param.un.acre_tsk.deadtim = 0;
+	param.un.acre_tsk.floatim = 0;
+	param.un.acre_tsk.argc = 1;
+	param.un.acre_tsk.argv = sg_loader_argv;
+
+	if ((tskid = mz_acre_tsk(&param)) < 0) {
+		mz_rel_mpl(LOADER_MPL_ID, image);
+		return tskid;
+	}
+	if ((ercd = mz_sta_tsk(tskid)) != E_OK) {
+		mz_del_tsk(tskid);
+		mz_rel_mpl(LOADER_MPL_ID, image);
+		return ercd;
+	}
+	*p_tskid = tskid;
+
+	return E_OK;
+}
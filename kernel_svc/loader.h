@@ -0,0 +1,76 @@
+/*!
+ * @file ターゲット非依存部
+ * @brief タスクイメージローダインターフェース
+ * @attention gcc4.5.x以外は試していない
+ */
+
+
+#ifndef _LOADER_H_INCLUDED_
+#define _LOADER_H_INCLUDED_
+
+
+/* os/kernel */
+#include "kernel/defines.h"
+
+
+#define LOADER_IMAGE_MAGIC				0x49545a4d	/*! タスクイメージの識別子("MZTI") */
+#define LOADER_NAME_SIZE					16					/*! タスク名の最大長(NULを含む) */
+#define LOADER_MPL_ID							(MEMORYPOOL_ID_NUM - 1)	/*! ローダが使用する可変長メモリプールID */
+#define LOADER_MPL_SIZE						0x10000			/*! ローダが使用する可変長メモリプールのサイズ */
+#define LOADER_IMAGE_MAX					0x8000			/*! 受信できるタスクイメージの最大サイズ(ヘッダを含む) */
+#define LOADER_ABI_VERSION				1						/*! サービステーブルの版数(メンバを追加したら上げる) */
+
+
+/*!
+ * @brief タスクイメージのヘッダ(イメージの先頭に置く)
+ * @note ・ヘッダの直後に位置独立(-fpic，GOTを使用しない)でリンクしたコードとデータを置く
+ * 			 ・crcはヘッダの直後からsize分のCRC-16(XMODEMと同じ生成多項式)
+ * 			 ・メイン関数の引数はLOADER_SERVICESを参照
+ */
+typedef struct {
+	UINT32 magic;													/*! LOADER_IMAGE_MAGIC */
+	UINT32 size;													/*! ヘッダを除くコードとデータのサイズ */
+	UINT32 entry;													/*! コードの先頭からタスクのメイン関数までのオフセット */
+	UINT32 stacksize;											/*! タスクのスタックサイズ */
+	int priority;													/*! タスクの優先度 */
+	UINT16 crc;														/*! コードとデータのCRC-16 */
+	UINT16 reserved;											/*! 予約(0) */
+	char name[LOADER_NAME_SIZE];					/*! タスク名 */
+} LOADER_IMAGE_HEADER;
+
+
+/*!
+ * @brief ロードしたタスクへ渡すカーネルサービステーブル
+ * @note ・ロードしたタスクはカーネルとリンクしないので，カーネルのサービスはこのテーブル経由でのみ呼ぶ
+ * 				 (カーネルのシンボルを直接呼ぶと，イメージを置いた番地によって飛び先がずれる)
+ * 			 ・メイン関数はint main(int argc, char *argv[])とし，argc=1，argv[0]にテーブルの先頭番地が入る
+ * 				 (const LOADER_SERVICES *svc = (const LOADER_SERVICES *)argv[0];)
+ * 			 ・versionがLOADER_ABI_VERSIONより小さい場合は，それ以降に追加されたメンバを使用しない事
+ * 			 ・メンバは末尾にのみ追加し，並びと型は変更しない
+ * 			 ・メイン関数から戻るとタスクは終了する(ext_tsk()と同じ)
+ */
+typedef struct {
+	UINT32 version;												/*! LOADER_ABI_VERSION */
+	UINT32 size;													/*! テーブルのサイズ(sizeof(LOADER_SERVICES)) */
+	void (*ext_tsk)(void);								/*! 自タスクの終了 */
+	void (*exd_tsk)(void);								/*! 自タスクの終了と排除 */
+	ER (*get_tid)(ER_ID *p_tskid);				/*! 自タスクのID参照 */
+	ER (*get_pri)(ER_ID tskid, int *p_tskpri);	/*! タスクの優先度取得 */
+	ER (*chg_pri)(ER_ID tskid, int tskpri);	/*! タスクの優先度変更 */
+	ER (*slp_tsk)(void);									/*! 自タスクの起床待ち */
+	ER (*tslp_tsk)(int tmout);						/*! 自タスクの起床待ち(タイムアウトあり) */
+	ER (*wup_tsk)(ER_ID tskid);						/*! タスクの起床 */
+	ER (*rel_wai)(ER_ID tskid);						/*! 待ち状態強制解除 */
+	ER (*tget_mpl)(ER_ID mplid, int blksz, void **p_blk, int tmout);	/*! 可変長メモリブロックの獲得 */
+	ER (*rel_mpl)(ER_ID mplid, void *blk);	/*! 可変長メモリブロックの返却 */
+	ER (*get_tim)(UINT64 *p_systim);			/*! 単調増加時刻(usec)の参照 */
+	int (*puts)(char *str);								/*! コンソールへの文字列出力 */
+	int (*putxval)(unsigned long value, int column);	/*! コンソールへの16進数出力 */
+} LOADER_SERVICES;
+
+
+/*! タスクイメージを受信して起動する */
+extern ER load_task_image(ER_ID *p_tskid);
+
+
+#endif
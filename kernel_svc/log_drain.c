@@ -0,0 +1,241 @@
+/*!
+ * @file ターゲット非依存部<モジュール:log_drain.o>
+ * @brief ログ吸い出し
+ * @attention gcc4.5.x以外は試していない
+ * @note ・最低優先度のサービスタスクがログリングからイベントを取り出し，CRC-16付きのパケットにして
+ * 				 シリアルへ流し続ける(システムを止めずに長時間のトレースを取る)
+ * 			 ・記録側(kernel)はリングへ書くだけで待たされない．吸い出しが追いつかない分は
+ * 				 ログリングの方針に従って捨てられ，パケットの通し番号とdropsで分かる
+ * 			 ・送信は送信リングバッファの半分までしか積まず，空くまで起床待ちとなるので，
+ * 				 シリアルの帯域に合わせて自然に間引かれる(コンソール出力の分は空けておく)
+ * 			 ・吸い出しタスク自身のシステムコールと送信割込みもトレースされるので，
+ * 				 不要ならばtraceコマンドでカテゴリを絞る
+ * 			 ・kernelには時間指定の待ちがないので，LOG_DRAIN_BATCHに満たない残りは次に溜まるまで送信しない
+ * 			 ・取り出したイベントはリングから消え，パケットはXMODEMの送受信に混ざるので，
+ * 				 吸い出し中(log_drain_busy())はsendlog,loadを受け付けない
+ */
+
+
+/* os/kernel_svc */
+#include "log_drain.h"
+/* os/kernel */
+#include "kernel/kernel.h"
+/* os/arch/cpu */
+#include "arch/cpu/intr_cntrl.h"
+/* os/net */
+#include "net/crc16.h"
+/* os/target/driver */
+#include "target/driver/serial_driver.h"
+
+
+/*! パケットの送信 */
+static ER log_drain_send(UINT32 num, UINT32 seq, UINT32 drops);
+
+/*! ログ吸い出しタスク */
+static int log_drain_tsk_main(int argc, char *argv[]);
+
+
+/*!
+ * @brief ログ吸い出しの情報
+ */
+static struct {
+	ER_ID tskid;													/*! 吸い出しタスクのID */
+	volatile BOOL enable;									/*! 吸い出し中か */
+	volatile BOOL sleep;									/*! 吸い出しタスクが停止中の起床待ちか */
+	volatile BOOL active;									/*! パケットを取り出して送信中か(停止後も送り終えるまで) */
+	UINT32 packets;												/*! 送信したパケット数 */
+	UINT32 errors;												/*! 送信できなかったパケット数 */
+	LOG_DRAIN_PACKET packet;							/*! 送信するパケット */
+} sg_drain = {-1, FALSE, FALSE, FALSE};
+
+
+/*!
+ * @brief パケットの送信
+ * @param[in] num:パケットに詰めたイベント数
+ * 	@arg 1～LOG_DRAIN_BATCH
+ * @param[in] seq:先頭のイベントの通し番号
+ * 	@arg 特になし
+ * @param[in] drops:ログリングがこれまでに捨てたレコード数
+ * 	@arg 特になし
+ * @param[out] なし
+ * @return エラーコード
+ *	@retval E_OK:正常終了,上記以外:serial_send_frame()のエラーコード
+ * @note イベントはlog_consume()でパケットへ直接取り出しておく
+ */
+static ER log_drain_send(UINT32 num, UINT32 seq, UINT32 drops)
+{
+	LOG_DRAIN_PACKET *packet = &sg_drain.packet;
+	UINT8 *crc = (UINT8 *)&packet->event[num]; /* 最後のイベントの直後 */
+	int len = sizeof(packet->header) + num * sizeof(LOG_EVENT);
+	UINT16 sum;
+	ER ercd;
+
+	packet->header.sync[0] = LOG_DRAIN_SYNC0;
+	packet->header.sync[1] = LOG_DRAIN_SYNC1;
+	packet->header.type = LOG_DRAIN_TYPE_EVENT;
+	packet->header.count = (UINT8)num;
+	packet->header.seq = seq;
+	packet->header.drops = drops;
+
+	sum = crc16_update((UINT8 *)packet, len, 0);
+	crc[0] = (UINT8)sum;
+	crc[1] = (UINT8)(sum >> 8);
+
+	/* 送信リングバッファが空くまで起床待ち(ここで帯域に合わせる) */
+	ercd = serial_send_frame((unsigned char *)packet, len + sizeof(packet->crc), TRUE);
+	if (ercd == E_OK) {
+		sg_drain.packets++;
+	}
+	else {
+		sg_drain.errors++;
+	}
+
+	return ercd;
+}
+
+
+/*!
+ * @brief ログ吸い出しタスク
+ * @param[in] argc:使用しない
+ * @param[in] *argv[]:使用しない
+ * @return 終了値(戻らない)
+ * @note slp_tsk()がサポートされないスケジューラ(RM以降)の場合はポーリングとなる
+ */
+static int log_drain_tsk_main(int argc, char *argv[])
+{
+	unsigned long cpsr;
+	UINT32 num, seq, drops;
+
+	while (1) {
+		cpsr = save_disable_irq();
+		/* 停止中は起床待ち(起床後はIRQ禁止のまま戻ってくる) */
+		if (!sg_drain.enable) {
+			sg_drain.sleep = TRUE;
+			if (mz_slp_tsk() != E_OK) {
+				sg_drain.sleep = FALSE;
+			}
+		}
+		else {
+			/* 処理なし */
+		}
+		restore_irq(cpsr);
+
+		if (!sg_drain.enable) {
+			continue;
+		}
+
+		/* 溜まるまで待つ(他の起床要求で起床した場合はある分だけ送る) */
+		log_wait(LOG_DRAIN_BATCH);
+
+		/* 待ちの間に停止された場合は取り出さない(sendlogへ残す) */
+		cpsr = save_disable_irq();
+		sg_drain.active = sg_drain.enable;
+		restore_irq(cpsr);
+		if (!sg_drain.active) {
+			continue;
+		}
+
+		num = log_consume(sg_drain.packet.event, LOG_DRAIN_BATCH, &seq, &drops);
+		if (num != 0) {
+			log_drain_send(num, seq, drops);
+		}
+		else {
+			/* 処理なし */
+		}
+		sg_drain.active = FALSE;
+	}
+
+	return 0;
+}
+
+
+/*!
+ * @brief ログ吸い出しタスクの生成と起動
+ * @param[in] なし
+ * @param[out] なし
+ * @return エラーコード
+ *	@retval 0より小さい:mz_run_tsk()のエラーコード,E_OK:正常終了
+ * @note 起動直後は停止中(log_drain_enable()で開始する)
+ */
+ER log_drain_init(void)
+{
+	SYSCALL_PARAMCB param;
+
+	sg_drain.enable = sg_drain.sleep = sg_drain.active = FALSE;
+	sg_drain.packets = sg_drain.errors = 0;
+
+	param.un.run_tsk.func = log_drain_tsk_main;
+	param.un.run_tsk.name = "log drain tsk";
+	param.un.run_tsk.priority = LOG_DRAIN_TSK_PRI;
+	param.un.run_tsk.stacksize = LOG_DRAIN_TSK_STACK;
+	param.un.run_tsk.rate = 0;
+	param.un.run_tsk.rel_exetim = 0;
+	param.un.run_tsk.deadtim = 0;
+	param.un.run_tsk.floatim = 0;
+	param.un.run_tsk.argc = 0;
+	param.un.run_tsk.argv = NULL;
+
+	if ((sg_drain.tskid = mz_run_tsk(&param)) < 0) {
+		return sg_drain.tskid;
+	}
+
+	return E_OK;
+}
+
+
+/*!
+ * @brief ログ吸い出しの開始と停止
+ * @param[in] enable:開始するか
+ * 	@arg TRUE:開始,FALSE:停止
+ * @param[out] なし
+ * @return なし
+ * @note ・タスクから呼ぶ(停止中の吸い出しタスクを起床させる)
+ * 			 ・停止は送信中のパケットを送り終えてから有効になる
+ */
+void log_drain_enable(BOOL enable)
+{
+	unsigned long cpsr = save_disable_irq();
+
+	sg_drain.enable = enable;
+	/* 停止中の吸い出しタスクを起床させる */
+	if (enable && sg_drain.sleep) {
+		sg_drain.sleep = FALSE;
+		mz_wup_tsk(sg_drain.tskid);
+	}
+	else {
+		/* 処理なし */
+	}
+
+	restore_irq(cpsr);
+}
+
+
+/*!
+ * @brief ログ吸い出しの状態の取得
+ * @param[out] *p_packets:送信したパケット数を格納する領域
+ * 	@arg NULL以外
+ * @param[out] *p_errors:送信できなかったパケット数を格納する領域
+ * 	@arg NULL以外
+ * @return 吸い出し中か
+ */
+BOOL log_drain_status(UINT32 *p_packets, UINT32 *p_errors)
+{
+	*p_packets = sg_drain.packets;
+	*p_errors = sg_drain.errors;
+
+	return sg_drain.enable;
+}
+
+
+/*!
+ * @brief ログ吸い出し中か
+ * @param[in] なし
+ * @param[out] なし
+ * @return 吸い出し中か(停止後に送り終えていないパケットがある場合も含む)
+ * @note ・sendlog,loadの受け付け前に呼ぶ(吸い出し中はログリングとシリアルを吸い出しが使う)
+ * 			 ・割込みハンドラからも呼べる
+ */
+BOOL log_drain_busy(void)
+{
+	return sg_drain.enable || sg_drain.active;
+}
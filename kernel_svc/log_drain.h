@@ -0,0 +1,65 @@
+/*!
+ * @file ターゲット非依存部
+ * @brief ログ吸い出しインターフェース
+ * @attention gcc4.5.x以外は試していない
+ */
+
+
+#ifndef _LOG_DRAIN_H_INCLUDED_
+#define _LOG_DRAIN_H_INCLUDED_
+
+
+/* os/kernel */
+#include "kernel/defines.h"
+/* os/kernel_svc */
+#include "log_manage.h"
+
+
+#define LOG_DRAIN_SYNC0						0xA5				/*! パケットの同期バイト0 */
+#define LOG_DRAIN_SYNC1						0x5A				/*! パケットの同期バイト1 */
+#define LOG_DRAIN_TYPE_EVENT			1						/*! パケットの種類(トレースイベント) */
+#define LOG_DRAIN_BATCH						16					/*! 1パケットに詰めるイベント数(溜まるまで送信しない) */
+#define LOG_DRAIN_TSK_PRI					(PRIORITY_NUM - 1)	/*! 吸い出しタスクの優先度(最低) */
+#define LOG_DRAIN_TSK_STACK				0x200				/*! 吸い出しタスクのスタックサイズ */
+
+
+/*!
+ * @brief パケットのヘッダ(12byte，リトルエンディアン)
+ * @note ・ヘッダの直後にcount個のイベント(LOG_EVENT)，その直後にCRC-16(2byte，リトルエンディアン)を置く
+ * 			 ・CRC-16はヘッダの先頭からイベントの終わりまで(XMODEMと同じ生成多項式)
+ * 			 ・受信側は同期バイトを探してCRC-16で確定するので，コンソール出力がパケットの間に混ざってもよい
+ * 			 ・形式はtools/trace_decode.cと合わせる事
+ */
+typedef struct {
+	UINT8 sync[2];												/*! LOG_DRAIN_SYNC0,LOG_DRAIN_SYNC1 */
+	UINT8 type;														/*! パケットの種類 */
+	UINT8 count;													/*! イベント数 */
+	UINT32 seq;														/*! 先頭のイベントの通し番号 */
+	UINT32 drops;													/*! ログリングがこれまでに捨てたレコード数 */
+} LOG_DRAIN_HEADER;
+
+
+/*!
+ * @brief パケット(送信の作業領域)
+ */
+typedef struct {
+	LOG_DRAIN_HEADER header;							/*! ヘッダ */
+	LOG_EVENT event[LOG_DRAIN_BATCH];			/*! イベント */
+	UINT8 crc[2];													/*! CRC-16の置き場所(イベントが少ない場合は直後に詰める) */
+} LOG_DRAIN_PACKET;
+
+
+/*! ログ吸い出しタスクの生成と起動(initタスクから呼ぶ) */
+extern ER log_drain_init(void);
+
+/*! ログ吸い出しの開始と停止 */
+extern void log_drain_enable(BOOL enable);
+
+/*! ログ吸い出しの状態の取得 */
+extern BOOL log_drain_status(UINT32 *p_packets, UINT32 *p_errors);
+
+/*! ログ吸い出し中か */
+extern BOOL log_drain_busy(void);
+
+
+#endif
@@ -0,0 +1,306 @@
+/*!
+ * @file ターゲット非依存部<モジュール:log_encode.o>
+ * @brief ログのエクスポート符号化
+ * @attention gcc4.5.x以外は試していない
+ * @note ・トレースイベントは同じタスクID，優先度，単調増加のカウンタが続くので，
+ * 				 前のレコードとの差分をvarintで詰め，さらに繰り返しを後方参照(LZSS)で圧縮する
+ * 			 ・シリアル送信がエクスポートのボトルネックなので，sendlogの送信量を減らす
+ * 			 ・作業領域は静的に持つ(sendlogを実行するサービスタスクのスタックは小さい)
+ */
+
+
+/* os/kernel_svc */
+#include "log_encode.h"
+/* os/c_lib */
+#include "c_lib/lib.h"
+
+
+#define LOG_ENCODE_EVENT_TYPES		16					/*! 引数の前回値を保持するイベントの種類数(超える種類は0番と共用) */
+#define LOG_ENCODE_LZ_HASH_SIZE		1024				/*! 後方参照の候補を引くハッシュ表の要素数(2のべき乗) */
+
+
+/*!
+ * @brief 符号化の出力先
+ */
+typedef struct {
+	UINT8 *buf;														/*! 出力領域 */
+	UINT32 size;													/*! 出力領域のサイズ */
+	UINT32 pos;														/*! 次に書き込む位置 */
+	BOOL over;														/*! 出力領域が溢れたか */
+} LOG_ENCODE_STREAM;
+
+
+/*! 1byteの出力 */
+static void log_encode_put(LOG_ENCODE_STREAM *s, UINT8 c);
+
+/*! varintの出力 */
+static void log_encode_put_varint(LOG_ENCODE_STREAM *s, UINT32 val);
+
+/*! 符号付き差分をzigzagで符号なしにする */
+static UINT32 log_encode_zigzag(UINT32 cur, UINT32 prev);
+
+/*! 差分とvarintによる符号化 */
+static UINT32 log_encode_delta(const LOG_EVENT *rec, UINT32 count, UINT8 *buf, UINT32 size);
+
+/*! 後方参照(LZSS)による圧縮 */
+static UINT32 log_encode_lz(const UINT8 *in, UINT32 len, UINT8 *buf, UINT32 size);
+
+
+/*!
+ * @brief 符号化の作業領域
+ */
+static struct {
+	UINT32 prev_arg[LOG_ENCODE_EVENT_TYPES][2];							/*! イベントの種類ごとの引数の前回値 */
+	UINT16 lz_head[LOG_ENCODE_LZ_HASH_SIZE];								/*! ハッシュごとの直近の位置+1(0は候補なし) */
+	UINT8 work[LOG_ENCODE_BUF_SIZE];												/*! 差分とvarintの出力(後方参照の入力) */
+	UINT8 out[sizeof(LOG_ENCODE_HEADER) + LOG_ENCODE_BUF_SIZE];	/*! 符号化したダンプ */
+} sg_encode;
+
+
+/*!
+ * @brief 1byteの出力
+ * @param[in] *s:出力先
+ * 	@arg NULL以外
+ * @param[in] c:出力する値
+ * 	@arg 特になし
+ * @param[out] なし
+ * @return なし
+ * @note 溢れた場合は書き込まずにoverを立てる(呼び出し側は最後に1回だけ検査する)
+ */
+static void log_encode_put(LOG_ENCODE_STREAM *s, UINT8 c)
+{
+	if (s->pos < s->size) {
+		s->buf[s->pos++] = c;
+	}
+	else {
+		s->over = TRUE;
+	}
+}
+
+
+/*!
+ * @brief varintの出力
+ * @param[in] *s:出力先
+ * 	@arg NULL以外
+ * @param[in] val:出力する値
+ * 	@arg 特になし
+ * @param[out] なし
+ * @return なし
+ * @note 下位から7bitずつ出力し，続きがあるバイトは最上位ビットを立てる(1～5byte)
+ */
+static void log_encode_put_varint(LOG_ENCODE_STREAM *s, UINT32 val)
+{
+	while (val >= 0x80) {
+		log_encode_put(s, (UINT8)(val | 0x80));
+		val >>= 7;
+	}
+	log_encode_put(s, (UINT8)val);
+}
+
+
+/*!
+ * @brief 符号付き差分をzigzagで符号なしにする
+ * @param[in] cur:今回の値
+ * 	@arg 特になし
+ * @param[in] prev:前回の値
+ * 	@arg 特になし
+ * @param[out] なし
+ * @return 差分(0,-1,1,-2,2...を0,1,2,3,4...へ写す)
+ */
+static UINT32 log_encode_zigzag(UINT32 cur, UINT32 prev)
+{
+	UINT32 diff = cur - prev;
+
+	return (diff << 1) ^ (0 - (diff >> 31));
+}
+
+
+/*!
+ * @brief 差分とvarintによる符号化
+ * @param[in] *rec:古い順に並べたレコード
+ * 	@arg NULL以外
+ * @param[in] count:レコード数
+ * 	@arg 特になし
+ * @param[out] *buf:出力領域
+ * 	@arg NULL以外
+ * @param[in] size:出力領域のサイズ
+ * 	@arg 特になし
+ * @return 出力したサイズ(溢れた場合は0)
+ */
+static UINT32 log_encode_delta(const LOG_EVENT *rec, UINT32 count, UINT8 *buf, UINT32 size)
+{
+	LOG_ENCODE_STREAM s = {buf, size, 0, FALSE};
+	UINT32 prev_time = 0, prev_tskid = 0;
+	UINT32 *prev_arg, i;
+	UINT8 tag;
+
+	memset(sg_encode.prev_arg, 0, sizeof(sg_encode.prev_arg));
+
+	for (i = 0; i < count && !s.over; i++, rec++) {
+		prev_arg = sg_encode.prev_arg[(rec->event < LOG_ENCODE_EVENT_TYPES) ? rec->event : 0];
+
+		tag = (rec->event < LOG_ENCODE_TAG_EVENT) ? (UINT8)rec->event : LOG_ENCODE_TAG_EVENT;
+		tag |= (rec->tskid == prev_tskid) ? LOG_ENCODE_TAG_SAME_TSKID : 0;
+		tag |= (rec->arg0 == prev_arg[0]) ? LOG_ENCODE_TAG_SAME_ARG0 : 0;
+		tag |= (rec->arg1 == prev_arg[1]) ? LOG_ENCODE_TAG_SAME_ARG1 : 0;
+
+		log_encode_put(&s, tag);
+		log_encode_put_varint(&s, rec->time - prev_time); /* サイクルカウンタは一周しても差分は正 */
+		if ((tag & LOG_ENCODE_TAG_EVENT) == LOG_ENCODE_TAG_EVENT) {
+			log_encode_put_varint(&s, rec->event);
+		}
+		if (!(tag & LOG_ENCODE_TAG_SAME_TSKID)) {
+			log_encode_put_varint(&s, log_encode_zigzag(rec->tskid, prev_tskid));
+		}
+		if (!(tag & LOG_ENCODE_TAG_SAME_ARG0)) {
+			log_encode_put_varint(&s, log_encode_zigzag(rec->arg0, prev_arg[0]));
+		}
+		if (!(tag & LOG_ENCODE_TAG_SAME_ARG1)) {
+			log_encode_put_varint(&s, log_encode_zigzag(rec->arg1, prev_arg[1]));
+		}
+
+		prev_time = rec->time;
+		prev_tskid = rec->tskid;
+		prev_arg[0] = rec->arg0;
+		prev_arg[1] = rec->arg1;
+	}
+
+	return s.over ? 0 : s.pos;
+}
+
+
+/*!
+ * @brief 後方参照(LZSS)による圧縮
+ * @param[in] *in:圧縮するデータ
+ * 	@arg NULL以外
+ * @param[in] len:圧縮するデータのサイズ
+ * 	@arg LOG_ENCODE_BUF_SIZE以下
+ * @param[out] *buf:出力領域
+ * 	@arg NULL以外
+ * @param[in] size:出力領域のサイズ
+ * 	@arg 特になし
+ * @return 出力したサイズ(溢れた場合は0)
+ * @note ・候補は先頭3byteのハッシュごとに直近の1箇所のみとし，探索を1回の比較で済ませる
+ * 			 ・一致は現在位置を越えて伸びてもよい(展開側は1byteずつ複写する)
+ */
+static UINT32 log_encode_lz(const UINT8 *in, UINT32 len, UINT8 *buf, UINT32 size)
+{
+	LOG_ENCODE_STREAM s = {buf, size, 0, FALSE};
+	UINT32 pos = 0, flag_pos = 0, cand = 0, match, max, dist, hash, i;
+	UINT8 bit = 0;
+
+	memset(sg_encode.lz_head, 0, sizeof(sg_encode.lz_head));
+
+	while (pos < len && !s.over) {
+		/* 8要素ごとにフラグを置く */
+		if (bit == 0) {
+			flag_pos = s.pos;
+			log_encode_put(&s, 0);
+			bit = 1;
+		}
+
+		match = 0;
+		if (pos + LOG_ENCODE_LZ_MIN <= len) {
+			hash = ((in[pos] << 6) ^ (in[pos + 1] << 3) ^ in[pos + 2]) & (LOG_ENCODE_LZ_HASH_SIZE - 1);
+			cand = sg_encode.lz_head[hash];
+			sg_encode.lz_head[hash] = (UINT16)(pos + 1);
+			/* 候補があり，参照できる距離 */
+			if (cand != 0 && pos - (cand - 1) <= LOG_ENCODE_LZ_WINDOW) {
+				cand--;
+				max = (len - pos < LOG_ENCODE_LZ_MAX) ? len - pos : LOG_ENCODE_LZ_MAX;
+				while (match < max && in[cand + match] == in[pos + match]) {
+					match++;
+				}
+			}
+			else {
+				/* 処理なし */
+			}
+		}
+
+		/* 後方参照 */
+		if (match >= LOG_ENCODE_LZ_MIN) {
+			if (!s.over) {
+				buf[flag_pos] |= bit;
+			}
+			dist = pos - cand - 1;
+			log_encode_put(&s, (UINT8)dist);
+			log_encode_put(&s, (UINT8)(((dist >> 8) << 4) | (match - LOG_ENCODE_LZ_MIN)));
+			/* 一致した範囲も候補として登録する */
+			for (i = 1; i < match && pos + i + LOG_ENCODE_LZ_MIN <= len; i++) {
+				hash = ((in[pos + i] << 6) ^ (in[pos + i + 1] << 3) ^ in[pos + i + 2]) & (LOG_ENCODE_LZ_HASH_SIZE - 1);
+				sg_encode.lz_head[hash] = (UINT16)(pos + i + 1);
+			}
+			pos += match;
+		}
+		/* リテラル */
+		else {
+			log_encode_put(&s, in[pos++]);
+		}
+		bit <<= 1;
+	}
+
+	return s.over ? 0 : s.pos;
+}
+
+
+/*!
+ * @brief エクスポートするダンプの符号化
+ * @param[in] *dump:log_export_begin()が返したダンプ(ログリングのヘッダと古い順に並べたレコード)
+ * 	@arg NULL以外
+ * @param[in] flags:符号化の指定
+ * 	@arg LOG_ENCODE_DELTA,LOG_ENCODE_LZ
+ * @param[out] **p_buf:符号化したダンプを格納する領域
+ * 	@arg NULL以外
+ * @return 符号化したダンプのサイズ(ヘッダを含む)
+ *	@retval 0:符号化できない(作業領域が溢れた，元のダンプより小さくならない，ダンプの不正)
+ * @note ・0の場合は元のダンプをそのまま送る
+ * 			 ・符号化したダンプは作業領域のコピーなので，返却後はログリングの凍結を解除してよい
+ * 			 ・作業領域は1つなので，複数のタスクから同時に呼ばない事
+ */
+UINT32 log_encode(const UINT8 *dump, UINT32 flags, UINT8 **p_buf)
+{
+	const LOG_RING *ring = (const LOG_RING *)dump;
+	LOG_ENCODE_HEADER *header = (LOG_ENCODE_HEADER *)sg_encode.out;
+	UINT8 *payload = sg_encode.out + sizeof(*header);
+	UINT32 raw_size, size, dump_size;
+
+	if (ring->magic != LOG_RING_MAGIC || ring->record_size != sizeof(LOG_EVENT) || (flags & ~LOG_ENCODE_LZ)) {
+		return 0;
+	}
+	dump_size = sizeof(*ring) + ring->count * ring->record_size;
+
+	/* 差分とvarint(後方参照で圧縮する場合は作業領域へ) */
+	raw_size = log_encode_delta((const LOG_EVENT *)(ring + 1), ring->count,
+															(flags & LOG_ENCODE_LZ) ? sg_encode.work : payload, LOG_ENCODE_BUF_SIZE);
+	if (raw_size == 0 && ring->count != 0) {
+		return 0;
+	}
+
+	/* 後方参照 */
+	if (flags & LOG_ENCODE_LZ) {
+		size = log_encode_lz(sg_encode.work, raw_size, payload, LOG_ENCODE_BUF_SIZE);
+		if (size == 0 && raw_size != 0) {
+			return 0;
+		}
+	}
+	else {
+		size = raw_size;
+	}
+
+	/* 小さくならない */
+	if (sizeof(*header) + size >= dump_size) {
+		return 0;
+	}
+
+	header->magic = LOG_ENCODE_MAGIC;
+	header->flags = flags;
+	header->count = ring->count;
+	header->seq = ring->seq;
+	header->drops = ring->drops;
+	header->raw_size = raw_size;
+	header->size = size;
+
+	*p_buf = sg_encode.out;
+
+	return sizeof(*header) + size;
+}
@@ -0,0 +1,62 @@
+/*!
+ * @file ターゲット非依存部
+ * @brief ログのエクスポート符号化インターフェース
+ * @attention gcc4.5.x以外は試していない
+ */
+
+
+#ifndef _LOG_ENCODE_H_INCLUDED_
+#define _LOG_ENCODE_H_INCLUDED_
+
+
+/* os/kernel */
+#include "kernel/defines.h"
+/* os/kernel_svc */
+#include "log_manage.h"
+
+
+#define LOG_ENCODE_MAGIC					0x5a474c4d	/*! 符号化したダンプの識別子("MLGZ") */
+#define LOG_ENCODE_BUF_SIZE				4096				/*! 符号化の作業領域のサイズ(ログ格納専用メモリセグメントと同じ) */
+
+/*! 符号化の指定(LOG_ENCODE_HEADERのflags) */
+#define LOG_ENCODE_DELTA					0x0					/*! 差分とvarintのみ */
+#define LOG_ENCODE_LZ							0x1					/*! 差分とvarintの後に後方参照(LZSS)で圧縮する */
+
+/*! レコードのタグ(先頭1byte) */
+#define LOG_ENCODE_TAG_EVENT			0x0f				/*! イベントの種類(0x0fの場合は直後にvarintで置く) */
+#define LOG_ENCODE_TAG_SAME_TSKID	0x10				/*! タスクIDが前のレコードと同じ */
+#define LOG_ENCODE_TAG_SAME_ARG0	0x20				/*! 引数0が同じ種類の前のイベントと同じ */
+#define LOG_ENCODE_TAG_SAME_ARG1	0x40				/*! 引数1が同じ種類の前のイベントと同じ */
+
+/*! 後方参照(LZSS)の形式 */
+#define LOG_ENCODE_LZ_WINDOW			4096				/*! 参照できる距離(12bit) */
+#define LOG_ENCODE_LZ_MIN					3						/*! 後方参照にする最小の一致長 */
+#define LOG_ENCODE_LZ_MAX					18					/*! 最大の一致長(4bit + LOG_ENCODE_LZ_MIN) */
+
+
+/*!
+ * @brief 符号化したダンプのヘッダ(リトルエンディアン)
+ * @note ・ヘッダの直後にsize byteの符号化データを置く
+ * 			 ・1レコードはタグ，時刻の差分(varint)，[イベントの種類(varint)]，[タスクIDの差分]，[引数0の差分]，
+ * 				 [引数1の差分]の順で，差分は符号付きをzigzagで符号なしにしてからvarint(7bitずつ，下位から)で置く
+ * 			 ・時刻とタスクIDは直前のレコード，引数は同じ種類の直前のイベントとの差分(最初は0との差分)
+ * 			 ・LOG_ENCODE_LZの場合は，上記のバイト列(raw_size byte)をフラグ1byte + 8要素単位で置く．
+ * 				 フラグのビットが1の要素は2byteの後方参照(距離-1の12bitと一致長-3の4bit)，0の要素はリテラル1byte
+ * 			 ・形式はtools/trace_decode.cと合わせる事
+ */
+typedef struct {
+	UINT32 magic;													/*! LOG_ENCODE_MAGIC */
+	UINT32 flags;													/*! 符号化の指定 */
+	UINT32 count;													/*! レコード数 */
+	UINT32 seq;														/*! 次に書き込むレコードの通し番号(先頭はseq - count番) */
+	UINT32 drops;													/*! 捨てた(上書きした)レコード数 */
+	UINT32 raw_size;											/*! 後方参照で圧縮する前のサイズ */
+	UINT32 size;													/*! 符号化データのサイズ */
+} LOG_ENCODE_HEADER;
+
+
+/*! エクスポートするダンプの符号化 */
+extern UINT32 log_encode(const UINT8 *dump, UINT32 flags, UINT8 **p_buf);
+
+
+#endif
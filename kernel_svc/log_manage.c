@@ -2,7 +2,9 @@
  * @file ターゲット非依存部<モジュール:log_manage.o>
  * @brief ロギング
  * @attention gcc4.5.x以外は試していない
- * @note 時間の対応を行う
+ * @note ・kernelの遷移(システムコール，割込み，タイマ満了，待ち解除，ディスパッチ)を
+ * 				 サイクルカウンタ付きの16byte固定長イベントとして記録する
+ * 			 ・ログ格納専用メモリセグメントをリングとして使用し，満杯になっても方針に従って捨てて動作を続ける
  */
 
 
@@ -10,82 +12,370 @@
 #include "log_manage.h"
 /* os/kernel */
 #include "kernel/kernel.h"
+/* os/arch */
+#include "arch/cpu/intr_cntrl.h"
+#include "arch/cpu/pmu.h"
 /* os/c_lib */
 #include "c_lib/lib.h"
 
 
-#define LOG_BUFFER_MAX 			4096	/*! ログバッファの最大 */
-#define CONTEXT_LOG_ONESIZE 92		/*! コンテキストログ1つあたりの大きさ */
+#define LOG_BUFFER_MAX 			4096	/*! ログ格納専用メモリセグメントのサイズ */
+#define LOG_RECORD_MAX			((LOG_BUFFER_MAX - sizeof(LOG_RING)) / sizeof(LOG_EVENT)) /*! 格納できるレコード数 */
 
-/*! ログの数 */
-UINT32 g_log_counter = 0;
+
+/*! レコードの取得 */
+static LOG_EVENT* log_record(UINT32 index);
+
+/*! レコードの並びを反転 */
+static void log_reverse(UINT32 first, UINT32 last);
+
+
+/*! 起動時に有効なトレースカテゴリ */
+#ifdef DEBUG_LEVEL2
+#define LOG_MASK_DEFAULT		(LOG_CAT_TRACE_ALL | LOG_CAT_DEBUG_MSG | LOG_CAT_KERNEL_MSG)
+#else
+#define LOG_MASK_DEFAULT		(LOG_CAT_DEBUG_MSG | LOG_CAT_KERNEL_MSG)
+#endif
+
+/*! 有効なトレースカテゴリで定義されたビット */
+#define LOG_MASK_VALID			(LOG_CAT_TRACE_ALL | LOG_CAT_DEBUG_MSG | LOG_CAT_KERNEL_MSG)
+
+
+/*! 有効なトレースカテゴリ(トレースポイントとメッセージマクロが参照する) */
+volatile UINT32 g_log_mask = LOG_MASK_DEFAULT;
 
 /*! ログ格納専用メモリセグメント */
 extern volatile unsigned long _logbuffer_start;
-static volatile unsigned long *logbuf = &_logbuffer_start;
+static LOG_RING *sg_ring = (LOG_RING *)&_logbuffer_start;
+
+/*!
+ * @brief レコードの蓄積待ち
+ * @note ・待ちのタスクは1つのみ(吸い出しタスク)
+ * 			 ・記録はIRQ禁止区間やシステムコールの途中でも行われるので，log_event()からは起床させず，
+ * 				 ディスパッチ直前のlog_kick()で起床させる
+ */
+static struct {
+	volatile ER_ID tskid;									/*! 蓄積待ちのタスクID(-1は待ちなし) */
+	volatile UINT32 want;									/*! 蓄積待ちのタスクを起床させるレコード数 */
+} sg_log_waiter = {-1, 0};
 
 
 /*!
- * コンテキストスイッチングのログの出力(Linux jsonログを参考(フォーマット変換は行わない))
- * log_tcb : コンテキストスイッチング対象TCB
+ * @brief レコードの取得
+ * @param[in] index:リング内のレコードの位置
+ * 	@arg 0～capacity-1
+ * @param[out] なし
+ * @return レコードへのポインタ
  */
-void get_log(OBJP log_tcb)
+static LOG_EVENT* log_record(UINT32 index)
 {
-	static UINT32 tmp = 0;
-	TCB *work = (TCB *)log_tcb;
-	UINT32 tskid, priority, state;
+	return (LOG_EVENT *)(sg_ring + 1) + index;
+}
 
-	/* 実行可能タスクが決定していない時(init_tsk生成等で呼ばれる) */
-	if (work == NULL) {
-		return;
+
+/*!
+ * @brief レコードの並びを反転
+ * @param[in] first:反転する範囲の先頭
+ * 	@arg 特になし
+ * @param[in] last:反転する範囲の終端(含まない)
+ * 	@arg first以上
+ * @param[out] なし
+ * @return なし
+ */
+static void log_reverse(UINT32 first, UINT32 last)
+{
+	LOG_EVENT tmp;
+
+	while (first + 1 < last) {
+		last--;
+		tmp = *log_record(first);
+		*log_record(first) = *log_record(last);
+		*log_record(last) = tmp;
+		first++;
 	}
-	/* ログバッファがオーバーフローした場合 */
-	else if (LOG_BUFFER_MAX < ((g_log_counter + 1) * CONTEXT_LOG_ONESIZE)) {
-		KERNEL_OUTMSG("error: get_log() \n");
-		down_system(); /* kernelのフリーズ */
+}
+
+
+/*!
+ * @brief ログリングの初期化
+ * @param[in] なし
+ * @param[out] なし
+ * @return なし
+ * @note kernelの初期化時(initタスクの生成前)に呼ぶ
+ */
+void log_init(void)
+{
+	memset(sg_ring, 0, sizeof(*sg_ring));
+	sg_ring->magic = LOG_RING_MAGIC;
+	sg_ring->record_size = sizeof(LOG_EVENT);
+	sg_ring->capacity = LOG_RECORD_MAX;
+	sg_ring->policy = LOG_DROP_OLDEST;
+}
+
+
+/*!
+ * @brief ログリングが満杯の時の方針を設定
+ * @param[in] policy:満杯の時の方針
+ * 	@arg LOG_DROP_OLDEST,LOG_DROP_NEWEST
+ * @param[out] なし
+ * @return エラーコード
+ *	@retval E_PAR:方針の不正,E_OK:正常終了
+ */
+ER log_set_policy(LOG_POLICY policy)
+{
+	if (policy != LOG_DROP_OLDEST && policy != LOG_DROP_NEWEST) {
+		return E_PAR;
+	}
+	sg_ring->policy = policy;
+
+	return E_OK;
+}
+
+
+/*!
+ * @brief 有効なトレースカテゴリの設定
+ * @param[in] mask:有効にするトレースカテゴリ(LOG_CAT_*の論理和)
+ * 	@arg 定義済みのビットのみ
+ * @param[out] なし
+ * @return エラーコード
+ *	@retval E_PAR:未定義のビットを含む,E_OK:正常終了
+ * @note ・タスクからもkernelからも呼べる(1ワードの書き込みなので排他しない)
+ * 			 ・無効にしたカテゴリのトレースポイントは次の通過から記録しない
+ */
+ER log_set_mask(UINT32 mask)
+{
+	if (mask & ~LOG_MASK_VALID) {
+		return E_PAR;
+	}
+	g_log_mask = mask;
+
+	return E_OK;
+}
+
+
+/*!
+ * @brief 有効なトレースカテゴリの取得
+ * @param[in] なし
+ * @param[out] なし
+ * @return 有効なトレースカテゴリ(LOG_CAT_*の論理和)
+ */
+UINT32 log_get_mask(void)
+{
+	return g_log_mask;
+}
+
+
+/*!
+ * @brief エクスポートのためにログリングを凍結して古い順に並べる
+ * @param[out] **p_buf:エクスポートする領域(ログリングの先頭)を格納する領域
+ * 	@arg NULL以外
+ * @return エクスポートするサイズ(ヘッダとcount個のレコード)
+ * @note ・凍結中にkernelが書こうとしたレコードは捨ててdropsに数える
+ * 			 ・最も古いレコードが先頭にくるようにリングをその場で回転する(3回の反転)ので，
+ * 				 受信側はヘッダのseq - countから順に通し番号を振ればよい
+ * 			 ・送信が終わったらlog_export_end()を呼ぶ
+ */
+UINT32 log_export_begin(UINT8 **p_buf)
+{
+	unsigned long cpsr;
+	UINT32 oldest;
+
+	cpsr = save_disable_irq();
+	sg_ring->frozen = TRUE; /* レコードは割込み禁止状態で書くので，タスクから見て書きかけのレコードはない */
+	restore_irq(cpsr);
+
+	/* 最も古いレコードを先頭へ回転 */
+	oldest = (sg_ring->head + sg_ring->capacity - sg_ring->count) % sg_ring->capacity;
+	if (oldest != 0) {
+		log_reverse(0, oldest);
+		log_reverse(oldest, sg_ring->capacity);
+		log_reverse(0, sg_ring->capacity);
+	}
+	sg_ring->head = sg_ring->count % sg_ring->capacity;
+
+	*p_buf = (UINT8 *)sg_ring;
+
+	return sizeof(*sg_ring) + sg_ring->count * sg_ring->record_size;
+}
+
+
+/*!
+ * @brief エクスポートの終了(ログリングの凍結を解除)
+ * @param[in] なし
+ * @param[out] なし
+ * @return なし
+ * @note エクスポートしたレコードは消さない(次のエクスポートにも含まれる)
+ */
+void log_export_end(void)
+{
+	sg_ring->frozen = FALSE;
+}
+
+
+/*!
+ * @brief 最も古いレコードから取り出す
+ * @param[out] *buf:取り出したレコードを格納する領域
+ * 	@arg max個分の領域
+ * @param[in] max:取り出す最大のレコード数
+ * 	@arg 特になし
+ * @param[out] *p_seq:取り出した最初のレコードの通し番号を格納する領域
+ * 	@arg NULL以外
+ * @param[out] *p_drops:これまでに捨てた(上書きした)レコード数を格納する領域
+ * 	@arg NULL以外
+ * @return 取り出したレコード数(エクスポート中は0)
+ * @note ・取り出したレコードはリングから消える(sendlogのエクスポートには含まれない)
+ * 			 ・コピーの間だけIRQ禁止にするので，記録側(kernel)を待たせるのは最大max個分のコピー時間のみ
+ * 			 ・上書きによる取りこぼしは前回取り出した最後の通し番号との差で分かる
+ */
+UINT32 log_consume(LOG_EVENT *buf, UINT32 max, UINT32 *p_seq, UINT32 *p_drops)
+{
+	unsigned long cpsr;
+	UINT32 oldest, num, i;
+
+	/* ログリングの初期化前 */
+	if (sg_ring->magic != LOG_RING_MAGIC) {
+		return 0;
+	}
+
+	cpsr = save_disable_irq();
+
+	/* エクスポート中 */
+	if (sg_ring->frozen) {
+		restore_irq(cpsr);
+		return 0;
+	}
+
+	num = (sg_ring->count < max) ? sg_ring->count : max;
+	oldest = (sg_ring->head + sg_ring->capacity - sg_ring->count) % sg_ring->capacity;
+	*p_seq = sg_ring->seq - sg_ring->count;
+	*p_drops = sg_ring->drops;
+	for (i = 0; i < num; i++) {
+		buf[i] = *log_record((oldest + i) % sg_ring->capacity);
+	}
+	sg_ring->count -= num;
+
+	restore_irq(cpsr);
+
+	return num;
+}
+
+
+/*!
+ * @brief レコードが溜まるまで待つ
+ * @param[in] want:起床するレコード数
+ * 	@arg 1～格納できるレコード数
+ * @param[out] なし
+ * @return エラーコード
+ *	@retval E_PAR:レコード数の不正,E_OBJ:他のタスクが蓄積待ち,
+ *					E_OK:正常終了(溜まった，または他の起床要求で起床した),上記以外:mz_slp_tsk()のエラーコード
+ * @note ・タスクから呼ぶ(起床待ちの間もkernelの記録は止めない)
+ * 			 ・エクスポート中は溜まっていても待つ
+ */
+ER log_wait(UINT32 want)
+{
+	unsigned long cpsr;
+	ER ercd = E_OK;
+
+	if (want == 0 || want > sg_ring->capacity) {
+		return E_PAR;
+	}
+
+	cpsr = save_disable_irq();
+	/* 他のタスクが蓄積待ち */
+	if (sg_log_waiter.tskid != -1) {
+		ercd = E_OBJ;
+	}
+	/* まだ溜まっていない(起床後はIRQ禁止のまま戻ってくる) */
+	else if (sg_ring->frozen || sg_ring->count < want) {
+		sg_log_waiter.want = want;
+		sg_log_waiter.tskid = (ER_ID)g_current->init.tskid;
+		ercd = mz_slp_tsk();
+		sg_log_waiter.tskid = -1; /* log_kick()以外で起床した場合も待ちを解除 */
+	}
+	else {
+		/* 処理なし */
+	}
+	restore_irq(cpsr);
+
+	return ercd;
+}
+
+
+/*!
+ * @brief 蓄積待ちのタスクの起床
+ * @param[in] なし
+ * @param[out] なし
+ * @return なし
+ * @note ・kernelのディスパッチ直前(context_switching())で呼ぶ
+ * 			 ・起床による記録(待ち解除)は待ちを解除してから行われるので，再帰しない
+ */
+void log_kick(void)
+{
+	/* 蓄積待ちのタスクがいて，要求数まで溜まった */
+	if (sg_log_waiter.tskid != -1 && !sg_ring->frozen && sg_ring->count >= sg_log_waiter.want) {
+		mz_iwup_tsk(sg_log_waiter.tskid);
+		sg_log_waiter.tskid = -1;
 	}
 	else {
 		/* 処理なし */
 	}
+}
+
+
+/*!
+ * @brief トレースイベントの記録
+ * @param[in] event:イベントの種類
+ * 	@arg LOG_EVENT_ID
+ * @param[in] tskid:イベントに関係するタスクのID
+ * 	@arg 特になし
+ * @param[in] arg0:引数0
+ * 	@arg 特になし(イベントの種類ごとの意味はLOG_EVENT_ID参照)
+ * @param[in] arg1:引数1
+ * 	@arg 特になし(イベントの種類ごとの意味はLOG_EVENT_ID参照)
+ * @param[out] なし
+ * @return なし
+ * @note ・ネストした割込みハンドラからも呼ばれるので，レコードの確保と書き込みは割込み禁止で行う
+ * 			 ・満杯の時はLOG_DROP_OLDESTなら最も古いレコードを上書きし，LOG_DROP_NEWESTなら捨てる
+ */
+void log_event(LOG_EVENT_ID event, UINT32 tskid, UINT32 arg0, UINT32 arg1)
+{
+	LOG_EVENT *rec;
+	unsigned long cpsr;
+
+	/* ログリングの初期化前 */
+	if (sg_ring->magic != LOG_RING_MAGIC) {
+		return;
+	}
+
+	cpsr = save_disable_irq();
 
-	tskid = (UINT32)work->init.tskid;
-	priority = (UINT32)work->priority;
-	state = (UINT32)work->state;
-	
-	/*
-	 * prevのログをメモリセグメントへ
-	 * ・prevログ
-	 *  システムコールを発行したタスクの次(ISR適用後(currentが切り替わるものは，適用前のログとなる))の状態
-	 */
-	if (g_log_counter == tmp) {
-		DEBUG_LEVEL1_OUTMSG(" out prev log : get_log().\n");
-		memset((char *)logbuf, 0, TASK_NAME_SIZE * 4);
-		strcpy((char *)logbuf, work->init.name);
-		logbuf += TASK_NAME_SIZE;
-		*logbuf = tskid;
-		logbuf++;
-		*logbuf = tskid;
-		logbuf++;
-		*logbuf = priority;
-		logbuf++;
-		*logbuf = state;
-		logbuf++;
-		tmp = g_log_counter;
-		g_log_counter++;
-	}
-	/*
-	 * nextのログをメモリセグメントへ
-	 * ・nextログ
-	 *  次にディスパッチされるタスクの状態
-	 */
+	/* エクスポート中 */
+	if (sg_ring->frozen) {
+		sg_ring->drops++;
+		restore_irq(cpsr);
+		return;
+	}
+	/* 満杯 */
+	else if (sg_ring->count == sg_ring->capacity) {
+		sg_ring->drops++;
+		/* 新しいレコードを捨てる */
+		if (sg_ring->policy == LOG_DROP_NEWEST) {
+			restore_irq(cpsr);
+			return;
+		}
+	}
 	else {
-		DEBUG_LEVEL1_OUTMSG(" out next log : get_log().\n");
-		*logbuf = tskid;
-		logbuf++;
-		*logbuf = priority;
-		logbuf++;
-		*logbuf = state;
-		logbuf++;
-		tmp = g_log_counter;
+		sg_ring->count++;
 	}
+
+	rec = log_record(sg_ring->head);
+	rec->time = pmu_read_ccnt();
+	rec->event = (UINT16)event;
+	rec->tskid = (UINT16)tskid;
+	rec->arg0 = arg0;
+	rec->arg1 = arg1;
+	sg_ring->head = (sg_ring->head + 1) % sg_ring->capacity;
+	sg_ring->seq++;
+
+	restore_irq(cpsr);
 }
@@ -14,14 +14,128 @@
 #include "kernel/defines.h"
 
 
-#define CONTEXT_LOG_ONESIZE 92		/* コンテキストログ1つあたりの大きさ */
+#define LOG_RING_MAGIC					0x474f4c4d	/*! ログリングの識別子("MLOG") */
 
 
-/* ログの数 */
-extern UINT32 g_log_counter;
+/*!
+ * @brief ログリングが満杯の時の方針
+ */
+typedef enum {
+	LOG_DROP_OLDEST = 0,									/*! 最も古いレコードを上書きする(常時トレース向け) */
+	LOG_DROP_NEWEST,											/*! 新しいレコードを捨てる(起動直後の記録を残す) */
+} LOG_POLICY;
+
+
+/*!
+ * @brief トレースイベントの種類
+ * @note 値はダンプ形式の一部なので，追加する場合は末尾へ足す(tools/trace_decode.cと合わせる事)
+ */
+typedef enum {
+	LOG_EV_SYSCALL_ENTRY = 1,							/*! システムコールの入り口(arg0:ISRタイプ,arg1:呼び出し種別) */
+	LOG_EV_SYSCALL_EXIT,									/*! システムコールの出口(arg0:ISRタイプ,arg1:返却値) */
+	LOG_EV_IRQ_ENTRY,											/*! 外部割込みの入り口(arg0:割込み番号,arg1:ネストしているか) */
+	LOG_EV_IRQ_EXIT,											/*! 外部割込みの出口(arg0:割込み番号,arg1:スケジューラを呼ぶか) */
+	LOG_EV_TIMER,													/*! タイマの満了(arg0:タイマの種類,arg1:コールバックルーチン) */
+	LOG_EV_WAKEUP,												/*! 待ち解除(tskid:起床したタスク,arg0:待ち解除の返却値,arg1:待ち要因) */
+	LOG_EV_DISPATCH,											/*! ディスパッチ(tskid:次に実行するタスク,arg0:契機の割込みタイプ,arg1:優先度) */
+} LOG_EVENT_ID;
+
+
+/*! LOG_EV_SYSCALL_ENTRYの呼び出し種別(arg1) */
+#define LOG_SYSCALL_PARAM					0						/*! パラメータブロック渡し */
+#define LOG_SYSCALL_REG						1						/*! レジスタ渡し */
+#define LOG_SYSCALL_INTR					2						/*! 非タスクコンテキスト用 */
+
+/*! LOG_EV_TIMERのタイマの種類(arg0) */
+#define LOG_TIMER_CYCLIC					0						/*! 周期タイマ */
+#define LOG_TIMER_ONESHOT					1						/*! ワンショットタイマ(差分のキュー) */
+
+
+/*!
+ * @brief トレースイベントのレコード(16byte固定長，リトルエンディアン)
+ * @note timeはPMUのサイクルカウンタ(CPUクロック，32bitで一周する)なので，
+ * 			 デコーダは前のレコードとの差分を積算して時刻を復元する
+ */
+typedef struct {
+	UINT32 time;													/*! サイクルカウンタ値 */
+	UINT16 event;													/*! イベントの種類(LOG_EVENT_ID) */
+	UINT16 tskid;													/*! タスクID */
+	UINT32 arg0;													/*! 引数0 */
+	UINT32 arg1;													/*! 引数1 */
+} LOG_EVENT;
+
+
+/*!
+ * @brief ログリング(ログ格納専用メモリセグメントの先頭に置き，直後にレコードを並べる)
+ * @note ・レコードの書き込みは割込み禁止状態で行う(ネストした割込みからも書く)
+ * 			 ・seqは書き込んだレコードの通し番号(単調増加)で，リング内の最も古いレコードはseq - count番
+ * 			 ・エクスポート中(frozen)は書き込まずに捨てるので，タスクからリングを読み出しても一貫している
+ */
+typedef struct {
+	UINT32 magic;													/*! LOG_RING_MAGIC */
+	UINT32 record_size;										/*! レコードのサイズ */
+	UINT32 capacity;											/*! 格納できるレコード数 */
+	UINT32 head;													/*! 次に書き込むレコードの位置 */
+	UINT32 count;													/*! 格納しているレコード数 */
+	UINT32 seq;														/*! 次に書き込むレコードの通し番号 */
+	UINT32 drops;													/*! 捨てた(上書きした)レコード数 */
+	UINT32 policy;												/*! 満杯の時の方針(LOG_POLICY) */
+	volatile UINT32 frozen;								/*! エクスポート中か */
+} LOG_RING;
+
+
+/*!
+ * トレースポイント
+ * -カテゴリが無効な時は分岐1回(無効側へ予測)で抜ける
+ * -NO_TRACEPOINT定義時はトレースポイント自体を組み込まない(引数の変数は未使用の警告を出さない)
+ */
+#ifndef NO_TRACEPOINT
+#define LOG_TRACE(cat, event, tskid, arg0, arg1) \
+	do { \
+		if (LOG_CAT_ENABLED(cat)) { \
+			log_event((event), (UINT32)(tskid), (UINT32)(arg0), (UINT32)(arg1)); \
+		} \
+	} while (0)
+#else
+/* 引数は使用した扱いにする(コードは生成されない) */
+#define LOG_TRACE(cat, event, tskid, arg0, arg1) \
+	do { \
+		if (0) { \
+			log_event((event), (UINT32)(tskid), (UINT32)(arg0), (UINT32)(arg1)); \
+		} \
+	} while (0)
+#endif
+
+
+/*! ログリングの初期化 */
+extern void log_init(void);
+
+/*! ログリングが満杯の時の方針を設定 */
+extern ER log_set_policy(LOG_POLICY policy);
+
+/*! 有効なトレースカテゴリの設定 */
+extern ER log_set_mask(UINT32 mask);
+
+/*! 有効なトレースカテゴリの取得 */
+extern UINT32 log_get_mask(void);
+
+/*! エクスポートのためにログリングを凍結して古い順に並べる */
+extern UINT32 log_export_begin(UINT8 **p_buf);
+
+/*! エクスポートの終了(ログリングの凍結を解除) */
+extern void log_export_end(void);
+
+/*! 最も古いレコードから取り出す */
+extern UINT32 log_consume(LOG_EVENT *buf, UINT32 max, UINT32 *p_seq, UINT32 *p_drops);
+
+/*! レコードが溜まるまで待つ */
+extern ER log_wait(UINT32 want);
+
+/*! 蓄積待ちのタスクの起床 */
+extern void log_kick(void);
 
-/*! コンテキストスイッチングのログの出力(Linux jsonログを参考(フォーマット変換は行わない)) */
-extern void get_log(OBJP log_tcb);
+/*! トレースイベントの記録 */
+extern void log_event(LOG_EVENT_ID event, UINT32 tskid, UINT32 arg0, UINT32 arg1);
 
 
 #endif
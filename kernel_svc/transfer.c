@@ -0,0 +1,163 @@
+/*!
+ * @file ターゲット非依存部<モジュール:transfer.o>
+ * @brief 転送タスク
+ * @attention gcc4.5.x以外は試していない
+ * @note ・ログの送信やタスクイメージの受信(XMODEM)のように，相手を待って長く止まる処理を
+ * 				 通常の優先度のタスクで行う(遅延処理サービスタスクは短い処理のみとし，転送中も
+ * 				 他の遅延処理を止めない)
+ * 			 ・依頼は1件のみ受け付け，転送中の依頼はE_OBJとする
+ * 			 ・転送中は受信リングバッファを転送処理が使うので，コマンドの読み出しは転送の終了後とする
+ */
+
+
+/* os/kernel_svc */
+#include "transfer.h"
+/* os/kernel */
+#include "kernel/kernel.h"
+/* os/arch/cpu */
+#include "arch/cpu/intr_cntrl.h"
+/* os/c_lib */
+#include "c_lib/lib.h"
+
+
+/*! 転送タスク */
+static int transfer_tsk_main(int argc, char *argv[]);
+
+
+/*!
+ * @brief 転送タスクの情報
+ */
+static struct {
+	ER_ID tskid;													/*! 転送タスクのID */
+	volatile BOOL busy;										/*! 依頼中(実行中)か */
+	volatile BOOL sleep;									/*! 転送タスクが依頼の起床待ちか */
+	TRANSFER_FUNC func;										/*! 依頼された転送処理 */
+	char arg[TRANSFER_ARG_SIZE];					/*! 転送処理へ渡す引数(依頼元の領域は書き換えられるので写す) */
+} sg_transfer = {-1, FALSE, FALSE};
+
+
+/*!
+ * @brief 転送タスク
+ * @param[in] argc:使用しない
+ * @param[in] *argv[]:使用しない
+ * @return 終了値(戻らない)
+ * @note slp_tsk()がサポートされないスケジューラ(RM以降)の場合はポーリングとなる
+ */
+static int transfer_tsk_main(int argc, char *argv[])
+{
+	unsigned long cpsr;
+
+	while (1) {
+		cpsr = save_disable_irq();
+		/* 依頼がなければ起床待ち(起床後はIRQ禁止のまま戻ってくる) */
+		if (!sg_transfer.busy) {
+			sg_transfer.sleep = TRUE;
+			if (mz_slp_tsk() != E_OK) {
+				sg_transfer.sleep = FALSE;
+			}
+		}
+		else {
+			/* 処理なし */
+		}
+		restore_irq(cpsr);
+
+		if (!sg_transfer.busy) {
+			continue;
+		}
+
+		(*sg_transfer.func)(sg_transfer.arg);
+		sg_transfer.busy = FALSE; /* 次の依頼を受け付ける */
+	}
+
+	return 0;
+}
+
+
+/*!
+ * @brief 転送タスクの生成と起動
+ * @param[in] なし
+ * @param[out] なし
+ * @return エラーコード
+ *	@retval 0より小さい:mz_run_tsk()のエラーコード,E_OK:正常終了
+ * @note 起動直後は依頼の起床待ち
+ */
+ER transfer_init(void)
+{
+	SYSCALL_PARAMCB param;
+
+	sg_transfer.busy = sg_transfer.sleep = FALSE;
+
+	param.un.run_tsk.func = transfer_tsk_main;
+	param.un.run_tsk.name = "transfer tsk";
+	param.un.run_tsk.priority = TRANSFER_TSK_PRI;
+	param.un.run_tsk.stacksize = TRANSFER_TSK_STACK;
+	param.un.run_tsk.rate = 0;
+	param.un.run_tsk.rel_exetim = 0;
+	param.un.run_tsk.deadtim = 0;
+	param.un.run_tsk.floatim = 0;
+	param.un.run_tsk.argc = 0;
+	param.un.run_tsk.argv = NULL;
+
+	if ((sg_transfer.tskid = mz_run_tsk(&param)) < 0) {
+		return sg_transfer.tskid;
+	}
+
+	return E_OK;
+}
+
+
+/*!
+ * @brief 転送処理の依頼
+ * @param[in] func:転送処理
+ * 	@arg NULL以外
+ * @param[in] *arg:転送処理へ渡す引数(写してから渡す)
+ * 	@arg 終端を含めてTRANSFER_ARG_SIZE以下の文字列
+ * @param[out] なし
+ * @return エラーコード
+ *	@retval E_PAR:引数が長すぎる,E_OBJ:転送中,E_OK:正常終了
+ * @note タスクから呼ぶ(起床待ちの転送タスクを起床させる)
+ */
+ER transfer_request(TRANSFER_FUNC func, const char *arg)
+{
+	unsigned long cpsr;
+
+	if (strlen(arg) >= TRANSFER_ARG_SIZE) {
+		return E_PAR;
+	}
+
+	cpsr = save_disable_irq();
+	/* 転送中 */
+	if (sg_transfer.busy) {
+		restore_irq(cpsr);
+		return E_OBJ;
+	}
+
+	sg_transfer.func = func;
+	strcpy(sg_transfer.arg, arg);
+	sg_transfer.busy = TRUE;
+	/* 起床待ちの転送タスクを起床させる */
+	if (sg_transfer.sleep) {
+		sg_transfer.sleep = FALSE;
+		mz_wup_tsk(sg_transfer.tskid);
+	}
+	else {
+		/* 処理なし */
+	}
+
+	restore_irq(cpsr);
+
+	return E_OK;
+}
+
+
+/*!
+ * @brief 転送処理の依頼中(実行中)か
+ * @param[in] なし
+ * @param[out] なし
+ * @return 依頼中か
+ * @note 割込みハンドラからも呼べる
+ */
+BOOL transfer_busy(void)
+{
+	return sg_transfer.busy;
+}
@@ -0,0 +1,35 @@
+/*!
+ * @file ターゲット非依存部
+ * @brief 転送タスクインターフェース
+ * @attention gcc4.5.x以外は試していない
+ */
+
+
+#ifndef _TRANSFER_H_INCLUDED_
+#define _TRANSFER_H_INCLUDED_
+
+
+/* os/kernel */
+#include "kernel/defines.h"
+
+
+#define TRANSFER_ARG_SIZE					16					/*! 転送処理へ渡す引数の最大長(終端を含む) */
+#define TRANSFER_TSK_PRI					8						/*! 転送タスクの優先度(遅延処理サービスタスクより低い通常の優先度) */
+#define TRANSFER_TSK_STACK				0x400				/*! 転送タスクのスタックサイズ */
+
+
+/*! 転送処理(転送タスクのコンテキストで呼ばれる) */
+typedef void (*TRANSFER_FUNC)(char *arg);
+
+
+/*! 転送タスクの生成と起動(initタスクから呼ぶ) */
+extern ER transfer_init(void);
+
+/*! 転送処理の依頼(タスクから呼ぶ) */
+extern ER transfer_request(TRANSFER_FUNC func, const char *arg);
+
+/*! 転送処理の依頼中(実行中)か */
+extern BOOL transfer_busy(void);
+
+
+#endif
@@ -1 +1 @@
-C_SOURCES += xmodem.c
+C_SOURCES += xmodem.c crc16.c
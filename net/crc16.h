@@ -0,0 +1,20 @@
+/*!
+ * @file ターゲット非依存部
+ * @brief CRC-16(CCITT)計算インターフェース
+ * @attention gcc4.5.x以外は試していない
+ */
+
+
+#ifndef _CRC16_H_INCLUDED_
+#define _CRC16_H_INCLUDED_
+
+
+/* os/kernel */
+#include "kernel/defines.h"
+
+
+/*! CRC-16の計算 */
+extern UINT16 crc16_update(const UINT8 *p, UINT32 len, UINT16 crc);
+
+
+#endif
@@ -1,34 +1,138 @@
 /*!
  * @file ターゲット非依存部<モジュール:xmodem.o>
- * @brief xmodem転送プロトコル(送信)
+ * @brief xmodem転送プロトコル(送受信)
  * @attention gcc4.5.x以外は試していない
+ * @note ・XMODEM(128byteブロック，チェックサム)とXMODEM-1K(1Kブロック，CRC-16)に対応し，受信側の開始要求で切り替える
+ * 			 ・YMODEM-G(ブロック0にファイル名とサイズ，ブロックごとの応答なし)にも対応する
+ * 			 ・受信はCRCモードのみ('C'で開始)とし，128byteと1Kブロックの混在を受け付ける
+ * 			 ・相手からの文字はすべてタイムアウトありの起床待ち(recv_serial_timed())で受信し，相手が止まっても戻ってくる
  */
 
 
 /* os/net */
 #include "jis_ctrl_crd.h"
 #include "xmodem.h"
+#include "crc16.h"
+/* os/kernel */
+#include "kernel/kernel.h"
 /* os/target/driver */
 #include "target/driver/serial_driver.h"
 
 
-#define XMODEM_BLOCK_SIZE 128 /* XMODEMのブロックサイズ */
+#define XMODEM_BLOCK_OVERHEAD 5 /* ヘッダ(SOH/STX)，ブロック番号，反転したブロック番号，CRC-16(チェックサムは1byte) */
+#define XMODEM_CRC_REQUEST 'C' /* 受信側のCRCモード要求 */
+#define YMODEM_G_REQUEST 'G' /* 受信側のYMODEM-G(ストリーミング)要求 */
+#define XMODEM_START_RETRY 60 /* 受信開始時に'C'を送る回数 */
+#define XMODEM_START_WAIT 1000 /* 受信開始時に'C'を送ってから送信側の応答を待つ時間(msec) */
+#define XMODEM_BLOCK_WAIT 10000 /* 受信中に次のブロックを待つ時間(msec) */
+#define XMODEM_ERROR_MAX 10 /* 同じブロックで誤りを許す回数 */
 
 
-/*! NAK待ち(データ送信開始前に呼ぶ) */
-static void wait_xmodem(void);
+/*! 相手からの1文字を時間を区切って待つ */
+static int recv_xmodem_timed(int msec);
+
+/*! 受信側の要求(NAK，'C'，'G'またはCAN)待ち */
+static int wait_xmodem(void);
+
+/*! 受信側からの中断(CAN)を検査する */
+static BOOL check_xmodem_cancel(void);
+
+/*! YMODEMのブロック0(ファイル名とサイズ)の送信 */
+static void write_ymodem_header(const char *name, UINT32 size);
+
+/*! YMODEM-Gでのブロック送信制御 */
+static BOOL send_ymodem_g_blocks(const char *name, UINT8 *bufp, UINT32 size);
+
+/*! 送信側から指定数の文字を受信する */
+static BOOL recv_xmodem_bytes(UINT8 *p, int len);
+
+/*! 受信の中断(CANを送る) */
+static void cancel_xmodem(void);
+
+/*! XMODEMでのブロック受信制御 */
+static ER recv_xmodem_blocks(UINT8 *bufp, UINT32 size, UINT32 *p_len);
 
 /*! ブロックの送信 */
-static void write_xmodem_block(UINT8 block_number, UINT8 *logbuf, int data_len);
+static void write_xmodem_block(UINT8 block_number, UINT8 *logbuf, int data_len, int block_size, BOOL crc);
+
+/*! XMODEMでのブロック送信制御 */
+static BOOL send_xmodem_blocks(UINT8 *bufp, UINT32 size, int block_size);
+
+
+/*! ブロックバッファ(DMA送信中は書き換えない) */
+static UINT8 sg_xmodem_block[XMODEM_1K_BLOCK_SIZE + XMODEM_BLOCK_OVERHEAD];
+
+
+/*!
+ * 相手からの1文字を時間を区切って待つ
+ * msec : 待つ時間(msec)
+ * (返却値)0以上 : 受信した文字
+ * (返却値)-1 : タイムアウト
+ * -生データ受信の起床待ち(タイムアウトあり)なので，待つ間はCPUを使わない
+ */
+static int recv_xmodem_timed(int msec)
+{
+	char c;
+
+	if (recv_serial_timed(&c, 1, msec) == 1) {
+		return (UINT8)c;
+	}
+	else {
+		return -1;
+	}
+}
+
+
+/*!
+ * 受信側の要求(NAK，'C'，'G'またはCAN)待ち
+ * (返却値)XMODEM_CRC_REQUEST : CRCモード
+ * (返却値)YMODEM_G_REQUEST : YMODEM-G(CRCモード，ブロックごとの応答なし)
+ * (返却値)JIS_X_0211_NAK : チェックサムモード
+ * (返却値)JIS_X_0211_CAN : 中断(受信側が要求を送らずにXMODEM_START_RETRY回タイムアウトした場合も含む)
+ */
+static int wait_xmodem(void)
+{
+	int c, retry = 0;
+
+	/* 受信側から要求を受信するまで(要求以外の文字は読み捨てる) */
+	while (retry < XMODEM_START_RETRY) {
+		c = recv_xmodem_timed(XMODEM_START_WAIT);
+		if (c == XMODEM_CRC_REQUEST || c == YMODEM_G_REQUEST || c == JIS_X_0211_NAK || c == JIS_X_0211_CAN) {
+			return c;
+		}
+		else if (c < 0) {
+			retry++;
+		}
+		else {
+			/* 処理なし */
+		}
+	}
+
+	return JIS_X_0211_CAN;
+}
 
 
-/*! NAK待ち(データ送信開始前に呼ぶ) */
-static void wait_xmodem(void)
+/*!
+ * 受信側からの中断(CAN)を検査する
+ * (返却値)TRUE : CANを受信した
+ * (返却値)FALSE : CANを受信していない
+ * -応答を待たずにブロックを送り続ける間に呼び，受信済みの文字をすべて読み捨てる(待ちにはならない)
+ */
+static BOOL check_xmodem_cancel(void)
 {
-	/* 受信側からNAKを受信するまで */
-	while(JIS_X_0211_NAK != recv_serial_byte()) {
-		;
+	char c;
+	BOOL cancel = FALSE;
+
+	while (recv_serial(&c, 1, FALSE) == 1) {
+		if ((UINT8)c == JIS_X_0211_CAN) {
+			cancel = TRUE;
+		}
+		else {
+			/* 処理なし */
+		}
 	}
+
+	return cancel;
 }
 
 
@@ -37,103 +141,451 @@ static void wait_xmodem(void)
  * block_number : ブロック番号
  * *logbuf : 送信するデータがあるポインタ
  * data_len : ブロック内のデータ長
+ * block_size : ブロックサイズ(XMODEM_BLOCK_SIZEの場合はSOH，XMODEM_1K_BLOCK_SIZEの場合はSTX)
+ * crc : TRUEの場合はCRC-16，FALSEの場合はチェックサムを付加
+ * -ヘッダからCRC-16(チェックサム)までをブロックバッファに組み立て，DMAでまとめて送信する
  */
-static void write_xmodem_block(UINT8 block_number, UINT8 *logbuf, int data_len)
+static void write_xmodem_block(UINT8 block_number, UINT8 *logbuf, int data_len, int block_size, BOOL crc)
 {
 	UINT8 check_sum;
+	UINT8 *p = sg_xmodem_block;
+	UINT8 *data;
+	UINT16 crc16;
 	int i;
 
-	send_serial_byte(block_number); /* ブロック番号の送信 */
+	*p++ = (block_size == XMODEM_1K_BLOCK_SIZE) ? JIS_X_0211_STX : JIS_X_0211_SOH; /* データ送信開始の合図 */
+	*p++ = block_number; /* ブロック番号 */
+	*p++ = ~block_number; /* 反転したブロック番号 */
 
-	send_serial_byte((~block_number)); /* 反転したブロック番号の送信 */
+	data = p;
+	/* ログバッファの内容を格納 */
+	for (i = 0; i < data_len; i++) {
+		*p++ = *logbuf++;
+	}
+	/* ブロックサイズに満たない分をEOFで埋める */
+	for (; i < block_size; i++) {
+		*p++ = JIS_X_0211_SUB;
+	}
 
-	check_sum = 0;
-	/* 128バイト分のデータを送信 */
-	for (i = 0; i < XMODEM_BLOCK_SIZE; i++) {
-		/* 送信dataが128バイトに満たない場合 */
-		if (data_len <= i) {
-			send_serial_byte(JIS_X_0211_SUB); /* 足りない分をEOFで埋める */
-			check_sum += JIS_X_0211_SUB; /* EOF分のチェックサムの計算 */
-		}
-		/* 送信dataが128バイトに満たす場合 */
-		else {
-			send_serial_byte(*logbuf); /* ログバッファの内容を1バイトずつ送信 */
-			check_sum += *logbuf; /* チェックサムの計算 */
-			logbuf++;
+	/* CRC-16(上位，下位の順) */
+	if (crc) {
+		crc16 = crc16_update(data, block_size, 0);
+		*p++ = (UINT8)(crc16 >> 8);
+		*p++ = (UINT8)crc16;
+	}
+	/* チェックサム */
+	else {
+		check_sum = 0;
+		for (i = 0; i < block_size; i++) {
+			check_sum += data[i];
 		}
+		*p++ = check_sum;
 	}
 
-	send_serial_byte(check_sum); /* チェックサムの送信 */
-
+	serial_send_dma(sg_xmodem_block, p - sg_xmodem_block); /* 送信完了まで起床待ち(エラー時は受信側がNAKを返す) */
 }
 
 
 /*!
- * XMODEMでの送信制御
+ * XMODEMでのブロック送信制御
  * *bufp : 送信するログバッファポインタの先頭
  * size : 送信するログサイズ
+ * block_size : ブロックサイズ(XMODEM_BLOCK_SIZEまたはXMODEM_1K_BLOCK_SIZE)
  * (返却値)TRUE : 成功
  * (返却値)FALSE : 失敗
+ * -受信側がNAKで開始した場合(チェックサムモード)は，1Kブロックを受け付けないので128byteブロックとする
+ * -1Kブロックでも，残りが128byte以下のブロックは128byteブロックで送る(EOFの埋め草を減らす)
+ * -受信側からCANを受けた場合は，CANを2つ返して直ちに失敗とする(再送しない)
  */
-BOOL send_xmodem(UINT8 *bufp, UINT32 size)
+static BOOL send_xmodem_blocks(UINT8 *bufp, UINT32 size, int block_size)
 {
-	/*
-	 * 送信データの終端のため,1つ余分にとる(サイズが128の倍数の場合)
-	 */
-	int cont = size / XMODEM_BLOCK_SIZE + 2; /* 送信するブロック数 */
-	int data = size;
+	UINT32 data = size;
 	int data_len; /* ブロック内のデータ長 */
-	UINT8 recv_crd, block_number = 1; /* ブロック番号は1からスタート */
+	int cur_size; /* 送信するブロックのサイズ */
+	BOOL crc, tail = FALSE;
+	int recv_crd;
+	UINT8 block_number = 1; /* ブロック番号は1からスタート */
 
-	wait_xmodem(); /* 受信側のNAK待ち */	
+	recv_crd = wait_xmodem(); /* 受信側のNAKまたは'C'待ち */
+	/* 中断 */
+	if (recv_crd == JIS_X_0211_CAN) {
+		return FALSE;
+	}
+	/* チェックサムモード */
+	else if (recv_crd == JIS_X_0211_NAK) {
+		block_size = XMODEM_BLOCK_SIZE;
+		crc = FALSE;
+	}
+	else {
+		crc = TRUE;
+	}
 
-	while (1) {
+	/*
+	 * 送信データの終端のため,1つ余分にとる(サイズがブロックサイズの倍数の場合)
+	 */
+	while (!tail) {
 		/* 送信データ量の処理 */
-		if (128 < data) {
-			data -= 128;
-			data_len = 128;
-		}
-		else {
-			data_len = data;
-		}
-		send_serial_byte(JIS_X_0211_SOH); /* データ送信開始の合図 */
-		write_xmodem_block(block_number, bufp, data_len); /* ブロック送信 */
-		recv_crd = recv_serial_byte(); /* 受信側から制御コードを受信 */
+		cur_size = (data <= XMODEM_BLOCK_SIZE) ? XMODEM_BLOCK_SIZE : block_size;
+		data_len = (cur_size < data) ? cur_size : (int)data;
+		write_xmodem_block(block_number, bufp, data_len, cur_size, crc); /* ブロック送信 */
+		recv_crd = recv_xmodem_timed(XMODEM_BLOCK_WAIT); /* 受信側から制御コードを受信 */
 
 		/* 引き続き送信する */
 		if (recv_crd == JIS_X_0211_ACK) {
 			block_number++; /* 次のブロックへ */
-			bufp += XMODEM_BLOCK_SIZE; /* ログバッファポインタを更新 */
+			bufp += data_len; /* ログバッファポインタを更新 */
+			data -= data_len;
+			tail = (data_len < cur_size); /* EOFで埋めたブロックを送信した */
 		}
 		/* 同じブロックの再送 */
 		else if (recv_crd == JIS_X_0211_NAK) {
 			/* 処理なし(ブロック再送となる) */
 		}
-		/* 中断(コンソールでCtrl-cが入力された場合) */
+		/* 中断(受信側でCtrl-cが入力された場合) */
 		else if (recv_crd == JIS_X_0211_CAN) {
 			send_serial_byte(JIS_X_0211_CAN); /* データ送信中断の合図 */
+			send_serial_byte(JIS_X_0211_CAN);
+			return FALSE;
 		}
-		/* ACKとNAK以外はエラーとする */
+		/* ACKとNAK以外(タイムアウトを含む)はエラーとする */
 		else {
 			return FALSE;
 		}
+	}
+
+	/* 送信終了 */
+	send_serial_byte(JIS_X_0211_EOT); /* データ送信終了(ブロックの終了)の合図 */
+	recv_crd = recv_xmodem_timed(XMODEM_BLOCK_WAIT); /* 受信側から制御コードを受信 */
+	/* 受信側が正常ならば,ACKを受信 */
+	if (JIS_X_0211_ACK == recv_crd) {
+		putxval((--block_number), 0);
+		DEBUG_LEVEL1_OUTMSG(" out block number value : send_xmodem().\n");
+		return TRUE;
+	}
+	/* ACK以外をエラーとする */
+	else {
+		return FALSE;
+	}
+}
+
+
+/*!
+ * YMODEMのブロック0(ファイル名とサイズ)の送信
+ * *name : ファイル名(NULLの場合はバッチ終了の空ブロック)
+ * size : ファイルサイズ
+ * -ファイル名，NUL，10進数のサイズ，NULの順に格納し，残りはNULで埋める(受信側はサイズで領域を確保できる)
+ */
+static void write_ymodem_header(const char *name, UINT32 size)
+{
+	UINT8 header[XMODEM_BLOCK_SIZE];
+	char digits[10];
+	int i = 0, n = 0;
+
+	memset(header, 0, sizeof(header));
+
+	if (name != NULL) {
+		/* ファイル名(サイズの格納分は残す) */
+		while (*name != '\0' && i < XMODEM_BLOCK_SIZE - (int)sizeof(digits) - 2) {
+			header[i++] = *name++;
+		}
+		i++; /* NUL */
+		/* サイズを10進数へ変換(下位の桁から) */
+		do {
+			digits[n++] = '0' + size % 10;
+			size /= 10;
+		} while (size != 0);
+		while (n > 0) {
+			header[i++] = digits[--n];
+		}
+	}
+	else {
+		/* 処理なし(すべてNUL) */
+	}
+
+	write_xmodem_block(0, header, XMODEM_BLOCK_SIZE, XMODEM_BLOCK_SIZE, TRUE);
+}
+
 
+/*!
+ * YMODEM-Gでのブロック送信制御
+ * *name : 受信側へ通知するファイル名
+ * *bufp : 送信するログバッファポインタの先頭
+ * size : 送信するログサイズ
+ * (返却値)TRUE : 成功
+ * (返却値)FALSE : 失敗(受信側がYMODEM-Gでない，またはCANで中断)
+ * -受信側の'G'でブロック0を送り，再度の'G'で1Kブロックを応答なしで続けて送る
+ * -ブロックの間では受信済みの文字を検査し，CANがあれば中断する(受信側は誤りを検出したらCANを送る)
+ * -最初のEOTにNAKが返された場合は，EOTを1度だけ再送してACKを待つ
+ * -EOTのACK後，'G'でバッチ終了の空ブロック0を送る(空ブロックへの応答は待たない)
+ */
+static BOOL send_ymodem_g_blocks(const char *name, UINT8 *bufp, UINT32 size)
+{
+	UINT32 data = size;
+	int data_len; /* ブロック内のデータ長 */
+	int cur_size; /* 送信するブロックのサイズ */
+	int recv_crd;
+	UINT8 block_number = 1; /* ブロック番号は1からスタート */
+
+	/* 受信側がYMODEM-Gでない */
+	if (wait_xmodem() != YMODEM_G_REQUEST) {
+		send_serial_byte(JIS_X_0211_CAN); /* データ送信中断の合図 */
+		send_serial_byte(JIS_X_0211_CAN);
+		return FALSE;
+	}
+
+	write_ymodem_header(name, size); /* ブロック0送信 */
+	/* 受信側はブロック0を受け付けると再度'G'を送る */
+	if (wait_xmodem() != YMODEM_G_REQUEST) {
+		return FALSE;
+	}
+
+	while (data != 0) {
+		/* 中断 */
+		if (check_xmodem_cancel()) {
+			send_serial_byte(JIS_X_0211_CAN); /* データ送信中断の合図 */
+			send_serial_byte(JIS_X_0211_CAN);
+			return FALSE;
+		}
+		cur_size = (data <= XMODEM_BLOCK_SIZE) ? XMODEM_BLOCK_SIZE : XMODEM_1K_BLOCK_SIZE;
+		data_len = (cur_size < data) ? cur_size : (int)data;
+		write_xmodem_block(block_number, bufp, data_len, cur_size, TRUE); /* ブロック送信(応答は待たない) */
+		block_number++;
+		bufp += data_len;
+		data -= data_len;
+	}
+
+	/* 最後のブロックまでに中断された(EOTの応答と取り違えないよう読み残しを捨てる) */
+	if (check_xmodem_cancel()) {
+		return FALSE;
+	}
+
+	/* 送信終了 */
+	send_serial_byte(JIS_X_0211_EOT); /* データ送信終了(ブロックの終了)の合図 */
+	recv_crd = recv_xmodem_timed(XMODEM_BLOCK_WAIT);
+	/* 受信側は最初のEOTにNAKを返す事がある(EOTの取り違えを防ぐため．再度のEOTにACKを返す) */
+	if (recv_crd == JIS_X_0211_NAK) {
+		send_serial_byte(JIS_X_0211_EOT);
+		recv_crd = recv_xmodem_timed(XMODEM_BLOCK_WAIT);
+	}
+	else {
+		/* 処理なし */
+	}
+	/* 受信側が正常ならば,ACKを受信 */
+	if (recv_crd != JIS_X_0211_ACK) {
+		return FALSE;
+	}
+
+	/* バッチ終了 */
+	if (wait_xmodem() != YMODEM_G_REQUEST) {
+		return FALSE;
+	}
+	write_ymodem_header(NULL, 0);
+
+	DEBUG_LEVEL1_OUTVLE((UINT8)(block_number - 1), 0);
+	DEBUG_LEVEL1_OUTMSG(" out block number value : send_ymodem_g().\n");
+
+	return TRUE;
+}
+
+
+/*!
+ * XMODEMでの送信制御
+ * *bufp : 送信するログバッファポインタの先頭
+ * size : 送信するログサイズ
+ * block_size : ブロックサイズ(XMODEM_BLOCK_SIZEまたはXMODEM_1K_BLOCK_SIZE，受信側がCRCモードの場合のみ1K)
+ * (返却値)TRUE : 成功
+ * (返却値)FALSE : 失敗
+ * -転送中は受信側の制御コードを行組み立てさせないよう，生データ受信へ切り替える
+ */
+BOOL send_xmodem(UINT8 *bufp, UINT32 size, int block_size)
+{
+	BOOL ret;
+
+	if (block_size != XMODEM_BLOCK_SIZE && block_size != XMODEM_1K_BLOCK_SIZE) {
+		return FALSE;
+	}
+
+	serial_recv_raw(TRUE);
+	ret = send_xmodem_blocks(bufp, size, block_size);
+	serial_recv_raw(FALSE);
+
+	return ret;
+}
+
+
+/*!
+ * YMODEM-Gでの送信制御
+ * *name : 受信側へ通知するファイル名
+ * *bufp : 送信するログバッファポインタの先頭
+ * size : 送信するログサイズ
+ * (返却値)TRUE : 成功
+ * (返却値)FALSE : 失敗
+ * -誤りのないリンク(USBシリアル等)向けで，誤りの回復は行わない(受信側が中断する)
+ */
+BOOL send_ymodem_g(const char *name, UINT8 *bufp, UINT32 size)
+{
+	BOOL ret;
+
+	serial_recv_raw(TRUE);
+	ret = send_ymodem_g_blocks(name, bufp, size);
+	serial_recv_raw(FALSE);
+
+	return ret;
+}
+
+
+/*!
+ * 送信側から指定数の文字を受信する
+ * *p : 受信した文字を格納する領域
+ * len : 受信する数
+ * (返却値)TRUE : 受信した
+ * (返却値)FALSE : XMODEM_BLOCK_WAIT(msec)の間に1文字も届かなかった(ブロックの途中で止まった)
+ * -生データ受信の起床待ち(タイムアウトあり)で，受信リングバッファの半分ずつまとめて読み出す
+ */
+static BOOL recv_xmodem_bytes(UINT8 *p, int len)
+{
+	int n;
+
+	while (len > 0) {
+		if ((n = recv_serial_timed((char *)p, len, XMODEM_BLOCK_WAIT)) <= 0) {
+			return FALSE;
+		}
+		p += n;
+		len -= n;
+	}
+
+	return TRUE;
+}
+
+
+/*!
+ * 受信の中断(CANを送る)
+ */
+static void cancel_xmodem(void)
+{
+	send_serial_byte(JIS_X_0211_CAN); /* データ受信中断の合図 */
+	send_serial_byte(JIS_X_0211_CAN);
+}
+
+
+/*!
+ * XMODEMでのブロック受信制御
+ * *bufp : 受信したデータを格納する領域
+ * size : 格納する領域のサイズ
+ * *p_len : 受信したデータ長(最後のブロックのEOFの埋め草を含む)を格納する領域
+ * (返却値)E_OK : 正常終了
+ * (返却値)E_TMOUT : 送信側が開始しない，またはブロックの途中で止まった
+ * (返却値)E_NOMEM : 格納する領域が足りない
+ * (返却値)E_OBJ : 送信側の中断，ブロック番号の不整合または誤りが多すぎる
+ * -'C'を送って送信側の開始を待ち，SOH(128byte)またはSTX(1K)のブロックをCRC-16で検査する
+ * -誤りのあるブロックはNAK，直前のブロックの再送はACKのみ返して読み捨てる
+ */
+static ER recv_xmodem_blocks(UINT8 *bufp, UINT32 size, UINT32 *p_len)
+{
+	int c = -1, retry, block_size, errors = 0;
+	UINT8 *data, expect = 1; /* ブロック番号は1からスタート */
+	UINT16 crc16;
+	UINT32 len = 0;
+
+	/* 送信側が開始するまで'C'を送る */
+	for (retry = 0; retry < XMODEM_START_RETRY && c < 0; retry++) {
+		send_serial_byte(XMODEM_CRC_REQUEST);
+		c = recv_xmodem_timed(XMODEM_START_WAIT);
+	}
+
+	while (1) {
+		/* タイムアウト */
+		if (c < 0) {
+			cancel_xmodem();
+			return E_TMOUT;
+		}
 		/* 送信終了 */
-		if (block_number == (UINT8)cont) {
-			send_serial_byte(JIS_X_0211_EOT); /* データ送信終了(ブロックの終了)の合図 */
-			recv_crd = recv_serial_byte(); /* 受信側から制御コードを受信 */
-			/* 受信側が正常ならば,ACKを受信 */
-			if (JIS_X_0211_ACK == recv_crd) {
-				putxval((--block_number), 0);
-				DEBUG_LEVEL1_OUTMSG(" out block number value : send_xmodem().\n");
-				return TRUE;
-			}
-			/* ACK以外をエラーとする */
-			else {
-				return FALSE;
+		else if (c == JIS_X_0211_EOT) {
+			send_serial_byte(JIS_X_0211_ACK);
+			*p_len = len;
+			return E_OK;
+		}
+		/* 中断 */
+		else if (c == JIS_X_0211_CAN) {
+			return E_OBJ;
+		}
+		else if (c == JIS_X_0211_SOH) {
+			block_size = XMODEM_BLOCK_SIZE;
+		}
+		else if (c == JIS_X_0211_STX) {
+			block_size = XMODEM_1K_BLOCK_SIZE;
+		}
+		/* ブロックの先頭以外は読み捨てる */
+		else {
+			c = recv_xmodem_timed(XMODEM_BLOCK_WAIT);
+			continue;
+		}
+
+		/* ブロック番号，反転したブロック番号，データ，CRC-16(ブロックの途中で止まった) */
+		if (!recv_xmodem_bytes(sg_xmodem_block, block_size + XMODEM_BLOCK_OVERHEAD - 1)) {
+			cancel_xmodem();
+			return E_TMOUT;
+		}
+		data = &sg_xmodem_block[2];
+		crc16 = (data[block_size] << 8) | data[block_size + 1];
+
+		/* ブロックの誤り */
+		if ((UINT8)(sg_xmodem_block[0] + sg_xmodem_block[1]) != 0xff || crc16_update(data, block_size, 0) != crc16) {
+			if (++errors >= XMODEM_ERROR_MAX) {
+				cancel_xmodem();
+				return E_OBJ;
 			}
+			send_serial_byte(JIS_X_0211_NAK); /* 同じブロックの再送要求 */
+		}
+		/* 直前のブロックの再送(ACKが届かなかった) */
+		else if (sg_xmodem_block[0] == (UINT8)(expect - 1)) {
+			send_serial_byte(JIS_X_0211_ACK);
+		}
+		/* ブロック番号の不整合 */
+		else if (sg_xmodem_block[0] != expect) {
+			cancel_xmodem();
+			return E_OBJ;
+		}
+		/* 格納する領域が足りない */
+		else if (size - len < (UINT32)block_size) {
+			cancel_xmodem();
+			return E_NOMEM;
+		}
+		else {
+			memcpy(bufp + len, data, block_size);
+			len += block_size;
+			expect++;
+			errors = 0;
+			send_serial_byte(JIS_X_0211_ACK);
 		}
+
+		c = recv_xmodem_timed(XMODEM_BLOCK_WAIT);
 	}
+}
+
+
+/*!
+ * XMODEMでの受信制御
+ * *bufp : 受信したデータを格納する領域
+ * size : 格納する領域のサイズ
+ * *p_len : 受信したデータ長(最後のブロックのEOFの埋め草を含む)を格納する領域
+ * (返却値)E_OK : 正常終了
+ * (返却値)E_PAR : パラメータ不正
+ * (返却値)上記以外 : recv_xmodem_blocks()のエラーコード
+ * -転送中は送信側のデータを行組み立てさせないよう，生データ受信へ切り替える
+ * -タスクコンテキストから呼ぶ(受信リングバッファの起床待ちを使用する)
+ */
+ER recv_xmodem(UINT8 *bufp, UINT32 size, UINT32 *p_len)
+{
+	ER ercd;
+
+	if (bufp == NULL || p_len == NULL) {
+		return E_PAR;
+	}
+
+	serial_recv_raw(TRUE);
+	ercd = recv_xmodem_blocks(bufp, size, p_len);
+	serial_recv_raw(FALSE);
 
-	return FALSE;
+	return ercd;
 }
@@ -1,6 +1,6 @@
 /*!
  * @file ターゲット非依存部
- * @brief xmodem転送プロトコル(送信)インターフェース
+ * @brief xmodem転送プロトコル(送受信)インターフェース
  * @attention gcc4.5.x以外は試していない
  */
 
@@ -13,8 +13,18 @@
 #include "kernel/defines.h"
 
 
+#define XMODEM_BLOCK_SIZE			128				/*! XMODEMのブロックサイズ */
+#define XMODEM_1K_BLOCK_SIZE	1024			/*! XMODEM-1Kのブロックサイズ */
+
+
 /*! XMODEMでの送信制御 */
-extern BOOL send_xmodem(UINT8 *bufp, UINT32 size);
+extern BOOL send_xmodem(UINT8 *bufp, UINT32 size, int block_size);
+
+/*! YMODEM-Gでの送信制御 */
+extern BOOL send_ymodem_g(const char *name, UINT8 *bufp, UINT32 size);
+
+/*! XMODEMでの受信制御 */
+extern ER recv_xmodem(UINT8 *bufp, UINT32 size, UINT32 *p_len);
 
 
 #endif
@@ -2,4 +2,4 @@
 #target/driver/build.mk
 
 # driver
-C_SOURCES += serial_driver.c timer_driver.c
+C_SOURCES += serial_driver.c timer_driver.c dma_driver.c
@@ -0,0 +1,419 @@
+/*!
+ * @file ターゲット依存部<モジュール:dma_driver.o>
+ * @brief システムDMA(sDMA)ドライバ
+ * @attention gcc4.5.x以外は試していない,
+ *            レジスタパックに構造体は使用しない(バイエンディアンCPUへの移植性低下のため)
+ * @note ・DM3730CPUマニュアル参照
+ * 			 ・論理チャネルnはハードウェアのチャネルnを使用し，完了割込みはすべてSDMA_IRQ_0(L0)へ通知する
+ * 			 ・MMU(Dキャッシュ)を有効化していない前提なので，転送開始前はメモリバリアのみ行う
+ * 			 ・DMA_HOST_MOCK定義時はレジスタアクセスを模擬レジスタへ置き換え，ホスト上で
+ * 				 チャネルの状態遷移を検証できるようにする(割込み禁止とバリアは行わない)
+ */
+
+
+/* os/target/driver */
+#include "dma_driver.h"
+#ifndef DMA_HOST_MOCK
+/* os/kernel */
+#include "kernel/intr_manage.h"
+/* os/arch/cpu */
+#include "arch/cpu/intr_cntrl.h"
+#endif
+
+
+#define SDMA_BASE_ADR						0x48056000 								/*! sDMA(DMA4)のマップアドレス */
+
+
+/* sDMAの各レジスタ定義(ベースアドレスからのオフセット) */
+#define DMA4_IRQSTATUS_L(j)			(0x08 + 0x04 * (j)) 			/*! 割込みステータス(書き込み1でクリア) */
+#define DMA4_IRQENABLE_L(j)			(0x18 + 0x04 * (j)) 			/*! 割込み有効化 */
+#define DMA4_CCR(i)							(0x80 + 0x60 * (i)) 			/*! チャネル制御 */
+#define DMA4_CLNK_CTRL(i)				(0x84 + 0x60 * (i)) 			/*! チャネルリンク制御 */
+#define DMA4_CICR(i)						(0x88 + 0x60 * (i)) 			/*! チャネル割込み有効化 */
+#define DMA4_CSR(i)							(0x8C + 0x60 * (i)) 			/*! チャネルステータス(書き込み1でクリア) */
+#define DMA4_CSDP(i)						(0x90 + 0x60 * (i)) 			/*! チャネル転送パラメータ */
+#define DMA4_CEN(i)							(0x94 + 0x60 * (i)) 			/*! フレーム内のエレメント数 */
+#define DMA4_CFN(i)							(0x98 + 0x60 * (i)) 			/*! ブロック内のフレーム数 */
+#define DMA4_CSSA(i)						(0x9C + 0x60 * (i)) 			/*! 転送元開始アドレス */
+#define DMA4_CDSA(i)						(0xA0 + 0x60 * (i)) 			/*! 転送先開始アドレス */
+
+/* CCRのビット定義 */
+#define DMA4_CCR_SYNC_LO(req)		((req) & 0x1F) 								/*! SYNCHRO_CONTROL[4:0] */
+#define DMA4_CCR_SYNC_HI(req)		(((req) >> 5) << 19) 					/*! SYNCHRO_CONTROL_UPPER[20:19] */
+#define DMA4_CCR_ENABLE					(1 << 7) 											/*! チャネル有効化 */
+#define DMA4_CCR_SRC_POST_INC		(1 << 12) 										/*! 転送元アドレスをポストインクリメント */
+#define DMA4_CCR_DST_CONSTANT		(0 << 14) 										/*! 転送先アドレスを固定 */
+
+/* CICR,CSRのビット定義 */
+#define DMA4_CSR_DROP						(1 << 1) 											/*! 同期要求の取りこぼし */
+#define DMA4_CSR_BLOCK					(1 << 5) 											/*! ブロック転送完了 */
+#define DMA4_CSR_TRANS_ERR			(1 << 8) 											/*! 転送エラー */
+#define DMA4_CSR_SECURE_ERR			(1 << 9) 											/*! セキュアエラー */
+#define DMA4_CSR_SUPERVISOR_ERR	(1 << 10) 										/*! スーパーバイザエラー */
+#define DMA4_CSR_MISALIGNED_ERR	(1 << 11) 										/*! アドレス境界エラー */
+#define DMA4_CSR_ERR_MASK				(DMA4_CSR_DROP | DMA4_CSR_TRANS_ERR | DMA4_CSR_SECURE_ERR | \
+																 DMA4_CSR_SUPERVISOR_ERR | DMA4_CSR_MISALIGNED_ERR)
+#define DMA4_CSR_ALL						0x1FFE 												/*! CSRの全ステータスビット */
+
+
+#ifdef DMA_HOST_MOCK
+
+/*! 模擬レジスタへの書き込み(IRQSTATUS,CSRは書き込み1でクリアを模擬する) */
+static void dma_mock_write(UINT32 offset, UINT32 dat);
+
+#define DMA_REG_READ(offset)				g_dma_mock_regs[(offset) >> 2]
+#define DMA_REG_WRITE(offset, dat)	dma_mock_write((offset), (dat))
+#define DMA_LOCK(cpsr)							((cpsr) = 0)
+#define DMA_UNLOCK(cpsr)						((void)(cpsr))
+#define DMA_BARRIER()
+
+#else
+
+#define DMA_REG_READ(offset)				REG32_READ(SDMA_BASE_ADR + (offset))
+#define DMA_REG_WRITE(offset, dat)	REG32_WRITE(SDMA_BASE_ADR + (offset), (dat))
+#define DMA_LOCK(cpsr)							((cpsr) = save_disable_irq())
+#define DMA_UNLOCK(cpsr)						restore_irq(cpsr)
+#define DMA_BARRIER()								asm volatile ("mcr p15, 0, %0, c7, c10, 4" : : "r"(0) : "memory") /* DSB */
+
+#endif
+
+
+/*!
+ * @brief チャネル管理情報
+ */
+typedef struct {
+	volatile DMA_CH_STATE state;					/*! チャネルの状態 */
+	DMA_DONE done;												/*! 転送完了通知関数 */
+	int arg;															/*! 転送完了通知関数の引数 */
+} DMA_CHANNEL;
+
+
+/*! チャネルのハードウェアを停止してステータスをクリアする */
+static void dma_channel_reset(int ch);
+
+
+/*! チャネル管理情報 */
+static DMA_CHANNEL sg_dma_channels[DMA_CHANNEL_NUM];
+
+#ifdef DMA_HOST_MOCK
+/*! 模擬レジスタ */
+UINT32 g_dma_mock_regs[DMA_MOCK_REG_SIZE / 4];
+#endif
+
+
+/*!
+ * @brief チャネルのハードウェアを停止してステータスをクリアする
+ * @param[in] ch:チャネル番号
+ * 	@arg 0~DMA_CHANNEL_NUM-1
+ * @param[out] なし
+ * @return なし
+ */
+static void dma_channel_reset(int ch)
+{
+	DMA_REG_WRITE(DMA4_CCR(ch), 0);
+	DMA_REG_WRITE(DMA4_CICR(ch), 0);
+	DMA_REG_WRITE(DMA4_CLNK_CTRL(ch), 0);
+	DMA_REG_WRITE(DMA4_CSR(ch), DMA4_CSR_ALL);
+	DMA_REG_WRITE(DMA4_IRQSTATUS_L(0), 1 << ch);
+}
+
+
+/*!
+ * @brief sDMAドライバの初期化
+ * @param[in] なし
+ * @param[out] なし
+ * @return なし
+ * @note ・initタスクから，完了割込みのMIRを有効化する前に呼ぶ
+ * 			 ・完了割込みはベクタ割込みハンドラとして登録する
+ */
+void dma_init(void)
+{
+	int ch;
+	unsigned long cpsr;
+
+	DMA_LOCK(cpsr);
+	for (ch = 0; ch < DMA_CHANNEL_NUM; ch++) {
+		dma_channel_reset(ch);
+		sg_dma_channels[ch].state = DMA_CH_FREE;
+		sg_dma_channels[ch].done = NULL;
+		sg_dma_channels[ch].arg = 0;
+	}
+	DMA_REG_WRITE(DMA4_IRQENABLE_L(0), 0);
+	DMA_UNLOCK(cpsr);
+
+#ifndef DMA_HOST_MOCK
+	def_vec_isr(DMA_INTR_LINE, dma_intr);
+#endif
+}
+
+
+/*!
+ * @brief チャネルの割り当て
+ * @param[in] なし
+ * @param[out] なし
+ * @return チャネル番号またはエラーコード
+ *	@retval E_NOID:割り当て可能なチャネルがない,0以上:チャネル番号
+ */
+ER dma_alloc_channel(void)
+{
+	int ch;
+	unsigned long cpsr;
+
+	DMA_LOCK(cpsr);
+	for (ch = 0; ch < DMA_CHANNEL_NUM; ch++) {
+		if (sg_dma_channels[ch].state == DMA_CH_FREE) {
+			sg_dma_channels[ch].state = DMA_CH_IDLE;
+			DMA_UNLOCK(cpsr);
+			return ch;
+		}
+	}
+	DMA_UNLOCK(cpsr);
+
+	return E_NOID;
+}
+
+
+/*!
+ * @brief チャネルの解放
+ * @param[in] ch:チャネル番号
+ * 	@arg 0~DMA_CHANNEL_NUM-1
+ * @return エラーコード
+ *	@retval E_ID:チャネル番号不正,E_OBJ:未割り当てまたは転送中,E_OK:正常終了
+ */
+ER dma_free_channel(int ch)
+{
+	unsigned long cpsr;
+
+	if (ch < 0 || DMA_CHANNEL_NUM <= ch) {
+		return E_ID;
+	}
+
+	DMA_LOCK(cpsr);
+	/* 未割り当てまたは転送中 */
+	if (sg_dma_channels[ch].state == DMA_CH_FREE || sg_dma_channels[ch].state == DMA_CH_BUSY) {
+		DMA_UNLOCK(cpsr);
+		return E_OBJ;
+	}
+	dma_channel_reset(ch);
+	sg_dma_channels[ch].state = DMA_CH_FREE;
+	sg_dma_channels[ch].done = NULL;
+	DMA_UNLOCK(cpsr);
+
+	return E_OK;
+}
+
+
+/*!
+ * @brief メモリからデバイス(固定アドレス)へのバイト転送開始
+ * @param[in] ch:チャネル番号
+ * 	@arg 0~DMA_CHANNEL_NUM-1
+ * @param[in] *src:転送元の先頭アドレス
+ * 	@arg NULL以外
+ * @param[in] dev_adr:転送先のデバイスレジスタアドレス
+ * 	@arg 特になし
+ * @param[in] len:転送バイト数
+ * 	@arg 1~DMA_ELEMENT_MAX
+ * @param[in] req:DMA要求(CCRのSYNCHRO_CONTROL値，0は非同期)
+ * 	@arg 0~127
+ * @param[in] done:転送完了通知関数
+ * 	@arg NULLの場合は通知しない
+ * @param[in] arg:転送完了通知関数の引数
+ * 	@arg 特になし
+ * @return エラーコード
+ *	@retval E_ID:チャネル番号不正,E_PAR:パラメータ不正,E_OBJ:未割り当てまたは転送中,E_OK:転送開始
+ * @note ・エレメント同期(DMA要求1回で1byte)で転送し，ブロック転送完了で完了割込みを発生させる
+ * 			 ・転送元の内容は完了通知まで書き換えない事
+ */
+ER dma_start_mem_to_dev(int ch, const void *src, UINT32 dev_adr, UINT32 len, int req, DMA_DONE done, int arg)
+{
+	unsigned long cpsr;
+
+	if (ch < 0 || DMA_CHANNEL_NUM <= ch) {
+		return E_ID;
+	}
+	else if (src == NULL || len == 0 || DMA_ELEMENT_MAX < len || req < 0 || 127 < req) {
+		return E_PAR;
+	}
+	else {
+		/* 処理なし */
+	}
+
+	DMA_LOCK(cpsr);
+	/* 未割り当てまたは転送中 */
+	if (sg_dma_channels[ch].state == DMA_CH_FREE || sg_dma_channels[ch].state == DMA_CH_BUSY) {
+		DMA_UNLOCK(cpsr);
+		return E_OBJ;
+	}
+	sg_dma_channels[ch].done = done;
+	sg_dma_channels[ch].arg = arg;
+	sg_dma_channels[ch].state = DMA_CH_BUSY;
+
+	dma_channel_reset(ch);
+	DMA_REG_WRITE(DMA4_CSDP(ch), 0); /* 8bit転送，バースト及びパックなし */
+	DMA_REG_WRITE(DMA4_CEN(ch), len);
+	DMA_REG_WRITE(DMA4_CFN(ch), 1);
+	DMA_REG_WRITE(DMA4_CSSA(ch), (UINT32)(unsigned long)src);
+	DMA_REG_WRITE(DMA4_CDSA(ch), dev_adr);
+	DMA_REG_WRITE(DMA4_CICR(ch), DMA4_CSR_BLOCK | DMA4_CSR_ERR_MASK);
+	DMA_REG_WRITE(DMA4_IRQENABLE_L(0), DMA_REG_READ(DMA4_IRQENABLE_L(0)) | (1 << ch));
+	DMA_BARRIER(); /* 転送元の書き込みを完了させてから開始する */
+	DMA_REG_WRITE(DMA4_CCR(ch), DMA4_CCR_SYNC_LO(req) | DMA4_CCR_SYNC_HI(req) |
+								DMA4_CCR_SRC_POST_INC | DMA4_CCR_DST_CONSTANT | DMA4_CCR_ENABLE);
+	DMA_UNLOCK(cpsr);
+
+	return E_OK;
+}
+
+
+/*!
+ * @brief 転送の中断
+ * @param[in] ch:チャネル番号
+ * 	@arg 0~DMA_CHANNEL_NUM-1
+ * @return エラーコード
+ *	@retval E_ID:チャネル番号不正,E_OBJ:転送中でない,E_OK:正常終了
+ * @note 中断した場合，転送完了通知関数は呼ばれない(状態はIDLEへ戻る)
+ */
+ER dma_stop(int ch)
+{
+	unsigned long cpsr;
+
+	if (ch < 0 || DMA_CHANNEL_NUM <= ch) {
+		return E_ID;
+	}
+
+	DMA_LOCK(cpsr);
+	/* 転送中でない */
+	if (sg_dma_channels[ch].state != DMA_CH_BUSY) {
+		DMA_UNLOCK(cpsr);
+		return E_OBJ;
+	}
+	DMA_REG_WRITE(DMA4_IRQENABLE_L(0), DMA_REG_READ(DMA4_IRQENABLE_L(0)) & ~(1 << ch));
+	dma_channel_reset(ch);
+	sg_dma_channels[ch].state = DMA_CH_IDLE;
+	DMA_UNLOCK(cpsr);
+
+	return E_OK;
+}
+
+
+/*!
+ * @brief チャネルの状態取得
+ * @param[in] ch:チャネル番号
+ * 	@arg 0~DMA_CHANNEL_NUM-1
+ * @return チャネルの状態(チャネル番号不正の場合はDMA_CH_FREE)
+ */
+DMA_CH_STATE dma_get_state(int ch)
+{
+	if (ch < 0 || DMA_CHANNEL_NUM <= ch) {
+		return DMA_CH_FREE;
+	}
+
+	return sg_dma_channels[ch].state;
+}
+
+
+/*!
+ * @brief 完了割込み処理(ベクタ割込みハンドラ)
+ * @param[in] irq:IRQ番号
+ * 	@arg DMA_INTR_LINE
+ * @return スケジューラを呼ぶか(通知先のiwup_tsk()等は自身で要求するのでFALSE)
+ * @note ・完了割込みの割込み線(DMA_INTR_LINE)以外では処理しない
+ * 			 ・割込みステータスの立っているチャネルごとに，CSRからDONEかERRORかを決めて通知する
+ * 			 ・エラーの場合もチャネルは停止しているので，再度dma_start_mem_to_dev()で開始できる
+ */
+BOOL dma_intr(INTRPT_TYPE irq)
+{
+	UINT32 status, csr;
+	int ch;
+	ER ercd;
+	DMA_CHANNEL *chp;
+
+	/* 完了割込みの割込み線以外 */
+	if (irq != DMA_INTR_LINE) {
+		return FALSE;
+	}
+
+	status = DMA_REG_READ(DMA4_IRQSTATUS_L(0)) & DMA_REG_READ(DMA4_IRQENABLE_L(0));
+
+	for (ch = 0; ch < DMA_CHANNEL_NUM; ch++) {
+		if (!(status & (1 << ch))) {
+			continue;
+		}
+		chp = &sg_dma_channels[ch];
+		csr = DMA_REG_READ(DMA4_CSR(ch));
+		DMA_REG_WRITE(DMA4_IRQENABLE_L(0), DMA_REG_READ(DMA4_IRQENABLE_L(0)) & ~(1 << ch));
+		dma_channel_reset(ch);
+
+		/* 中断済み等で転送中でない(割込みステータスのクリアのみ) */
+		if (chp->state != DMA_CH_BUSY) {
+			continue;
+		}
+		/* 転送エラー */
+		else if (csr & DMA4_CSR_ERR_MASK) {
+			chp->state = DMA_CH_ERROR;
+			ercd = E_OBJ;
+		}
+		else {
+			chp->state = DMA_CH_DONE;
+			ercd = E_OK;
+		}
+
+		if (chp->done != NULL) {
+			(*chp->done)(ch, ercd, chp->arg);
+		}
+		else {
+			/* 処理なし */
+		}
+	}
+
+	return FALSE;
+}
+
+
+#ifdef DMA_HOST_MOCK
+
+/*!
+ * @brief 模擬レジスタへの書き込み
+ * @param[in] offset:レジスタのオフセット
+ * 	@arg DMA_MOCK_REG_SIZE未満
+ * @param[in] dat:書き込む値
+ * 	@arg 特になし
+ * @return なし
+ * @note IRQSTATUS_L0及びCSRは，実機と同じく書き込み1のビットをクリアする
+ */
+static void dma_mock_write(UINT32 offset, UINT32 dat)
+{
+	/* 書き込み1でクリアするレジスタ */
+	if (offset == DMA4_IRQSTATUS_L(0) ||
+			(DMA4_CSR(0) <= offset && (offset - DMA4_CSR(0)) % 0x60 == 0)) {
+		g_dma_mock_regs[offset >> 2] &= ~dat;
+	}
+	else {
+		g_dma_mock_regs[offset >> 2] = dat;
+	}
+}
+
+
+/*!
+ * @brief ハードウェアによる転送終了を模擬する
+ * @param[in] ch:チャネル番号
+ * 	@arg 0~DMA_CHANNEL_NUM-1
+ * @param[in] csr:転送終了時のCSR(DMA4_CSR_BLOCKで正常完了，エラービットで転送エラー)
+ * 	@arg 特になし
+ * @return なし
+ * @note CCRのENABLEを落とし，CICRで有効なステータスであれば割込みステータスを立てて完了割込み処理を呼ぶ
+ */
+void dma_mock_finish(int ch, UINT32 csr)
+{
+	g_dma_mock_regs[DMA4_CCR(ch) >> 2] &= ~DMA4_CCR_ENABLE;
+	g_dma_mock_regs[DMA4_CSR(ch) >> 2] |= csr;
+	if (g_dma_mock_regs[DMA4_CICR(ch) >> 2] & csr) {
+		g_dma_mock_regs[DMA4_IRQSTATUS_L(0) >> 2] |= 1 << ch;
+		dma_intr(DMA_INTR_LINE);
+	}
+	else {
+		/* 処理なし */
+	}
+}
+
+#endif
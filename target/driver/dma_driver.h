@@ -0,0 +1,77 @@
+/*!
+ * @file ターゲット依存部
+ * @brief システムDMA(sDMA)ドライバインターフェース
+ * @attention gcc4.5.x以外は試していない
+ * @note DM3730CPUマニュアル参照
+ */
+
+
+#ifndef _DMA_DRIVER_H_INCLUDED_
+#define _DMA_DRIVER_H_INCLUDED_
+
+
+/* os/kernel */
+#include "kernel/defines.h"
+
+
+#define DMA_CHANNEL_NUM						8					/*! ドライバで管理する論理チャネル数(ハードウェアは32チャネル) */
+#define DMA_ELEMENT_MAX						0xFFFFFF	/*! 1回の転送で指定できる最大エレメント数(CENは24bit) */
+#define DMA_INTR_LINE							INTERRUPT_TYPE_SDMA_IRQ_0	/*! 完了割込みに使用する割込み線 */
+
+#define UART3_DMA_TX_REQ					53				/*! UART3送信のDMA要求(CCRのSYNCHRO_CONTROL値，S_DMA_52 + 1) */
+
+
+/*!
+ * @brief チャネルの状態
+ * @note FREE → (dma_alloc_channel) → IDLE → (dma_start_mem_to_dev) → BUSY → (完了割込み) → DONE/ERROR
+ * 			 DONE,ERRORからは再びdma_start_mem_to_dev()で開始でき，dma_free_channel()でFREEへ戻る
+ */
+typedef enum {
+	DMA_CH_FREE = 0,											/*! 未割り当て */
+	DMA_CH_IDLE,													/*! 割り当て済み(転送なし) */
+	DMA_CH_BUSY,													/*! 転送中 */
+	DMA_CH_DONE,													/*! 転送完了 */
+	DMA_CH_ERROR,													/*! 転送エラーで停止 */
+} DMA_CH_STATE;
+
+
+/*! 転送完了通知関数(完了割込みのコンテキストで呼ばれる，ercdはE_OKまたはE_OBJ) */
+typedef void (*DMA_DONE)(int ch, ER ercd, int arg);
+
+
+/*! sDMAドライバの初期化 */
+extern void dma_init(void);
+
+/*! チャネルの割り当て */
+extern ER dma_alloc_channel(void);
+
+/*! チャネルの解放 */
+extern ER dma_free_channel(int ch);
+
+/*! メモリからデバイス(固定アドレス)へのバイト転送開始 */
+extern ER dma_start_mem_to_dev(int ch, const void *src, UINT32 dev_adr, UINT32 len, int req, DMA_DONE done, int arg);
+
+/*! 転送の中断 */
+extern ER dma_stop(int ch);
+
+/*! チャネルの状態取得 */
+extern DMA_CH_STATE dma_get_state(int ch);
+
+/*! 完了割込み処理(ベクタ割込みハンドラ) */
+extern BOOL dma_intr(INTRPT_TYPE irq);
+
+
+#ifdef DMA_HOST_MOCK
+
+#define DMA_MOCK_REG_SIZE					0x1000		/*! 模擬レジスタ領域のサイズ */
+
+/*! 模擬レジスタ(sDMAのレジスタ空間をメモリ上に置き換えたもの) */
+extern UINT32 g_dma_mock_regs[DMA_MOCK_REG_SIZE / 4];
+
+/*! ハードウェアによる転送終了を模擬する(CSRを設定して完了割込み処理を呼ぶ) */
+extern void dma_mock_finish(int ch, UINT32 csr);
+
+#endif
+
+
+#endif
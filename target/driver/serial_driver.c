@@ -9,8 +9,13 @@
 
 /* os/target/driver */
 #include "serial_driver.h"
+#include "dma_driver.h"
 /* os/kernel */
 #include "kernel/defines.h"
+#include "kernel/kernel.h"
+/* os/arch/cpu */
+#include "arch/cpu/cpu_cntrl.h"
+#include "arch/cpu/intr_cntrl.h"
 
 
 #define	UARTClock		(48000000 / 1)																				/*! クロック(Hz) */
@@ -25,18 +30,83 @@
 #define	ULCR			(UART3_BASE_ADR + 0x0c)																	/*! データーフォーマット設定 */
 #define	UMCR			(UART3_BASE_ADR + 0x10)
 #define	ULSR			(UART3_BASE_ADR + 0x14)																	/*! 送信FIFOバッファチェック */
+#define	USSR			(UART3_BASE_ADR + 0x44)																	/*! 補助ステータス(送信FIFOバッファ満杯の検査) */
 
 #define UDLL URBR																													/*! レジスタリネーム．ボーレートの設定など */
 #define	UDLM			(UART3_BASE_ADR + 0x04)																	/*! ボーレートの設定など */
 
+#define UART_TX_FIFO_SIZE		64																						/*! 送信FIFOバッファのサイズ */
+#define UART_SSR_TX_FIFO_FULL	0x01																				/*! SSR:送信FIFOバッファが満杯 */
+
+#define UART_FCR_FIFO_EN		0x01																					/*! FCR:送受信FIFOバッファ有効化 */
+#define UART_FCR_DMA_MODE		0x08																					/*! FCR:DMAモード1(送信FIFOに空きがあればDMA要求) */
+
+
+/*!
+ * @brief 送信リングバッファ
+ * @note ・headは書き込み側(タスク，割込みハンドラ)，tailは送信割込みのみが書き換える
+ * 			 ・書き込み側同士及び送信割込みとの排他はIRQ禁止で行う
+ * 			 ・DMA送信中は送信リングバッファへ積むだけとし，送信割込みはDMA完了後に有効化する
+ */
+static struct {
+	volatile UINT32 head;																										/*! 次に書き込む位置 */
+	volatile UINT32 tail;																										/*! 次に送信する位置 */
+	volatile ER_ID waiter;																									/*! 空き待ちのタスクID(-1は待ちなし) */
+	volatile BOOL polled;																										/*! ポーリング送信か(起動直後とdown_system()) */
+	volatile UINT32 wake;																										/*! 空き待ちのタスクを起床させる残りデータ数 */
+	volatile BOOL dma;																											/*! DMA送信中か */
+	volatile ER_ID dma_waiter;																							/*! DMA送信完了待ちのタスクID(-1は待ちなし) */
+	volatile ER dma_ercd;																										/*! DMA送信の結果 */
+	ER dma_ch;																															/*! DMA送信に使用するチャネル(負の場合はDMA送信しない) */
+	volatile ER_ID frame_waiter;																						/*! フレーム送信の空き待ちのタスクID(-1は待ちなし) */
+	volatile UINT32 frame_wake;																							/*! フレーム送信の空き待ちのタスクを起床させる残りデータ数 */
+	unsigned char buf[SERIAL_TX_BUF_SIZE];																	/*! 送信データ */
+} sg_tx = {0, 0, -1, TRUE, SERIAL_TX_BUF_SIZE / 2, FALSE, -1, E_OK, -1, -1, 0};
+
+
+/*!
+ * @brief 受信リングバッファ
+ * @note ・head,lineは受信割込みのみ，tailは読み出し側(タスク)のみが書き換える
+ * 			 ・tail～lineが読み出せる確定済みデータ，line～headは行組み立て中(編集可能)のデータ
+ * 			 ・読み出し側と受信割込みとの排他はIRQ禁止で行う
+ */
+static struct {
+	volatile UINT32 head;																										/*! 次に書き込む位置 */
+	volatile UINT32 tail;																										/*! 次に読み出す位置 */
+	volatile UINT32 line;																										/*! 確定済みデータの終端(行組み立ての先頭) */
+	volatile ER_ID waiter;																									/*! 受信待ちのタスクID(-1は待ちなし) */
+	volatile UINT32 want;																										/*! 受信待ちのタスクを起床させる確定済みデータ数 */
+	volatile BOOL raw;																											/*! 行組み立てを行わないか */
+	volatile BOOL polled;																										/*! ポーリング受信か(起動直後) */
+	UINT32 overruns;																												/*! 受信リングバッファが満杯で捨てた数 */
+	unsigned char buf[SERIAL_RX_BUF_SIZE];																	/*! 受信データ */
+} sg_rx = {0, 0, 0, -1, 1, FALSE, TRUE};
 
 
 /*! 送信可能かチェック */
 static int is_send_serial_enable(void);
 
+/*! 1文字をポーリングで送信 */
+static void send_serial_byte_polled(unsigned char c);
+
+/*! 送信リングバッファが満杯の時に空きを待つ */
+static ER wait_serial_tx_space(unsigned long cpsr);
+
+/*! 送信リングバッファが空になるまで待つ */
+static ER wait_serial_tx_empty(void);
+
+/*! DMA送信完了通知 */
+static void serial_dma_done(int ch, ER ercd, int arg);
+
 /*! 受信可能かチェック */
 static int is_recv_serial_enable(void);
 
+/*! 1文字をポーリングで受信 */
+static unsigned char recv_serial_byte_polled(void);
+
+/*! 受信した1文字を行規則に従って受信リングバッファへ格納 */
+static int serial_rx_store(unsigned char c);
+
 
 /*! デバイス初期化 */
 void uart3_init(void)
@@ -70,10 +140,10 @@ static int is_send_serial_enable(void)
 
 
 /*!
-* 1文字送信
+* 1文字をポーリングで送信
 * c:
 */
-void send_serial_byte(unsigned char c)
+static void send_serial_byte_polled(unsigned char c)
 {
   /* 送信完了まで待機(FIFOバッファを使用しない) */
   while (!is_send_serial_enable()) {
@@ -85,6 +155,391 @@ void send_serial_byte(unsigned char c)
 }
 
 
+/*!
+* 送信リングバッファが満杯の時に空きを待つ(IRQ禁止状態で呼ぶ)
+* cpsr : 呼び出し側がsave_disable_irq()で保存したCPSR
+* (返却値)E_OK : 空きを作った，または空きを待った(呼び出し側で満杯か再検査する)
+* (返却値)E_CTX : DMA送信中に待てない呼び出し元から呼ばれた(空きは作らない)
+* -タスクからの呼び出しで他に空き待ちのタスクがいなければ，送信割込みで起床されるまで起床待ちとなる
+* -割込みハンドラ及びカーネルからの呼び出し(またはslp_tsk()が使えない場合)は，最も古い1文字をポーリングで送信して空きを作る
+* -DMA送信中はTHRへ書き込めないので，積まれた文字は捨てない．IRQ許可で呼ばれたタスク(2番目の空き待ち等)は
+*  IRQを許可してDMA完了後の送信割込みで空くのを待ち，それ以外はE_CTXとする
+*/
+static ER wait_serial_tx_space(unsigned long cpsr)
+{
+	ER ercd;
+
+	/* タスクコンテキスト(システムモード)かつ，空き待ちのタスクがいない */
+	if ((cpsr & 0x1f) == CPSR_SYS_MODE && sg_tx.waiter == -1) {
+		sg_tx.waiter = (ER_ID)g_current->init.tskid;
+		ercd = mz_slp_tsk(); /* 起床後はIRQ禁止のまま戻ってくる */
+		sg_tx.waiter = -1; /* 送信割込み以外で起床した場合も待ちを解除 */
+		if (ercd == E_OK) {
+			return E_OK;
+		}
+	}
+	else {
+		/* 処理なし */
+	}
+
+	/* DMA送信中(THRへ書き込めない) */
+	if (sg_tx.dma) {
+		/* タスクコンテキスト(システムモード)以外，またはIRQ禁止で呼ばれたので待てない */
+		if ((cpsr & 0x1f) != CPSR_SYS_MODE || (cpsr & IRQ_DISABLE)) {
+			return E_CTX;
+		}
+		/* IRQを許可して，DMA完了通知と送信割込みを受け付ける */
+		restore_irq(cpsr);
+		save_disable_irq();
+		return E_OK;
+	}
+	else {
+		/* 処理なし */
+	}
+
+	send_serial_byte_polled(sg_tx.buf[sg_tx.tail & (SERIAL_TX_BUF_SIZE - 1)]);
+	sg_tx.tail++;
+
+	return E_OK;
+}
+
+
+/*!
+* 1文字送信
+* c:
+* (返却値)E_OK : 送信リングバッファへ格納した(ポーリング送信の場合は送信完了)
+* (返却値)E_CTX : 送信リングバッファが満杯のDMA送信中に，待てない呼び出し元(割込みハンドラ等)から呼ばれた
+*                 (cは格納しない．既に積まれた文字は捨てない)
+* -送信リングバッファへ格納して戻り，送信は送信割込み(serial_intr_send())で行う
+* -ポーリング送信の場合(起動直後とdown_system())は，送信完了まで待機する
+*/
+ER send_serial_byte(unsigned char c)
+{
+	unsigned long cpsr;
+
+	/* ポーリング送信の場合 */
+	if (sg_tx.polled) {
+		send_serial_byte_polled(c);
+		return E_OK;
+	}
+
+	cpsr = save_disable_irq();
+	/* 送信リングバッファが満杯 */
+	while (sg_tx.head - sg_tx.tail >= SERIAL_TX_BUF_SIZE) {
+		if (wait_serial_tx_space(cpsr) != E_OK) {
+			restore_irq(cpsr);
+			return E_CTX;
+		}
+	}
+	sg_tx.buf[sg_tx.head & (SERIAL_TX_BUF_SIZE - 1)] = c;
+	sg_tx.head++;
+	/* DMA送信中は，DMA完了後に送信割込みを有効化する */
+	if (!sg_tx.dma) {
+		serial_intr_send_enable(); /* THRが空ならば，すぐに送信割込みが発生する */
+	}
+	else {
+		/* 処理なし */
+	}
+	restore_irq(cpsr);
+
+	return E_OK;
+}
+
+
+/*!
+* 送信リングバッファが空になるまで待つ(タスクコンテキストからIRQ禁止状態で呼ぶ)
+* (返却値)E_OK : 空になった
+* (返却値)E_OBJ : 他のタスクが空き待ち
+* (返却値)上記以外 : mz_slp_tsk()のエラーコード
+*/
+static ER wait_serial_tx_empty(void)
+{
+	ER ercd = E_OK;
+
+	while (sg_tx.head != sg_tx.tail) {
+		/* 他のタスクが空き待ち */
+		if (sg_tx.waiter != -1) {
+			return E_OBJ;
+		}
+		sg_tx.waiter = (ER_ID)g_current->init.tskid;
+		sg_tx.wake = 0;
+		ercd = mz_slp_tsk(); /* 起床後はIRQ禁止のまま戻ってくる */
+		sg_tx.waiter = -1;
+		sg_tx.wake = SERIAL_TX_BUF_SIZE / 2;
+		if (ercd != E_OK) {
+			break;
+		}
+	}
+
+	return ercd;
+}
+
+
+/*!
+* DMA送信完了通知(sDMAの完了割込みから呼ばれる)
+* ch : チャネル番号
+* ercd : 転送結果
+* arg : 使用しない
+* -UARTをDMAモードから戻し，DMA送信中に積まれた文字があれば送信割込みを有効化する
+*/
+static void serial_dma_done(int ch, ER ercd, int arg)
+{
+	REG8_WRITE(UFCR, UART_FCR_FIFO_EN);
+	sg_tx.dma_ercd = ercd;
+	sg_tx.dma = FALSE;
+
+	/* DMA送信中に積まれた文字がある */
+	if (sg_tx.head != sg_tx.tail) {
+		serial_intr_send_enable();
+	}
+	else {
+		/* 処理なし */
+	}
+
+	/* DMA送信したタスクを起床させる */
+	if (sg_tx.dma_waiter != -1) {
+		mz_iwup_tsk(sg_tx.dma_waiter);
+		sg_tx.dma_waiter = -1;
+	}
+	else {
+		/* 処理なし */
+	}
+}
+
+
+/*!
+* DMAによるまとめ送信
+* *buf : 送信するデータ(送信完了まで書き換えない)
+* len : 送信するバイト数
+* (返却値)E_OK : 送信完了
+* (返却値)E_OBJ : DMA転送エラー(データの一部または全部が送信されていない)
+* -送信順序を保つため送信リングバッファが空になるのを待ってからDMA転送を開始し，完了まで起床待ちとなる
+* -ポーリング送信，DMAチャネルなし，タスクコンテキスト以外または他のタスクが送信待ちの場合は，
+*  1文字ずつsend_serial_byte()で送信する
+*/
+ER serial_send_dma(const unsigned char *buf, int len)
+{
+	unsigned long cpsr;
+	ER ercd;
+	int i;
+
+	if (len <= 0) {
+		return E_OK;
+	}
+
+	cpsr = save_disable_irq();
+	/* DMA送信できる(割込み送信，DMAチャネルあり，タスクコンテキスト) */
+	if (!sg_tx.polled && sg_tx.dma_ch >= 0 && !sg_tx.dma && (cpsr & 0x1f) == CPSR_SYS_MODE &&
+			wait_serial_tx_empty() == E_OK) {
+		sg_tx.dma = TRUE;
+		REG8_WRITE(UFCR, UART_FCR_FIFO_EN | UART_FCR_DMA_MODE);
+		ercd = dma_start_mem_to_dev(sg_tx.dma_ch, buf, UTHR, (UINT32)len, UART3_DMA_TX_REQ, serial_dma_done, 0);
+		if (ercd == E_OK) {
+			/* DMA完了通知で起床(他の起床要求で起床した場合は待ち直す) */
+			while (sg_tx.dma) {
+				sg_tx.dma_waiter = (ER_ID)g_current->init.tskid;
+				if (mz_slp_tsk() != E_OK) {
+					/* slp_tsk()がサポートされないスケジューラの場合はIRQを許可して完了を待つ */
+					sg_tx.dma_waiter = -1;
+					restore_irq(cpsr);
+					while (sg_tx.dma) {
+						;
+					}
+					cpsr = save_disable_irq();
+				}
+			}
+			ercd = sg_tx.dma_ercd;
+			restore_irq(cpsr);
+			return ercd;
+		}
+		REG8_WRITE(UFCR, UART_FCR_FIFO_EN);
+		sg_tx.dma = FALSE;
+	}
+	else {
+		/* 処理なし */
+	}
+	restore_irq(cpsr);
+
+	for (i = 0; i < len; i++) {
+		send_serial_byte(buf[i]);
+	}
+
+	return E_OK;
+}
+
+
+/*!
+* フレームのまとめ送信
+* *buf : 送信するフレーム
+* len : 送信するバイト数(SERIAL_TX_FRAME_MAX以下)
+* wait : 送信リングバッファに空きがない時に空き待ちするか
+* (返却値)E_OK : 送信リングバッファへ格納した(ポーリング送信の場合は送信完了)
+* (返却値)E_PAR : フレームが大きすぎる
+* (返却値)E_TMOUT : 空きがない(waitがFALSEの場合)
+* (返却値)E_CTX : 空きがなく，タスクコンテキスト以外から呼ばれた
+* (返却値)E_OBJ : 空きがなく，他のタスクがフレーム送信の空き待ち
+* (返却値)上記以外 : mz_slp_tsk()のエラーコード
+* -フレームはIRQ禁止で一度に格納するので，他のタスクや割込みハンドラの出力がフレームの途中に混ざらない
+* -格納後の使用量が送信リングバッファの半分を超えないようにし，残りはコンソール出力に空けておく
+*  (フレーム送信は最も古い文字をポーリング送信して空きを作る事はしないので，送信帯域以上には積まない)
+*/
+ER serial_send_frame(const unsigned char *buf, int len, BOOL wait)
+{
+	unsigned long cpsr;
+	ER ercd;
+	int i;
+
+	if (len <= 0) {
+		return E_OK;
+	}
+	else if (len > SERIAL_TX_FRAME_MAX) {
+		return E_PAR;
+	}
+	else {
+		/* 処理なし */
+	}
+
+	/* ポーリング送信の場合 */
+	if (sg_tx.polled) {
+		for (i = 0; i < len; i++) {
+			send_serial_byte_polled(buf[i]);
+		}
+		return E_OK;
+	}
+
+	cpsr = save_disable_irq();
+	/* フレームを格納すると半分を超える */
+	while (sg_tx.head - sg_tx.tail > SERIAL_TX_FRAME_MAX - (UINT32)len) {
+		/* 空き待ちしない */
+		if (!wait) {
+			restore_irq(cpsr);
+			return E_TMOUT;
+		}
+		/* タスクコンテキスト(システムモード)以外 */
+		else if ((cpsr & 0x1f) != CPSR_SYS_MODE) {
+			restore_irq(cpsr);
+			return E_CTX;
+		}
+		/* 他のタスクがフレーム送信の空き待ち */
+		else if (sg_tx.frame_waiter != -1) {
+			restore_irq(cpsr);
+			return E_OBJ;
+		}
+		else {
+			/* 処理なし */
+		}
+		sg_tx.frame_waiter = (ER_ID)g_current->init.tskid;
+		sg_tx.frame_wake = SERIAL_TX_FRAME_MAX - (UINT32)len;
+		ercd = mz_slp_tsk(); /* 起床後はIRQ禁止のまま戻ってくる */
+		sg_tx.frame_waiter = -1; /* 送信割込み以外で起床した場合も待ちを解除 */
+		if (ercd != E_OK) {
+			restore_irq(cpsr);
+			return ercd;
+		}
+	}
+
+	for (i = 0; i < len; i++) {
+		sg_tx.buf[sg_tx.head & (SERIAL_TX_BUF_SIZE - 1)] = buf[i];
+		sg_tx.head++;
+	}
+	/* DMA送信中は，DMA完了後に送信割込みを有効化する */
+	if (!sg_tx.dma) {
+		serial_intr_send_enable(); /* THRが空ならば，すぐに送信割込みが発生する */
+	}
+	else {
+		/* 処理なし */
+	}
+	restore_irq(cpsr);
+
+	return E_OK;
+}
+
+
+/*!
+* 送信割込み処理(THR空割込み)
+* -送信FIFOバッファの空きがトリガレベルになった所なので，満杯になるまで送信リングバッファから移す
+*  (割込み時点では全部は空いていないので，FIFOサイズ分を書くと溢れた文字が捨てられる)
+* -送信リングバッファが空になったら送信割込みを無効化する
+* -空き待ちのタスクは，半分以上空いたら起床させる
+* -フレーム送信の空き待ちのタスクは，フレームが入るまで空いたら起床させる
+*/
+void serial_intr_send(void)
+{
+	int n;
+
+	for (n = 0; n < UART_TX_FIFO_SIZE && sg_tx.tail != sg_tx.head && !(REG8_READ(USSR) & UART_SSR_TX_FIFO_FULL); n++) {
+		REG8_WRITE(UTHR, sg_tx.buf[sg_tx.tail & (SERIAL_TX_BUF_SIZE - 1)]);
+		sg_tx.tail++;
+	}
+
+	/* 送信リングバッファが空 */
+	if (sg_tx.tail == sg_tx.head) {
+		serial_intr_send_disable();
+	}
+	else {
+		/* 処理なし */
+	}
+
+	/* 空き待ちのタスクがいて，要求数まで空いた(通常は半分，wait_serial_tx_empty()は全部) */
+	if (sg_tx.waiter != -1 && sg_tx.head - sg_tx.tail <= sg_tx.wake) {
+		mz_iwup_tsk(sg_tx.waiter);
+		sg_tx.waiter = -1;
+	}
+	else {
+		/* 処理なし */
+	}
+
+	/* フレーム送信の空き待ちのタスクがいて，フレームが入るまで空いた */
+	if (sg_tx.frame_waiter != -1 && sg_tx.head - sg_tx.tail <= sg_tx.frame_wake) {
+		mz_iwup_tsk(sg_tx.frame_waiter);
+		sg_tx.frame_waiter = -1;
+	}
+	else {
+		/* 処理なし */
+	}
+}
+
+
+/*!
+* 送信リングバッファを使用した割込み送信へ切り替える
+* -UARTの割込みハンドラを登録した後(initタスク)で呼ぶ
+* -DMA送信用のチャネルもここで割り当てる(dma_init()の後で呼ぶ事)
+*/
+void serial_send_buffered(void)
+{
+	sg_tx.dma_ch = dma_alloc_channel(); /* 割り当てられない場合はDMA送信しない */
+	sg_tx.polled = FALSE;
+}
+
+
+/*!
+* ポーリング送信へ切り替える(パニック出力用)
+* -送信リングバッファに残っている文字はポーリングで送信してから切り替える
+* -割込みやスケジューラが使えない状態でも出力できる
+*/
+void serial_send_polled(void)
+{
+	unsigned long cpsr = save_disable_irq();
+
+	/* DMA送信中ならば中断する */
+	if (sg_tx.dma) {
+		dma_stop(sg_tx.dma_ch);
+		REG8_WRITE(UFCR, UART_FCR_FIFO_EN);
+		sg_tx.dma = FALSE;
+	}
+	else {
+		/* 処理なし */
+	}
+	serial_intr_send_disable();
+	while (sg_tx.tail != sg_tx.head) {
+		send_serial_byte_polled(sg_tx.buf[sg_tx.tail & (SERIAL_TX_BUF_SIZE - 1)]);
+		sg_tx.tail++;
+	}
+	sg_tx.polled = TRUE;
+	restore_irq(cpsr);
+}
+
+
 /*!
 * 受信可能かチェック
 * (返却値) :
@@ -96,10 +551,10 @@ static int is_recv_serial_enable(void)
 
 
 /*!
-* １文字受信
+* 1文字をポーリングで受信
 * (返却値) :
 */
-unsigned char recv_serial_byte(void)
+static unsigned char recv_serial_byte_polled(void)
 {
   unsigned char s, c;
 
@@ -123,6 +578,249 @@ unsigned char recv_serial_byte(void)
 }
 
 
+/*!
+* １文字受信
+* (返却値) :
+* -割込み受信の場合，タスクからの呼び出しは受信リングバッファから読み出す(確定済みデータがなければ起床待ち)
+* -ポーリング受信の場合(起動直後)及び割込みハンドラからの呼び出しは，受信完了まで待機する
+*/
+unsigned char recv_serial_byte(void)
+{
+	unsigned long cpsr;
+	char c;
+
+	asm volatile("mrs %0, cpsr" : "=r"(cpsr));
+
+	/* 割込み受信かつ，タスクコンテキスト(システムモード) */
+	if (!sg_rx.polled && (cpsr & 0x1f) == CPSR_SYS_MODE) {
+		while (recv_serial(&c, 1, TRUE) != 1) {
+			;
+		}
+		return (unsigned char)c;
+	}
+	else {
+		return recv_serial_byte_polled();
+	}
+}
+
+
+/*!
+* 受信した1文字を行規則に従って受信リングバッファへ格納(受信割込みから呼ぶ)
+* c : 受信した文字
+* (返却値) : 確定した行の数(0または1)
+* -生データ受信の場合は，格納した文字をそのまま確定する
+* -行組み立ての場合は，'\r'を'\n'へ変換してエコーバックし，バックスペース(0x08,0x7f)は組み立て中の1文字を消す
+* -'\n'を受信するか，組み立て中の行がSERIAL_RX_LINE_MAXに達したら確定する
+*/
+static int serial_rx_store(unsigned char c)
+{
+	/* 行組み立て中のバックスペース */
+	if (!sg_rx.raw && (c == 0x08 || c == 0x7f)) {
+		if (sg_rx.head != sg_rx.line) {
+			sg_rx.head--;
+			send_serial_byte('\b');
+			send_serial_byte(' ');
+			send_serial_byte('\b');
+		}
+		else {
+			/* 処理なし */
+		}
+		return 0;
+	}
+	else {
+		/* 処理なし */
+	}
+
+	/* 受信リングバッファが満杯 */
+	if (sg_rx.head - sg_rx.tail >= SERIAL_RX_BUF_SIZE) {
+		sg_rx.overruns++;
+		return 0;
+	}
+
+	/* 生データ受信 */
+	if (sg_rx.raw) {
+		sg_rx.buf[sg_rx.head & (SERIAL_RX_BUF_SIZE - 1)] = c;
+		sg_rx.head++;
+		sg_rx.line = sg_rx.head;
+		return 0;
+	}
+
+	c = (c == '\r') ? '\n' : c;
+	sg_rx.buf[sg_rx.head & (SERIAL_RX_BUF_SIZE - 1)] = c;
+	sg_rx.head++;
+
+	/* エコーバック */
+	if (c == '\n') {
+		send_serial_byte('\r');
+	}
+	else {
+		/* 処理なし */
+	}
+	send_serial_byte(c);
+
+	/* 行の確定 */
+	if (c == '\n') {
+		sg_rx.line = sg_rx.head;
+		return 1;
+	}
+	/* 組み立て中の行が長すぎる(改行なしで確定) */
+	else if (sg_rx.head - sg_rx.line >= SERIAL_RX_LINE_MAX) {
+		sg_rx.line = sg_rx.head;
+	}
+	else {
+		/* 処理なし */
+	}
+
+	return 0;
+}
+
+
+/*!
+* 受信割込み処理(受信データ有割込み及びタイムアウト割込み)
+* (返却値) : 確定した行の数
+* -受信FIFOバッファが空になるまで受信リングバッファへ移す(受信エラーの文字は捨てる)
+* -受信待ちのタスクは，確定済みデータが要求数に達したら起床させる
+*/
+int serial_intr_recv(void)
+{
+	unsigned char s, c;
+	int lines = 0;
+
+	while ((s = is_recv_serial_enable()) & 0x01) {
+		c = REG8_READ(URBR);
+		/* 受信エラーの場合 */
+		if (s & 0x1e) {
+			continue;
+		}
+		lines += serial_rx_store(c);
+	}
+
+	/* 受信待ちのタスクがいて，確定済みデータが要求数に達した */
+	if (sg_rx.waiter != -1 && sg_rx.line - sg_rx.tail >= sg_rx.want) {
+		mz_iwup_tsk(sg_rx.waiter);
+		sg_rx.waiter = -1;
+	}
+	else {
+		/* 処理なし */
+	}
+
+	return lines;
+}
+
+
+/*!
+* 受信リングバッファから読み出す(rcv_ser相当)
+* *buf : 読み出した文字を格納する領域
+* len : 読み出す最大数(1以上)
+* wait : 確定済みデータがない場合に起床待ちするか
+* (返却値)recv_serial_timed()と同じ
+*/
+int recv_serial(char *buf, int len, BOOL wait)
+{
+	return recv_serial_timed(buf, len, (wait) ? TMO_FEVR : TMO_POL);
+}
+
+
+/*!
+* 受信リングバッファから読み出す(タイムアウトあり，trcv_ser相当)
+* *buf : 読み出した文字を格納する領域
+* len : 読み出す最大数(1以上)
+* tmout : 確定済みデータが要求数に満たない場合に起床待ちする時間(msec.TMO_POLでポーリング，TMO_FEVRで永久待ち)
+* (返却値)0より大きい : 読み出した数
+* (返却値)E_TMOUT : 確定済みデータがない(ポーリングまたはタイムアウト)
+* (返却値)E_CTX : タスクコンテキスト以外からの呼び出し，または他のタスクが受信待ち
+* (返却値)E_PAR : lenまたはtmoutが不正
+* -行組み立ての場合は確定した1行('\n'まで)を超えては読み出さず，1行または確定済みデータがあれば起床する
+* -生データ受信の場合はlen(受信リングバッファの半分まで)に達したら起床する
+* -タイムアウトした場合は，それまでに確定したデータを読み出す(生データ受信ではlenに満たない事がある)
+*/
+int recv_serial_timed(char *buf, int len, int tmout)
+{
+	unsigned long cpsr;
+	int n = 0;
+	char c;
+	ER ercd;
+	UINT32 want;
+
+	if (len <= 0 || tmout < TMO_FEVR) {
+		return E_PAR;
+	}
+
+	want = (sg_rx.raw) ? (UINT32)len : 1;
+	want = (want > SERIAL_RX_BUF_SIZE / 2) ? SERIAL_RX_BUF_SIZE / 2 : want;
+
+	cpsr = save_disable_irq();
+	/* 確定済みデータが要求数に満たない */
+	if (sg_rx.line - sg_rx.tail < want) {
+		/* ポーリング */
+		if (tmout == TMO_POL) {
+			restore_irq(cpsr);
+			return E_TMOUT;
+		}
+		/* タスクコンテキスト(システムモード)以外，または他のタスクが受信待ち */
+		else if ((cpsr & 0x1f) != CPSR_SYS_MODE || sg_rx.waiter != -1) {
+			restore_irq(cpsr);
+			return E_CTX;
+		}
+		else {
+			sg_rx.waiter = (ER_ID)g_current->init.tskid;
+			sg_rx.want = want;
+			ercd = mz_tslp_tsk(tmout); /* 起床後はIRQ禁止のまま戻ってくる */
+			sg_rx.waiter = -1; /* 受信割込み以外で起床した場合も待ちを解除 */
+			/* タイムアウトは確定済みの分を読み出す */
+			if (ercd != E_OK && ercd != E_TMOUT) {
+				restore_irq(cpsr);
+				return ercd;
+			}
+		}
+	}
+	else {
+		/* 処理なし */
+	}
+
+	while (n < len && sg_rx.tail != sg_rx.line) {
+		c = (char)sg_rx.buf[sg_rx.tail & (SERIAL_RX_BUF_SIZE - 1)];
+		sg_rx.tail++;
+		buf[n++] = c;
+		/* 行組み立ての場合は1行まで */
+		if (!sg_rx.raw && c == '\n') {
+			break;
+		}
+		else {
+			/* 処理なし */
+		}
+	}
+	restore_irq(cpsr);
+
+	return (n == 0) ? E_TMOUT : n;
+}
+
+
+/*!
+* 受信リングバッファを使用した割込み受信へ切り替える
+* -UARTの割込みハンドラを登録した後(initタスク)で呼ぶ
+*/
+void serial_recv_buffered(void)
+{
+	sg_rx.polled = FALSE;
+}
+
+
+/*!
+* 行組み立てを行わない生データ受信との切り替え(ファイル転送用)
+* raw : TRUEで生データ受信，FALSEで行組み立て
+* -行組み立て中のデータは，切り替え時に確定する
+*/
+void serial_recv_raw(BOOL raw)
+{
+	unsigned long cpsr = save_disable_irq();
+
+	sg_rx.line = sg_rx.head;
+	sg_rx.raw = raw;
+	restore_irq(cpsr);
+}
+
+
 /*
 * 送信割込みが有効か検査
 * (返却値)
@@ -10,17 +10,26 @@
 #define _SERIAL_DRIVER_H_INCLUDED_
 
 
+/* os/kernel */
+#include "kernel/defines.h"
+
+
 #define	UART3_BASE_ADR		0x49020000																			/*! UART3のポートアドレス(メモリマップアドレス) */
 
 #define	UIIR			(UART3_BASE_ADR + 0x08)																	/*! まだ未使用 */
 #define UFCR UIIR																													/*! レジスタリネーム．送受信FIFOバッファ無効有効化とクリア制御 */
 
+#define SERIAL_TX_BUF_SIZE		1024																				/*! 送信リングバッファのサイズ(2のべき乗) */
+#define SERIAL_TX_FRAME_MAX		(SERIAL_TX_BUF_SIZE / 2)										/*! まとめて送信できるフレームの最大長 */
+#define SERIAL_RX_BUF_SIZE		256																					/*! 受信リングバッファのサイズ(2のべき乗) */
+#define SERIAL_RX_LINE_MAX		128																					/*! 行組み立ての最大長(超えた分は改行なしで確定) */
+
 
 /* デバイス初期化 */
 extern void uart3_init(void);
 
 /*! １文字送信 */
-extern void send_serial_byte(unsigned char c);
+extern ER send_serial_byte(unsigned char c);
 
 /*! １文字受信 */
 extern unsigned char recv_serial_byte(void);
@@ -43,5 +52,35 @@ extern void serial_intr_recv_enable(void);
 /* 受信割込みを無効化する */
 extern void serial_intr_recv_disable(void);
 
+/* 送信割込み処理(THR空割込み) */
+extern void serial_intr_send(void);
+
+/* 送信リングバッファを使用した割込み送信へ切り替える */
+extern void serial_send_buffered(void);
+
+/* DMAによるまとめ送信(完了まで起床待ち) */
+extern ER serial_send_dma(const unsigned char *buf, int len);
+
+/* フレームのまとめ送信(途中に他の出力を混ぜない) */
+extern ER serial_send_frame(const unsigned char *buf, int len, BOOL wait);
+
+/* ポーリング送信へ切り替える(パニック出力用) */
+extern void serial_send_polled(void);
+
+/* 受信割込み処理(受信FIFOバッファを空になるまで受信リングバッファへ移す) */
+extern int serial_intr_recv(void);
+
+/* 受信リングバッファから読み出す(rcv_ser相当) */
+extern int recv_serial(char *buf, int len, BOOL wait);
+
+/* 受信リングバッファから読み出す(タイムアウトあり，trcv_ser相当) */
+extern int recv_serial_timed(char *buf, int len, int tmout);
+
+/* 受信リングバッファを使用した割込み受信へ切り替える */
+extern void serial_recv_buffered(void);
+
+/* 行組み立てを行わない生データ受信との切り替え */
+extern void serial_recv_raw(BOOL raw);
+
 
 #endif
@@ -11,6 +11,10 @@
 #include "timer_driver.h"
 
 
+/* 32KHz Sync Timer(常時動作しているフリーランカウンタ) */
+#define SYNCTIMER_32K_CR        0x48320010 								/* 32KHz同期カウンタ(32768Hz，32bit) */
+
+
 /* Timer Instance Summary(汎用タイマ1〜11のマップアドレス) */
 #define GPT1_BASE_ADR           0x48318000 								/* General Purpose Timer1(汎用タイマ1のマップアドレス) Module */
 #define GPT2_BASE_ADR           0x49032000 								/* General Purpose Timer2(汎用タイマ2のマップアドレス) Module */
@@ -486,3 +490,15 @@ ER_VLE get_timervalue(int index)
 		return E_NG;
 	}
 }
+
+
+/*!
+ * 32KHz同期カウンタの現在値を取得する関数
+ * -リセット後から常時動作しているフリーランカウンタ(32768Hz)で，約36時間でラップアラウンドする
+ * -レジスタの読み出しのみなので，タスクから直接呼んでもよい
+ * (返却値)count : 32KHz同期カウンタの現在値
+ */
+UINT32 get_sync_counter(void)
+{
+	return REG32_READ(SYNCTIMER_32K_CR);
+}
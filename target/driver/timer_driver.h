@@ -35,5 +35,8 @@ extern void cancel_timer(int index);
 /*! タイマ動作中か検査する関数 */
 extern ER_VLE get_timervalue(int index);
 
+/*! 32KHz同期カウンタの現在値を取得する関数 */
+extern UINT32 get_sync_counter(void);
+
 
 #endif
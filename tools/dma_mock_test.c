@@ -0,0 +1,273 @@
+/*!
+ * @file ホストツール
+ * @brief sDMAドライバのチャネル状態遷移の検証
+ * @attention ホスト(PC)のgccでビルドする(make test)
+ * @note ・target/driver/dma_driver.cをDMA_HOST_MOCK定義でビルドし，模擬レジスタ上で
+ * 				 転送の開始，完了，エラー，中断と完了通知関数の呼び出しを検証する
+ * 			 ・ハードウェアの転送終了はdma_mock_finish()で模擬する
+ * 			 ・c_lib/lib.hとstdio.hは宣言が衝突するので，printf()のみを宣言して使用する
+ *
+ * 使い方 : dma_mock_test(失敗した検証があれば1で終了する)
+ */
+
+
+/* os/target/driver */
+#include "target/driver/dma_driver.h"
+
+
+/* sDMAのレジスタ定義(dma_driver.cと合わせる事) */
+#define DMA4_IRQSTATUS_L0				0x08
+#define DMA4_IRQENABLE_L0				0x18
+#define DMA4_CCR(i)							(0x80 + 0x60 * (i))
+#define DMA4_CICR(i)						(0x88 + 0x60 * (i))
+#define DMA4_CEN(i)							(0x94 + 0x60 * (i))
+#define DMA4_CCR_ENABLE					(1 << 7)
+#define DMA4_CSR_BLOCK					(1 << 5)
+#define DMA4_CSR_TRANS_ERR			(1 << 8)
+
+#define MOCK_REG(offset)				g_dma_mock_regs[(offset) >> 2]
+#define MOCK_DEV_ADR						0x49020000		/*! 転送先のデバイスレジスタ(UART3のTHR) */
+#define MOCK_ARG								0x5a					/*! 完了通知関数の引数 */
+
+
+/*! 検証結果の出力(失敗数を数える) */
+#define CHECK(cond)							check((cond), #cond, __LINE__)
+
+
+extern int printf(const char *format, ...);
+
+
+/*! 完了通知関数の呼び出し記録 */
+static struct {
+	int count;														/*! 呼ばれた回数 */
+	int ch;																/*! 最後に通知されたチャネル */
+	ER ercd;															/*! 最後に通知されたエラーコード */
+	int arg;															/*! 最後に通知された引数 */
+} sg_done;
+
+/*! 失敗した検証の数 */
+static int sg_failures;
+
+/*! 送信データ */
+static const UINT8 sg_src[16] = "dma mock test";
+
+
+/*!
+ * 検証結果の出力
+ * cond : 検証した条件
+ * *expr : 条件の式
+ * line : 行番号
+ */
+static void check(int cond, const char *expr, int line)
+{
+	if (!cond) {
+		printf("NG line %d : %s\n", line, expr);
+		sg_failures++;
+	}
+}
+
+
+/*!
+ * 完了通知関数(呼び出しを記録する)
+ * ch : チャネル番号
+ * ercd : E_OKまたはE_OBJ
+ * arg : 開始時に渡した引数
+ */
+static void mock_done(int ch, ER ercd, int arg)
+{
+	sg_done.count++;
+	sg_done.ch = ch;
+	sg_done.ercd = ercd;
+	sg_done.arg = arg;
+}
+
+
+/*!
+ * 完了通知関数の呼び出し記録の初期化
+ */
+static void clear_done(void)
+{
+	sg_done.count = 0;
+	sg_done.ch = -1;
+	sg_done.ercd = E_OK;
+	sg_done.arg = 0;
+}
+
+
+/*!
+ * 割り当てと解放，パラメータの検査
+ */
+static void test_alloc(void)
+{
+	int ch, i;
+
+	dma_init();
+	for (ch = 0; ch < DMA_CHANNEL_NUM; ch++) {
+		CHECK(dma_get_state(ch) == DMA_CH_FREE);
+	}
+
+	/* 未割り当てのチャネルは開始，中断，解放できない */
+	CHECK(dma_start_mem_to_dev(0, sg_src, MOCK_DEV_ADR, 1, 0, NULL, 0) == E_OBJ);
+	CHECK(dma_stop(0) == E_OBJ);
+	CHECK(dma_free_channel(0) == E_OBJ);
+	CHECK(dma_free_channel(DMA_CHANNEL_NUM) == E_ID);
+
+	/* すべて割り当てると不足する */
+	for (i = 0; i < DMA_CHANNEL_NUM; i++) {
+		CHECK(dma_alloc_channel() == i);
+		CHECK(dma_get_state(i) == DMA_CH_IDLE);
+	}
+	CHECK(dma_alloc_channel() == E_NOID);
+
+	/* パラメータ不正 */
+	CHECK(dma_start_mem_to_dev(-1, sg_src, MOCK_DEV_ADR, 1, 0, NULL, 0) == E_ID);
+	CHECK(dma_start_mem_to_dev(0, NULL, MOCK_DEV_ADR, 1, 0, NULL, 0) == E_PAR);
+	CHECK(dma_start_mem_to_dev(0, sg_src, MOCK_DEV_ADR, 0, 0, NULL, 0) == E_PAR);
+	CHECK(dma_start_mem_to_dev(0, sg_src, MOCK_DEV_ADR, DMA_ELEMENT_MAX + 1, 0, NULL, 0) == E_PAR);
+	CHECK(dma_start_mem_to_dev(0, sg_src, MOCK_DEV_ADR, 1, 128, NULL, 0) == E_PAR);
+	CHECK(dma_get_state(0) == DMA_CH_IDLE);
+
+	for (i = 0; i < DMA_CHANNEL_NUM; i++) {
+		CHECK(dma_free_channel(i) == E_OK);
+		CHECK(dma_get_state(i) == DMA_CH_FREE);
+	}
+}
+
+
+/*!
+ * 転送の開始から正常完了まで
+ */
+static void test_done(void)
+{
+	int ch;
+
+	dma_init();
+	clear_done();
+	ch = dma_alloc_channel();
+	CHECK(ch == 0);
+
+	CHECK(dma_start_mem_to_dev(ch, sg_src, MOCK_DEV_ADR, sizeof(sg_src), UART3_DMA_TX_REQ, mock_done, MOCK_ARG) == E_OK);
+	CHECK(dma_get_state(ch) == DMA_CH_BUSY);
+	CHECK(MOCK_REG(DMA4_CCR(ch)) & DMA4_CCR_ENABLE);
+	CHECK(MOCK_REG(DMA4_CEN(ch)) == sizeof(sg_src));
+	CHECK(MOCK_REG(DMA4_IRQENABLE_L0) & (1 << ch));
+
+	/* 転送中は開始も解放もできない */
+	CHECK(dma_start_mem_to_dev(ch, sg_src, MOCK_DEV_ADR, 1, 0, mock_done, 0) == E_OBJ);
+	CHECK(dma_free_channel(ch) == E_OBJ);
+	CHECK(sg_done.count == 0);
+
+	dma_mock_finish(ch, DMA4_CSR_BLOCK);
+	CHECK(sg_done.count == 1);
+	CHECK(sg_done.ch == ch);
+	CHECK(sg_done.ercd == E_OK);
+	CHECK(sg_done.arg == MOCK_ARG);
+	CHECK(dma_get_state(ch) == DMA_CH_DONE);
+	CHECK(!(MOCK_REG(DMA4_CCR(ch)) & DMA4_CCR_ENABLE));
+	CHECK(!(MOCK_REG(DMA4_IRQSTATUS_L0) & (1 << ch)));
+	CHECK(!(MOCK_REG(DMA4_IRQENABLE_L0) & (1 << ch)));
+
+	/* 完了後の割込み(取り残されたステータス)では通知しない */
+	MOCK_REG(DMA4_IRQSTATUS_L0) |= 1 << ch;
+	MOCK_REG(DMA4_IRQENABLE_L0) |= 1 << ch;
+	CHECK(dma_intr(DMA_INTR_LINE) == FALSE);
+	CHECK(sg_done.count == 1);
+	CHECK(dma_get_state(ch) == DMA_CH_DONE);
+
+	CHECK(dma_free_channel(ch) == E_OK);
+	CHECK(dma_get_state(ch) == DMA_CH_FREE);
+}
+
+
+/*!
+ * 転送エラーと，エラー後の再開
+ */
+static void test_error(void)
+{
+	int ch;
+
+	dma_init();
+	clear_done();
+	ch = dma_alloc_channel();
+
+	CHECK(dma_start_mem_to_dev(ch, sg_src, MOCK_DEV_ADR, sizeof(sg_src), UART3_DMA_TX_REQ, mock_done, MOCK_ARG) == E_OK);
+	dma_mock_finish(ch, DMA4_CSR_TRANS_ERR);
+	CHECK(sg_done.count == 1);
+	CHECK(sg_done.ch == ch);
+	CHECK(sg_done.ercd == E_OBJ);
+	CHECK(dma_get_state(ch) == DMA_CH_ERROR);
+	CHECK(MOCK_REG(DMA4_CCR(ch)) == 0);
+	CHECK(MOCK_REG(DMA4_CICR(ch)) == 0);
+
+	/* エラーからは再び開始できる */
+	CHECK(dma_start_mem_to_dev(ch, sg_src, MOCK_DEV_ADR, 4, UART3_DMA_TX_REQ, mock_done, MOCK_ARG + 1) == E_OK);
+	CHECK(dma_get_state(ch) == DMA_CH_BUSY);
+	dma_mock_finish(ch, DMA4_CSR_BLOCK);
+	CHECK(sg_done.count == 2);
+	CHECK(sg_done.ercd == E_OK);
+	CHECK(sg_done.arg == MOCK_ARG + 1);
+	CHECK(dma_get_state(ch) == DMA_CH_DONE);
+}
+
+
+/*!
+ * 転送の中断と，複数チャネルの完了割込み
+ */
+static void test_stop(void)
+{
+	int ch0, ch1;
+
+	dma_init();
+	clear_done();
+	ch0 = dma_alloc_channel();
+	ch1 = dma_alloc_channel();
+
+	/* 中断した転送は通知しない */
+	CHECK(dma_start_mem_to_dev(ch0, sg_src, MOCK_DEV_ADR, 4, 0, mock_done, 0) == E_OK);
+	CHECK(dma_stop(ch0) == E_OK);
+	CHECK(dma_get_state(ch0) == DMA_CH_IDLE);
+	CHECK(dma_stop(ch0) == E_OBJ);
+	dma_mock_finish(ch0, DMA4_CSR_BLOCK);
+	CHECK(sg_done.count == 0);
+	CHECK(dma_get_state(ch0) == DMA_CH_IDLE);
+
+	/* 完了したチャネルのみ通知する */
+	CHECK(dma_start_mem_to_dev(ch0, sg_src, MOCK_DEV_ADR, 4, 0, mock_done, 0) == E_OK);
+	CHECK(dma_start_mem_to_dev(ch1, sg_src, MOCK_DEV_ADR, 4, 0, mock_done, 1) == E_OK);
+	dma_mock_finish(ch1, DMA4_CSR_BLOCK);
+	CHECK(sg_done.count == 1);
+	CHECK(sg_done.ch == ch1);
+	CHECK(sg_done.arg == 1);
+	CHECK(dma_get_state(ch0) == DMA_CH_BUSY);
+	CHECK(dma_get_state(ch1) == DMA_CH_DONE);
+
+	/* 完了割込みの割込み線以外では処理しない */
+	MOCK_REG(DMA4_IRQSTATUS_L0) |= 1 << ch0;
+	CHECK(dma_intr((INTRPT_TYPE)(DMA_INTR_LINE + 1)) == FALSE);
+	CHECK(sg_done.count == 1);
+	CHECK(dma_get_state(ch0) == DMA_CH_BUSY);
+
+	/* 完了通知関数なし */
+	CHECK(dma_stop(ch0) == E_OK);
+	CHECK(dma_start_mem_to_dev(ch0, sg_src, MOCK_DEV_ADR, 4, 0, NULL, 0) == E_OK);
+	dma_mock_finish(ch0, DMA4_CSR_BLOCK);
+	CHECK(sg_done.count == 1);
+	CHECK(dma_get_state(ch0) == DMA_CH_DONE);
+}
+
+
+int main(void)
+{
+	test_alloc();
+	test_done();
+	test_error();
+	test_stop();
+
+	if (sg_failures != 0) {
+		printf("dma_mock_test : %d failed\n", sg_failures);
+		return 1;
+	}
+	printf("dma_mock_test : OK\n");
+
+	return 0;
+}
@@ -0,0 +1,543 @@
+/*!
+ * @file ホストツール
+ * @brief トレースダンプのデコーダ
+ * @attention ホスト(PC)のgccでビルドする(make tools)
+ * @note ・sendlogで受信したダンプ(ログリングのヘッダと古い順に並べたイベント)を時系列の表にする
+ * 			 ・sendlogの引数にdelta,lzを付けて符号化したダンプ(kernel_svc/log_encode.h)は，元のダンプに戻してから表にする
+ * 			 ・-sの場合はdrainコマンドのパケットを記録したシリアルのキャプチャを読み，同期バイトを探して
+ * 				 CRC-16の正しいパケットのみを表にする(間に混ざったコンソール出力は読み飛ばす)
+ * 			 ・ダンプはリトルエンディアンなので，ホストのエンディアンに関係なくバイト単位で読む
+ * 			 ・XMODEMの埋め草(0x1A)はヘッダのcountで読み飛ばす
+ * 			 ・ヘッダとイベントの形式はkernel_svc/log_manage.h，符号化の形式はkernel_svc/log_encode.h，
+ * 				 パケットの形式はkernel_svc/log_drain.hと合わせる事
+ *
+ * 使い方 : trace_decode [-m CPUクロック(MHz)] [-s] ダンプファイル(-sの場合はキャプチャファイル)
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define LOG_RING_MAGIC					0x474f4c4dUL	/*! ログリングの識別子("MLOG") */
+#define LOG_RING_HEADER_SIZE		36						/*! ログリングのヘッダサイズ(UINT32 × 9) */
+#define LOG_EVENT_SIZE					16						/*! イベントのレコードサイズ */
+#define LOG_DUMP_MAX						0x1000000			/*! 読み込むダンプの最大サイズ */
+#define LOG_ENCODE_MAGIC				0x5a474c4dUL	/*! 符号化したダンプの識別子("MLGZ") */
+#define LOG_ENCODE_HEADER_SIZE	28						/*! 符号化したダンプのヘッダサイズ(UINT32 × 7) */
+#define LOG_ENCODE_LZ						0x1						/*! 後方参照(LZSS)で圧縮している */
+#define LOG_ENCODE_TAG_EVENT		0x0f					/*! タグ:イベントの種類(0x0fの場合は直後にvarint) */
+#define LOG_ENCODE_TAG_SAME_TSKID	0x10				/*! タグ:タスクIDが前のレコードと同じ */
+#define LOG_ENCODE_TAG_SAME_ARG0	0x20				/*! タグ:引数0が同じ種類の前のイベントと同じ */
+#define LOG_ENCODE_TAG_SAME_ARG1	0x40				/*! タグ:引数1が同じ種類の前のイベントと同じ */
+#define LOG_ENCODE_EVENT_TYPES	16						/*! 引数の前回値を保持するイベントの種類数 */
+#define LOG_ENCODE_LZ_MIN				3							/*! 後方参照の最小の一致長 */
+#define LOG_DRAIN_SYNC0					0xA5					/*! パケットの同期バイト0 */
+#define LOG_DRAIN_SYNC1					0x5A					/*! パケットの同期バイト1 */
+#define LOG_DRAIN_TYPE_EVENT		1							/*! パケットの種類(トレースイベント) */
+#define LOG_DRAIN_HEADER_SIZE		12						/*! パケットのヘッダサイズ */
+#define LOG_DRAIN_CRC_SIZE			2							/*! パケットのCRC-16のサイズ */
+
+
+/*! イベントの種類ごとの表示名(LOG_EVENT_IDの順) */
+static const char *sg_event_name[] = {
+	"?",
+	"syscall-entry",
+	"syscall-exit",
+	"irq-entry",
+	"irq-exit",
+	"timer",
+	"wakeup",
+	"dispatch",
+};
+
+
+/*!
+ * @brief リトルエンディアンの32bit値の読み出し
+ * @param[in] *p:読み出す位置
+ * @return 読み出した値
+ */
+static unsigned long get_le32(const unsigned char *p)
+{
+	return (unsigned long)p[0] | ((unsigned long)p[1] << 8) |
+		((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+
+/*!
+ * @brief リトルエンディアンの16bit値の読み出し
+ * @param[in] *p:読み出す位置
+ * @return 読み出した値
+ */
+static unsigned int get_le16(const unsigned char *p)
+{
+	return (unsigned int)p[0] | ((unsigned int)p[1] << 8);
+}
+
+
+/*!
+ * @brief リトルエンディアンの32bit値の書き込み
+ * @param[out] *p:書き込む位置
+ * @param[in] val:書き込む値
+ * @return なし
+ */
+static void put_le32(unsigned char *p, unsigned long val)
+{
+	p[0] = (unsigned char)val;
+	p[1] = (unsigned char)(val >> 8);
+	p[2] = (unsigned char)(val >> 16);
+	p[3] = (unsigned char)(val >> 24);
+}
+
+
+/*!
+ * @brief varintの読み出し
+ * @param[in] *p:読み出すデータ
+ * @param[in] len:データ長
+ * @param[in,out] *pos:読み出す位置(読み出した分進める)
+ * @param[out] *val:読み出した値
+ * @return 0:正常終了,-1:データ不足
+ */
+static int get_varint(const unsigned char *p, size_t len, size_t *pos, unsigned long *val)
+{
+	int shift = 0;
+
+	*val = 0;
+	while (*pos < len && shift < 35) {
+		*val |= (unsigned long)(p[*pos] & 0x7f) << shift;
+		if (!(p[(*pos)++] & 0x80)) {
+			*val &= 0xFFFFFFFFUL;
+			return 0;
+		}
+		shift += 7;
+	}
+
+	return -1;
+}
+
+
+/*!
+ * @brief zigzagの差分を前回値に足す
+ * @param[in] prev:前回値
+ * @param[in] zz:zigzagで符号なしにした差分
+ * @return 今回値
+ */
+static unsigned long unzigzag(unsigned long prev, unsigned long zz)
+{
+	unsigned long diff = (zz >> 1) ^ (0 - (zz & 1));
+
+	return (prev + diff) & 0xFFFFFFFFUL;
+}
+
+
+/*!
+ * @brief 後方参照(LZSS)の展開
+ * @param[in] *in:圧縮データ
+ * @param[in] len:圧縮データのサイズ
+ * @param[out] *out:展開先
+ * @param[in] size:展開後のサイズ
+ * @return 0:正常終了,-1:データの不正
+ */
+static int expand_lz(const unsigned char *in, size_t len, unsigned char *out, size_t size)
+{
+	size_t ip = 0, op = 0, dist, match, i;
+	unsigned int flag = 0, bit = 0;
+
+	while (op < size) {
+		if (bit == 0) {
+			if (ip >= len) {
+				return -1;
+			}
+			flag = in[ip++];
+			bit = 1;
+		}
+		/* 後方参照(距離-1の12bitと一致長-3の4bit) */
+		if (flag & bit) {
+			if (ip + 2 > len) {
+				return -1;
+			}
+			dist = ((size_t)(in[ip + 1] >> 4) << 8 | in[ip]) + 1;
+			match = (in[ip + 1] & 0x0f) + LOG_ENCODE_LZ_MIN;
+			ip += 2;
+			if (dist > op || op + match > size) {
+				return -1;
+			}
+			for (i = 0; i < match; i++, op++) {
+				out[op] = out[op - dist]; /* 重なってもよいので1byteずつ複写 */
+			}
+		}
+		/* リテラル */
+		else {
+			if (ip >= len) {
+				return -1;
+			}
+			out[op++] = in[ip++];
+		}
+		bit = (bit << 1) & 0xff;
+	}
+
+	return 0;
+}
+
+
+/*!
+ * @brief 符号化したダンプを元のダンプ(ログリングのヘッダと古い順に並べたイベント)に戻す
+ * @param[in] *buf:符号化したダンプ
+ * @param[in] len:符号化したダンプのサイズ
+ * @param[out] **p_dump:元のダンプ(呼び出し側で解放する)
+ * @param[out] *p_len:元のダンプのサイズ
+ * @param[in] *name:ファイル名(エラー表示用)
+ * @return 0:正常終了,1:データの不正
+ */
+static int decode_encoded(const unsigned char *buf, size_t len, unsigned char **p_dump, size_t *p_len, const char *name)
+{
+	unsigned long flags, count, seq, drops, raw_size, size, i;
+	unsigned long time = 0, tskid = 0, event, val;
+	unsigned long prev_arg[LOG_ENCODE_EVENT_TYPES][2];
+	unsigned long *arg;
+	const unsigned char *raw;
+	unsigned char *work = NULL, *dump, *rec;
+	size_t pos = 0;
+	unsigned int tag;
+
+	if (len < LOG_ENCODE_HEADER_SIZE) {
+		fprintf(stderr, "%s: truncated header\n", name);
+		return 1;
+	}
+	flags = get_le32(buf + 4);
+	count = get_le32(buf + 8);
+	seq = get_le32(buf + 12);
+	drops = get_le32(buf + 16);
+	raw_size = get_le32(buf + 20);
+	size = get_le32(buf + 24);
+	if (len < LOG_ENCODE_HEADER_SIZE + size || count > LOG_DUMP_MAX / LOG_EVENT_SIZE) {
+		fprintf(stderr, "%s: truncated (%lu bytes expected)\n", name, size);
+		return 1;
+	}
+	printf("# encoded=%lu bytes%s raw=%lu bytes\n", (unsigned long)len, (flags & LOG_ENCODE_LZ) ? " lz" : " delta",
+				 LOG_RING_HEADER_SIZE + count * LOG_EVENT_SIZE);
+
+	/* 後方参照の展開 */
+	raw = buf + LOG_ENCODE_HEADER_SIZE;
+	if (flags & LOG_ENCODE_LZ) {
+		work = malloc(raw_size ? raw_size : 1);
+		if (expand_lz(raw, size, work, raw_size) != 0) {
+			fprintf(stderr, "%s: broken back-reference\n", name);
+			free(work);
+			return 1;
+		}
+		raw = work;
+	}
+	else {
+		raw_size = size;
+	}
+
+	/* 元のダンプのヘッダ */
+	*p_len = LOG_RING_HEADER_SIZE + count * LOG_EVENT_SIZE;
+	dump = calloc(1, *p_len);
+	put_le32(dump, LOG_RING_MAGIC);
+	put_le32(dump + 4, LOG_EVENT_SIZE);
+	put_le32(dump + 8, count);
+	put_le32(dump + 16, count);
+	put_le32(dump + 20, seq);
+	put_le32(dump + 24, drops);
+
+	/* 差分とvarintの復元 */
+	memset(prev_arg, 0, sizeof(prev_arg));
+	for (i = 0; i < count; i++) {
+		if (pos >= raw_size) {
+			break;
+		}
+		tag = raw[pos++];
+		event = tag & LOG_ENCODE_TAG_EVENT;
+		if (get_varint(raw, raw_size, &pos, &val) != 0 ||
+				(event == LOG_ENCODE_TAG_EVENT && get_varint(raw, raw_size, &pos, &event) != 0)) {
+			break;
+		}
+		time = (time + val) & 0xFFFFFFFFUL;
+		arg = prev_arg[(event < LOG_ENCODE_EVENT_TYPES) ? event : 0];
+		if (!(tag & LOG_ENCODE_TAG_SAME_TSKID)) {
+			if (get_varint(raw, raw_size, &pos, &val) != 0) {
+				break;
+			}
+			tskid = unzigzag(tskid, val);
+		}
+		if (!(tag & LOG_ENCODE_TAG_SAME_ARG0)) {
+			if (get_varint(raw, raw_size, &pos, &val) != 0) {
+				break;
+			}
+			arg[0] = unzigzag(arg[0], val);
+		}
+		if (!(tag & LOG_ENCODE_TAG_SAME_ARG1)) {
+			if (get_varint(raw, raw_size, &pos, &val) != 0) {
+				break;
+			}
+			arg[1] = unzigzag(arg[1], val);
+		}
+
+		rec = dump + LOG_RING_HEADER_SIZE + i * LOG_EVENT_SIZE;
+		put_le32(rec, time);
+		rec[4] = (unsigned char)event;
+		rec[5] = (unsigned char)(event >> 8);
+		rec[6] = (unsigned char)tskid;
+		rec[7] = (unsigned char)(tskid >> 8);
+		put_le32(rec + 8, arg[0]);
+		put_le32(rec + 12, arg[1]);
+	}
+	free(work);
+
+	if (i < count) {
+		fprintf(stderr, "%s: broken record %lu\n", name, i);
+		*p_len = LOG_RING_HEADER_SIZE + i * LOG_EVENT_SIZE; /* 復元できた所までを表にする */
+	}
+	*p_dump = dump;
+
+	return 0;
+}
+
+
+/*!
+ * @brief CRC-16の計算(生成多項式0x1021，MSBファースト，初期値0．net/crc16.cと同じ)
+ * @param[in] *p:計算するデータ
+ * @param[in] len:データ長
+ * @return CRC-16
+ */
+static unsigned int crc16(const unsigned char *p, size_t len)
+{
+	unsigned int crc = 0;
+	int i;
+
+	while (len--) {
+		crc ^= (unsigned int)*p++ << 8;
+		for (i = 0; i < 8; i++) {
+			crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+		}
+		crc &= 0xFFFF;
+	}
+
+	return crc;
+}
+
+
+/*!
+ * @brief イベントを1行で表示
+ * @param[in] seq:イベントの通し番号
+ * @param[in] cycles:最初のイベントからのサイクル数(一周を補正済み)
+ * @param[in] delta:前のイベントからのサイクル数
+ * @param[in] mhz:CPUクロック(MHz，0の場合はサイクル数で表示)
+ * @param[in] *rec:イベントのレコード
+ * @return なし
+ */
+static void print_event(unsigned long seq, unsigned long long cycles, unsigned long delta,
+												unsigned int mhz, const unsigned char *rec)
+{
+	unsigned int event = get_le16(rec + 4);
+	unsigned int tskid = get_le16(rec + 6);
+	unsigned long arg0 = get_le32(rec + 8);
+	unsigned long arg1 = get_le32(rec + 12);
+	const char *name;
+
+	name = (event < sizeof(sg_event_name) / sizeof(sg_event_name[0])) ? sg_event_name[event] : "?";
+
+	if (mhz) {
+		printf("%8lu %14.3fus %12.3fus ", seq, (double)cycles / mhz, (double)delta / mhz);
+	}
+	else {
+		printf("%8lu %16llu %12lu ", seq, cycles, delta);
+	}
+	printf("%-14s tsk=%-3u arg0=0x%08lx arg1=0x%08lx\n", name, tskid, arg0, arg1);
+}
+
+
+/*!
+ * @brief 表の見出しを表示
+ * @param[in] mhz:CPUクロック(MHz，0の場合はサイクル数で表示)
+ * @return なし
+ */
+static void print_title(unsigned int mhz)
+{
+	printf("#    seq %16s %13s event\n", mhz ? "time" : "cycles", "delta");
+}
+
+
+/*!
+ * @brief sendlogのダンプを表にする
+ * @param[in] *buf:ダンプ
+ * @param[in] len:ダンプのサイズ
+ * @param[in] mhz:CPUクロック(MHz，0の場合はサイクル数で表示)
+ * @param[in] *name:ファイル名(エラー表示用)
+ * @return 終了値(0:正常終了,1:ダンプではない)
+ */
+static int decode_dump(const unsigned char *buf, size_t len, unsigned int mhz, const char *name)
+{
+	unsigned long record_size, count, seq, drops, i;
+	unsigned long prev = 0, delta;
+	unsigned long long cycles = 0;
+
+	/* ヘッダの検査 */
+	if (len < LOG_RING_HEADER_SIZE || get_le32(buf) != LOG_RING_MAGIC) {
+		fprintf(stderr, "%s: not a trace dump\n", name);
+		return 1;
+	}
+	record_size = get_le32(buf + 4);
+	count = get_le32(buf + 16);
+	seq = get_le32(buf + 20);
+	drops = get_le32(buf + 24);
+	if (record_size != LOG_EVENT_SIZE) {
+		fprintf(stderr, "%s: unsupported record size %lu\n", name, record_size);
+		return 1;
+	}
+	if (len < LOG_RING_HEADER_SIZE + count * record_size) {
+		fprintf(stderr, "%s: truncated (%lu records expected)\n", name, count);
+		count = (len - LOG_RING_HEADER_SIZE) / record_size;
+	}
+
+	printf("# records=%lu first_seq=%lu drops=%lu\n", count, seq - count, drops);
+	print_title(mhz);
+
+	/* サイクルカウンタは32bitで一周するので，差分を積算する(イベント間隔は一周未満とみなす) */
+	for (i = 0; i < count; i++) {
+		const unsigned char *rec = buf + LOG_RING_HEADER_SIZE + i * record_size;
+		unsigned long time = get_le32(rec);
+
+		delta = (i == 0) ? 0 : ((time - prev) & 0xFFFFFFFFUL);
+		cycles += delta;
+		prev = time;
+		print_event(seq - count + i, cycles, delta, mhz, rec);
+	}
+
+	return 0;
+}
+
+
+/*!
+ * @brief drainコマンドのパケットのキャプチャを表にする
+ * @param[in] *buf:キャプチャ
+ * @param[in] len:キャプチャのサイズ
+ * @param[in] mhz:CPUクロック(MHz，0の場合はサイクル数で表示)
+ * @return 終了値(0:正常終了)
+ * @note ・通し番号が飛んだ所(吸い出しが追いつかずに上書きされた)とdropsの増加は注釈行で示す
+ * 			 ・通し番号が飛んだ所は時刻の連続性が失われるので，差分を0として積算し直す
+ */
+static int decode_stream(const unsigned char *buf, size_t len, unsigned int mhz)
+{
+	size_t pos = 0, size;
+	unsigned long count, seq, drops, i;
+	unsigned long next_seq = 0, last_drops = 0, prev = 0, delta;
+	unsigned long packets = 0, bad = 0;
+	unsigned long long cycles = 0;
+	int first = 1;
+
+	print_title(mhz);
+
+	while (pos + LOG_DRAIN_HEADER_SIZE + LOG_DRAIN_CRC_SIZE <= len) {
+		const unsigned char *p = buf + pos;
+
+		/* 同期バイトを探す */
+		if (p[0] != LOG_DRAIN_SYNC0 || p[1] != LOG_DRAIN_SYNC1 || p[2] != LOG_DRAIN_TYPE_EVENT || p[3] == 0) {
+			pos++;
+			continue;
+		}
+		count = p[3];
+		size = LOG_DRAIN_HEADER_SIZE + count * LOG_EVENT_SIZE;
+		if (pos + size + LOG_DRAIN_CRC_SIZE > len) {
+			break;
+		}
+		/* CRC-16の不一致(同期バイトに見えたデータかパケットの破損) */
+		if (crc16(p, size) != get_le16(p + size)) {
+			bad++;
+			pos++;
+			continue;
+		}
+		seq = get_le32(p + 4);
+		drops = get_le32(p + 8);
+
+		if (!first && seq != next_seq) {
+			printf("# lost %lu events (seq %lu-%lu)\n", (seq - next_seq) & 0xFFFFFFFFUL, next_seq, seq - 1);
+		}
+		if (!first && drops != last_drops) {
+			printf("# ring dropped %lu records\n", (drops - last_drops) & 0xFFFFFFFFUL);
+		}
+
+		/* サイクルカウンタは32bitで一周するので，差分を積算する(イベント間隔は一周未満とみなす) */
+		for (i = 0; i < count; i++) {
+			const unsigned char *rec = p + LOG_DRAIN_HEADER_SIZE + i * LOG_EVENT_SIZE;
+			unsigned long time = get_le32(rec);
+
+			delta = (first || (i == 0 && seq != next_seq)) ? 0 : ((time - prev) & 0xFFFFFFFFUL);
+			cycles += delta;
+			prev = time;
+			first = 0;
+			print_event(seq + i, cycles, delta, mhz, rec);
+		}
+
+		next_seq = (seq + count) & 0xFFFFFFFFUL;
+		last_drops = drops;
+		packets++;
+		pos += size + LOG_DRAIN_CRC_SIZE;
+	}
+
+	printf("# packets=%lu crc_errors=%lu\n", packets, bad);
+
+	return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+	FILE *fp;
+	unsigned char *buf;
+	size_t len;
+	unsigned int mhz = 0;
+	int stream = 0;
+	int argi = 1;
+	int ret;
+
+	while (argi < argc && argv[argi][0] == '-') {
+		if (!strcmp(argv[argi], "-m") && argi + 1 < argc) {
+			mhz = (unsigned int)atoi(argv[argi + 1]);
+			argi += 2;
+		}
+		else if (!strcmp(argv[argi], "-s")) {
+			stream = 1;
+			argi++;
+		}
+		else {
+			break;
+		}
+	}
+	if (argi >= argc) {
+		fprintf(stderr, "usage: %s [-m MHz] [-s] dumpfile\n", argv[0]);
+		return 1;
+	}
+	if ((fp = fopen(argv[argi], "rb")) == NULL) {
+		perror(argv[argi]);
+		return 1;
+	}
+	buf = malloc(LOG_DUMP_MAX);
+	len = fread(buf, 1, LOG_DUMP_MAX, fp);
+	fclose(fp);
+
+	if (stream) {
+		ret = decode_stream(buf, len, mhz);
+	}
+	/* 符号化したダンプ */
+	else if (len >= 4 && get_le32(buf) == LOG_ENCODE_MAGIC) {
+		unsigned char *dump;
+		size_t dump_len;
+
+		ret = decode_encoded(buf, len, &dump, &dump_len, argv[argi]);
+		if (ret == 0) {
+			ret = decode_dump(dump, dump_len, mhz, argv[argi]);
+			free(dump);
+		}
+	}
+	else {
+		ret = decode_dump(buf, len, mhz, argv[argi]);
+	}
+
+	free(buf);
+
+	return ret;
+}
@@ -0,0 +1,375 @@
+/*!
+ * @file ホストツール
+ * @brief タイムアウトあり起床待ち(tslp_tsk())の検証
+ * @attention ホスト(PC)のgccでビルドする(make test)
+ * @note ・kernel/task_sync.cをビルドし，レディーキュー，差分のキュー(ソフトタイマ)，ログを模擬して
+ * 				 tslp_tsk_isr()，wup_tsk_isr()，rel_wai_isr()とタイムアウトの競合を検証する
+ * 			 ・タイマの満了は模擬タイマに記録したコールバックルーチンを呼んで再現する
+ * 			 ・c_lib/lib.hとstdio.hは宣言が衝突するので，printf()のみを宣言して使用する
+ *
+ * 使い方 : tslp_tsk_test(失敗した検証があれば1で終了する)
+ */
+
+
+/* os/kernel */
+#include "kernel/task_sync.h"
+#include "kernel/ready.h"
+#include "kernel/multi_timer.h"
+#include "kernel/mempool_manage.h"
+/* os/kernel_svc */
+#include "kernel_svc/log_manage.h"
+
+
+/*! 検証結果の出力(失敗数を数える) */
+#define CHECK(cond)							check((cond), #cond, __LINE__)
+
+
+extern int printf(const char *format, ...);
+
+
+/*! 実行状態タスク(kernel/kernel.cの代わり) */
+TCB *g_current;
+
+/*! 有効なトレースカテゴリ(kernel_svc/log_manage.cの代わり．トレースは出さない) */
+volatile UINT32 g_log_mask;
+
+/*! 模擬タイマ(差分のキューに1つだけ積まれる) */
+static struct {
+	TMRCB tmrcb;													/*! 返却したタイマコントロールブロック */
+	BOOL active;													/*! 差分のキューにつながれているか */
+	int creates;													/*! create_tmrcb_diffque()の呼び出し回数 */
+	int deletes;													/*! delete_tmrcb_diffque()の呼び出し回数 */
+	int stale_deletes;										/*! 満了済み(解放済み)のタイマを排除しようとした回数 */
+} sg_tmr;
+
+/*! 模擬レディーキューの呼び出し回数 */
+static struct {
+	int gets;															/*! getcurrent()の呼び出し回数 */
+	int puts;															/*! putcurrent()で実際にレディーへつないだ回数 */
+} sg_ready;
+
+/*! 検証するタスクと，実行状態の別タスク */
+static TCB sg_task, sg_other;
+
+/*! 検証するタスクのシステムコール返却値 */
+static ER sg_ret;
+
+/*! 失敗した検証の数 */
+static int sg_failures;
+
+
+/*!
+ * 検証結果の出力
+ * cond : 検証した条件
+ * *expr : 条件の式
+ * line : 行番号
+ */
+static void check(int cond, const char *expr, int line)
+{
+	if (!cond) {
+		printf("NG line %d : %s\n", line, expr);
+		sg_failures++;
+	}
+}
+
+
+/*!
+ * レディーから抜き取る(kernel/ready.cの代わり)
+ */
+ER getcurrent(void)
+{
+	if (!(g_current->state & TASK_READY)) {
+		return E_OBJ;
+	}
+	g_current->state &= ~TASK_READY;
+	sg_ready.gets++;
+
+	return E_OK;
+}
+
+
+/*!
+ * レディーへつなぐ(kernel/ready.cの代わり．既にレディーの場合はE_OBJ)
+ */
+ER putcurrent(void)
+{
+	if (g_current->state & TASK_READY) {
+		return E_OBJ;
+	}
+	g_current->state |= TASK_READY;
+	sg_ready.puts++;
+
+	return E_OK;
+}
+
+
+/*!
+ * 差分のキューのノードを作成(kernel/multi_timer.cの代わり)
+ */
+OBJP create_tmrcb_diffque(short flag, int request_sec, TMRRQ_OBJP rqobjp, TMR_CALLRTE func, void *argv)
+{
+	sg_tmr.tmrcb.flag = flag;
+	sg_tmr.tmrcb.usec = request_sec;
+	sg_tmr.tmrcb.rqobjp = rqobjp;
+	sg_tmr.tmrcb.func = func;
+	sg_tmr.tmrcb.argv = argv;
+	sg_tmr.active = TRUE;
+	sg_tmr.creates++;
+
+	return (OBJP)&sg_tmr.tmrcb;
+}
+
+
+/*!
+ * 差分のキューのノードを排除(kernel/multi_timer.cの代わり)
+ */
+void delete_tmrcb_diffque(TMRCB *deltbf)
+{
+	if (deltbf != &sg_tmr.tmrcb || !sg_tmr.active) {
+		sg_tmr.stale_deletes++;
+		return;
+	}
+	sg_tmr.active = FALSE;
+	sg_tmr.deletes++;
+}
+
+
+/*!
+ * 可変長メモリブロック獲得待ちキューから外す(kernel/mempool_manage.cの代わり．使用しない)
+ */
+void get_mpl_waitque(TCB *tcb)
+{
+	(void)tcb;
+}
+
+
+/*!
+ * トレースの記録(kernel_svc/log_manage.cの代わり．g_log_maskが0なので呼ばれない)
+ */
+void log_event(LOG_EVENT_ID event, UINT32 tskid, UINT32 arg0, UINT32 arg1)
+{
+	(void)event;
+	(void)tskid;
+	(void)arg0;
+	(void)arg1;
+}
+
+
+/*!
+ * タイマの満了(差分のキューの満了処理の代わり．満了したタイマは解放される)
+ */
+static void fire_timer(void)
+{
+	TCB *saved = g_current;
+
+	CHECK(sg_tmr.active);
+	if (!sg_tmr.active) {
+		return;
+	}
+	sg_tmr.active = FALSE;
+	(*sg_tmr.tmrcb.func)(sg_tmr.tmrcb.argv);
+	g_current = saved;
+}
+
+
+/*!
+ * 検証するタスクを実行状態とし，模擬の記録を初期化する
+ */
+static void reset(void)
+{
+	sg_task.init.tskid = 1;
+	sg_task.state = TASK_READY;
+	sg_task.wait_info.tobjp = 0;
+	sg_task.syscall_info.ret = (OBJP)&sg_ret;
+	sg_other.init.tskid = 2;
+	sg_other.state = TASK_READY;
+	sg_ret = E_OK;
+	sg_tmr.active = FALSE;
+	sg_tmr.creates = sg_tmr.deletes = sg_tmr.stale_deletes = 0;
+	sg_ready.gets = sg_ready.puts = 0;
+	g_current = &sg_task;
+}
+
+
+/*!
+ * 検証するタスクがtslp_tsk()を発行し，別タスクへ切り替わる(返却値は待ち解除まで書き換えられる)
+ */
+static ER sleep_task(int tmout)
+{
+	ER ercd;
+
+	g_current = &sg_task;
+	ercd = tslp_tsk_isr(tmout);
+	sg_ret = ercd;
+	g_current = &sg_other;
+
+	return ercd;
+}
+
+
+/*!
+ * パラメータとポーリング
+ */
+static void test_param(void)
+{
+	reset();
+	CHECK(sleep_task(TMO_FEVR - 1) == E_PAR);
+	CHECK(sleep_task(0x7fffffff / 1000 + 1) == E_PAR);
+	CHECK(sleep_task(TMO_POL) == E_TMOUT);
+	CHECK(sg_ready.gets == 0);
+	CHECK(sg_tmr.creates == 0);
+	CHECK(sg_task.state == TASK_READY);
+}
+
+
+/*!
+ * タイムアウトなしの起床待ちと起床
+ */
+static void test_forever(void)
+{
+	reset();
+	CHECK(sleep_task(TMO_FEVR) == E_OK);
+	CHECK(sg_ready.gets == 1);
+	CHECK(sg_tmr.creates == 0);
+	CHECK(!(sg_task.state & TASK_WAIT_TIME_SLEEP));
+
+	CHECK(wup_tsk_isr(&sg_task) == E_OK);
+	CHECK(sg_ready.puts == 1);
+	CHECK(sg_tmr.deletes == 0 && sg_tmr.stale_deletes == 0);
+	CHECK(sg_ret == E_OK);
+	CHECK(sg_task.state == TASK_READY);
+}
+
+
+/*!
+ * タイムアウト(満了後の起床と強制解除は対象タスクに触らない)
+ */
+static void test_timeout(void)
+{
+	reset();
+	CHECK(sleep_task(100) == E_OK);
+	CHECK(sg_tmr.creates == 1);
+	CHECK(sg_tmr.tmrcb.usec == 100 * 1000);
+	CHECK(sg_tmr.tmrcb.flag == OTHER_MAKE_TIMER);
+	CHECK(sg_task.wait_info.tobjp == (TMR_OBJP)&sg_tmr.tmrcb);
+	CHECK(sg_task.state & TASK_WAIT_TIME_SLEEP);
+
+	fire_timer();
+	CHECK(sg_ret == E_TMOUT);
+	CHECK(sg_task.wait_info.tobjp == 0);
+	CHECK(sg_task.state == TASK_READY);
+	CHECK(sg_ready.puts == 1);
+	CHECK(g_current == &sg_other);
+
+	/* 満了後に届いた起床要求(解放済みのタイマを排除しない，返却値を書き換えない) */
+	wup_tsk_isr(&sg_task);
+	CHECK(sg_tmr.stale_deletes == 0);
+	CHECK(sg_ready.puts == 1);
+	CHECK(sg_ret == E_TMOUT);
+
+	/* 満了後に届いた強制解除 */
+	CHECK(rel_wai_isr(&sg_task) == E_OBJ);
+	CHECK(sg_tmr.stale_deletes == 0);
+	CHECK(sg_ret == E_TMOUT);
+}
+
+
+/*!
+ * 満了前の起床(タイマを排除し，満了しない)
+ */
+static void test_wakeup(void)
+{
+	reset();
+	CHECK(sleep_task(50) == E_OK);
+
+	CHECK(wup_tsk_isr(&sg_task) == E_OK);
+	CHECK(sg_tmr.deletes == 1);
+	CHECK(!sg_tmr.active);
+	CHECK(sg_task.wait_info.tobjp == 0);
+	CHECK(!(sg_task.state & TASK_WAIT_TIME_SLEEP));
+	CHECK(sg_task.state == TASK_READY);
+	CHECK(sg_ret == E_OK);
+	CHECK(sg_ready.puts == 1);
+
+	/* 2回目の起床要求(既にレディー) */
+	wup_tsk_isr(&sg_task);
+	CHECK(sg_tmr.deletes == 1 && sg_tmr.stale_deletes == 0);
+	CHECK(sg_ready.puts == 1);
+
+	/* 実行状態のタスクは起床できない */
+	g_current = &sg_task;
+	CHECK(wup_tsk_isr(&sg_task) == E_ILUSE);
+}
+
+
+/*!
+ * 満了前の強制解除(E_RLWAIを返し，タイマを排除する)
+ */
+static void test_rel_wai(void)
+{
+	reset();
+	CHECK(sleep_task(50) == E_OK);
+
+	CHECK(rel_wai_isr(&sg_task) == E_OK);
+	CHECK(sg_ret == E_RLWAI);
+	CHECK(sg_tmr.deletes == 1);
+	CHECK(!sg_tmr.active);
+	CHECK(sg_task.wait_info.tobjp == 0);
+	CHECK(sg_task.state == TASK_READY);
+	CHECK(sg_ready.puts == 1);
+
+	/* 強制解除後の起床要求 */
+	wup_tsk_isr(&sg_task);
+	CHECK(sg_ret == E_RLWAI);
+	CHECK(sg_ready.puts == 1);
+	CHECK(sg_tmr.stale_deletes == 0);
+
+	/* タイムアウトなしの起床待ちの強制解除 */
+	reset();
+	CHECK(sleep_task(TMO_FEVR) == E_OK);
+	CHECK(rel_wai_isr(&sg_task) == E_OK);
+	CHECK(sg_ret == E_RLWAI);
+	CHECK(sg_tmr.deletes == 0 && sg_tmr.stale_deletes == 0);
+}
+
+
+/*!
+ * 起床待ちの繰り返し(前の待ちのタイマや状態が残らない)
+ */
+static void test_repeat(void)
+{
+	int i;
+
+	reset();
+	for (i = 0; i < 3; i++) {
+		CHECK(sleep_task(10) == E_OK);
+		fire_timer();
+		CHECK(sg_ret == E_TMOUT);
+		CHECK(sleep_task(10) == E_OK);
+		CHECK(wup_tsk_isr(&sg_task) == E_OK);
+		CHECK(sg_ret == E_OK);
+	}
+	CHECK(sg_tmr.creates == 6);
+	CHECK(sg_tmr.deletes == 3 && sg_tmr.stale_deletes == 0);
+	CHECK(sg_task.state == TASK_READY);
+	CHECK(sg_task.wait_info.tobjp == 0);
+}
+
+
+int main(void)
+{
+	test_param();
+	test_forever();
+	test_timeout();
+	test_wakeup();
+	test_rel_wai();
+	test_repeat();
+
+	if (sg_failures != 0) {
+		printf("tslp_tsk_test : %d failed\n", sg_failures);
+		return 1;
+	}
+	printf("tslp_tsk_test : OK\n");
+
+	return 0;
+}